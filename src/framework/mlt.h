@@ -59,6 +59,9 @@ extern "C"
 #include "mlt_cache.h"
 #include "mlt_version.h"
 #include "mlt_slices.h"
+#include "mlt_peaks.h"
+#include "mlt_audio_ring.h"
+#include "mlt_image.h"
 
 #ifdef __cplusplus
 }
@@ -52,8 +52,11 @@ struct mlt_animation_s
 	double fps;           /**< framerate to use when converting time clock strings to frame units */
 	locale_t locale;      /**< pointer to a locale to use when converting strings to numeric values */
 	animation_node nodes; /**< a linked list of keyframes (and possibly non-keyframe values) */
+	int changes;          /**< the number of edits made through the keyframe functions */
 };
 
+static int animation_insert( mlt_animation self, mlt_animation_item item );
+
 /** Create a new animation object.
  *
  * \public \memberof mlt_animation_s
@@ -232,7 +235,7 @@ int mlt_animation_parse(mlt_animation self, const char *data, int length, double
 		}
 
 		// Now insert into place
-		mlt_animation_insert( self, &item );
+		animation_insert( self, &item );
 	}
 	mlt_animation_interpolate( self );
 
@@ -454,19 +457,16 @@ int mlt_animation_get_item( mlt_animation self, mlt_animation_item item, int pos
 	return error;
 }
 
-/** Insert an animation item.
+/** Insert an animation item without counting it as an edit.
  *
- * \public \memberof mlt_animation_s
+ * \private \memberof mlt_animation_s
  * \param self an animation
  * \param item an animation item
  * \return true if there was an error
- * \see mlt_animation_parse_item
  */
 
-int mlt_animation_insert( mlt_animation self, mlt_animation_item item )
+static int animation_insert( mlt_animation self, mlt_animation_item item )
 {
-	if (!self || !item) return 1;
-
 	int error = 0;
 	animation_node node = calloc( 1, sizeof( *node ) );
 	node->item.frame = item->frame;
@@ -523,6 +523,23 @@ int mlt_animation_insert( mlt_animation self, mlt_animation_item item )
 	return error;
 }
 
+/** Insert an animation item.
+ *
+ * \public \memberof mlt_animation_s
+ * \param self an animation
+ * \param item an animation item
+ * \return true if there was an error
+ * \see mlt_animation_parse_item
+ */
+
+int mlt_animation_insert( mlt_animation self, mlt_animation_item item )
+{
+	if (!self || !item) return 1;
+
+	self->changes ++;
+	return animation_insert( self, item );
+}
+
 /** Remove the keyframe at the specified position.
  *
  * \public \memberof mlt_animation_s
@@ -542,7 +559,10 @@ int mlt_animation_remove( mlt_animation self, int position )
 		node = node->next;
 
 	if ( node && position == node->item.frame )
+	{
 		error = mlt_animation_drop( self, node );
+		self->changes ++;
+	}
 
 	return error;
 }
@@ -896,6 +916,7 @@ int mlt_animation_key_set_type(mlt_animation self, int index, mlt_keyframe_type
 
 	if ( node ) {
 		node->item.keyframe_type = type;
+		self->changes ++;
 		mlt_animation_interpolate(self);
 	} else {
 		error = 1;
@@ -927,6 +948,7 @@ int mlt_animation_key_set_frame(mlt_animation self, int index, int frame)
 
 	if ( node ) {
 		node->item.frame = frame;
+		self->changes ++;
 		mlt_animation_interpolate(self);
 	} else {
 		error = 1;
@@ -934,3 +956,18 @@ int mlt_animation_key_set_frame(mlt_animation self, int index, int frame)
 
 	return error;
 }
+
+/** Get the number of edits made to the keyframes.
+ *
+ * This counts the insertions, removals, and keyframe changes made with the
+ * functions of this interface, but not parsing, so that a properties list can
+ * tell when an animation it handed out was edited.
+ * \public \memberof mlt_animation_s
+ * \param self an animation
+ * \return the number of edits or 0 if \p self is NULL
+ */
+
+int mlt_animation_changes( mlt_animation self )
+{
+	return self ? self->changes : 0;
+}
@@ -69,6 +69,7 @@ extern int mlt_animation_key_get( mlt_animation self, mlt_animation_item item, i
 extern void mlt_animation_close( mlt_animation self );
 extern int mlt_animation_key_set_type( mlt_animation self, int index, mlt_keyframe_type type );
 extern int mlt_animation_key_set_frame( mlt_animation self, int index, int frame );
+extern int mlt_animation_changes( mlt_animation self );
 
 #endif
 
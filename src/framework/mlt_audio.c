@@ -501,6 +501,26 @@ const char * mlt_audio_format_name( mlt_audio_format format )
 	return "invalid";
 }
 
+/** Get the id of audio format from short name.
+ *
+ * \public \memberof mlt_frame_s
+ * \param name the audio format short name
+ * \return an audio format or mlt_audio_none if the name is not known
+ */
+
+mlt_audio_format mlt_audio_format_id( const char * name )
+{
+	mlt_audio_format f;
+
+	for( f = mlt_audio_s16; name && f <= mlt_audio_u8; f++ )
+	{
+		if( !strcmp( mlt_audio_format_name( f ), name ) )
+			return f;
+	}
+
+	return mlt_audio_none;
+}
+
 /** Get the amount of bytes needed for a block of audio.
   *
   * \public \memberof mlt_frame_s
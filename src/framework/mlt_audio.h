@@ -57,6 +57,7 @@ extern void mlt_audio_copy( mlt_audio dst, mlt_audio src, int samples, int src_s
 extern int mlt_audio_calculate_frame_samples( float fps, int frequency, int64_t position );
 extern int64_t mlt_audio_calculate_samples_to_position( float fps, int frequency, int64_t position );
 extern const char * mlt_audio_format_name( mlt_audio_format format );
+extern mlt_audio_format mlt_audio_format_id( const char * name );
 extern int mlt_audio_format_size( mlt_audio_format format, int samples, int channels );
 extern const char * mlt_audio_channel_layout_name( mlt_channel_layout layout );
 extern mlt_channel_layout mlt_audio_channel_layout_id( const char * name );
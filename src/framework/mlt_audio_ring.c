@@ -0,0 +1,380 @@
+/**
+ * \file mlt_audio_ring.c
+ * \brief lock-free audio ring buffer between a render thread and an audio device
+ * \see mlt_audio_ring_s
+ *
+ * Copyright (C) 2019 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "mlt_audio_ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+
+/** The size that keeps the indices of the two sides out of each other's cache line. */
+#define RING_CACHE_LINE (64)
+
+/** \brief Audio ring class
+ *
+ * A ring passes interleaved samples from exactly one writer, normally the
+ * thread that renders frames, to exactly one reader, normally the callback of
+ * an audio device. Neither side takes a lock, so the device callback never
+ * waits for the render thread. Each side only stores its own count and the
+ * counts live on separate cache lines.
+ *
+ * The counts run from 0 to twice the capacity so a full ring can be told
+ * apart from an empty one without giving up a slot.
+ */
+
+struct mlt_audio_ring_s
+{
+	uint8_t *data;
+	int sample_size;                /**< bytes per sample of all channels */
+	unsigned int capacity;          /**< the number of samples the ring holds */
+	char pad0[RING_CACHE_LINE];
+	atomic_uint write_count;        /**< position of the writer, stored by the writer only */
+	atomic_uint flush_count;        /**< position up to which the reader must discard */
+	atomic_int flush;               /**< set by the writer when flush_count is new */
+	char pad1[RING_CACHE_LINE];
+	atomic_uint read_count;         /**< position of the reader, stored by the reader only */
+	atomic_uint underruns;          /**< the number of reads that came up short */
+	char pad2[RING_CACHE_LINE];
+};
+
+/** Get the distance from one count to another.
+ */
+
+static inline unsigned int ring_distance( mlt_audio_ring self, unsigned int to, unsigned int from )
+{
+	return to >= from ? to - from : to + 2 * self->capacity - from;
+}
+
+/** Move a count forward.
+ */
+
+static inline unsigned int ring_advance( mlt_audio_ring self, unsigned int count, unsigned int samples )
+{
+	count += samples;
+	return count >= 2 * self->capacity ? count - 2 * self->capacity : count;
+}
+
+/** Get the address of the sample at a count.
+ */
+
+static inline uint8_t *ring_address( mlt_audio_ring self, unsigned int count )
+{
+	return self->data + ( count >= self->capacity ? count - self->capacity : count ) * self->sample_size;
+}
+
+/** Create a ring.
+ *
+ * \public \memberof mlt_audio_ring_s
+ * \param sample_size the number of bytes in one sample of all channels
+ * \param capacity the maximum number of samples the ring holds
+ * \return a new ring or NULL on error
+ */
+
+mlt_audio_ring mlt_audio_ring_new( int sample_size, int capacity )
+{
+	mlt_audio_ring self = NULL;
+	if ( sample_size > 0 && capacity > 0 && capacity < ( 1 << 30 ) )
+	{
+		self = calloc( 1, sizeof( struct mlt_audio_ring_s ) );
+		if ( self )
+		{
+			self->data = calloc( capacity, sample_size );
+			self->sample_size = sample_size;
+			self->capacity = capacity;
+			atomic_init( &self->write_count, 0 );
+			atomic_init( &self->flush_count, 0 );
+			atomic_init( &self->flush, 0 );
+			atomic_init( &self->read_count, 0 );
+			atomic_init( &self->underruns, 0 );
+			if ( !self->data )
+			{
+				free( self );
+				self = NULL;
+			}
+		}
+	}
+	return self;
+}
+
+/** Get the number of samples the ring holds when it is full.
+ *
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ * \return the capacity in samples
+ */
+
+int mlt_audio_ring_capacity( mlt_audio_ring self )
+{
+	return self->capacity;
+}
+
+/** Get the number of samples that can be written without overwriting unread samples.
+ *
+ * This is for the writer.
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ * \return the free space in samples
+ */
+
+int mlt_audio_ring_space( mlt_audio_ring self )
+{
+	unsigned int read = atomic_load_explicit( &self->read_count, memory_order_acquire );
+	unsigned int write = atomic_load_explicit( &self->write_count, memory_order_relaxed );
+	return self->capacity - ring_distance( self, write, read );
+}
+
+/** Wait for space in the ring.
+ *
+ * The writer polls rather than waiting on a condition so that the reader
+ * never has to signal it.
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ * \param samples the number of samples wanted, limited to the capacity
+ * \param timeout the maximum time to wait in milliseconds
+ * \return the free space in samples, which is less than \p samples on time out
+ */
+
+int mlt_audio_ring_wait_space( mlt_audio_ring self, int samples, int timeout )
+{
+	struct timespec tm = { 0, 1000000 };
+	int space = mlt_audio_ring_space( self );
+
+	if ( samples > (int) self->capacity )
+		samples = self->capacity;
+	while ( space < samples && timeout-- > 0 )
+	{
+		nanosleep( &tm, NULL );
+		space = mlt_audio_ring_space( self );
+	}
+	return space;
+}
+
+/** Get the contiguous free space at the position of the writer.
+ *
+ * This lets the writer fill the ring in place. Call mlt_audio_ring_write_end()
+ * with the number of samples actually stored. The space may be less than the
+ * total free space when it wraps at the end of the ring.
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ * \param[in,out] samples the number of samples wanted; set to the number available
+ * \return the address of the first free sample
+ */
+
+void *mlt_audio_ring_write_begin( mlt_audio_ring self, int *samples )
+{
+	unsigned int write = atomic_load_explicit( &self->write_count, memory_order_relaxed );
+	unsigned int contiguous = self->capacity - ( write >= self->capacity ? write - self->capacity : write );
+	int space = mlt_audio_ring_space( self );
+
+	if ( *samples > space )
+		*samples = space;
+	if ( *samples > (int) contiguous )
+		*samples = contiguous;
+	return ring_address( self, write );
+}
+
+/** Publish samples stored after mlt_audio_ring_write_begin().
+ *
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ * \param samples the number of samples stored
+ */
+
+void mlt_audio_ring_write_end( mlt_audio_ring self, int samples )
+{
+	unsigned int write = atomic_load_explicit( &self->write_count, memory_order_relaxed );
+	atomic_store_explicit( &self->write_count, ring_advance( self, write, samples ), memory_order_release );
+}
+
+/** Write samples into the ring.
+ *
+ * This does not wait for space.
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ * \param data the interleaved samples or NULL to write silence
+ * \param samples the number of samples
+ * \return the number of samples written
+ */
+
+int mlt_audio_ring_write( mlt_audio_ring self, const void *data, int samples )
+{
+	int written = 0;
+	while ( written < samples )
+	{
+		int count = samples - written;
+		void *dest = mlt_audio_ring_write_begin( self, &count );
+		if ( count <= 0 )
+			break;
+		if ( data )
+			memcpy( dest, (const uint8_t*) data + written * self->sample_size, count * self->sample_size );
+		else
+			memset( dest, 0, count * self->sample_size );
+		mlt_audio_ring_write_end( self, count );
+		written += count;
+	}
+	return written;
+}
+
+/** Discard the samples that have not been read yet.
+ *
+ * This is for the writer. The reader drops the samples on its next read;
+ * samples written after the flush are kept.
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ */
+
+void mlt_audio_ring_flush( mlt_audio_ring self )
+{
+	unsigned int write = atomic_load_explicit( &self->write_count, memory_order_relaxed );
+	atomic_store_explicit( &self->flush_count, write, memory_order_release );
+	atomic_store_explicit( &self->flush, 1, memory_order_release );
+}
+
+/** Apply a pending flush on the side of the reader.
+ */
+
+static void ring_apply_flush( mlt_audio_ring self )
+{
+	if ( atomic_load_explicit( &self->flush, memory_order_relaxed ) &&
+		 atomic_exchange_explicit( &self->flush, 0, memory_order_acquire ) )
+	{
+		unsigned int flush = atomic_load_explicit( &self->flush_count, memory_order_acquire );
+		unsigned int write = atomic_load_explicit( &self->write_count, memory_order_acquire );
+		unsigned int read = atomic_load_explicit( &self->read_count, memory_order_relaxed );
+		if ( ring_distance( self, flush, read ) <= ring_distance( self, write, read ) )
+			atomic_store_explicit( &self->read_count, flush, memory_order_release );
+	}
+}
+
+/** Get the number of samples waiting to be read.
+ *
+ * Either side may call this; divided by the frequency it is the latency the
+ * ring adds to playback.
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ * \return the number of samples
+ */
+
+int mlt_audio_ring_available( mlt_audio_ring self )
+{
+	unsigned int write = atomic_load_explicit( &self->write_count, memory_order_acquire );
+	unsigned int read = atomic_load_explicit( &self->read_count, memory_order_acquire );
+	return ring_distance( self, write, read );
+}
+
+/** Get the contiguous samples at the position of the reader.
+ *
+ * Call mlt_audio_ring_read_end() with the number of samples consumed.
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ * \param[in,out] samples the number of samples wanted; set to the number available
+ * \return the address of the first sample
+ */
+
+const void *mlt_audio_ring_read_begin( mlt_audio_ring self, int *samples )
+{
+	ring_apply_flush( self );
+
+	unsigned int read = atomic_load_explicit( &self->read_count, memory_order_relaxed );
+	unsigned int contiguous = self->capacity - ( read >= self->capacity ? read - self->capacity : read );
+	int available = ring_distance( self, atomic_load_explicit( &self->write_count, memory_order_acquire ), read );
+
+	if ( *samples > available )
+		*samples = available;
+	if ( *samples > (int) contiguous )
+		*samples = contiguous;
+	return ring_address( self, read );
+}
+
+/** Release samples consumed after mlt_audio_ring_read_begin().
+ *
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ * \param samples the number of samples consumed
+ */
+
+void mlt_audio_ring_read_end( mlt_audio_ring self, int samples )
+{
+	unsigned int read = atomic_load_explicit( &self->read_count, memory_order_relaxed );
+	atomic_store_explicit( &self->read_count, ring_advance( self, read, samples ), memory_order_release );
+}
+
+/** Read samples from the ring.
+ *
+ * This never waits. When fewer samples are available than requested, the
+ * rest of \p data is filled with silence and the read counts as an underrun.
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ * \param data the buffer that receives the interleaved samples
+ * \param samples the number of samples wanted
+ * \return the number of samples read
+ */
+
+int mlt_audio_ring_read( mlt_audio_ring self, void *data, int samples )
+{
+	int done = 0;
+	while ( done < samples )
+	{
+		int count = samples - done;
+		const void *src = mlt_audio_ring_read_begin( self, &count );
+		if ( count <= 0 )
+			break;
+		memcpy( (uint8_t*) data + done * self->sample_size, src, count * self->sample_size );
+		mlt_audio_ring_read_end( self, count );
+		done += count;
+	}
+	if ( done < samples )
+	{
+		memset( (uint8_t*) data + done * self->sample_size, 0, ( samples - done ) * self->sample_size );
+		atomic_fetch_add_explicit( &self->underruns, 1, memory_order_relaxed );
+	}
+	return done;
+}
+
+/** Get the number of reads that found too few samples.
+ *
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ * \return the number of underruns since the ring was created
+ */
+
+int64_t mlt_audio_ring_underruns( mlt_audio_ring self )
+{
+	return atomic_load_explicit( &self->underruns, memory_order_relaxed );
+}
+
+/** Destroy a ring.
+ *
+ * Neither side may use the ring any more.
+ * \public \memberof mlt_audio_ring_s
+ * \param self a ring
+ */
+
+void mlt_audio_ring_close( mlt_audio_ring self )
+{
+	if ( self )
+	{
+		free( self->data );
+		free( self );
+	}
+}
@@ -0,0 +1,54 @@
+/**
+ * \file mlt_audio_ring.h
+ * \brief lock-free audio ring buffer between a render thread and an audio device
+ * \see mlt_audio_ring_s
+ *
+ * Copyright (C) 2019 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef MLT_AUDIO_RING_H
+#define MLT_AUDIO_RING_H
+
+#include "mlt_types.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct mlt_audio_ring_s *mlt_audio_ring;
+
+extern mlt_audio_ring mlt_audio_ring_new( int sample_size, int capacity );
+extern int mlt_audio_ring_capacity( mlt_audio_ring self );
+extern int mlt_audio_ring_space( mlt_audio_ring self );
+extern int mlt_audio_ring_wait_space( mlt_audio_ring self, int samples, int timeout );
+extern int mlt_audio_ring_write( mlt_audio_ring self, const void *data, int samples );
+extern void *mlt_audio_ring_write_begin( mlt_audio_ring self, int *samples );
+extern void mlt_audio_ring_write_end( mlt_audio_ring self, int samples );
+extern void mlt_audio_ring_flush( mlt_audio_ring self );
+extern int mlt_audio_ring_available( mlt_audio_ring self );
+extern int mlt_audio_ring_read( mlt_audio_ring self, void *data, int samples );
+extern const void *mlt_audio_ring_read_begin( mlt_audio_ring self, int *samples );
+extern void mlt_audio_ring_read_end( mlt_audio_ring self, int samples );
+extern int64_t mlt_audio_ring_underruns( mlt_audio_ring self );
+extern void mlt_audio_ring_close( mlt_audio_ring self );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -378,9 +378,14 @@ static void on_consumer_frame_show( mlt_properties owner, mlt_consumer consumer,
 {
 	if ( frame ) {
 		consumer_private* priv = consumer->local;
+		int conversions = mlt_properties_get_int( MLT_FRAME_PROPERTIES( frame ), "audio_conversions" );
 		pthread_mutex_lock( &priv->position_mutex );
 		priv->position = mlt_frame_get_position( frame );
 		pthread_mutex_unlock( &priv->position_mutex );
+
+		// Keep a running count of audio format conversions to expose format thrash
+		if ( conversions > 0 )
+			mlt_properties_set_int( owner, "audio_conversions", mlt_properties_get_int( owner, "audio_conversions" ) + conversions );
 	}
 }
 
@@ -478,6 +483,11 @@ static void set_audio_format( mlt_consumer self )
 		else if ( !strcmp( format, "u8" ) )
 			priv->audio_format = mlt_audio_u8;
 	}
+	else if ( mlt_audio_format_id( mlt_properties_get( properties, "mlt_audio_native_format" ) ) != mlt_audio_none )
+	{
+		// Render in the native format unless told otherwise
+		priv->audio_format = mlt_audio_format_id( mlt_properties_get( properties, "mlt_audio_native_format" ) );
+	}
 }
 
 /** Set the image format to use in render threads.
@@ -716,8 +726,10 @@ mlt_frame mlt_consumer_get_frame( mlt_consumer self )
 		// Get the test card producer
 		mlt_producer test_card = mlt_properties_get_data( properties, "test_card_producer", NULL );
 
-		// Attach the test frame producer to it.
-		if ( test_card != NULL )
+		// Attach the test frame producer to it unless the frame is only evaluated for audio.
+		if ( mlt_properties_get_int( properties, "audio_only" ) )
+			mlt_properties_set_int( frame_properties, "consumer_audio_only", 1 );
+		else if ( test_card != NULL )
 			mlt_properties_set_data( frame_properties, "test_card_producer", test_card, 0, NULL, NULL );
 
 		// Pass along the interpolation and deinterlace options
@@ -728,6 +740,9 @@ mlt_frame mlt_consumer_get_frame( mlt_consumer self )
 		mlt_properties_set_int( frame_properties, "consumer_tff", mlt_properties_get_int( properties, "top_field_first" ) );
 		mlt_properties_set( frame_properties, "consumer_color_trc", mlt_properties_get( properties, "color_trc" ) );
 		mlt_properties_set( frame_properties, "consumer_channel_layout", mlt_properties_get( properties, "channel_layout" ) );
+		if ( mlt_properties_get( properties, "mlt_audio_native_format" ) )
+			mlt_properties_set_int( frame_properties, "consumer_audio_format",
+				mlt_audio_format_id( mlt_properties_get( properties, "mlt_audio_native_format" ) ) );
 	}
 
 	// Return the frame
@@ -771,7 +786,8 @@ static void *consumer_read_ahead_thread( void *arg )
 	int height = mlt_properties_get_int( properties, "height" );
 
 	// See if video is turned off
-	int video_off = mlt_properties_get_int( properties, "video_off" );
+	int audio_only = mlt_properties_get_int( properties, "audio_only" );
+	int video_off = mlt_properties_get_int( properties, "video_off" ) || audio_only;
 	int preview_off = mlt_properties_get_int( properties, "preview_off" );
 	int preview_format = mlt_properties_get_int( properties, "preview_format" );
 
@@ -782,6 +798,10 @@ static void *consumer_read_ahead_thread( void *arg )
 	// See if audio is turned off
 	int audio_off = mlt_properties_get_int( properties, "audio_off" );
 
+	// When only audio is evaluated, the buffer is sized in samples
+	int audio_buffer = mlt_properties_get( properties, "audio_buffer" ) ?
+		mlt_properties_get_int( properties, "audio_buffer" ) : priv->frequency;
+
 	// General frame variable
 	mlt_frame frame = NULL;
 	uint8_t *image = NULL;
@@ -824,7 +844,7 @@ static void *consumer_read_ahead_thread( void *arg )
 		// Get the image of the first frame
 		if ( !video_off )
 		{
-			mlt_events_fire( MLT_CONSUMER_PROPERTIES( self ), "consumer-frame-render", frame, NULL );
+			mlt_events_fire_id( MLT_CONSUMER_PROPERTIES( self ), mlt_event_consumer_frame_render, frame, NULL );
 			mlt_frame_get_image( frame, &image, &priv->image_format, &width, &height, 0 );
 		}
 
@@ -841,6 +861,8 @@ static void *consumer_read_ahead_thread( void *arg )
 	{
 		// Get the maximum size of the buffer
 		int buffer = (priv->speed == 0) ? 1 : MAX(mlt_properties_get_int( properties, "buffer" ), 0) + 1;
+		if ( audio_only && priv->speed && priv->frequency > 0 )
+			buffer = MAX( (int) ( audio_buffer * priv->fps / priv->frequency ), 0 ) + 1;
 	
 		// Put the current frame into the queue
 		pthread_mutex_lock( &priv->queue_mutex );
@@ -902,7 +924,7 @@ static void *consumer_read_ahead_thread( void *arg )
 				height = mlt_properties_get_int( properties, "height" );
 
 				// Get the image
-				mlt_events_fire( MLT_CONSUMER_PROPERTIES( self ), "consumer-frame-render", frame, NULL );
+				mlt_events_fire_id( MLT_CONSUMER_PROPERTIES( self ), mlt_event_consumer_frame_render, frame, NULL );
 				mlt_log_timings_begin();
 				mlt_frame_get_image( frame, &image, &priv->image_format, &width, &height, 0 );
 				mlt_log_timings_end( NULL, "mlt_frame_get_image" );
@@ -1038,7 +1060,7 @@ static void *consumer_worker_thread( void *arg )
 	mlt_image_format format = priv->image_format;
 
 	// See if video is turned off
-	int video_off = mlt_properties_get_int( properties, "video_off" );
+	int video_off = mlt_properties_get_int( properties, "video_off" ) || mlt_properties_get_int( properties, "audio_only" );
 	int preview_off = mlt_properties_get_int( properties, "preview_off" );
 	int preview_format = mlt_properties_get_int( properties, "preview_format" );
 
@@ -1095,7 +1117,7 @@ static void *consumer_worker_thread( void *arg )
 			// Fetch width/height again
 			width = mlt_properties_get_int( properties, "width" );
 			height = mlt_properties_get_int( properties, "height" );
-			mlt_events_fire( MLT_CONSUMER_PROPERTIES( self ), "consumer-frame-render", frame, NULL );
+			mlt_events_fire_id( MLT_CONSUMER_PROPERTIES( self ), mlt_event_consumer_frame_render, frame, NULL );
 			mlt_frame_get_image( frame, &image, &format, &width, &height, 0 );
 		}
 		mlt_properties_set_int( MLT_FRAME_PROPERTIES( frame ), "rendered", 1 );
@@ -1555,6 +1577,10 @@ mlt_frame mlt_consumer_rt_frame( mlt_consumer self )
 	mlt_properties properties = MLT_CONSUMER_PROPERTIES( self );
 	consumer_private *priv = self->local;
 
+	// Image workers are of no use when frames are only evaluated for audio
+	if ( !priv->started && abs( priv->real_time ) > 1 && mlt_properties_get_int( properties, "audio_only" ) )
+		priv->real_time = priv->real_time > 0 ? 1 : -1;
+
 	// Check if the user has requested real time or not
 	if ( priv->real_time > 1 || priv->real_time < -1 )
 	{
@@ -79,8 +79,14 @@
  *   Set this to -1 if the consumer does not care about the field order.
  * \properties \em mlt_image_format the image format to request in rendering threads, defaults to yuv422
  * \properties \em mlt_audio_format the audio format to request in rendering threads, defaults to S16
+ * \properties \em mlt_audio_native_format the audio format that services should process in when they can,
+ *   which also becomes the default for mlt_audio_format; float (planar) is the recommended choice
+ * \properties \em audio_conversions the number of audio format conversions in the frames shown so far (read only)
  * \properties \em audio_off set non-zero to disable audio processing
  * \properties \em video_off set non-zero to disable video processing
+ * \properties \em audio_only set non-zero to evaluate frames for their audio only: image stacks
+ *   are never run, mlt_frame_get_image() returns a blank image and a single read-ahead thread is used
+ * \properties \em audio_buffer when audio_only, the size of the read-ahead buffer in samples, defaults to one second
  * \properties \em drop_count the number of video frames not rendered since starting consumer
  */
 
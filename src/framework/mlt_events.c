@@ -43,12 +43,29 @@ static int events_destroyed = 0;
  * A service can register an event and fire/send it upon certain conditions or times.
  * Likewise, a service or an application can listen/receive specific events on specific
  * services.
+ *
+ * Each registered event has a slot holding its transmitter and listeners. Event names
+ * map to process-wide integer ids (see mlt_events_id()), and the listening mask has
+ * a bit set for every id that may have listeners, so firing an event nobody listens
+ * to returns at once.
  */
 
+typedef struct
+{
+	int id;
+	const char *name;
+	mlt_transmitter transmitter;
+	mlt_properties listeners;
+}
+event_slot;
+
 struct mlt_events_struct
 {
 	mlt_properties owner;
-	mlt_properties list;
+	event_slot *slots;
+	int count;
+	int closing;
+	uint64_t listening;
 };
 
 typedef struct mlt_events_struct *mlt_events;
@@ -66,6 +83,38 @@ struct mlt_event_struct
 	void *service;
 };
 
+/** The names of the predefined event ids, in the order of mlt_event_id. */
+
+static const char *predefined_events[] =
+{
+	"property-changed",
+	"service-changed",
+	"producer-changed",
+	"consumer-frame-show",
+	"consumer-frame-render"
+};
+
+/** The registry of event names; the index of a name is its id. */
+
+static struct
+{
+	pthread_mutex_t mutex;
+	char **names;
+	int count;
+	int size;
+}
+registry = { PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0 };
+
+/** Get the bit of the listening mask that covers an event id.
+ *
+ * Ids past the width of the mask share the last bit.
+ */
+
+static inline uint64_t event_bit( int id )
+{
+	return ( uint64_t )1 << ( id < 63 ? id : 63 );
+}
+
 /** Increment the reference count on self event.
  *
  * \public \memberof mlt_event_struct
@@ -102,6 +151,13 @@ void mlt_event_unblock( mlt_event self )
 		self->block_count --;
 }
 
+/* Forward declaration to private functions.
+*/
+
+static mlt_events mlt_events_fetch( mlt_properties );
+static void mlt_events_close( mlt_events );
+static void mlt_events_refresh( mlt_events );
+
 /** Close self event.
  *
  * \public \memberof mlt_event_struct
@@ -113,7 +169,12 @@ void mlt_event_close( mlt_event self )
 	if ( self != NULL )
 	{
 		if ( -- self->ref_count == 1 )
+		{
+			mlt_events events = self->owner;
 			self->owner = NULL;
+			if ( events != NULL && !events->closing )
+				mlt_events_refresh( events );
+		}
 		if ( self->ref_count <= 0 )
 		{
 #ifdef _MLT_EVENT_CHECKS_
@@ -124,11 +185,103 @@ void mlt_event_close( mlt_event self )
 	}
 }
 
-/* Forward declaration to private functions.
-*/
+/** Get the integer id of an event name.
+ *
+ * Ids are shared by all objects in the process; a name that was not seen
+ * before is assigned the next free id. The framework events have the fixed
+ * ids of mlt_event_id.
+ *
+ * \public \memberof mlt_events_struct
+ * \param name the name of an event
+ * \return the id of the event or -1 on error
+ */
 
-static mlt_events mlt_events_fetch( mlt_properties );
-static void mlt_events_close( mlt_events );
+int mlt_events_id( const char *name )
+{
+	int id = -1;
+	if ( name == NULL )
+		return id;
+
+	pthread_mutex_lock( &registry.mutex );
+
+	if ( registry.count == 0 )
+	{
+		int count = sizeof( predefined_events ) / sizeof( predefined_events[0] );
+		registry.size = count + 32;
+		registry.names = malloc( registry.size * sizeof( char* ) );
+		for ( registry.count = 0; registry.count < count; registry.count ++ )
+			registry.names[ registry.count ] = strdup( predefined_events[ registry.count ] );
+	}
+
+	for ( id = 0; id < registry.count; id ++ )
+		if ( !strcmp( registry.names[ id ], name ) )
+			break;
+
+	if ( id == registry.count )
+	{
+		if ( registry.count == registry.size )
+		{
+			registry.size *= 2;
+			registry.names = realloc( registry.names, registry.size * sizeof( char* ) );
+		}
+		registry.names[ registry.count ++ ] = strdup( name );
+	}
+
+	pthread_mutex_unlock( &registry.mutex );
+
+	return id;
+}
+
+/** Get the name of an event id.
+ *
+ * \private \memberof mlt_events_struct
+ * \param id the id of an event
+ * \return the name, which lives as long as the process
+ */
+
+static const char *mlt_events_name( int id )
+{
+	const char *name = NULL;
+	pthread_mutex_lock( &registry.mutex );
+	if ( id >= 0 && id < registry.count )
+		name = registry.names[ id ];
+	pthread_mutex_unlock( &registry.mutex );
+	return name;
+}
+
+/** Find the slot of an event by id.
+ *
+ * \private \memberof mlt_events_struct
+ * \param events an events object
+ * \param id the id of an event
+ * \return the slot or NULL if the event is not registered
+ */
+
+static event_slot *mlt_events_slot( mlt_events events, int id )
+{
+	int i;
+	for ( i = 0; i < events->count; i ++ )
+		if ( events->slots[ i ].id == id )
+			return &events->slots[ i ];
+	return NULL;
+}
+
+/** Find the slot of an event by name.
+ *
+ * \private \memberof mlt_events_struct
+ * \param events an events object
+ * \param name the name of an event
+ * \return the slot or NULL if the event is not registered
+ */
+
+static event_slot *mlt_events_slot_by_name( mlt_events events, const char *name )
+{
+	int i;
+	for ( i = 0; i < events->count; i ++ )
+		if ( events->slots[ i ].name == name || !strcmp( events->slots[ i ].name, name ) )
+			return &events->slots[ i ];
+	return NULL;
+}
 
 /** Initialise the events structure.
  *
@@ -142,7 +295,6 @@ void mlt_events_init( mlt_properties self )
 	if (!events && self) {
 		events = calloc( 1, sizeof( struct mlt_events_struct ) );
 		if (events) {
-			events->list = mlt_properties_new( );
 			events->owner = self;
 			mlt_properties_set_data( self, "_events", events, 0, ( mlt_destructor )mlt_events_close, NULL );
 		}
@@ -162,18 +314,67 @@ int mlt_events_register( mlt_properties self, const char *id, mlt_transmitter tr
 {
 	int error = 1;
 	mlt_events events = mlt_events_fetch( self );
-	if ( events != NULL )
+	int number = mlt_events_id( id );
+	if ( events != NULL && number >= 0 )
 	{
-		mlt_properties list = events->list;
-		char temp[ 128 ];
-		error = mlt_properties_set_data( list, id, transmitter, 0, NULL, NULL );
-		sprintf( temp, "list:%s", id );
-		if ( mlt_properties_get_data( list, temp, NULL ) == NULL )
-			mlt_properties_set_data( list, temp, mlt_properties_new( ), 0, ( mlt_destructor )mlt_properties_close, NULL );
+		event_slot *slot = mlt_events_slot( events, number );
+		if ( slot == NULL )
+		{
+			event_slot *slots = realloc( events->slots, ( events->count + 1 ) * sizeof( event_slot ) );
+			if ( slots != NULL )
+			{
+				events->slots = slots;
+				slot = &slots[ events->count ++ ];
+				slot->id = number;
+				slot->name = mlt_events_name( number );
+				slot->listeners = mlt_properties_new( );
+			}
+		}
+		if ( slot != NULL )
+		{
+			slot->transmitter = transmitter;
+			error = 0;
+		}
 	}
 	return error;
 }
 
+/** Send an event to the listeners of a slot.
+ *
+ * \private \memberof mlt_events_struct
+ * \param events an events object
+ * \param slot the slot of the event
+ * \param alist the arguments for the transmitter, terminated by NULL
+ * \return the number of listeners
+ */
+
+static int mlt_events_send( mlt_events events, event_slot *slot, va_list alist )
+{
+	int result = 0;
+	int i = 0;
+	void *args[ 10 ];
+	mlt_properties listeners = slot->listeners;
+	mlt_transmitter transmitter = slot->transmitter;
+
+	do
+		args[ i ] = va_arg( alist, void * );
+	while( args[ i ++ ] != NULL );
+
+	for ( i = 0; i < mlt_properties_count( listeners ); i ++ )
+	{
+		mlt_event event = mlt_properties_get_data_at( listeners, i, NULL );
+		if ( event != NULL && event->owner != NULL && event->block_count == 0 )
+		{
+			if ( transmitter != NULL )
+				transmitter( event->listener, event->owner->owner, event->service, args );
+			else
+				event->listener( event->owner->owner, event->service );
+			++result;
+		}
+	}
+	return result;
+}
+
 /** Fire an event.
  *
  * This takes a variable number of arguments to supply to the listener.
@@ -188,43 +389,66 @@ int mlt_events_fire( mlt_properties self, const char *id, ... )
 {
 	int result = 0;
 	mlt_events events = mlt_events_fetch( self );
-	if ( events != NULL )
+	if ( events != NULL && events->listening && id != NULL )
 	{
-		int i = 0;
-		va_list alist;
-		void *args[ 10 ];
-		mlt_properties list = events->list;
-		mlt_properties listeners = NULL;
-		char temp[ 128 ];
-		mlt_transmitter transmitter = mlt_properties_get_data( list, id, NULL );
-		sprintf( temp, "list:%s", id );
-		listeners = mlt_properties_get_data( list, temp, NULL );
-
-		va_start( alist, id );
-		do
-			args[ i ] = va_arg( alist, void * );
-		while( args[ i ++ ] != NULL );
-		va_end( alist );
-
-		if ( listeners != NULL )
+		event_slot *slot = mlt_events_slot_by_name( events, id );
+		if ( slot != NULL && ( events->listening & event_bit( slot->id ) ) )
 		{
-			for ( i = 0; i < mlt_properties_count( listeners ); i ++ )
-			{
-				mlt_event event = mlt_properties_get_data_at( listeners, i, NULL );
-				if ( event != NULL && event->owner != NULL && event->block_count == 0 )
-				{
-					if ( transmitter != NULL )
-						transmitter( event->listener, event->owner->owner, event->service, args );
-					else
-						event->listener( event->owner->owner, event->service );
-					++result;
-				}
-			}
+			va_list alist;
+			va_start( alist, id );
+			result = mlt_events_send( events, slot, alist );
+			va_end( alist );
 		}
 	}
 	return result;
 }
 
+/** Fire an event by its integer id.
+ *
+ * This is the same as mlt_events_fire() without looking up the name.
+ * This takes a variable number of arguments to supply to the listener.
+ *
+ * \public \memberof mlt_events_struct
+ * \param self a properties list
+ * \param id the id of an event from mlt_events_id()
+ * \return the number of listeners
+ */
+
+int mlt_events_fire_id( mlt_properties self, int id, ... )
+{
+	int result = 0;
+	mlt_events events = mlt_events_fetch( self );
+	if ( events != NULL && ( events->listening & event_bit( id ) ) )
+	{
+		event_slot *slot = mlt_events_slot( events, id );
+		if ( slot != NULL )
+		{
+			va_list alist;
+			va_start( alist, id );
+			result = mlt_events_send( events, slot, alist );
+			va_end( alist );
+		}
+	}
+	return result;
+}
+
+/** Determine if an event may have listeners.
+ *
+ * This is a cheap test to skip preparing the arguments of an event that
+ * nobody listens to. It may report listeners that are blocked.
+ *
+ * \public \memberof mlt_events_struct
+ * \param self a properties list
+ * \param id the id of an event from mlt_events_id()
+ * \return true if the event has listeners
+ */
+
+int mlt_events_listening( mlt_properties self, int id )
+{
+	mlt_events events = mlt_events_fetch( self );
+	return events != NULL && id >= 0 && ( events->listening & event_bit( id ) ) != 0;
+}
+
 /** Register a listener.
  *
  * \public \memberof mlt_events_struct
@@ -239,15 +463,13 @@ mlt_event mlt_events_listen( mlt_properties self, void *service, const char *id,
 {
 	mlt_event event = NULL;
 	mlt_events events = mlt_events_fetch( self );
-	if ( events != NULL )
+	if ( events != NULL && id != NULL )
 	{
-		mlt_properties list = events->list;
-		mlt_properties listeners = NULL;
-		char temp[ 128 ];
-		sprintf( temp, "list:%s", id );
-		listeners = mlt_properties_get_data( list, temp, NULL );
-		if ( listeners != NULL )
+		event_slot *slot = mlt_events_slot_by_name( events, id );
+		if ( slot != NULL )
 		{
+			mlt_properties listeners = slot->listeners;
+			char temp[ 128 ];
 			int first_null = -1;
 			int i = 0;
 			for ( i = 0; event == NULL && i < mlt_properties_count( listeners ); i ++ )
@@ -283,6 +505,8 @@ mlt_event mlt_events_listen( mlt_properties self, void *service, const char *id,
 				}
 			}
 
+			if ( event != NULL )
+				events->listening |= event_bit( slot->id );
 		}
 	}
 	return event;
@@ -301,19 +525,14 @@ void mlt_events_block( mlt_properties self, void *service )
 	if ( events != NULL )
 	{
 		int i = 0, j = 0;
-		mlt_properties list = events->list;
-		for ( j = 0; j < mlt_properties_count( list ); j ++ )
+		for ( j = 0; j < events->count; j ++ )
 		{
-			char *temp = mlt_properties_get_name( list, j );
-			if ( !strncmp( temp, "list:", 5 ) )
+			mlt_properties listeners = events->slots[ j ].listeners;
+			for ( i = 0; i < mlt_properties_count( listeners ); i ++ )
 			{
-				mlt_properties listeners = mlt_properties_get_data( list, temp, NULL );
-				for ( i = 0; i < mlt_properties_count( listeners ); i ++ )
-				{
-					mlt_event entry = mlt_properties_get_data_at( listeners, i, NULL );
-					if ( entry != NULL && entry->service == service )
-						mlt_event_block( entry );
-				}
+				mlt_event entry = mlt_properties_get_data_at( listeners, i, NULL );
+				if ( entry != NULL && entry->service == service )
+					mlt_event_block( entry );
 			}
 		}
 	}
@@ -332,19 +551,14 @@ void mlt_events_unblock( mlt_properties self, void *service )
 	if ( events != NULL )
 	{
 		int i = 0, j = 0;
-		mlt_properties list = events->list;
-		for ( j = 0; j < mlt_properties_count( list ); j ++ )
+		for ( j = 0; j < events->count; j ++ )
 		{
-			char *temp = mlt_properties_get_name( list, j );
-			if ( !strncmp( temp, "list:", 5 ) )
+			mlt_properties listeners = events->slots[ j ].listeners;
+			for ( i = 0; i < mlt_properties_count( listeners ); i ++ )
 			{
-				mlt_properties listeners = mlt_properties_get_data( list, temp, NULL );
-				for ( i = 0; i < mlt_properties_count( listeners ); i ++ )
-				{
-					mlt_event entry = mlt_properties_get_data_at( listeners, i, NULL );
-					if ( entry != NULL && entry->service == service )
-						mlt_event_unblock( entry );
-				}
+				mlt_event entry = mlt_properties_get_data_at( listeners, i, NULL );
+				if ( entry != NULL && entry->service == service )
+					mlt_event_unblock( entry );
 			}
 		}
 	}
@@ -363,22 +577,18 @@ void mlt_events_disconnect( mlt_properties self, void *service )
 	if ( events != NULL )
 	{
 		int i = 0, j = 0;
-		mlt_properties list = events->list;
-		for ( j = 0; j < mlt_properties_count( list ); j ++ )
+		for ( j = 0; j < events->count; j ++ )
 		{
-			char *temp = mlt_properties_get_name( list, j );
-			if ( !strncmp( temp, "list:", 5 ) )
+			mlt_properties listeners = events->slots[ j ].listeners;
+			for ( i = 0; i < mlt_properties_count( listeners ); i ++ )
 			{
-				mlt_properties listeners = mlt_properties_get_data( list, temp, NULL );
-				for ( i = 0; i < mlt_properties_count( listeners ); i ++ )
-				{
-					mlt_event entry = mlt_properties_get_data_at( listeners, i, NULL );
-					char *name = mlt_properties_get_name( listeners, i );
-					if ( entry != NULL && entry->service == service )
-						mlt_properties_set_data( listeners, name, NULL, 0, NULL, NULL );
-				}
+				mlt_event entry = mlt_properties_get_data_at( listeners, i, NULL );
+				char *name = mlt_properties_get_name( listeners, i );
+				if ( entry != NULL && entry->service == service )
+					mlt_properties_set_data( listeners, name, NULL, 0, NULL, NULL );
 			}
 		}
+		mlt_events_refresh( events );
 	}
 }
 
@@ -450,7 +660,10 @@ void mlt_events_close_wait_for( mlt_properties self, mlt_event event )
 	if ( event != NULL )
 	{
 		condition_pair *pair = event->service;
+		mlt_events events = event->owner;
 		event->owner = NULL;
+		if ( events != NULL )
+			mlt_events_refresh( events );
 		pthread_mutex_unlock( &pair->mutex );
 		pthread_mutex_destroy( &pair->mutex );
 		pthread_cond_destroy( &pair->cond );
@@ -473,6 +686,32 @@ static mlt_events mlt_events_fetch( mlt_properties self )
 	return events;
 }
 
+/** Recompute the listening mask of an events object.
+ *
+ * \private \memberof mlt_events_struct
+ * \param events an events object
+ */
+
+static void mlt_events_refresh( mlt_events events )
+{
+	uint64_t listening = 0;
+	int i = 0, j = 0;
+	for ( j = 0; j < events->count; j ++ )
+	{
+		mlt_properties listeners = events->slots[ j ].listeners;
+		for ( i = 0; i < mlt_properties_count( listeners ); i ++ )
+		{
+			mlt_event entry = mlt_properties_get_data_at( listeners, i, NULL );
+			if ( entry != NULL && entry->owner != NULL )
+			{
+				listening |= event_bit( events->slots[ j ].id );
+				break;
+			}
+		}
+	}
+	events->listening = listening;
+}
+
 /** Close the events object.
  *
  * \private \memberof mlt_events_struct
@@ -483,7 +722,11 @@ static void mlt_events_close( mlt_events events )
 {
 	if ( events != NULL )
 	{
-		mlt_properties_close( events->list );
+		int i;
+		events->closing = 1;
+		for ( i = 0; i < events->count; i ++ )
+			mlt_properties_close( events->slots[ i ].listeners );
+		free( events->slots );
 		free( events );
 	}
 }
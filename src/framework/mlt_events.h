@@ -41,9 +41,27 @@ typedef void ( *mlt_transmitter )( );
 typedef void ( *mlt_listener )( );
 #endif
 
+/** The ids of the events fired by the framework
+ *
+ * Other event names get ids from mlt_events_id() on first use.
+ */
+
+typedef enum
+{
+	mlt_event_property_changed = 0, /**< "property-changed" */
+	mlt_event_service_changed,      /**< "service-changed" */
+	mlt_event_producer_changed,     /**< "producer-changed" */
+	mlt_event_consumer_frame_show,  /**< "consumer-frame-show" */
+	mlt_event_consumer_frame_render /**< "consumer-frame-render" */
+}
+mlt_event_id;
+
 extern void mlt_events_init( mlt_properties self );
 extern int mlt_events_register( mlt_properties self, const char *id, mlt_transmitter transmitter );
 extern int mlt_events_fire( mlt_properties self, const char *id, ... );
+extern int mlt_events_id( const char *name );
+extern int mlt_events_fire_id( mlt_properties self, int id, ... );
+extern int mlt_events_listening( mlt_properties self, int id );
 extern mlt_event mlt_events_listen( mlt_properties self, void *service, const char *id, mlt_listener listener );
 extern void mlt_events_block( mlt_properties self, void *service );
 extern void mlt_events_unblock( mlt_properties self, void *service );
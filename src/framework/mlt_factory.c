@@ -21,12 +21,14 @@
 
 #include "mlt.h"
 #include "mlt_repository.h"
+#include "mlt_luma_map.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <locale.h>
 #include <libgen.h>
+#include <stdatomic.h>
 
 /** the default subdirectory of the datadir for holding presets */
 #define PRESETS_DIR "/presets"
@@ -67,7 +69,7 @@ static mlt_repository repository = NULL;
 /** the events object for the factory events */
 static mlt_properties event_object = NULL;
 /** for tracking the unique_id set on each constructed service */
-static int unique_id = 0;
+static atomic_int unique_id = 0;
 
 /* Event transmitters. */
 
@@ -325,7 +327,7 @@ int mlt_environment_set( const char *name, const char *value )
 
 static void set_common_properties( mlt_properties properties, mlt_profile profile, const char *type, const char *service )
 {
-	mlt_properties_set_int( properties, "_unique_id", ++ unique_id );
+	mlt_properties_set_int( properties, "_unique_id", atomic_fetch_add( &unique_id, 1 ) + 1 );
 	mlt_properties_set( properties, "mlt_type", type );
 	if ( mlt_properties_get_int( properties, "_mlt_service_hidden" ) == 0 )
 		mlt_properties_set( properties, "mlt_service", service );
@@ -511,6 +513,7 @@ void mlt_factory_close( )
 		}
 		free( mlt_directory );
 		mlt_directory = NULL;
+		mlt_luma_map_cache_purge( );
 		mlt_pool_close( );
 	}
 }
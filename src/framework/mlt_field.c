@@ -183,6 +183,7 @@ int mlt_field_plant_filter( mlt_field self, mlt_filter that, int track )
 		mlt_tractor_connect( self->tractor, self->producer );
 
 		// Fire an event
+		mlt_properties_touch( mlt_field_properties( self ) );
 		mlt_events_fire( mlt_field_properties( self ), "service-changed", NULL );
 	}
 
@@ -214,6 +215,7 @@ int mlt_field_plant_transition( mlt_field self, mlt_transition that, int a_track
 		mlt_tractor_connect( self->tractor, self->producer );
 
 		// Fire an event
+		mlt_properties_touch( mlt_field_properties( self ) );
 		mlt_events_fire( mlt_field_properties( self ), "service-changed", NULL );
 	}
 
@@ -265,5 +267,6 @@ void mlt_field_disconnect_service( mlt_field self, mlt_service service )
 		default:
 			break;
 	}
+	mlt_properties_touch( mlt_field_properties( self ) );
 	mlt_events_fire( mlt_field_properties( self ), "service-changed", NULL );
 }
@@ -21,9 +21,12 @@
  */
 
 #include "mlt_frame.h"
+#include "mlt_image.h"
+#include "mlt_property.h"
 #include "mlt_producer.h"
 #include "mlt_factory.h"
 #include "mlt_profile.h"
+#include "mlt_peaks.h"
 #include "mlt_log.h"
 
 #include <stdio.h>
@@ -321,6 +324,21 @@ mlt_deque mlt_frame_service_stack( mlt_frame self )
 	return self->stack_service;
 }
 
+/** Release the shared image of a frame once neither its image nor its alpha is used.
+ *
+ * \private \memberof mlt_frame_s
+ * \param self a frame
+ * \param image the image the frame is going to have
+ * \param alpha the alpha channel the frame is going to have
+ */
+
+static void release_shared_image( mlt_frame self, void *image, void *alpha )
+{
+	mlt_image shared = mlt_properties_get_data( MLT_FRAME_PROPERTIES( self ), "_image", NULL );
+	if ( shared && shared->data != image && ( !shared->alpha || shared->alpha != alpha ) )
+		mlt_properties_set_data( MLT_FRAME_PROPERTIES( self ), "_image", NULL, 0, NULL, NULL );
+}
+
 /** Set a new image on the frame.
   *
   * \public \memberof mlt_frame_s
@@ -333,6 +351,8 @@ mlt_deque mlt_frame_service_stack( mlt_frame self )
 
 int mlt_frame_set_image( mlt_frame self, uint8_t *image, int size, mlt_destructor destroy )
 {
+	release_shared_image( self, image, mlt_properties_get_data( MLT_FRAME_PROPERTIES( self ), "alpha", NULL ) );
+	mlt_properties_set_data( MLT_FRAME_PROPERTIES( self ), "_alpha_summary", NULL, 0, NULL, NULL );
 	return mlt_properties_set_data( MLT_FRAME_PROPERTIES( self ), "image", image, size, destroy, NULL );
 }
 
@@ -349,6 +369,8 @@ int mlt_frame_set_image( mlt_frame self, uint8_t *image, int size, mlt_destructo
 int mlt_frame_set_alpha( mlt_frame self, uint8_t *alpha, int size, mlt_destructor destroy )
 {
 	self->get_alpha_mask = NULL;
+	release_shared_image( self, mlt_properties_get_data( MLT_FRAME_PROPERTIES( self ), "image", NULL ), alpha );
+	mlt_properties_set_data( MLT_FRAME_PROPERTIES( self ), "_alpha_summary", NULL, 0, NULL, NULL );
 	return mlt_properties_set_data( MLT_FRAME_PROPERTIES( self ), "alpha", alpha, size, destroy, NULL );
 }
 
@@ -587,34 +609,139 @@ static int generate_test_image( mlt_properties properties, uint8_t **buffer,  ml
 }
 
 
-/** Get the image associated to the frame.
+/** Give a frame its own copy of shared data before it is modified.
  *
- * You should express the desired format, width, and height as inputs. As long
- * as the loader producer was used to generate this or the imageconvert filter
- * was attached, then you will get the image back in the format you desire.
- * However, you do not always get the width and height you request depending
- * on properties and filters. You do not need to supply a pre-allocated
- * buffer, but you should always supply the desired image format.
+ * Frames made by mlt_frame_clone() share their audio and image buffers.
+ * \private \memberof mlt_frame_s
+ * \param properties the frame's properties
+ * \param name the name of the data property
+ * \param data the data that is about to be modified
+ * \param size the size of the data if the property does not record it
+ * \return the data to modify
+ */
+
+static void *writable_data( mlt_properties properties, const char *name, void *data, int size )
+{
+	int length = 0;
+	if ( data && data == mlt_properties_get_data( properties, name, &length )
+		 && mlt_properties_is_shared( properties, name ) )
+	{
+		if ( length > 0 )
+			size = length;
+		if ( size > 0 )
+		{
+			void *copy = mlt_pool_alloc( size );
+			memcpy( copy, data, size );
+			mlt_properties_set_data( properties, name, copy, size, mlt_pool_release, NULL );
+			data = copy;
+		}
+	}
+	return data;
+}
+
+/** Replace the shared image of a frame with a packed and writable copy.
  *
- * \public \memberof mlt_frame_s
+ * \private \memberof mlt_frame_s
+ * \param self a frame
+ * \param image the shared image of the frame, whose data is the frame's image
+ * \return the copy
+ */
+
+static mlt_image unshare_image( mlt_frame self, mlt_image image )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	int with_alpha = image->alpha && image->alpha == mlt_properties_get_data( properties, "alpha", NULL );
+	mlt_image copy = mlt_image_copy( image );
+
+	mlt_properties_set_data( properties, "_image", copy, 0, ( mlt_destructor )mlt_image_close, NULL );
+	mlt_frame_set_image( self, copy->data, 0, NULL );
+	if ( with_alpha )
+		mlt_frame_set_alpha( self, copy->alpha, copy->width * copy->height, NULL );
+	return copy;
+}
+
+/** Give a frame its own copy of its image or alpha before it is modified.
+ *
+ * The image and alpha set by mlt_frame_set_shared_image() may be shared with
+ * other frames and services and are copied unless the frame holds the only
+ * reference to a writable image.
+ * \private \memberof mlt_frame_s
+ * \param self a frame
+ * \param name "image" or "alpha"
+ * \param data the data that is about to be modified
+ * \param size the size of the data if the property does not record it
+ * \return the data to modify
+ */
+
+static void *writable_image( mlt_frame self, const char *name, void *data, int size )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	mlt_image image = mlt_properties_get_data( properties, "_image", NULL );
+	int is_alpha = !strcmp( name, "alpha" );
+
+	if ( image && data && data == ( is_alpha ? image->alpha : image->data )
+		 && data == mlt_properties_get_data( properties, name, NULL )
+		 && ( !mlt_image_is_writable( image ) || mlt_properties_is_shared( properties, "_image" ) ) )
+	{
+		if ( !is_alpha || image->data == mlt_properties_get_data( properties, "image", NULL ) )
+		{
+			image = unshare_image( self, image );
+			data = is_alpha ? image->alpha : image->data;
+		}
+		else
+		{
+			// Only the alpha is still that of the shared image
+			size = image->width * image->height;
+			void *copy = mlt_pool_alloc( size );
+			memcpy( copy, data, size );
+			mlt_frame_set_alpha( self, copy, size, mlt_pool_release );
+			data = copy;
+		}
+		return data;
+	}
+	return writable_data( properties, name, data, size );
+}
+
+/** Make sure the image handed out by a frame is packed.
+ *
+ * \private \memberof mlt_frame_s
+ * \param self a frame
+ * \param[in,out] buffer the image that is about to be handed out
+ */
+
+static void pack_image( mlt_frame self, uint8_t **buffer )
+{
+	mlt_image image = mlt_properties_get_data( MLT_FRAME_PROPERTIES( self ), "_image", NULL );
+	if ( image && image->data == *buffer && !mlt_image_is_packed( image ) )
+		*buffer = unshare_image( self, image )->data;
+}
+
+/** Get the image of a frame, allowing a shared image that is not packed.
+ *
+ * \private \memberof mlt_frame_s
  * \param self a frame
  * \param[out] buffer an image buffer
  * \param[in,out] format the image format
  * \param[in,out] width the horizontal size in pixels
  * \param[in,out] height the vertical size in pixels
  * \param writable whether or not you will need to be able to write to the memory returned in \p buffer
+ * \param views whether the caller honours the strides of the shared image
  * \return true if error
- * \todo Better describe the width and height as inputs.
  */
 
-int mlt_frame_get_image( mlt_frame self, uint8_t **buffer, mlt_image_format *format, int *width, int *height, int writable )
+static int fetch_image( mlt_frame self, uint8_t **buffer, mlt_image_format *format, int *width, int *height, int writable, int views )
 {
 	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
 	mlt_get_image get_image = mlt_frame_pop_get_image( self );
 	mlt_image_format requested_format = *format;
 	int error = 0;
 
-	if ( get_image )
+	if ( get_image && mlt_properties_get_int( properties, "consumer_audio_only" ) )
+	{
+		// The consumer only wants the audio, so the image stack is never run.
+		error = generate_test_image( properties, buffer, format, width, height, writable );
+	}
+	else if ( get_image )
 	{
 		mlt_properties_set_int( properties, "image_count", mlt_properties_get_int( properties, "image_count" ) - 1 );
 		error = get_image( self, buffer, format, width, height, writable );
@@ -622,6 +749,8 @@ int mlt_frame_get_image( mlt_frame self, uint8_t **buffer, mlt_image_format *for
 		{
 			mlt_properties_set_int( properties, "width", *width );
 			mlt_properties_set_int( properties, "height", *height );
+			if ( !views || ( self->convert_image && requested_format != mlt_image_none && requested_format != *format ) )
+				pack_image( self, buffer );
 			if ( self->convert_image && requested_format != mlt_image_none )
 				self->convert_image( self, buffer, format, requested_format );
 			mlt_properties_set_int( properties, "format", *format );
@@ -637,6 +766,8 @@ int mlt_frame_get_image( mlt_frame self, uint8_t **buffer, mlt_image_format *for
 		*buffer = mlt_properties_get_data( properties, "image", NULL );
 		*width = mlt_properties_get_int( properties, "width" );
 		*height = mlt_properties_get_int( properties, "height" );
+		if ( !views || ( self->convert_image && requested_format != mlt_image_none && requested_format != *format ) )
+			pack_image( self, buffer );
 		if ( self->convert_image && *buffer && requested_format != mlt_image_none )
 		{
 			self->convert_image( self, buffer, format, requested_format );
@@ -648,9 +779,207 @@ int mlt_frame_get_image( mlt_frame self, uint8_t **buffer, mlt_image_format *for
 		error = generate_test_image( properties, buffer, format, width, height, writable );
 	}
 
+	if ( !error && writable && buffer && *buffer )
+	{
+		// The caller may change the alpha of an rgb24a image
+		mlt_properties_set_data( properties, "_alpha_summary", NULL, 0, NULL, NULL );
+		*buffer = writable_image( self, "image", *buffer,
+			mlt_image_format_size( *format, *width, *height, NULL ) );
+		writable_image( self, "alpha", mlt_properties_get_data( properties, "alpha", NULL ),
+			*width * *height );
+	}
+
+	return error;
+}
+
+/** Get the image associated to the frame.
+ *
+ * You should express the desired format, width, and height as inputs. As long
+ * as the loader producer was used to generate this or the imageconvert filter
+ * was attached, then you will get the image back in the format you desire.
+ * However, you do not always get the width and height you request depending
+ * on properties and filters. You do not need to supply a pre-allocated
+ * buffer, but you should always supply the desired image format.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ * \param[out] buffer an image buffer
+ * \param[in,out] format the image format
+ * \param[in,out] width the horizontal size in pixels
+ * \param[in,out] height the vertical size in pixels
+ * \param writable whether or not you will need to be able to write to the memory returned in \p buffer
+ * \return true if error
+ * \todo Better describe the width and height as inputs.
+ */
+
+int mlt_frame_get_image( mlt_frame self, uint8_t **buffer, mlt_image_format *format, int *width, int *height, int writable )
+{
+	return fetch_image( self, buffer, format, width, height, writable, 0 );
+}
+
+/** Set a shared image on the frame.
+ *
+ * The frame takes a reference to \p image and uses its buffers as the frame's
+ * image and alpha without copying them. mlt_frame_get_image() copies them
+ * before handing them out as writable unless the frame holds the only
+ * reference to a writable image.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ * \param image the image to share
+ * \return true if error
+ */
+
+int mlt_frame_set_shared_image( mlt_frame self, mlt_image image )
+{
+	if ( !self || !image )
+		return 1;
+
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	mlt_image_inc_ref( image );
+	mlt_properties_set_data( properties, "_image", image, 0, ( mlt_destructor )mlt_image_close, NULL );
+	mlt_frame_set_image( self, image->data, 0, NULL );
+	mlt_frame_set_alpha( self, image->alpha, image->alpha ? image->width * image->height : 0, NULL );
+	mlt_properties_set_int( properties, "format", image->format );
+	mlt_properties_set_int( properties, "width", image->width );
+	mlt_properties_set_int( properties, "height", image->height );
+	if ( image->colorspace > 0 )
+		mlt_properties_set_int( properties, "colorspace", image->colorspace );
+	return 0;
+}
+
+/** \brief A shared image that refers to the buffers of a frame
+ *
+ * It holds references to the frame's "image" and "alpha" properties, which
+ * own the buffers, so that they survive the frame replacing them.
+ */
+
+typedef struct
+{
+	struct mlt_image_s image;
+	mlt_property data;
+	mlt_property alpha;
+} frame_image;
+
+static void frame_image_close( void *ptr )
+{
+	frame_image *self = ptr;
+	if ( self->data )
+		mlt_property_close( self->data );
+	if ( self->alpha )
+		mlt_property_close( self->alpha );
+	free( self );
+}
+
+/** Get the image of the frame as a shared image.
+ *
+ * This gets the image as mlt_frame_get_image() does without asking to write
+ * to it. If the image is not already shared, the frame's buffers are wrapped,
+ * or copied once when the frame does not own them, into a new image that the
+ * frame shares from then on, so that further calls just add a reference.
+ *
+ * Unlike mlt_frame_get_image(), the image may be a view whose planes are not
+ * packed, see mlt_image_crop(); use the planes and strides of the image
+ * rather than its data.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ * \param[out] image a new reference to the image that must be released with mlt_image_close()
+ * \param[in,out] format the image format
+ * \param[in,out] width the horizontal size in pixels
+ * \param[in,out] height the vertical size in pixels
+ * \return true if error
+ */
+
+int mlt_frame_get_shared_image( mlt_frame self, mlt_image *image, mlt_image_format *format, int *width, int *height )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	uint8_t *buffer = NULL;
+	int error = fetch_image( self, &buffer, format, width, height, 0, 1 );
+
+	*image = NULL;
+	if ( !error && buffer )
+	{
+		mlt_image shared = mlt_properties_get_data( properties, "_image", NULL );
+		uint8_t *alpha = mlt_frame_get_alpha( self );
+		mlt_property data = NULL;
+
+		if ( shared && shared->data == buffer && shared->alpha == alpha && shared->format == *format
+			 && shared->width == *width && shared->height == *height )
+		{
+			mlt_image_inc_ref( shared );
+		}
+		else if ( buffer == mlt_properties_get_data( properties, "image", NULL )
+				  && ( data = mlt_properties_share_property( properties, "image" ) ) && mlt_property_owns_data( data ) )
+		{
+			// Wrap the buffers of the frame without copying them
+			frame_image *wrapper = calloc( 1, sizeof( frame_image ) );
+			shared = &wrapper->image;
+			mlt_image_set_values( shared, buffer, *format, *width, *height );
+			shared->colorspace = mlt_properties_get_int( properties, "colorspace" );
+			shared->ref_count = 1;
+			shared->close = frame_image_close;
+			wrapper->data = data;
+			if ( alpha )
+			{
+				shared->alpha = alpha;
+				if ( alpha == mlt_properties_get_data( properties, "alpha", NULL ) )
+					wrapper->alpha = mlt_properties_share_property( properties, "alpha" );
+				if ( wrapper->alpha && !mlt_property_owns_data( wrapper->alpha ) )
+				{
+					mlt_property_close( wrapper->alpha );
+					wrapper->alpha = NULL;
+				}
+			}
+			if ( alpha && !wrapper->alpha )
+			{
+				// The alpha is not owned by the frame
+				mlt_image_alloc_alpha( shared );
+				memcpy( shared->alpha, alpha, *width * *height );
+			}
+			mlt_frame_set_shared_image( self, shared );
+		}
+		else
+		{
+			// The buffers belong to another frame or service that may reuse them
+			struct mlt_image_s source;
+			if ( data )
+				mlt_property_close( data );
+			memset( &source, 0, sizeof( source ) );
+			mlt_image_set_values( &source, buffer, *format, *width, *height );
+			source.alpha = alpha;
+			shared = mlt_image_copy( &source );
+			shared->colorspace = mlt_properties_get_int( properties, "colorspace" );
+			mlt_frame_set_shared_image( self, shared );
+		}
+		*image = shared;
+	}
 	return error;
 }
 
+/** Determine if the image of the frame is solid.
+ *
+ * This is the case while the frame shows a solid shared image, see
+ * mlt_image_s; modifying the image replaces it with a copy that is not solid.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ * \return true if every row of the image and of its alpha channel is the same
+ */
+
+int mlt_frame_is_solid( mlt_frame self )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	mlt_image image = mlt_properties_get_data( properties, "_image", NULL );
+
+	return image && image->solid
+		&& image->data == mlt_properties_get_data( properties, "image", NULL )
+		&& !self->get_alpha_mask && image->alpha == mlt_properties_get_data( properties, "alpha", NULL )
+		&& image->format == mlt_properties_get_int( properties, "format" )
+		&& image->width == mlt_properties_get_int( properties, "width" )
+		&& image->height == mlt_properties_get_int( properties, "height" );
+}
+
 /** Get the alpha channel associated to the frame.
  *
  * Unlike mlt_frame_get_alpha(), this function WILL create an opaque alpha
@@ -678,6 +1007,13 @@ uint8_t *mlt_frame_get_alpha_mask( mlt_frame self )
 			memset( alpha, 255, size );
 			mlt_properties_set_data( &self->parent, "alpha", alpha, size, mlt_pool_release, NULL );
 		}
+		else
+		{
+			int size = mlt_properties_get_int( &self->parent, "width" ) * mlt_properties_get_int( &self->parent, "height" );
+			alpha = writable_image( self, "alpha", alpha, size );
+		}
+		// The caller may change the alpha
+		mlt_properties_set_data( &self->parent, "_alpha_summary", NULL, 0, NULL, NULL );
 	}
 	return alpha;
 }
@@ -705,6 +1041,115 @@ uint8_t *mlt_frame_get_alpha( mlt_frame self )
 	return alpha;
 }
 
+/** The cached alpha summary of a frame along with what it was computed from. */
+
+typedef struct
+{
+	mlt_alpha_summary summary;
+	const void *data;
+	int width;
+	int height;
+	mlt_image_format format;
+}
+alpha_summary_cache;
+
+/** Get a summary of the alpha channel of the frame's current image.
+ *
+ * The alpha is taken from the image itself for rgb24a and from the alpha
+ * channel otherwise. A frame without alpha is reported as fully opaque.
+ * The summary is computed on first use and cached on the frame until the
+ * image or alpha is replaced or handed out for writing by
+ * mlt_frame_get_image() or mlt_frame_get_alpha_mask(), so alpha changed in
+ * place through mlt_frame_get_alpha() must be final before it is requested.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ * \param[out] summary the alpha summary
+ */
+
+void mlt_frame_get_alpha_summary( mlt_frame self, mlt_alpha_summary *summary )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	int width = mlt_properties_get_int( properties, "width" );
+	int height = mlt_properties_get_int( properties, "height" );
+	mlt_image_format format = mlt_properties_get_int( properties, "format" );
+	uint8_t *image = mlt_properties_get_data( properties, "image", NULL );
+	const uint8_t *data = NULL;
+	int step = 1;
+	alpha_summary_cache *cache;
+
+	if ( format == mlt_image_rgb24a && image )
+	{
+		data = image + 3;
+		step = 4;
+	}
+	else
+	{
+		data = mlt_frame_get_alpha( self );
+	}
+
+	cache = mlt_properties_get_data( properties, "_alpha_summary", NULL );
+	if ( cache && cache->data == data && cache->width == width && cache->height == height && cache->format == format )
+	{
+		*summary = cache->summary;
+		return;
+	}
+
+	if ( data && height > 0 && mlt_frame_is_solid( self ) )
+	{
+		// Every row is the same as the first
+		mlt_image_alpha_summary( data, width, 1, step, summary );
+		if ( summary->height )
+			summary->height = height;
+	}
+	else if ( data )
+	{
+		mlt_image_alpha_summary( data, width, height, step, summary );
+	}
+	else
+	{
+		summary->x = summary->y = 0;
+		summary->width = width;
+		summary->height = height;
+		summary->opaque = 1;
+	}
+
+	cache = malloc( sizeof( *cache ) );
+	if ( cache )
+	{
+		cache->summary = *summary;
+		cache->data = data;
+		cache->width = width;
+		cache->height = height;
+		cache->format = format;
+		mlt_properties_set_data( properties, "_alpha_summary", cache, sizeof( *cache ), free, NULL );
+	}
+}
+
+/** Convert the audio of a frame and count the conversion.
+ *
+ * \private \memberof mlt_frame_s
+ * \param self a frame
+ * \param[in,out] buffer the audio samples
+ * \param[in,out] format the audio format
+ * \param requested_format the format to convert to
+ */
+
+static void convert_audio( mlt_frame self, void **buffer, mlt_audio_format *format, mlt_audio_format requested_format )
+{
+	if ( *format != requested_format )
+	{
+		mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+		int size = mlt_audio_format_size( *format, mlt_properties_get_int( properties, "audio_samples" ),
+			mlt_properties_get_int( properties, "audio_channels" ) );
+
+		// The converter may work in place, so it must not get shared audio
+		*buffer = writable_data( properties, "audio", *buffer, size );
+		if ( !self->convert_audio( self, buffer, format, requested_format ) )
+			mlt_properties_set_int( properties, "audio_conversions", mlt_properties_get_int( properties, "audio_conversions" ) + 1 );
+	}
+}
+
 /** Get the audio associated to the frame.
  *
  * You should express the desired format, frequency, channels, and samples as inputs. As long
@@ -741,7 +1186,7 @@ int mlt_frame_get_audio( mlt_frame self, void **buffer, mlt_audio_format *format
 		mlt_properties_set_int( properties, "audio_samples", *samples );
 		mlt_properties_set_int( properties, "audio_format", *format );
 		if ( self->convert_audio && *buffer && requested_format != mlt_audio_none )
-			self->convert_audio( self, buffer, format, requested_format );
+			convert_audio( self, buffer, format, requested_format );
 	}
 	else if ( mlt_properties_get_data( properties, "audio", NULL ) )
 	{
@@ -751,7 +1196,7 @@ int mlt_frame_get_audio( mlt_frame self, void **buffer, mlt_audio_format *format
 		*channels = mlt_properties_get_int( properties, "audio_channels" );
 		*samples = mlt_properties_get_int( properties, "audio_samples" );
 		if ( self->convert_audio && *buffer && requested_format != mlt_audio_none )
-			self->convert_audio( self, buffer, format, requested_format );
+			convert_audio( self, buffer, format, requested_format );
 	}
 	else
 	{
@@ -775,6 +1220,11 @@ int mlt_frame_get_audio( mlt_frame self, void **buffer, mlt_audio_format *format
 		mlt_properties_set_int( properties, "test_audio", 1 );
 	}
 
+	// Audio is modified in place, so it must not be shared
+	if ( *buffer )
+		*buffer = writable_data( properties, "audio", *buffer,
+			mlt_audio_format_size( *format, *samples, *channels ) );
+
 	// TODO: This does not belong here
 	if ( *format == mlt_audio_s16 && mlt_properties_get( properties, "meta.volume" ) && *buffer )
 	{
@@ -801,6 +1251,33 @@ int mlt_frame_get_audio( mlt_frame self, void **buffer, mlt_audio_format *format
 	return 0;
 }
 
+/** Choose the audio format that a service should request from a frame.
+ *
+ * A consumer may declare a native audio format with its mlt_audio_native_format
+ * property. Every service along the chain that can process it then requests it,
+ * so the audio is converted at most once at each end instead of at every step.
+ * The format requested of the calling service wins when the service supports it,
+ * followed by the native format and finally the service's preferred format.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ * \param requested the format that was requested of the calling service
+ * \param preferred the format the calling service uses otherwise
+ * \param supported a mask of MLT_AUDIO_FORMAT_FLAG values that the calling service can process
+ * \return the audio format to request
+ */
+
+mlt_audio_format mlt_frame_choose_audio_format( mlt_frame self, mlt_audio_format requested, mlt_audio_format preferred, int supported )
+{
+	mlt_audio_format native = mlt_properties_get_int( MLT_FRAME_PROPERTIES( self ), "consumer_audio_format" );
+
+	if ( requested != mlt_audio_none && ( supported & MLT_AUDIO_FORMAT_FLAG( requested ) ) )
+		return requested;
+	if ( native != mlt_audio_none && ( supported & MLT_AUDIO_FORMAT_FLAG( native ) ) )
+		return native;
+	return preferred;
+}
+
 /** Set the audio on a frame.
  *
  * \public \memberof mlt_frame_s
@@ -818,10 +1295,61 @@ int mlt_frame_set_audio( mlt_frame self, void *buffer, mlt_audio_format format,
 	return mlt_properties_set_data( MLT_FRAME_PROPERTIES( self ), "audio", buffer, size, destructor, NULL );
 }
 
+/** Draw the waveform of a frame from the peaks of its producer.
+ *
+ * Each channel gets a horizontal lane in which every column spans the minimum
+ * to the maximum of its samples, and the RMS range is drawn brighter.
+ */
+
+static unsigned char *waveform_from_peaks( mlt_frame self, mlt_peaks peaks, double fps, int w, int h )
+{
+	int frequency = mlt_peaks_frequency( peaks );
+	int channels = mlt_peaks_channels( peaks );
+	mlt_position position = mlt_frame_original_position( self );
+	int64_t start = mlt_audio_calculate_samples_to_position( fps, frequency, position );
+	int64_t end = start + mlt_audio_calculate_frame_samples( fps, frequency, position );
+	int size = w * h;
+	unsigned char *bitmap;
+	mlt_peak column;
+	int c, x, y;
+
+	if ( size <= 0 || channels <= 0 )
+		return NULL;
+	bitmap = mlt_pool_alloc( size );
+	column = mlt_pool_alloc( w * sizeof( struct mlt_peak_s ) );
+	if ( bitmap == NULL || column == NULL )
+	{
+		mlt_pool_release( bitmap );
+		mlt_pool_release( column );
+		return NULL;
+	}
+	memset( bitmap, 0, size );
+	mlt_properties_set_data( MLT_FRAME_PROPERTIES( self ), "waveform", bitmap, size, ( mlt_destructor )mlt_pool_release, NULL );
+
+	for ( c = 0; c < channels && !mlt_peaks_read( peaks, c, start, end, w, column ); c++ )
+	{
+		int center = h * ( c * 2 + 1 ) / channels / 2;
+		int half = h / channels / 2;
+		for ( x = 0; x < w; x++ )
+		{
+			int top = MAX( center - column[x].max * half / 32768, 0 );
+			int bottom = MIN( center - column[x].min * half / 32768, h - 1 );
+			int rms = column[x].rms * half / 32768;
+			for ( y = top; y <= bottom; y++ )
+				bitmap[ y * w + x ] = ( y >= center - rms && y <= center + rms ) ? 0xFF : 0x80;
+		}
+	}
+	mlt_pool_release( column );
+
+	return bitmap;
+}
+
 /** Get audio on a frame as a waveform image.
  *
  * This generates an 8-bit grayscale image representation of the audio in a
  * frame. Currently, this only really works for 2 channels.
+ * When the peaks of the producer are ready (see \p mlt_peaks_get), the image is
+ * drawn from them and the audio of the frame is not fetched.
  * This allocates the bitmap using mlt_pool so you should release the return
  * value with \p mlt_pool_release.
  *
@@ -841,6 +1369,12 @@ unsigned char *mlt_frame_get_waveform( mlt_frame self, int w, int h )
 	int channels = 2;
 	mlt_producer producer = mlt_frame_get_original_producer( self );
 	double fps = mlt_producer_get_fps( mlt_producer_cut_parent( producer ) );
+	mlt_peaks peaks = mlt_properties_get_data( MLT_PRODUCER_PROPERTIES( mlt_producer_cut_parent( producer ) ), "_peaks", NULL );
+
+	// Draw from the peaks of the producer when they are ready instead of decoding
+	if ( mlt_peaks_ready( peaks ) )
+		return waveform_from_peaks( self, peaks, fps, w, h );
+
 	int samples = mlt_audio_calculate_frame_samples( fps, frequency, mlt_frame_get_position( self ) );
 
 	// Increase audio resolution proportional to requested image size
@@ -1011,22 +1545,16 @@ mlt_properties mlt_frame_get_unique_properties( mlt_frame self, mlt_service serv
 	return mlt_properties_get_data( MLT_FRAME_PROPERTIES(self), unique, NULL );
 }
 
-/** Make a copy of a frame.
- *
- * This does not copy the get_image/get_audio processing stacks or any
- * data properties other than the audio and image.
+/** Copy the properties of a frame that cannot share them.
  *
- * \public \memberof mlt_frame_s
- * \param self the frame to clone
- * \param is_deep a boolean to indicate whether to make a deep copy of the audio
- * and video data chunks or to make a shallow copy by pointing to the supplied frame
- * \return a almost-complete copy of the frame
- * \todo copy the processing deques
+ * \private \memberof mlt_frame_s
+ * \param self the frame to copy
+ * \param new_frame the copy
+ * \param is_deep whether to copy the audio and video data
  */
 
-mlt_frame mlt_frame_clone( mlt_frame self, int is_deep )
+static void copy_frame( mlt_frame self, mlt_frame new_frame, int is_deep )
 {
-	mlt_frame new_frame = mlt_frame_init( NULL );
 	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
 	mlt_properties new_props = MLT_FRAME_PROPERTIES( new_frame );
 	void *data, *copy;
@@ -1077,7 +1605,49 @@ mlt_frame mlt_frame_clone( mlt_frame self, int is_deep )
 			};
 		}
 	}
-	else
+}
+
+/** Make a copy of a frame.
+ *
+ * This does not copy the get_image/get_audio processing stacks.
+ *
+ * The copy shares all the properties of the frame without copying them,
+ * including every data property, such as the audio, image, and alpha, along
+ * with its destructor. A property stays shared until either frame sets it,
+ * which gives that frame its own property. Shared binary data must not be
+ * modified in place without checking mlt_properties_is_shared() first:
+ * mlt_frame_get_image() with \p writable, mlt_frame_get_audio() and
+ * mlt_frame_get_alpha_mask() do this for the audio, image, and alpha, and
+ * give the frame its own copy before handing it out. A deep copy therefore
+ * behaves as if the audio and image were copied, but only pays for it when
+ * one of the frames modifies them. A shallow copy instead points to the
+ * audio, image, and alpha of the supplied frame without owning them and keeps
+ * a reference to that frame, so changes made to them in place show in both.
+ *
+ * A frame with events attached cannot share its properties. Its copy gets
+ * the serializable properties and, for a deep copy, copies of the audio,
+ * image, and alpha; other data properties are not copied.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self the frame to clone
+ * \param is_deep a boolean to indicate whether to make a deep copy of the audio
+ * and video data chunks or to make a shallow copy by pointing to the supplied frame
+ * \return a almost-complete copy of the frame
+ * \todo copy the processing deques
+ */
+
+mlt_frame mlt_frame_clone( mlt_frame self, int is_deep )
+{
+	mlt_frame new_frame = mlt_frame_init( NULL );
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	mlt_properties new_props = MLT_FRAME_PROPERTIES( new_frame );
+	void *data;
+	int size;
+
+	if ( mlt_properties_clone( new_props, properties ) )
+		copy_frame( self, new_frame, is_deep );
+
+	if ( !is_deep )
 	{
 		// This frame takes a reference on the original frame since the data is a shallow copy.
 		mlt_properties_inc_ref( properties );
@@ -1155,3 +1725,93 @@ int mlt_image_format_planes( mlt_image_format format, int width, int height, voi
 
 	return 0;
 }
+
+/** Summarize an alpha channel.
+ *
+ * \public \memberof mlt_frame_s
+ * \param alpha the first alpha value
+ * \param width the width of the image in pixels
+ * \param height the height of the image in pixels
+ * \param step the distance in bytes between alpha values, 1 for an alpha channel or 4 for rgb24a
+ * \param[out] summary the box around the pixels that are not fully transparent and whether all are opaque
+ */
+
+void mlt_image_alpha_summary( const uint8_t *alpha, int width, int height, int step, mlt_alpha_summary *summary )
+{
+	int left = width, right = -1, top = -1, bottom = -1;
+	int opaque = 1;
+	int x, y;
+
+	for ( y = 0; y < height; y++ )
+	{
+		const uint8_t *row = alpha + (size_t) y * width * step;
+		int first = -1, last = -1;
+
+		if ( step == 1 )
+		{
+			// Skip transparent words from both ends
+			x = 0;
+			while ( x + 8 <= width )
+			{
+				uint64_t word;
+				memcpy( &word, row + x, 8 );
+				if ( word )
+					break;
+				x += 8;
+			}
+			for ( ; x < width; x++ )
+				if ( row[x] ) { first = x; break; }
+			if ( first >= 0 )
+				for ( x = width - 1; x >= first; x-- )
+					if ( row[x] ) { last = x; break; }
+			if ( opaque )
+			{
+				for ( x = 0; x < width; x++ )
+					if ( row[x] != 0xff ) { opaque = 0; break; }
+			}
+		}
+		else
+		{
+			for ( x = 0; x < width; x++ )
+			{
+				uint8_t a = row[x * step];
+				if ( a )
+				{
+					if ( first < 0 )
+						first = x;
+					last = x;
+				}
+				if ( a != 0xff )
+					opaque = 0;
+			}
+		}
+
+		if ( first >= 0 )
+		{
+			if ( top < 0 )
+				top = y;
+			bottom = y;
+			if ( first < left )
+				left = first;
+			if ( last > right )
+				right = last;
+		}
+		else
+		{
+			opaque = 0;
+		}
+	}
+
+	if ( top < 0 )
+	{
+		summary->x = summary->y = summary->width = summary->height = 0;
+	}
+	else
+	{
+		summary->x = left;
+		summary->y = top;
+		summary->width = right - left + 1;
+		summary->height = bottom - top + 1;
+	}
+	summary->opaque = opaque && width > 0 && height > 0;
+}
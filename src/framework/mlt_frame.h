@@ -122,9 +122,14 @@ extern int mlt_frame_set_image( mlt_frame self, uint8_t *image, int size, mlt_de
 extern int mlt_frame_set_alpha( mlt_frame self, uint8_t *alpha, int size, mlt_destructor destroy );
 extern void mlt_frame_replace_image( mlt_frame self, uint8_t *image, mlt_image_format format, int width, int height );
 extern int mlt_frame_get_image( mlt_frame self, uint8_t **buffer, mlt_image_format *format, int *width, int *height, int writable );
+extern int mlt_frame_set_shared_image( mlt_frame self, mlt_image image );
+extern int mlt_frame_get_shared_image( mlt_frame self, mlt_image *image, mlt_image_format *format, int *width, int *height );
+extern int mlt_frame_is_solid( mlt_frame self );
 extern uint8_t *mlt_frame_get_alpha_mask( mlt_frame self );
 extern uint8_t *mlt_frame_get_alpha( mlt_frame self );
+extern void mlt_frame_get_alpha_summary( mlt_frame self, mlt_alpha_summary *summary );
 extern int mlt_frame_get_audio( mlt_frame self, void **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples );
+extern mlt_audio_format mlt_frame_choose_audio_format( mlt_frame self, mlt_audio_format requested, mlt_audio_format preferred, int supported );
 extern int mlt_frame_set_audio( mlt_frame self, void *buffer, mlt_audio_format, int size, mlt_destructor );
 extern unsigned char *mlt_frame_get_waveform( mlt_frame self, int w, int h );
 extern int mlt_frame_push_get_image( mlt_frame self, mlt_get_image get_image );
@@ -149,6 +154,7 @@ extern const char * mlt_image_format_name( mlt_image_format format );
 extern int mlt_image_format_size( mlt_image_format format, int width, int height, int *bpp );
 extern void mlt_frame_write_ppm( mlt_frame frame );
 extern int mlt_image_format_planes( mlt_image_format format, int width, int height, void* data, unsigned char *planes[4], int strides[4]);
+extern void mlt_image_alpha_summary( const uint8_t *alpha, int width, int height, int step, mlt_alpha_summary *summary );
 extern mlt_image_format mlt_image_format_id( const char * name );
 
 /** This macro scales RGB into the YUV gamut - y is scaled by 219/255 and uv by 224/255. */
@@ -0,0 +1,418 @@
+/**
+ * \file mlt_image.c
+ * \brief Image class
+ * \see mlt_image_s
+ *
+ * Copyright (C) 2020 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "mlt_image.h"
+#include "mlt_frame.h"
+#include "mlt_pool.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Get the reference count of an image as an atomic.
+ *
+ * \private \memberof mlt_image_s
+ * \param self the Image object
+ * \return the reference count
+ */
+
+static inline atomic_int *ref_count( mlt_image self )
+{
+	return ( atomic_int* ) &self->ref_count;
+}
+
+/** Allocate a new Image object.
+ *
+ * The new image holds one reference and is writable.
+ *
+ * \return a new image object with default values set
+ */
+
+mlt_image mlt_image_new()
+{
+	mlt_image self = calloc( 1, sizeof(struct mlt_image_s) );
+	self->writable = 1;
+	self->ref_count = 1;
+	self->close = free;
+	return self;
+}
+
+/** Release a reference to an image.
+ *
+ * The data and alpha are released and the object destroyed with the last reference.
+ *
+ * \public \memberof mlt_image_s
+ * \param self the Image object
+ */
+
+void mlt_image_close( mlt_image self )
+{
+	if ( self && atomic_fetch_sub( ref_count( self ), 1 ) <= 1 )
+	{
+		if ( self->release_data )
+		{
+			self->release_data( self->data );
+		}
+		if ( self->release_alpha )
+		{
+			self->release_alpha( self->alpha );
+		}
+		if ( self->close )
+		{
+			self->close( self );
+		}
+	}
+}
+
+/** Add a reference to an image.
+ *
+ * Every reference must be released with mlt_image_close().
+ *
+ * \public \memberof mlt_image_s
+ * \param self the Image object
+ * \return the new reference count
+ */
+
+int mlt_image_inc_ref( mlt_image self )
+{
+	return self ? atomic_fetch_add( ref_count( self ), 1 ) + 1 : 0;
+}
+
+/** Determine if the buffers of an image may be modified in place.
+ *
+ * \public \memberof mlt_image_s
+ * \param self the Image object
+ * \return true if the image is writable and nobody else holds a reference to it
+ */
+
+int mlt_image_is_writable( mlt_image self )
+{
+	return self && self->writable && atomic_load( ref_count( self ) ) <= 1;
+}
+
+/** Set the most common values for the image.
+ *
+ * The planes and strides are computed from the other values.
+ *
+ * \public \memberof mlt_image_s
+ * \param self the Image object
+ * \param data the buffer that contains the image data
+ * \param format the image format
+ * \param width the width of the image in pixels
+ * \param height the height of the image in pixels
+ */
+
+void mlt_image_set_values( mlt_image self, void* data, mlt_image_format format, int width, int height )
+{
+	self->data = data;
+	self->format = format;
+	self->width = width;
+	self->height = height;
+	self->release_data = NULL;
+	mlt_image_format_planes( format, width, height, data, self->planes, self->strides );
+}
+
+/** Get the most common values for the image.
+ *
+ * \public \memberof mlt_image_s
+ * \param self the Image object
+ * \param[out] data the buffer that contains the image data
+ * \param[out] format the image format
+ * \param[out] width the width of the image in pixels
+ * \param[out] height the height of the image in pixels
+ */
+
+void mlt_image_get_values( mlt_image self, void** data, mlt_image_format* format, int* width, int* height )
+{
+	*data = self->data;
+	*format = self->format;
+	*width = self->width;
+	*height = self->height;
+}
+
+/** Allocate the data field based on the other properties of the Image.
+ *
+ * If the data field is already set, and a destructor function exists, the data
+ * will be released. Else, the data pointer will be overwritten without being
+ * released.
+ *
+ * After this function call, the release_data field will be set and can be used
+ * to release the data when necessary.
+ *
+ * \public \memberof mlt_image_s
+ * \param self the Image object
+ */
+
+void mlt_image_alloc_data( mlt_image self )
+{
+	if ( !self ) return;
+
+	if ( self->release_data )
+	{
+		self->release_data( self->data );
+	}
+
+	int size = mlt_image_calculate_size( self );
+	self->data = mlt_pool_alloc( size );
+	self->release_data = mlt_pool_release;
+	mlt_image_format_planes( self->format, self->width, self->height, self->data, self->planes, self->strides );
+}
+
+/** Allocate the alpha field based on the other properties of the Image.
+ *
+ * If the alpha field is already set, and a destructor function exists, the alpha
+ * will be released. Else, the alpha pointer will be overwritten without being
+ * released.
+ *
+ * \public \memberof mlt_image_s
+ * \param self the Image object
+ */
+
+void mlt_image_alloc_alpha( mlt_image self )
+{
+	if ( !self ) return;
+
+	if ( self->release_alpha )
+	{
+		self->release_alpha( self->alpha );
+	}
+
+	self->alpha = mlt_pool_alloc( self->width * self->height );
+	self->release_alpha = mlt_pool_release;
+}
+
+/** Calculate the number of bytes needed for the Image data.
+ *
+ * \public \memberof mlt_image_s
+ * \param self the Image object
+ * \return the number of bytes
+ */
+
+int mlt_image_calculate_size( mlt_image self )
+{
+	if ( !self ) return 0;
+	return mlt_image_format_size( self->format, self->width, self->height, NULL );
+}
+
+/** Determine if the planes of an image are tightly packed.
+ *
+ * A packed image has the layout given by mlt_image_format_planes() for its
+ * format and size, which is what code that only gets a pointer to the image
+ * data expects.
+ *
+ * \public \memberof mlt_image_s
+ * \param self the Image object
+ * \return true if the image is packed
+ */
+
+int mlt_image_is_packed( mlt_image self )
+{
+	uint8_t *planes[4];
+	int strides[4];
+
+	if ( !self ) return 0;
+	mlt_image_format_planes( self->format, self->width, self->height, self->data, planes, strides );
+	return !memcmp( planes, self->planes, sizeof( planes ) ) && !memcmp( strides, self->strides, sizeof( strides ) );
+}
+
+/** Get the number of rows of a plane.
+ *
+ * \private \memberof mlt_image_s
+ * \param self the Image object
+ * \param plane the index of the plane
+ * \return the number of rows
+ */
+
+static int plane_height( mlt_image self, int plane )
+{
+	return ( self->format == mlt_image_yuv420p && plane > 0 ) ? self->height / 2 : self->height;
+}
+
+/** Make a writable copy of an image.
+ *
+ * The copy is packed, whatever the strides of \p self are.
+ *
+ * \public \memberof mlt_image_s
+ * \param self the Image object
+ * \return a new image with its own copy of the data and alpha
+ */
+
+mlt_image mlt_image_copy( mlt_image self )
+{
+	if ( !self ) return NULL;
+
+	mlt_image copy = mlt_image_new();
+	mlt_image_set_values( copy, NULL, self->format, self->width, self->height );
+	copy->colorspace = self->colorspace;
+	if ( self->data )
+	{
+		int i;
+		mlt_image_alloc_data( copy );
+		if ( !copy->strides[0] )
+		{
+			// Formats without planes in memory, such as textures
+			memcpy( copy->data, self->data, mlt_image_calculate_size( copy ) );
+		}
+		for ( i = 0; i < 4 && copy->strides[i]; i++ )
+		{
+			uint8_t *src = self->planes[i];
+			uint8_t *dst = copy->planes[i];
+			int y = plane_height( copy, i );
+
+			if ( self->strides[i] == copy->strides[i] )
+			{
+				memcpy( dst, src, copy->strides[i] * y );
+			}
+			else while ( y-- )
+			{
+				memcpy( dst, src, copy->strides[i] );
+				dst += copy->strides[i];
+				src += self->strides[i];
+			}
+		}
+	}
+	if ( self->alpha )
+	{
+		mlt_image_alloc_alpha( copy );
+		memcpy( copy->alpha, self->alpha, self->width * self->height );
+	}
+	return copy;
+}
+
+/** A view of a region of another image. */
+
+typedef struct
+{
+	struct mlt_image_s image;
+	mlt_image parent;
+}
+image_view;
+
+/** Destroy a view and release its reference to the image it shows.
+ *
+ * \private \memberof mlt_image_s
+ * \param view the view
+ */
+
+static void view_close( void *view )
+{
+	mlt_image_close( ( ( image_view* ) view )->parent );
+	free( view );
+}
+
+/** Get a view of a region of an image.
+ *
+ * The view uses the planes of \p self with their strides, so making one
+ * costs the same whatever the size of the region. The view holds a reference
+ * to \p self and is never writable. The alpha channel is always packed,
+ * so it is copied for the region.
+ *
+ * Packed yuv422 requires the region to start on an even column and yuv420p
+ * on an even column and row; yuv422p16 rounds the chroma down instead.
+ *
+ * \public \memberof mlt_image_s
+ * \param self the Image object
+ * \param left the first column of the region
+ * \param top the first row of the region
+ * \param width the width of the region in pixels
+ * \param height the height of the region in pixels
+ * \return a new image or NULL if the format or region is not supported
+ */
+
+mlt_image mlt_image_crop( mlt_image self, int left, int top, int width, int height )
+{
+	int bpp = 0;
+	int i;
+
+	if ( !self || !self->data || left < 0 || top < 0 || width <= 0 || height <= 0 ||
+		 left + width > self->width || top + height > self->height )
+		return NULL;
+
+	switch ( self->format )
+	{
+	case mlt_image_rgb24:
+	case mlt_image_rgb24a:
+	case mlt_image_opengl:
+		break;
+	case mlt_image_yuv422p16:
+		break;
+	case mlt_image_yuv422:
+		if ( left & 1 )
+			return NULL;
+		break;
+	case mlt_image_yuv420p:
+		if ( ( left & 1 ) || ( top & 1 ) )
+			return NULL;
+		break;
+	default:
+		return NULL;
+	}
+
+	image_view *view = calloc( 1, sizeof( image_view ) );
+	mlt_image result = &view->image;
+
+	mlt_image_inc_ref( self );
+	view->parent = self;
+	result->format = self->format;
+	result->width = width;
+	result->height = height;
+	result->colorspace = self->colorspace;
+	result->solid = self->solid;
+	result->ref_count = 1;
+	result->close = view_close;
+
+	// Offset each plane by the region, allowing for subsampled chroma
+	mlt_image_format_size( self->format, 1, 1, &bpp );
+	for ( i = 0; i < 4 && self->strides[i]; i++ )
+	{
+		int x = left, y = top, step = bpp;
+		if ( i > 0 && ( self->format == mlt_image_yuv420p || self->format == mlt_image_yuv422p16 ) )
+			x = left / 2;
+		if ( i > 0 && self->format == mlt_image_yuv420p )
+			y = top / 2;
+		if ( self->format == mlt_image_yuv420p )
+			step = 1;
+		else if ( self->format == mlt_image_yuv422p16 )
+			step = 2;
+		result->planes[i] = self->planes[i] + y * self->strides[i] + x * step;
+		result->strides[i] = self->strides[i];
+	}
+	result->data = result->planes[0];
+
+	if ( self->alpha )
+	{
+		uint8_t *src = ( uint8_t* ) self->alpha + top * self->width + left;
+		uint8_t *dst;
+		int y = height;
+
+		mlt_image_alloc_alpha( result );
+		dst = result->alpha;
+		while ( y-- )
+		{
+			memcpy( dst, src, width );
+			dst += width;
+			src += self->width;
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,76 @@
+/**
+ * \file mlt_image.h
+ * \brief Image class
+ * \see mlt_image_s
+ *
+ * Copyright (C) 2020 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef MLT_IMAGE_H
+#define MLT_IMAGE_H
+
+#include "mlt_types.h"
+
+/** \brief Image class
+ *
+ * Image is the data object that represents a picture and its alpha channel.
+ *
+ * An image created by mlt_image_new() is reference counted so that frames
+ * and services can share its buffers. Only the holder of the sole reference
+ * to a writable image may modify it; everyone else must make a copy first.
+ *
+ * The planes need not be packed: each row of a plane starts \p strides bytes
+ * after the previous one, which lets mlt_image_crop() show a region of an
+ * image without copying it. The alpha channel is always packed.
+ *
+ * A solid image has the same pixels on every row and the same value
+ * throughout its alpha channel, such as one filled with a colour. Services
+ * may use that to skip per-pixel work. A solid image is never writable.
+ */
+
+struct mlt_image_s
+{
+	mlt_image_format format;
+	int width;
+	int height;
+	int colorspace;
+	uint8_t* planes[4];
+	int strides[4];
+	void* data;
+	mlt_destructor release_data;
+	void* alpha;
+	mlt_destructor release_alpha;
+	int writable;                  /**< whether the buffers may be modified by the sole holder */
+	int solid;                     /**< whether every row of the image and of its alpha is the same */
+	int ref_count;                 /**< private, use mlt_image_inc_ref() and mlt_image_close() */
+	mlt_destructor close;
+};
+
+extern mlt_image mlt_image_new();
+extern void mlt_image_close( mlt_image self );
+extern int mlt_image_inc_ref( mlt_image self );
+extern int mlt_image_is_writable( mlt_image self );
+extern void mlt_image_set_values( mlt_image self, void* data, mlt_image_format format, int width, int height );
+extern void mlt_image_get_values( mlt_image self, void** data, mlt_image_format* format, int* width, int* height );
+extern void mlt_image_alloc_data( mlt_image self );
+extern void mlt_image_alloc_alpha( mlt_image self );
+extern int mlt_image_calculate_size( mlt_image self );
+extern int mlt_image_is_packed( mlt_image self );
+extern mlt_image mlt_image_copy( mlt_image self );
+extern mlt_image mlt_image_crop( mlt_image self, int left, int top, int width, int height );
+
+#endif
@@ -26,9 +26,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #define HALF_USHRT_MAX (1 << 15)
 
+/** the default number of bytes the luma map cache keeps for unused maps */
+#define LUMA_CACHE_DEFAULT_BUDGET (64 * 1024 * 1024)
+
 void mlt_luma_map_init(mlt_luma_map self)
 {
 	memset( self, 0, sizeof(struct mlt_luma_map_s) );
@@ -556,3 +560,305 @@ void mlt_luma_map_from_yuv422(uint8_t *image, uint16_t **map, int width, int hei
 	for ( i = 0; i < size; i += 2 )
 		*p++ = ( image[ i ] - 16 ) * 299; // 299 = 65535 / 219
 }
+
+/** Scale a 16-bit luma map using nearest neighbor.
+ *
+ * \param dest the destination map of \p dest_width x \p dest_height samples
+ * \param src the source map of \p src_width x \p src_height samples
+ * \param invert whether to invert the values
+ */
+
+void mlt_luma_map_scale(uint16_t *dest, int dest_width, int dest_height, const uint16_t *src, int src_width, int src_height, int invert)
+{
+	int x_step = ( src_width << 16 ) / dest_width;
+	int y_step = ( src_height << 16 ) / dest_height;
+	uint16_t mask = invert ? 0xffff : 0;
+	int i, j, x, y = 0;
+
+	for ( i = 0; i < dest_height; i++ )
+	{
+		const uint16_t *row = src + ( y >> 16 ) * src_width;
+		x = 0;
+		for ( j = 0; j < dest_width; j++ )
+		{
+			*dest++ = row[ x >> 16 ] ^ mask;
+			x += x_step;
+		}
+		y += y_step;
+	}
+}
+
+/** \brief Luma map cache entry
+ *
+ * An entry is identified by the resource it was loaded from, the size it was
+ * scaled to (zero for the original size) and whether it was inverted.
+ */
+
+typedef struct luma_cache_entry_s
+{
+	char *resource;
+	int key_width;
+	int key_height;
+	int invert;
+	uint16_t *map;
+	int width;
+	int height;
+	int refcount;
+	struct luma_cache_entry_s *next; ///< the next entry, most recently used first
+} luma_cache_entry;
+
+static pthread_mutex_t luma_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static luma_cache_entry *luma_cache = NULL;
+static int64_t luma_cache_budget = LUMA_CACHE_DEFAULT_BUDGET;
+
+static int64_t luma_entry_size( luma_cache_entry *entry )
+{
+	return (int64_t) entry->width * entry->height * sizeof( uint16_t );
+}
+
+static void luma_entry_close( luma_cache_entry *entry )
+{
+	mlt_pool_release( entry->map );
+	free( entry->resource );
+	free( entry );
+}
+
+/** Release unused entries, least recently used first, until the cache fits its budget.
+ * The caller must hold the cache mutex.
+ */
+
+static void luma_cache_trim( )
+{
+	int64_t total = 0;
+	luma_cache_entry *entry;
+	luma_cache_entry **link;
+	luma_cache_entry **victim;
+
+	for ( entry = luma_cache; entry; entry = entry->next )
+		total += luma_entry_size( entry );
+
+	while ( total > luma_cache_budget )
+	{
+		victim = NULL;
+		for ( link = &luma_cache; *link; link = &(*link)->next )
+			if ( (*link)->refcount == 0 )
+				victim = link;
+		if ( !victim )
+			break;
+		entry = *victim;
+		*victim = entry->next;
+		total -= luma_entry_size( entry );
+		luma_entry_close( entry );
+	}
+}
+
+/** Find an entry and move it to the front of the list.
+ * The caller must hold the cache mutex.
+ */
+
+static luma_cache_entry *luma_cache_find( const char *resource, int width, int height, int invert )
+{
+	luma_cache_entry **link;
+
+	for ( link = &luma_cache; *link; link = &(*link)->next )
+	{
+		luma_cache_entry *entry = *link;
+		if ( entry->key_width == width && entry->key_height == height && entry->invert == invert
+			&& !strcmp( entry->resource, resource ) )
+		{
+			*link = entry->next;
+			entry->next = luma_cache;
+			luma_cache = entry;
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/** Get a luma map from the shared cache.
+ *
+ * Maps are shared by every transition using the same resource, size and
+ * inversion. The returned map holds a reference which must be released with
+ * mlt_luma_map_cache_release(). It must not be modified.
+ *
+ * \param resource the file or producer the map was made from
+ * \param[in,out] width the scaled width or 0 for the map as loaded; on return, the width of the map
+ * \param[in,out] height the scaled height or 0 for the map as loaded; on return, the height of the map
+ * \param invert whether the map is inverted
+ * \return the map or NULL if it is not cached
+ */
+
+uint16_t *mlt_luma_map_cache_get(const char *resource, int *width, int *height, int invert)
+{
+	uint16_t *map = NULL;
+	luma_cache_entry *entry;
+
+	if ( !resource )
+		return NULL;
+	pthread_mutex_lock( &luma_cache_mutex );
+	entry = luma_cache_find( resource, *width, *height, !!invert );
+	if ( entry )
+	{
+		entry->refcount++;
+		*width = entry->width;
+		*height = entry->height;
+		map = entry->map;
+	}
+	pthread_mutex_unlock( &luma_cache_mutex );
+	return map;
+}
+
+/** Add a luma map to the shared cache.
+ *
+ * The cache takes ownership of \p map, which must have been allocated with
+ * mlt_pool_alloc(). If another thread already added the same map, \p map is
+ * released and the cached one is returned instead.
+ *
+ * \param resource the file or producer the map was made from
+ * \param key_width the scaled width or 0 for the map as loaded
+ * \param key_height the scaled height or 0 for the map as loaded
+ * \param invert whether the map is inverted
+ * \param map the map
+ * \param width the width of \p map
+ * \param height the height of \p map
+ * \return the cached map holding a reference for the caller
+ */
+
+uint16_t *mlt_luma_map_cache_put(const char *resource, int key_width, int key_height, int invert, uint16_t *map, int width, int height)
+{
+	luma_cache_entry *entry;
+
+	if ( !resource || !map )
+		return map;
+	pthread_mutex_lock( &luma_cache_mutex );
+	entry = luma_cache_find( resource, key_width, key_height, !!invert );
+	if ( entry )
+	{
+		mlt_pool_release( map );
+	}
+	else if ( ( entry = calloc( 1, sizeof( *entry ) ) ) )
+	{
+		entry->resource = strdup( resource );
+		entry->key_width = key_width;
+		entry->key_height = key_height;
+		entry->invert = !!invert;
+		entry->map = map;
+		entry->width = width;
+		entry->height = height;
+		entry->next = luma_cache;
+		luma_cache = entry;
+	}
+	else
+	{
+		// Out of memory, the caller keeps an uncached map
+		pthread_mutex_unlock( &luma_cache_mutex );
+		return map;
+	}
+	entry->refcount++;
+	map = entry->map;
+	luma_cache_trim( );
+	pthread_mutex_unlock( &luma_cache_mutex );
+	return map;
+}
+
+/** Get a scaled luma map, making it from the cached original if needed.
+ *
+ * \param resource the file or producer the map was made from
+ * \param width the scaled width
+ * \param height the scaled height
+ * \param invert whether to invert the map
+ * \return the map holding a reference for the caller or NULL if the original is not cached
+ */
+
+uint16_t *mlt_luma_map_cache_get_scaled(const char *resource, int width, int height, int invert)
+{
+	int w = width, h = height;
+	uint16_t *map = mlt_luma_map_cache_get( resource, &w, &h, invert );
+
+	if ( !map )
+	{
+		int orig_width = 0, orig_height = 0;
+		uint16_t *orig = mlt_luma_map_cache_get( resource, &orig_width, &orig_height, 0 );
+
+		if ( orig )
+		{
+			map = mlt_pool_alloc( width * height * sizeof( uint16_t ) );
+			if ( map )
+			{
+				mlt_luma_map_scale( map, width, height, orig, orig_width, orig_height, invert );
+				map = mlt_luma_map_cache_put( resource, width, height, invert, map, width, height );
+			}
+			mlt_luma_map_cache_release( orig );
+		}
+	}
+	return map;
+}
+
+/** Release a reference to a map obtained from the cache.
+ *
+ * This has the signature of a mlt_destructor so that it can be used as the
+ * destructor of a property. Maps that are not in the cache are released to the pool.
+ *
+ * \param map a map returned by mlt_luma_map_cache_get() or mlt_luma_map_cache_put()
+ */
+
+void mlt_luma_map_cache_release(void *map)
+{
+	luma_cache_entry *entry;
+
+	if ( !map )
+		return;
+	pthread_mutex_lock( &luma_cache_mutex );
+	for ( entry = luma_cache; entry; entry = entry->next )
+		if ( entry->map == map && entry->refcount > 0 )
+			break;
+	if ( entry )
+	{
+		entry->refcount--;
+		luma_cache_trim( );
+	}
+	pthread_mutex_unlock( &luma_cache_mutex );
+	if ( !entry )
+		mlt_pool_release( map );
+}
+
+/** Set the number of bytes the cache may use.
+ *
+ * Maps that are in use are never released, so the budget only limits how many
+ * unused maps are kept for later.
+ *
+ * \param bytes the budget in bytes
+ */
+
+void mlt_luma_map_cache_set_budget(int64_t bytes)
+{
+	pthread_mutex_lock( &luma_cache_mutex );
+	luma_cache_budget = bytes;
+	luma_cache_trim( );
+	pthread_mutex_unlock( &luma_cache_mutex );
+}
+
+/** Release all unused maps from the cache.
+ */
+
+void mlt_luma_map_cache_purge()
+{
+	luma_cache_entry **link;
+
+	pthread_mutex_lock( &luma_cache_mutex );
+	link = &luma_cache;
+	while ( *link )
+	{
+		luma_cache_entry *entry = *link;
+		if ( entry->refcount == 0 )
+		{
+			*link = entry->next;
+			luma_entry_close( entry );
+		}
+		else
+		{
+			link = &entry->next;
+		}
+	}
+	pthread_mutex_unlock( &luma_cache_mutex );
+}
@@ -57,6 +57,13 @@ extern mlt_luma_map mlt_luma_map_new( const char *path );
 extern uint16_t *mlt_luma_map_render( mlt_luma_map self );
 extern int mlt_luma_map_from_pgm( const char *filename, uint16_t **map, int *width, int *height );
 extern void mlt_luma_map_from_yuv422( uint8_t *image, uint16_t **map, int width, int height );
+extern void mlt_luma_map_scale( uint16_t *dest, int dest_width, int dest_height, const uint16_t *src, int src_width, int src_height, int invert );
+extern uint16_t *mlt_luma_map_cache_get( const char *resource, int *width, int *height, int invert );
+extern uint16_t *mlt_luma_map_cache_put( const char *resource, int key_width, int key_height, int invert, uint16_t *map, int width, int height );
+extern uint16_t *mlt_luma_map_cache_get_scaled( const char *resource, int width, int height, int invert );
+extern void mlt_luma_map_cache_release( void *map );
+extern void mlt_luma_map_cache_set_budget( int64_t bytes );
+extern void mlt_luma_map_cache_purge( );
 
 #ifdef __cplusplus
 }
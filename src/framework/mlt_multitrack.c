@@ -148,6 +148,7 @@ void mlt_multitrack_refresh( mlt_multitrack self )
 	}
 
 	// Update multitrack properties now - we'll not destroy the in point here
+	mlt_properties_touch( properties );
 	mlt_events_block( properties, properties );
 	mlt_properties_set_position( properties, "length", length );
 	mlt_events_unblock( properties, properties );
@@ -0,0 +1,736 @@
+/**
+ * \file mlt_peaks.c
+ * \brief audio peak files for drawing waveforms without decoding
+ * \see mlt_peaks_s
+ *
+ * Copyright (C) 2019 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "mlt_peaks.h"
+#include "mlt_producer.h"
+#include "mlt_factory.h"
+#include "mlt_filter.h"
+#include "mlt_frame.h"
+#include "mlt_audio.h"
+#include "mlt_profile.h"
+#include "mlt_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#define PEAKS_MAGIC "MLTPEAKS"
+#define PEAKS_VERSION (1)
+#define PEAKS_FREQUENCY (48000)
+#define PEAKS_BLOCK (256)
+#define PEAKS_MAX_CHANNELS (8)
+#define PEAKS_MAX_LEVELS (32)
+
+/** The header of a peak file.
+ *
+ * Level 0 holds a peak for every block of PEAKS_BLOCK samples and every
+ * further level merges pairs of peaks of the level below, down to a single
+ * peak. Each level is an array of blocks, and each block holds one
+ * mlt_peak_s per channel. The file is the same in memory and on disk so it
+ * can be mapped as is.
+ */
+
+typedef struct
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t frequency;
+	uint32_t channels;
+	uint32_t block;
+	uint32_t levels;
+	uint32_t reserved;
+	int64_t samples;                    /**< the number of samples covered */
+	uint64_t key;                       /**< a hash of the identity of the resource */
+	uint64_t offsets[PEAKS_MAX_LEVELS]; /**< byte offset of each level */
+	uint64_t counts[PEAKS_MAX_LEVELS];  /**< number of blocks in each level */
+} peaks_header;
+
+/** \brief Peaks class
+ *
+ * The peaks of a producer are decoded once by a background thread from a
+ * private instance of the producer and saved to a sidecar file named after the
+ * identity of the resource. Later instances of the same resource, in this or
+ * another process, map the file instead of decoding. A pass that could not
+ * decode all of the audio is kept in memory only.
+ */
+
+struct mlt_peaks_s
+{
+	uint8_t *data;           /**< the header followed by the levels */
+	size_t size;             /**< the size of data in bytes */
+	int mapped;              /**< whether data is a mapping of the file */
+	char *path;              /**< the sidecar file or NULL to keep the peaks in memory */
+	mlt_profile profile;     /**< the profile of the producer */
+	mlt_properties source;   /**< a copy of the properties of the producer */
+	mlt_producer producer;   /**< the private producer that is decoded */
+	pthread_t thread;
+	int running;
+	pthread_mutex_t mutex;
+	int ready;
+	int cancel;
+	int64_t decoded;
+};
+
+static uint64_t hash_bytes( uint64_t hash, const void *data, size_t size )
+{
+	const uint8_t *p = data;
+	while ( size-- )
+	{
+		hash ^= *p++;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static uint64_t hash_string( uint64_t hash, const char *s )
+{
+	return hash_bytes( hash, s, strlen( s ) + 1 );
+}
+
+/** Compute the offsets of the levels.
+ * \return the total size in bytes
+ */
+
+static size_t peaks_layout( peaks_header *header )
+{
+	uint64_t count = ( header->samples + header->block - 1 ) / header->block;
+	uint64_t offset = sizeof( peaks_header );
+	uint32_t level = 0;
+
+	if ( count < 1 )
+		count = 1;
+	while ( level < PEAKS_MAX_LEVELS )
+	{
+		header->offsets[level] = offset;
+		header->counts[level] = count;
+		offset += count * header->channels * sizeof( struct mlt_peak_s );
+		level ++;
+		if ( count == 1 )
+			break;
+		count = ( count + 1 ) / 2;
+	}
+	header->levels = level;
+	return offset;
+}
+
+static int make_directories( char *path )
+{
+	char *p = path + 1;
+	struct stat st;
+
+	while ( 1 )
+	{
+		char c;
+		p += strcspn( p, "/" );
+		c = *p;
+		*p = '\0';
+		if ( stat( path, &st ) )
+		{
+#ifdef _WIN32
+			int error = mkdir( path );
+#else
+			int error = mkdir( path, 0755 );
+#endif
+			if ( error && stat( path, &st ) )
+			{
+				*p = c;
+				return 1;
+			}
+		}
+		*p = c;
+		if ( !c )
+			break;
+		p ++;
+	}
+	return 0;
+}
+
+/** Find the sidecar file of a resource.
+ *
+ * Only resources that are files are saved. The directory is the producer
+ * property "peaks_directory", else the environment variable MLT_PEAKS_DIR,
+ * else mlt/peaks in the user's cache directory. An empty directory keeps the
+ * peaks in memory.
+ */
+
+static char *peaks_path( mlt_properties properties, uint64_t key )
+{
+	const char *directory = mlt_properties_get( properties, "peaks_directory" );
+	char *base = NULL;
+	char *path = NULL;
+
+	if ( !directory )
+		directory = getenv( "MLT_PEAKS_DIR" );
+	if ( !directory )
+	{
+		const char *cache = getenv( "XDG_CACHE_HOME" );
+		const char *home = getenv( "HOME" );
+		if ( cache || home )
+		{
+			base = malloc( strlen( cache ? cache : home ) + 20 );
+			sprintf( base, cache ? "%s/mlt/peaks" : "%s/.cache/mlt/peaks", cache ? cache : home );
+		}
+	}
+	else if ( strcmp( directory, "" ) )
+	{
+		base = strdup( directory );
+	}
+
+	if ( base && !make_directories( base ) )
+	{
+		path = malloc( strlen( base ) + 32 );
+		sprintf( path, "%s/%016" PRIx64 ".peaks", base, key );
+	}
+	free( base );
+	return path;
+}
+
+/** Map the sidecar file if it matches the header.
+ * \return true if there is no valid file
+ */
+
+static int peaks_load( mlt_peaks self, const peaks_header *expected )
+{
+	struct stat st;
+	int error = 1;
+
+	if ( !self->path || stat( self->path, &st ) || st.st_size != (off_t) self->size )
+		return 1;
+#ifndef _WIN32
+	int fd = open( self->path, O_RDONLY );
+	if ( fd >= 0 )
+	{
+		void *data = mmap( NULL, self->size, PROT_READ, MAP_SHARED, fd, 0 );
+		close( fd );
+		if ( data != MAP_FAILED )
+		{
+			self->data = data;
+			self->mapped = 1;
+		}
+	}
+#else
+	FILE *file = fopen( self->path, "rb" );
+	if ( file )
+	{
+		self->data = malloc( self->size );
+		if ( self->data && fread( self->data, 1, self->size, file ) != self->size )
+		{
+			free( self->data );
+			self->data = NULL;
+		}
+		fclose( file );
+	}
+#endif
+	if ( self->data )
+	{
+		error = memcmp( self->data, expected, sizeof( peaks_header ) );
+		if ( error )
+		{
+#ifndef _WIN32
+			munmap( self->data, self->size );
+#else
+			free( self->data );
+#endif
+			self->data = NULL;
+			self->mapped = 0;
+		}
+	}
+	return error;
+}
+
+/** Write the peaks to the sidecar file, replacing it atomically.
+*/
+
+static void peaks_save( mlt_peaks self )
+{
+	char *temp;
+	FILE *file;
+
+	if ( !self->path )
+		return;
+	temp = malloc( strlen( self->path ) + 32 );
+	sprintf( temp, "%s.%p.tmp", self->path, (void*) self );
+	file = fopen( temp, "wb" );
+	if ( file )
+	{
+		int error = fwrite( self->data, 1, self->size, file ) != self->size;
+		error |= fclose( file );
+		if ( error || rename( temp, self->path ) )
+			remove( temp );
+	}
+	free( temp );
+}
+
+static void merge_peak( mlt_peak dest, const struct mlt_peak_s *a, const struct mlt_peak_s *b )
+{
+	double ra = a->rms, rb = b->rms;
+	dest->min = MIN( a->min, b->min );
+	dest->max = MAX( a->max, b->max );
+	dest->rms = sqrt( ( ra * ra + rb * rb ) / 2 );
+}
+
+/** Create the private producer that is decoded in the background.
+*/
+
+static mlt_producer peaks_producer( mlt_profile profile, mlt_properties properties, int frequency )
+{
+	mlt_producer result = mlt_factory_producer( profile, mlt_properties_get( properties, "mlt_service" ),
+		mlt_properties_get( properties, "resource" ) );
+
+	if ( result )
+	{
+		mlt_properties result_properties = MLT_PRODUCER_PROPERTIES( result );
+		int count = mlt_properties_count( properties );
+		char frequency_arg[20];
+		mlt_filter filter;
+		int i;
+
+		// Carry over the settings that select and shape the audio, such as audio_index.
+		for ( i = 0; i < count; i++ )
+		{
+			const char *name = mlt_properties_get_name( properties, i );
+			const char *value = mlt_properties_get_value( properties, i );
+			if ( name && value && name[0] != '_' && strncmp( name, "mlt_", 4 ) && strcmp( name, "resource" ) )
+				mlt_properties_set( result_properties, name, value );
+		}
+		mlt_properties_set_int( result_properties, "video_index", -1 );
+
+		// Normalise the audio like the loader does.
+		filter = mlt_factory_filter( profile, "audioconvert", NULL );
+		if ( filter )
+		{
+			mlt_producer_attach( result, filter );
+			mlt_filter_close( filter );
+		}
+		snprintf( frequency_arg, sizeof( frequency_arg ), "%d", frequency );
+		filter = mlt_factory_filter( profile, "audioresample", frequency_arg );
+		if ( filter )
+		{
+			mlt_producer_attach( result, filter );
+			mlt_filter_close( filter );
+		}
+	}
+	return result;
+}
+
+static void *peaks_thread( void *arg )
+{
+	mlt_peaks self = arg;
+	peaks_header *header = (peaks_header*) self->data;
+	mlt_peak peaks = (mlt_peak)( self->data + header->offsets[0] );
+	int channels = header->channels;
+	int16_t min[PEAKS_MAX_CHANNELS], max[PEAKS_MAX_CHANNELS];
+	double sum[PEAKS_MAX_CHANNELS];
+	mlt_position position = 0;
+	int64_t decoded = 0;
+	int fill = 0;
+	int cancel = 0;
+	int failed = 0;
+	uint32_t level;
+	int c;
+
+	// Opening the producer may be slow, so it is done here rather than by mlt_peaks_get().
+	mlt_producer producer = self->producer = peaks_producer( self->profile, self->source, header->frequency );
+	if ( !producer )
+	{
+		mlt_log_warning( NULL, "cannot decode the peaks of %s\n", mlt_properties_get( self->source, "resource" ) );
+		return NULL;
+	}
+	double fps = mlt_producer_get_fps( producer );
+
+	for ( c = 0; c < channels; c++ )
+	{
+		min[c] = max[c] = 0;
+		sum[c] = 0.0;
+	}
+
+	mlt_producer_seek( producer, 0 );
+	while ( !cancel && decoded < header->samples )
+	{
+		mlt_frame frame = NULL;
+		int16_t *pcm = NULL;
+		mlt_audio_format format = mlt_audio_s16;
+		int frequency = header->frequency;
+		int frame_channels = channels;
+		int samples = mlt_audio_calculate_frame_samples( fps, frequency, position++ );
+		int i;
+
+		if ( mlt_service_get_frame( MLT_PRODUCER_SERVICE( producer ), &frame, 0 ) || !frame )
+		{
+			failed = 1;
+			break;
+		}
+		// Audio that cannot be had as 16-bit at the peak frequency counts as silence,
+		// and the pass is then not saved.
+		if ( mlt_frame_get_audio( frame, (void**) &pcm, &format, &frequency, &frame_channels, &samples ) ||
+			 !pcm || format != mlt_audio_s16 || frequency != (int) header->frequency )
+		{
+			pcm = NULL;
+			samples = mlt_audio_calculate_frame_samples( fps, header->frequency, position - 1 );
+			failed = 1;
+		}
+
+		for ( i = 0; i < samples && decoded < header->samples; i++, decoded++ )
+		{
+			for ( c = 0; c < channels; c++ )
+			{
+				int16_t value = pcm && c < frame_channels ? pcm[ i * frame_channels + c ] : 0;
+				if ( !fill || value < min[c] ) min[c] = value;
+				if ( !fill || value > max[c] ) max[c] = value;
+				sum[c] += (double) value * value;
+			}
+			if ( ++fill == (int) header->block )
+			{
+				for ( c = 0; c < channels; c++, peaks++ )
+				{
+					peaks->min = min[c];
+					peaks->max = max[c];
+					peaks->rms = MIN( sqrt( sum[c] / fill ), 65535.0 );
+					sum[c] = 0.0;
+				}
+				fill = 0;
+			}
+		}
+		mlt_frame_close( frame );
+
+		pthread_mutex_lock( &self->mutex );
+		self->decoded = decoded;
+		cancel = self->cancel;
+		pthread_mutex_unlock( &self->mutex );
+	}
+
+	if ( fill )
+	{
+		for ( c = 0; c < channels; c++, peaks++ )
+		{
+			peaks->min = min[c];
+			peaks->max = max[c];
+			peaks->rms = MIN( sqrt( sum[c] / fill ), 65535.0 );
+		}
+	}
+
+	if ( cancel )
+		return NULL;
+
+	// Build the coarser levels from the finer ones.
+	for ( level = 1; level < header->levels; level++ )
+	{
+		mlt_peak src = (mlt_peak)( self->data + header->offsets[level - 1] );
+		mlt_peak dest = (mlt_peak)( self->data + header->offsets[level] );
+		uint64_t b;
+		for ( b = 0; b < header->counts[level]; b++ )
+		{
+			for ( c = 0; c < channels; c++ )
+			{
+				const struct mlt_peak_s *a = &src[ 2 * b * channels + c ];
+				const struct mlt_peak_s *n = 2 * b + 1 < header->counts[level - 1] ? &src[ ( 2 * b + 1 ) * channels + c ] : a;
+				merge_peak( &dest[ b * channels + c ], a, n );
+			}
+		}
+	}
+
+	pthread_mutex_lock( &self->mutex );
+	self->ready = 1;
+	pthread_mutex_unlock( &self->mutex );
+
+	// Only save a complete pass of decoded audio.
+	if ( decoded == header->samples && !failed )
+		peaks_save( self );
+	else if ( failed )
+		mlt_log_warning( producer, "could not decode all of the audio of %s for its peaks\n",
+			mlt_properties_get( self->source, "resource" ) );
+
+	return NULL;
+}
+
+/** Get the peaks of a producer.
+ *
+ * The first call for a producer looks for a sidecar file of its resource and
+ * otherwise starts decoding its audio in the background. The peaks belong to
+ * the producer, or its parent if it is a cut, and are closed with it.
+ *
+ * \public \memberof mlt_peaks_s
+ * \param producer a producer
+ * \return the peaks, which may not be ready yet, or NULL if the producer has no resource
+ */
+
+mlt_peaks mlt_peaks_get( mlt_producer producer )
+{
+	mlt_properties properties;
+	mlt_peaks self;
+
+	if ( !producer )
+		return NULL;
+	producer = mlt_producer_cut_parent( producer );
+	properties = MLT_PRODUCER_PROPERTIES( producer );
+
+	mlt_service_lock( MLT_PRODUCER_SERVICE( producer ) );
+	self = mlt_properties_get_data( properties, "_peaks", NULL );
+	if ( !self && mlt_properties_get( properties, "resource" ) && mlt_properties_get( properties, "mlt_service" ) )
+	{
+		const char *resource = mlt_properties_get( properties, "resource" );
+		mlt_profile profile = mlt_service_profile( MLT_PRODUCER_SERVICE( producer ) );
+		double fps = profile ? mlt_profile_fps( profile ) : mlt_producer_get_fps( producer );
+		int channels = mlt_properties_get_int( properties, "audio_channels" );
+		peaks_header header;
+		struct stat st;
+
+		memset( &header, 0, sizeof( header ) );
+		memcpy( header.magic, PEAKS_MAGIC, sizeof( header.magic ) );
+		header.version = PEAKS_VERSION;
+		header.frequency = PEAKS_FREQUENCY;
+		header.channels = channels > 0 ? MIN( channels, PEAKS_MAX_CHANNELS ) : 2;
+		header.block = PEAKS_BLOCK;
+		header.samples = mlt_audio_calculate_samples_to_position( fps, header.frequency, mlt_producer_get_length( producer ) );
+
+		// The identity of the resource: the service, the resource and the size and time of the file.
+		header.key = hash_string( 0xcbf29ce484222325ULL, mlt_properties_get( properties, "mlt_service" ) );
+		header.key = hash_string( header.key, resource );
+		header.key = hash_string( header.key, mlt_properties_get( properties, "audio_index" ) ? mlt_properties_get( properties, "audio_index" ) : "" );
+		if ( !stat( resource, &st ) )
+		{
+			int64_t size = st.st_size;
+			int64_t mtime = st.st_mtime;
+			header.key = hash_bytes( header.key, &size, sizeof( size ) );
+			header.key = hash_bytes( header.key, &mtime, sizeof( mtime ) );
+		}
+
+		self = calloc( 1, sizeof( struct mlt_peaks_s ) );
+		if ( self )
+		{
+			pthread_mutex_init( &self->mutex, NULL );
+			self->size = peaks_layout( &header );
+			// Only files have an identity that outlives the producer.
+			if ( !stat( resource, &st ) && S_ISREG( st.st_mode ) )
+				self->path = peaks_path( properties, header.key );
+			if ( !peaks_load( self, &header ) )
+			{
+				self->ready = 1;
+				self->decoded = header.samples;
+			}
+			else
+			{
+				self->data = calloc( 1, self->size );
+				self->source = mlt_properties_new();
+				if ( self->data && self->source )
+				{
+					memcpy( self->data, &header, sizeof( header ) );
+					self->profile = profile;
+					mlt_properties_inherit( self->source, properties );
+					self->running = !pthread_create( &self->thread, NULL, peaks_thread, self );
+				}
+				if ( !self->running )
+					mlt_log_warning( MLT_PRODUCER_SERVICE( producer ), "cannot decode the peaks of %s\n", resource );
+			}
+			mlt_properties_set_data( properties, "_peaks", self, 0, (mlt_destructor) mlt_peaks_close, NULL );
+		}
+	}
+	mlt_service_unlock( MLT_PRODUCER_SERVICE( producer ) );
+
+	return self;
+}
+
+/** Determine if the peaks can be read.
+ *
+ * \public \memberof mlt_peaks_s
+ * \param self the peaks
+ * \return true if the peaks are complete
+ */
+
+int mlt_peaks_ready( mlt_peaks self )
+{
+	int ready = 0;
+	if ( self )
+	{
+		pthread_mutex_lock( &self->mutex );
+		ready = self->ready;
+		pthread_mutex_unlock( &self->mutex );
+	}
+	return ready;
+}
+
+/** Get the progress of the background pass.
+ *
+ * \public \memberof mlt_peaks_s
+ * \param self the peaks
+ * \return the fraction of the audio decoded so far
+ */
+
+double mlt_peaks_progress( mlt_peaks self )
+{
+	double progress = 0.0;
+	if ( self && self->data )
+	{
+		peaks_header *header = (peaks_header*) self->data;
+		pthread_mutex_lock( &self->mutex );
+		progress = header->samples > 0 ? (double) self->decoded / header->samples : 1.0;
+		pthread_mutex_unlock( &self->mutex );
+	}
+	return progress;
+}
+
+/** Get the sample rate of the peaks.
+ *
+ * \public \memberof mlt_peaks_s
+ * \param self the peaks
+ * \return the samples per second that sample positions refer to
+ */
+
+int mlt_peaks_frequency( mlt_peaks self )
+{
+	return self && self->data ? ( (peaks_header*) self->data )->frequency : 0;
+}
+
+/** Get the number of channels of the peaks.
+ *
+ * \public \memberof mlt_peaks_s
+ * \param self the peaks
+ * \return the number of channels
+ */
+
+int mlt_peaks_channels( mlt_peaks self )
+{
+	return self && self->data ? ( (peaks_header*) self->data )->channels : 0;
+}
+
+/** Get the number of samples covered by the peaks.
+ *
+ * \public \memberof mlt_peaks_s
+ * \param self the peaks
+ * \return the number of samples at the peaks frequency
+ */
+
+int64_t mlt_peaks_samples( mlt_peaks self )
+{
+	return self && self->data ? ( (peaks_header*) self->data )->samples : 0;
+}
+
+/** Read the peaks of a range of samples.
+ *
+ * The range is divided into \p count equal columns and the peak of each is
+ * merged from the coarsest level that still resolves a column. Columns
+ * narrower than a block report the peak of the whole block.
+ *
+ * \public \memberof mlt_peaks_s
+ * \param self the peaks
+ * \param channel the channel to read
+ * \param start the first sample
+ * \param end the sample after the last one
+ * \param count the number of columns
+ * \param peaks an array of \p count peaks to fill
+ * \return true if the peaks are not ready or the arguments are invalid
+ */
+
+int mlt_peaks_read( mlt_peaks self, int channel, int64_t start, int64_t end, int count, mlt_peak peaks )
+{
+	peaks_header *header;
+	const struct mlt_peak_s *level_peaks;
+	int64_t block, blocks;
+	double per_column;
+	uint32_t level = 0;
+	int i;
+
+	if ( !peaks || count <= 0 || end <= start || !mlt_peaks_ready( self ) )
+		return 1;
+	header = (peaks_header*) self->data;
+	if ( channel < 0 || channel >= (int) header->channels )
+		return 1;
+
+	per_column = (double) ( end - start ) / count;
+	while ( level + 1 < header->levels && (double) ( (int64_t) header->block << ( level + 1 ) ) <= per_column )
+		level ++;
+	block = (int64_t) header->block << level;
+	blocks = header->counts[level];
+	level_peaks = (const struct mlt_peak_s*)( self->data + header->offsets[level] );
+
+	for ( i = 0; i < count; i++ )
+	{
+		int64_t s0 = start + ( end - start ) * i / count;
+		int64_t s1 = start + ( end - start ) * ( i + 1 ) / count;
+		int64_t b0 = MAX( s0, 0 ) / block;
+		int64_t b1 = MAX( ( s1 + block - 1 ) / block, b0 + 1 );
+		double sum = 0.0;
+		int n = 0;
+
+		peaks[i].min = INT16_MAX;
+		peaks[i].max = INT16_MIN;
+		for ( ; s1 > 0 && b0 < b1 && b0 < blocks; b0++, n++ )
+		{
+			const struct mlt_peak_s *p = &level_peaks[ b0 * header->channels + channel ];
+			peaks[i].min = MIN( peaks[i].min, p->min );
+			peaks[i].max = MAX( peaks[i].max, p->max );
+			sum += (double) p->rms * p->rms;
+		}
+		if ( n )
+		{
+			peaks[i].rms = sqrt( sum / n );
+		}
+		else
+		{
+			peaks[i].min = peaks[i].max = 0;
+			peaks[i].rms = 0;
+		}
+	}
+	return 0;
+}
+
+/** Close the peaks, stopping the background pass.
+ *
+ * Normally the producer that owns the peaks closes them.
+ *
+ * \public \memberof mlt_peaks_s
+ * \param self the peaks
+ */
+
+void mlt_peaks_close( mlt_peaks self )
+{
+	if ( !self )
+		return;
+	if ( self->running )
+	{
+		pthread_mutex_lock( &self->mutex );
+		self->cancel = 1;
+		pthread_mutex_unlock( &self->mutex );
+		pthread_join( self->thread, NULL );
+	}
+	mlt_producer_close( self->producer );
+	mlt_properties_close( self->source );
+#ifndef _WIN32
+	if ( self->mapped )
+		munmap( self->data, self->size );
+	else
+#endif
+		free( self->data );
+	free( self->path );
+	pthread_mutex_destroy( &self->mutex );
+	free( self );
+}
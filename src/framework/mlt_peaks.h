@@ -0,0 +1,61 @@
+/**
+ * \file mlt_peaks.h
+ * \brief audio peak files for drawing waveforms without decoding
+ * \see mlt_peaks_s
+ *
+ * Copyright (C) 2019 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef MLT_PEAKS_H
+#define MLT_PEAKS_H
+
+#include "mlt_types.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** \brief Audio peak of a range of samples
+ *
+ * Samples are signed 16-bit; rms is the root mean square of the range.
+ */
+
+struct mlt_peak_s
+{
+	int16_t min;
+	int16_t max;
+	uint16_t rms;
+};
+
+typedef struct mlt_peak_s *mlt_peak;
+typedef struct mlt_peaks_s *mlt_peaks;
+
+extern mlt_peaks mlt_peaks_get( mlt_producer producer );
+extern int mlt_peaks_ready( mlt_peaks self );
+extern double mlt_peaks_progress( mlt_peaks self );
+extern int mlt_peaks_frequency( mlt_peaks self );
+extern int mlt_peaks_channels( mlt_peaks self );
+extern int64_t mlt_peaks_samples( mlt_peaks self );
+extern int mlt_peaks_read( mlt_peaks self, int channel, int64_t start, int64_t end, int count, mlt_peak peaks );
+extern void mlt_peaks_close( mlt_peaks self );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
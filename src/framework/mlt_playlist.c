@@ -219,6 +219,7 @@ static int mlt_playlist_virtual_refresh( mlt_playlist self )
 	}
 
 	// Refresh all properties
+	mlt_properties_touch( properties );
 	mlt_events_block( properties, properties );
 	mlt_properties_set_position( properties, "length", frame_count );
 	mlt_events_unblock( properties, properties );
@@ -128,7 +128,7 @@ int mlt_producer_init( mlt_producer self, void *child )
 static void mlt_producer_property_changed( mlt_service owner, mlt_producer self, char *name )
 {
 	if ( !strcmp( name, "in" ) || !strcmp( name, "out" ) || !strcmp( name, "length" ) )
-		mlt_events_fire( MLT_PRODUCER_PROPERTIES( mlt_producer_cut_parent( self ) ), "producer-changed", NULL );
+		mlt_events_fire_id( MLT_PRODUCER_PROPERTIES( mlt_producer_cut_parent( self ) ), mlt_event_producer_changed, NULL );
 }
 
 /** Listener for service changes.
@@ -142,7 +142,7 @@ static void mlt_producer_property_changed( mlt_service owner, mlt_producer self,
 
 static void mlt_producer_service_changed( mlt_service owner, mlt_producer self )
 {
-	mlt_events_fire( MLT_PRODUCER_PROPERTIES( mlt_producer_cut_parent( self ) ), "producer-changed", NULL );
+	mlt_events_fire_id( MLT_PRODUCER_PROPERTIES( mlt_producer_cut_parent( self ) ), mlt_event_producer_changed, NULL );
 }
 
 /** Create and initialize a new producer.
@@ -691,14 +691,17 @@ static int producer_get_frame( mlt_service service, mlt_frame_ptr frame, int ind
 		// We need to seek to the correct position in the clone
 		mlt_producer_seek( clone, mlt_producer_get_in( self ) + mlt_properties_get_int( properties, "_position" ) );
 
-		// Assign the clone property to the parent
-		mlt_properties_set_data( parent_properties, "use_clone", clone, 0, NULL, NULL );
+		// Assign the clone property to the parent; the parent uses itself otherwise,
+		// which spares changing its properties, and so its generation, on every frame
+		if ( clone != parent )
+			mlt_properties_set_data( parent_properties, "use_clone", clone, 0, NULL, NULL );
 
 		// Now get the frame from the parents service
 		result = mlt_service_get_frame( MLT_PRODUCER_SERVICE( parent ), frame, index );
 
 		// We're done with the clone now
-		mlt_properties_set_data( parent_properties, "use_clone", NULL, 0, NULL, NULL );
+		if ( clone != parent )
+			mlt_properties_set_data( parent_properties, "use_clone", NULL, 0, NULL, NULL );
 
 		// This is useful and required by always_active transitions to determine in/out points of the cut
 		if ( mlt_properties_get_data( MLT_FRAME_PROPERTIES( *frame ), "_producer", NULL ) == MLT_PRODUCER_SERVICE( parent ) )
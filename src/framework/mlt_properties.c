@@ -27,6 +27,7 @@
 
 #include "mlt_properties.h"
 #include "mlt_property.h"
+#include "mlt_animation.h"
 #include "mlt_deque.h"
 #include "mlt_log.h"
 #include "mlt_factory.h"
@@ -37,6 +38,7 @@
 #include <ctype.h>
 #include <stdarg.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <sys/types.h>
 #include <dirent.h>
 #include <sys/stat.h>
@@ -44,22 +46,49 @@
 #include <locale.h>
 #include <float.h>
 
-/** \brief private implementation of the property list */
+/** \brief private to property_list, the names and values of a list
+ *
+ * Lists made by mlt_properties_clone() share one table until either of them
+ * changes, and then share the properties until each one changes.
+ */
 
 typedef struct
 {
+	atomic_int ref_count;
 	int hash[ 199 ];
 	char **name;
 	mlt_property *value;
 	int count;
 	int size;
+	int animations;
+}
+property_table;
+
+/** \brief private implementation of the property list */
+
+typedef struct
+{
+	property_table *table;
 	mlt_properties mirror;
 	int ref_count;
 	pthread_mutex_t mutex;
 	locale_t locale;
+	int64_t generation;
+	int animation_changes;
+	int events;
 }
 property_list;
 
+/** The source of generation numbers; shared by all lists so that a generation is never reused. */
+
+static atomic_int_fast64_t generation_count = 1;
+
+/* Forward declaration to private functions.
+*/
+
+static int set_string( mlt_properties self, const char *name, const char *value );
+static void table_close( property_table *table );
+
 /* Memory leak checks */
 
 //#define _MLT_PROPERTY_CHECKS_ 2
@@ -94,9 +123,12 @@ int mlt_properties_init( mlt_properties self, void *child )
 
 		// Allocate the local structure
 		self->local = calloc( 1, sizeof( property_list ) );
+		( ( property_list * )self->local )->table = calloc( 1, sizeof( property_table ) );
+		atomic_init( &( ( property_list * )self->local )->table->ref_count, 1 );
 
 		// Increment the ref count
 		( ( property_list * )self->local )->ref_count = 1;
+		( ( property_list * )self->local )->generation = atomic_fetch_add( &generation_count, 1 );
 		pthread_mutex_init( &( ( property_list * )self->local )->mutex, NULL );;
 	}
 
@@ -360,6 +392,164 @@ static inline void mlt_properties_do_mirror( mlt_properties self, const char *na
 	}
 }
 
+/** Record a change to a property and fire the "property-changed" event.
+ *
+ * Private properties (names beginning with an underscore) are transient state
+ * and do not advance the generation.
+ * \private \memberof mlt_properties_s
+ * \param self a properties list
+ * \param name the name of the property that changed
+ */
+
+static inline void property_changed( mlt_properties self, const char *name )
+{
+	property_list *list = self->local;
+	if ( name[ 0 ] != '_' )
+		list->generation = atomic_fetch_add( &generation_count, 1 );
+	if ( list->events )
+		mlt_events_fire_id( self, mlt_event_property_changed, name, NULL );
+}
+
+/** \brief private to mlt_properties_s, collects the changes of a bulk update */
+
+typedef struct
+{
+	mlt_properties self;
+	char **names;
+	int count;
+	int changed;
+	int notify;
+}
+change_batch;
+
+/** Start collecting the changes of a bulk update.
+ *
+ * The changes are announced together by change_batch_end() once all the
+ * values are in place, so listeners never see a partial update and each name
+ * is announced only once.
+ * \private \memberof mlt_properties_s
+ * \param batch the batch to initialize
+ * \param self the properties list being updated
+ */
+
+static void change_batch_begin( change_batch *batch, mlt_properties self )
+{
+	property_list *list = self->local;
+	batch->self = self;
+	batch->names = NULL;
+	batch->count = 0;
+	batch->changed = 0;
+	batch->notify = list->events && mlt_events_listening( self, mlt_event_property_changed );
+}
+
+/** Record a change in a bulk update.
+ *
+ * \private \memberof mlt_properties_s
+ * \param batch a batch
+ * \param name the name of the property that changed
+ */
+
+static void change_batch_add( change_batch *batch, const char *name )
+{
+	int i;
+	if ( name[ 0 ] != '_' )
+		batch->changed = 1;
+	if ( !batch->notify )
+		return;
+	for ( i = 0; i < batch->count; i ++ )
+		if ( !strcmp( batch->names[ i ], name ) )
+			return;
+	if ( ( batch->count & 15 ) == 0 )
+		batch->names = realloc( batch->names, ( batch->count + 16 ) * sizeof( char* ) );
+	batch->names[ batch->count ++ ] = strdup( name );
+}
+
+/** Announce the changes of a bulk update.
+ *
+ * \private \memberof mlt_properties_s
+ * \param batch a batch
+ */
+
+static void change_batch_end( change_batch *batch )
+{
+	int i;
+	if ( batch->changed )
+		( ( property_list* )batch->self->local )->generation = atomic_fetch_add( &generation_count, 1 );
+	for ( i = 0; i < batch->count; i ++ )
+	{
+		mlt_events_fire_id( batch->self, mlt_event_property_changed, batch->names[ i ], NULL );
+		free( batch->names[ i ] );
+	}
+	free( batch->names );
+}
+
+/** Count the edits made to the animations of a table.
+ *
+ * \private \memberof mlt_properties_s
+ * \param table a table
+ * \return the sum of the edits of its animations
+ */
+
+static int table_animation_changes( property_table *table )
+{
+	int changes = 0;
+	int i;
+	for ( i = 0; i < table->count; i ++ )
+		changes += mlt_animation_changes( mlt_property_get_animation( table->value[ i ] ) );
+	return changes;
+}
+
+/** Get the generation of a properties list.
+ *
+ * The generation changes whenever a public property is set, cleared, or
+ * renamed, when an animation obtained with mlt_properties_get_animation() is
+ * edited, or when mlt_properties_touch() is called. Generations are unique
+ * across all lists, so an unchanged generation means the list is unchanged
+ * since it was last looked at. Changes made directly to a property obtained
+ * from the list are not seen.
+ * \public \memberof mlt_properties_s
+ * \param self a properties list
+ * \return the current generation or 0 if \p self is NULL
+ */
+
+int64_t mlt_properties_generation( mlt_properties self )
+{
+	if ( !self ) return 0;
+	property_list *list = self->local;
+	int64_t generation;
+
+	mlt_properties_lock( self );
+	if ( list->table->animations )
+	{
+		// The edits of an animation handed out for editing do not set a
+		// property, so look for them among the animations of the list
+		int changes = table_animation_changes( list->table );
+		if ( changes != list->animation_changes )
+		{
+			list->animation_changes = changes;
+			list->generation = atomic_fetch_add( &generation_count, 1 );
+		}
+	}
+	generation = list->generation;
+	mlt_properties_unlock( self );
+
+	return generation;
+}
+
+/** Mark a properties list as changed.
+ *
+ * Use this when an object derived from properties changes its structure
+ * without setting a property, such as when clips are added to a playlist.
+ * \public \memberof mlt_properties_s
+ * \param self a properties list
+ */
+
+void mlt_properties_touch( mlt_properties self )
+{
+	if ( self )
+		( ( property_list* )self->local )->generation = atomic_fetch_add( &generation_count, 1 );
+}
+
 /** Increment the reference count.
  *
  * \public \memberof mlt_properties_s
@@ -450,6 +640,9 @@ int mlt_properties_inherit( mlt_properties self, mlt_properties that )
 	if (value)
 		mlt_properties_set_string(self, "properties", value);
 
+	change_batch batch;
+	change_batch_begin( &batch, self );
+
 	mlt_properties_lock( that );
 
 	int count = mlt_properties_count( that );
@@ -461,12 +654,17 @@ int mlt_properties_inherit( mlt_properties self, mlt_properties that )
 		{
 			char *name = mlt_properties_get_name( that, i );
 			if (name && strcmp("properties", name))
-				mlt_properties_set_string( self, name, value );
+			{
+				set_string( self, name, value );
+				change_batch_add( &batch, name );
+			}
 		}
 	}
 
 	mlt_properties_unlock( that );
 
+	change_batch_end( &batch );
+
 	return 0;
 }
 
@@ -488,6 +686,8 @@ int mlt_properties_pass( mlt_properties self, mlt_properties that, const char *p
 	int count = mlt_properties_count( that );
 	int length = strlen( prefix );
 	int i = 0;
+	change_batch batch;
+	change_batch_begin( &batch, self );
 	for ( i = 0; i < count; i ++ )
 	{
 		char *name = mlt_properties_get_name( that, i );
@@ -495,12 +695,42 @@ int mlt_properties_pass( mlt_properties self, mlt_properties that, const char *p
 		{
 			char *value = mlt_properties_get_value( that, i );
 			if ( value != NULL )
-				mlt_properties_set_string( self, name + length, value );
+			{
+				set_string( self, name + length, value );
+				change_batch_add( &batch, name + length );
+			}
 		}
 	}
+	change_batch_end( &batch );
 	return 0;
 }
 
+/** Locate a property in a table by name.
+ *
+ * \private \memberof mlt_properties_s
+ * \param table a table of properties
+ * \param name the property to lookup by name
+ * \return the index of the property or -1 if not found
+ */
+
+static inline int table_index( property_table *table, const char *name )
+{
+	int i = table->hash[ generate_hash( name ) ] - 1;
+	if ( i >= 0 )
+	{
+		// Check if we're hashed
+		if ( table->count > 0 && table->name[ i ] &&
+		 	!strcmp( table->name[ i ], name ) )
+			return i;
+
+		// Locate the item
+		for ( i = table->count - 1; i >= 0; i -- )
+			if ( table->name[ i ] && !strcmp( table->name[ i ], name ) )
+				return i;
+	}
+	return -1;
+}
+
 /** Locate a property by name.
  *
  * \private \memberof mlt_properties_s
@@ -514,28 +744,82 @@ static inline mlt_property mlt_properties_find( mlt_properties self, const char
 	if ( !self || !name ) return NULL;
 	property_list *list = self->local;
 	mlt_property value = NULL;
-	int key = generate_hash( name );
 
 	mlt_properties_lock( self );
-
-	int i = list->hash[ key ] - 1;
+	int i = table_index( list->table, name );
 	if ( i >= 0 )
-	{
-		// Check if we're hashed
-		if ( list->count > 0 && list->name[ i ] &&
-		 	!strcmp( list->name[ i ], name ) )
-			value = list->value[ i ];
-
-		// Locate the item
-		for ( i = list->count - 1; value == NULL && i >= 0; i -- )
-			if ( list->name[ i ] && !strcmp( list->name[ i ], name ) )
-				value = list->value[ i ];
-	}
+		value = list->table->value[ i ];
 	mlt_properties_unlock( self );
 
 	return value;
 }
 
+/** Get a table of the list that it may modify.
+ *
+ * A table shared with other lists is copied first. The copy shares the
+ * properties themselves, which writable_property() copies in turn.
+ * The list must be locked.
+ * \private \memberof mlt_properties_s
+ * \param self a properties list
+ * \return the table
+ */
+
+static property_table *writable_table( mlt_properties self )
+{
+	property_list *list = self->local;
+	property_table *table = list->table;
+	if ( atomic_load( &table->ref_count ) > 1 )
+	{
+		property_table *copy = calloc( 1, sizeof( property_table ) );
+		int i;
+		atomic_init( &copy->ref_count, 1 );
+		memcpy( copy->hash, table->hash, sizeof( copy->hash ) );
+		copy->count = table->count;
+		copy->size = table->count;
+		copy->animations = table->animations;
+		if ( copy->size > 0 )
+		{
+			copy->name = malloc( copy->size * sizeof( char * ) );
+			copy->value = malloc( copy->size * sizeof( mlt_property ) );
+		}
+		for ( i = 0; i < copy->count; i ++ )
+		{
+			copy->name[ i ] = table->name[ i ] ? strdup( table->name[ i ] ) : NULL;
+			copy->value[ i ] = table->value[ i ];
+			mlt_property_inc_ref( copy->value[ i ] );
+		}
+		list->table = copy;
+		table_close( table );
+		table = copy;
+	}
+	return table;
+}
+
+/** Get a property of the list that it may modify.
+ *
+ * A property shared with other lists is replaced by a copy of its value.
+ * The list must be locked.
+ * \private \memberof mlt_properties_s
+ * \param self a properties list
+ * \param index the index of the property
+ * \return the property
+ */
+
+static mlt_property writable_property( mlt_properties self, int index )
+{
+	property_table *table = writable_table( self );
+	mlt_property property = table->value[ index ];
+	if ( mlt_property_ref_count( property ) > 1 )
+	{
+		mlt_property copy = mlt_property_init( );
+		mlt_property_pass( copy, property );
+		table->value[ index ] = copy;
+		mlt_property_close( property );
+		property = copy;
+	}
+	return property;
+}
+
 /** Add a new property.
  *
  * \private \memberof mlt_properties_s
@@ -546,37 +830,38 @@ static inline mlt_property mlt_properties_find( mlt_properties self, const char
 
 static mlt_property mlt_properties_add( mlt_properties self, const char *name )
 {
-	property_list *list = self->local;
 	int key = generate_hash( name );
 	mlt_property result;
 
 	mlt_properties_lock( self );
 
+	property_table *table = writable_table( self );
+
 	// Check that we have space and resize if necessary
-	if ( list->count == list->size )
+	if ( table->count == table->size )
 	{
-		list->size += 50;
-		list->name = realloc( list->name, list->size * sizeof( const char * ) );
-		list->value = realloc( list->value, list->size * sizeof( mlt_property ) );
+		table->size += 50;
+		table->name = realloc( table->name, table->size * sizeof( const char * ) );
+		table->value = realloc( table->value, table->size * sizeof( mlt_property ) );
 	}
 
 	// Assign name/value pair
-	list->name[ list->count ] = strdup( name );
-	list->value[ list->count ] = mlt_property_init( );
+	table->name[ table->count ] = strdup( name );
+	table->value[ table->count ] = mlt_property_init( );
 
 	// Assign to hash table
-	if ( list->hash[ key ] == 0 )
-		list->hash[ key ] = list->count + 1;
+	if ( table->hash[ key ] == 0 )
+		table->hash[ key ] = table->count + 1;
 
 	// Return and increment count accordingly
-	result = list->value[ list->count ++ ];
+	result = table->value[ table->count ++ ];
 
 	mlt_properties_unlock( self );
 
 	return result;
 }
 
-/** Fetch a property by name and add one if not found.
+/** Fetch a property to modify by name and add one if not found.
  *
  * \private \memberof mlt_properties_s
  * \param self a properties list
@@ -586,8 +871,15 @@ static mlt_property mlt_properties_add( mlt_properties self, const char *name )
 
 static mlt_property mlt_properties_fetch( mlt_properties self, const char *name )
 {
+	property_list *list = self->local;
+	mlt_property property = NULL;
+
 	// Try to find an existing property first
-	mlt_property property = mlt_properties_find( self, name );
+	mlt_properties_lock( self );
+	int i = table_index( list->table, name );
+	if ( i >= 0 )
+		property = writable_property( self, i );
+	mlt_properties_unlock( self );
 
 	// If it wasn't found, create one
 	if ( property == NULL )
@@ -597,23 +889,39 @@ static mlt_property mlt_properties_fetch( mlt_properties self, const char *name
 	return property;
 }
 
-/** Copy a property to another properties list.
+/** Copy a property to another properties list without announcing the change.
  *
- * \public \memberof mlt_properties_s
- * \author Zach <zachary.drew@gmail.com>
+ * \private \memberof mlt_properties_s
  * \param self the properties to copy to
  * \param that the properties to copy from
  * \param name the name of the property to copy
+ * \return true if the property was copied
  */
 
-void mlt_properties_pass_property( mlt_properties self, mlt_properties that, const char *name )
+static int pass_property( mlt_properties self, mlt_properties that, const char *name )
 {
 	// Make sure the source property isn't null.
 	mlt_property that_prop = mlt_properties_find( that, name );
 	if( that_prop == NULL )
-		return;
+		return 0;
 
 	mlt_property_pass( mlt_properties_fetch( self, name ), that_prop );
+	return 1;
+}
+
+/** Copy a property to another properties list.
+ *
+ * \public \memberof mlt_properties_s
+ * \author Zach <zachary.drew@gmail.com>
+ * \param self the properties to copy to
+ * \param that the properties to copy from
+ * \param name the name of the property to copy
+ */
+
+void mlt_properties_pass_property( mlt_properties self, mlt_properties that, const char *name )
+{
+	if ( pass_property( self, that, name ) )
+		property_changed( self, name );
 }
 
 /** Copy all properties specified in a comma-separated list to another properties list.
@@ -635,6 +943,9 @@ int mlt_properties_pass_list( mlt_properties self, mlt_properties that, const ch
 	char *ptr = props;
 	const char *delim = " ,\t\n";	// Any combination of spaces, commas, tabs, and newlines
 	int count, done = 0;
+	change_batch batch;
+
+	change_batch_begin( &batch, self );
 
 	while( !done )
 	{
@@ -645,7 +956,8 @@ int mlt_properties_pass_list( mlt_properties self, mlt_properties that, const ch
 		else
 			ptr[count] = '\0';	// Make it a real string
 
-		mlt_properties_pass_property( self, that, ptr );
+		if ( pass_property( self, that, ptr ) )
+			change_batch_add( &batch, ptr );
 
 		ptr += count + 1;
 		if ( !done )
@@ -654,9 +966,104 @@ int mlt_properties_pass_list( mlt_properties self, mlt_properties that, const ch
 
 	free( props );
 
+	change_batch_end( &batch );
+
 	return 0;
 }
 
+/** Make a list share all the properties of another list.
+ *
+ * This replaces the contents of \p self with those of \p that, including
+ * data properties, without copying anything: the two lists share the values
+ * until one of them changes a property, which then gets its own copy.
+ * Binary data is shared by pointer; anyone modifying data in place should
+ * first check mlt_properties_is_shared() and set a copy.
+ * Lists with events attached cannot share their properties.
+ * \public \memberof mlt_properties_s
+ * \param self the properties to replace
+ * \param that the properties to share
+ * \return true if error
+ */
+
+int mlt_properties_clone( mlt_properties self, mlt_properties that )
+{
+	if ( !self || !that || self == that ) return 1;
+	property_list *list = self->local;
+	property_list *other = that->local;
+	if ( list->events || other->events ) return 1;
+
+	mlt_properties_lock( that );
+	property_table *table = other->table;
+	int animation_changes = other->animation_changes;
+	atomic_fetch_add( &table->ref_count, 1 );
+	mlt_properties_unlock( that );
+
+	mlt_properties_lock( self );
+	property_table *old = list->table;
+	list->table = table;
+	list->animation_changes = animation_changes;
+	list->generation = atomic_fetch_add( &generation_count, 1 );
+	mlt_properties_unlock( self );
+
+	table_close( old );
+
+	return 0;
+}
+
+/** Determine if a property is shared with another list.
+ *
+ * Setting a shared property is always safe, but the value of a shared data
+ * property must not be modified in place.
+ * \public \memberof mlt_properties_s
+ * \param self a properties list
+ * \param name the name of the property
+ * \return true if the property exists and is shared
+ */
+
+int mlt_properties_is_shared( mlt_properties self, const char *name )
+{
+	if ( !self || !name ) return 0;
+	property_list *list = self->local;
+	int result = 0;
+
+	mlt_properties_lock( self );
+	int i = table_index( list->table, name );
+	if ( i >= 0 )
+		result = atomic_load( &list->table->ref_count ) > 1 || mlt_property_ref_count( list->table->value[ i ] ) > 1;
+	mlt_properties_unlock( self );
+
+	return result;
+}
+
+/** Get a reference to a property that keeps its value.
+ *
+ * The list never modifies a property that is referenced elsewhere, so the
+ * returned property keeps its value, including any data and its destructor,
+ * when the list later sets the name to something else or is closed.
+ * \public \memberof mlt_properties_s
+ * \param self a properties list
+ * \param name the name of the property
+ * \return a new reference to the property that must be released with mlt_property_close(), or NULL if not found
+ */
+
+mlt_property mlt_properties_share_property( mlt_properties self, const char *name )
+{
+	if ( !self || !name ) return NULL;
+	property_list *list = self->local;
+	mlt_property result = NULL;
+
+	mlt_properties_lock( self );
+	int i = table_index( list->table, name );
+	if ( i >= 0 )
+	{
+		result = list->table->value[ i ];
+		mlt_property_inc_ref( result );
+	}
+	mlt_properties_unlock( self );
+
+	return result;
+}
+
 static int is_valid_expression(mlt_properties self, const char* value)
 {
 	int result = *value != '\0';
@@ -785,7 +1192,7 @@ int mlt_properties_set( mlt_properties self, const char *name, const char *value
 			mlt_properties_preset( self, value );
 	}
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	property_changed( self, name );
 
 	return error;
 }
@@ -822,9 +1229,27 @@ int mlt_properties_set_or_default( mlt_properties self, const char *name, const
 
 int mlt_properties_set_string( mlt_properties self, const char *name, const char *value )
 {
-	int error = 1;
+	if ( !self || !name ) return 1;
 
-	if ( !self || !name ) return error;
+	int error = set_string( self, name, value );
+
+	property_changed( self, name );
+
+	return error;
+}
+
+/** Set a property to a string without announcing the change.
+ *
+ * \private \memberof mlt_properties_s
+ * \param self a properties list
+ * \param name the property to set
+ * \param value the property's new value
+ * \return true if error
+ */
+
+static int set_string( mlt_properties self, const char *name, const char *value )
+{
+	int error = 1;
 
 	// Fetch the property to work with
 	mlt_property property = mlt_properties_fetch( self, name );
@@ -847,8 +1272,6 @@ int mlt_properties_set_string( mlt_properties self, const char *name, const char
 			mlt_properties_preset( self, value );
 	}
 
-	mlt_events_fire( self, "property-changed", name, NULL );
-
 	return error;
 }
 
@@ -887,8 +1310,8 @@ char *mlt_properties_get_name( mlt_properties self, int index )
 {
 	if ( !self ) return NULL;
 	property_list *list = self->local;
-	if ( index >= 0 && index < list->count )
-		return list->name[ index ];
+	if ( index >= 0 && index < list->table->count )
+		return list->table->name[ index ];
 	return NULL;
 }
 
@@ -906,8 +1329,8 @@ char *mlt_properties_get_value_tf( mlt_properties self, int index, mlt_time_form
 {
 	if ( !self ) return NULL;
 	property_list *list = self->local;
-	if ( index >= 0 && index < list->count )
-		return mlt_property_get_string_l_tf( list->value[ index ], list->locale, time_format );
+	if ( index >= 0 && index < list->table->count )
+		return mlt_property_get_string_l_tf( list->table->value[ index ], list->locale, time_format );
 	return NULL;
 }
 
@@ -939,8 +1362,8 @@ void *mlt_properties_get_data_at( mlt_properties self, int index, int *size )
 {
 	if ( !self ) return NULL;
 	property_list *list = self->local;
-	if ( index >= 0 && index < list->count )
-		return mlt_property_get_data( list->value[ index ], size );
+	if ( index >= 0 && index < list->table->count )
+		return mlt_property_get_data( list->table->value[ index ], size );
 	return NULL;
 }
 
@@ -955,7 +1378,7 @@ int mlt_properties_count( mlt_properties self )
 {
 	if ( !self ) return -1;
 	property_list *list = self->local;
-	return list->count;
+	return list->table->count;
 }
 
 /** Set a value by parsing a name=value string.
@@ -1050,7 +1473,7 @@ int mlt_properties_set_int( mlt_properties self, const char *name, int value )
 		mlt_properties_do_mirror( self, name );
 	}
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	property_changed( self, name );
 
 	return error;
 }
@@ -1094,7 +1517,7 @@ int mlt_properties_set_int64( mlt_properties self, const char *name, int64_t val
 		mlt_properties_do_mirror( self, name );
 	}
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	property_changed( self, name );
 
 	return error;
 }
@@ -1146,7 +1569,7 @@ int mlt_properties_set_double( mlt_properties self, const char *name, double val
 		mlt_properties_do_mirror( self, name );
 	}
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	property_changed( self, name );
 
 	return error;
 }
@@ -1198,7 +1621,7 @@ int mlt_properties_set_position( mlt_properties self, const char *name, mlt_posi
 		mlt_properties_do_mirror( self, name );
 	}
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	property_changed( self, name );
 
 	return error;
 }
@@ -1244,7 +1667,11 @@ int mlt_properties_set_data( mlt_properties self, const char *name, void *value,
 	if ( property != NULL )
 		error = mlt_property_set_data( property, value, length, destroy, serialise );
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	// Remember whether events are attached, so changes to plain lists skip them
+	if ( name[ 0 ] == '_' && !strcmp( name, "_events" ) )
+		( ( property_list* )self->local )->events = value != NULL;
+
+	property_changed( self, name );
 
 	return error;
 }
@@ -1269,13 +1696,15 @@ int mlt_properties_rename( mlt_properties self, const char *source, const char *
 
 		// Locate the item
 		mlt_properties_lock( self );
-		for ( i = 0; i < list->count; i ++ )
+		property_table *table = writable_table( self );
+		for ( i = 0; i < table->count; i ++ )
 		{
-			if ( list->name[ i ] && !strcmp( list->name[ i ], source ) )
+			if ( table->name[ i ] && !strcmp( table->name[ i ], source ) )
 			{
-				free( list->name[ i ] );
-				list->name[ i ] = strdup( dest );
-				list->hash[ generate_hash( dest ) ] = i + 1;
+				free( table->name[ i ] );
+				table->name[ i ] = strdup( dest );
+				table->hash[ generate_hash( dest ) ] = i + 1;
+				list->generation = atomic_fetch_add( &generation_count, 1 );
 				break;
 			}
 		}
@@ -1297,9 +1726,9 @@ void mlt_properties_dump( mlt_properties self, FILE *output )
 	if ( !self || !output ) return;
 	property_list *list = self->local;
 	int i = 0;
-	for ( i = 0; i < list->count; i ++ )
-		if ( mlt_properties_get( self, list->name[ i ] ) != NULL )
-			fprintf( output, "%s=%s\n", list->name[ i ], mlt_properties_get( self, list->name[ i ] ) );
+	for ( i = 0; i < list->table->count; i ++ )
+		if ( mlt_properties_get( self, list->table->name[ i ] ) != NULL )
+			fprintf( output, "%s=%s\n", list->table->name[ i ], mlt_properties_get( self, list->table->name[ i ] ) );
 }
 
 /** Output the properties to a file handle.
@@ -1320,11 +1749,11 @@ void mlt_properties_debug( mlt_properties self, const char *title, FILE *output
 		property_list *list = self->local;
 		int i = 0;
 		fprintf( output, "[ ref=%d", list->ref_count );
-		for ( i = 0; i < list->count; i ++ )
-			if ( mlt_properties_get( self, list->name[ i ] ) != NULL )
-				fprintf( output, ", %s=%s", list->name[ i ], mlt_properties_get( self, list->name[ i ] ) );
+		for ( i = 0; i < list->table->count; i ++ )
+			if ( mlt_properties_get( self, list->table->name[ i ] ) != NULL )
+				fprintf( output, ", %s=%s", list->table->name[ i ], mlt_properties_get( self, list->table->name[ i ] ) );
 			else
-				fprintf( output, ", %s=%p", list->name[ i ], mlt_properties_get_data( self, list->name[ i ], NULL ) );
+				fprintf( output, ", %s=%p", list->table->name[ i ], mlt_properties_get_data( self, list->table->name[ i ], NULL ) );
 		fprintf( output, " ]" );
 	}
 	fprintf( output, "\n" );
@@ -1450,15 +1879,37 @@ int mlt_properties_dir_list( mlt_properties self, const char *dirname, const cha
 
 	if ( sort && mlt_properties_count( self ) )
 	{
-		property_list *list = self->local;
 		mlt_properties_lock( self );
-		qsort( list->value, mlt_properties_count( self ), sizeof( mlt_property ), mlt_compare );
+		property_table *table = writable_table( self );
+		qsort( table->value, table->count, sizeof( mlt_property ), mlt_compare );
 		mlt_properties_unlock( self );
 	}
 
 	return mlt_properties_count( self );
 }
 
+/** Release a reference to a table of properties.
+ *
+ * \private \memberof mlt_properties_s
+ * \param table a table
+ */
+
+static void table_close( property_table *table )
+{
+	if ( atomic_fetch_sub( &table->ref_count, 1 ) > 1 )
+		return;
+
+	int index = 0;
+	for ( index = table->count - 1; index >= 0; index -- )
+	{
+		mlt_property_close( table->value[ index ] );
+		free( table->name[ index ] );
+	}
+	free( table->name );
+	free( table->value );
+	free( table );
+}
+
 /** Close a properties object.
  *
  * Deallocates the properties object and everything it contains.
@@ -1477,7 +1928,6 @@ void mlt_properties_close( mlt_properties self )
 		else
 		{
 			property_list *list = self->local;
-			int index = 0;
 
 #if _MLT_PROPERTY_CHECKS_ == 1
 			// Show debug info
@@ -1493,11 +1943,7 @@ void mlt_properties_close( mlt_properties self )
 #endif
 
 			// Clean up names and values
-			for ( index = list->count - 1; index >= 0; index -- )
-			{
-				mlt_property_close( list->value[ index ] );
-				free( list->name[ index ] );
-			}
+			table_close( list->table );
 
 #if defined(__GLIBC__) || defined(__APPLE__)
 			// Cleanup locale
@@ -1510,8 +1956,6 @@ void mlt_properties_close( mlt_properties self )
 
 			// Clear up the list
 			pthread_mutex_destroy( &list->mutex );
-			free( list->name );
-			free( list->value );
 			free( list );
 
 			// Free self now if self has no child
@@ -2064,12 +2508,12 @@ static void serialise_yaml( mlt_properties self, strbuf output, int indent, int
 	int i = 0;
 	int is_sequence = mlt_properties_is_sequence( self );
 
-	for ( i = 0; i < list->count; i ++ )
+	for ( i = 0; i < list->table->count; i ++ )
 	{
 		// This implementation assumes that all data elements are property lists.
 		// Unfortunately, we do not have run time type identification.
-		mlt_properties child = mlt_property_get_data( list->value[ i ], NULL );
-		const char *name = list->name[i];
+		mlt_properties child = mlt_property_get_data( list->table->value[ i ], NULL );
+		const char *name = list->table->name[i];
 		const char *value = mlt_properties_get( self, name );
 
 		if ( is_sequence )
@@ -2243,7 +2687,7 @@ void mlt_properties_clear( mlt_properties self, const char *name )
 	if ( property )
 		mlt_property_clear( property );
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	property_changed( self, name );
 }
 
 /** Check if a property exists.
@@ -2404,7 +2848,7 @@ int mlt_properties_set_color( mlt_properties self, const char *name, mlt_color c
 		mlt_properties_do_mirror( self, name );
 	}
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	property_changed( self, name );
 
 	return error;
 }
@@ -2466,7 +2910,7 @@ int mlt_properties_anim_set( mlt_properties self, const char *name, const char *
 		mlt_properties_do_mirror( self, name );
 	}
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	property_changed( self, name );
 
 	return error;
 }
@@ -2524,7 +2968,7 @@ int mlt_properties_anim_set_int( mlt_properties self, const char *name, int valu
 		mlt_properties_do_mirror( self, name );
 	}
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	property_changed( self, name );
 
 	return error;
 }
@@ -2582,7 +3026,7 @@ int mlt_properties_anim_set_double( mlt_properties self, const char *name, doubl
 		mlt_properties_do_mirror( self, name );
 	}
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	property_changed( self, name );
 
 	return error;
 }
@@ -2597,8 +3041,26 @@ int mlt_properties_anim_set_double( mlt_properties self, const char *name, doubl
 
 mlt_animation mlt_properties_get_animation( mlt_properties self, const char *name )
 {
+	// The caller may modify the animation, so do not hand out a shared one
 	mlt_property value = mlt_properties_find( self, name );
-	return value == NULL ? NULL : mlt_property_get_animation( value );
+	mlt_animation animation = NULL;
+	if ( value && mlt_properties_is_shared( self, name ) )
+		value = mlt_properties_fetch( self, name );
+	if ( value )
+		animation = mlt_property_get_animation( value );
+	if ( animation )
+	{
+		// Let mlt_properties_generation() look for the edits of the caller
+		property_list *list = self->local;
+		mlt_properties_lock( self );
+		if ( !list->table->animations )
+		{
+			list->table->animations = 1;
+			list->animation_changes = table_animation_changes( list->table );
+		}
+		mlt_properties_unlock( self );
+	}
+	return animation;
 }
 
 /** Set a property to a rectangle value.
@@ -2626,7 +3088,7 @@ extern int mlt_properties_set_rect( mlt_properties self, const char *name, mlt_r
 		mlt_properties_do_mirror( self, name );
 	}
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	property_changed( self, name );
 
 	return error;
 }
@@ -2680,7 +3142,7 @@ extern int mlt_properties_anim_set_rect( mlt_properties self, const char *name,
 		mlt_properties_do_mirror( self, name );
 	}
 
-	mlt_events_fire( self, "property-changed", name, NULL );
+	property_changed( self, name );
 
 	return error;
 }
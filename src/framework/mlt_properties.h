@@ -54,6 +54,9 @@ extern int mlt_properties_dec_ref( mlt_properties self );
 extern int mlt_properties_ref_count( mlt_properties self );
 extern void mlt_properties_mirror( mlt_properties self, mlt_properties that );
 extern int mlt_properties_inherit( mlt_properties self, mlt_properties that );
+extern int mlt_properties_clone( mlt_properties self, mlt_properties that );
+extern int mlt_properties_is_shared( mlt_properties self, const char *name );
+extern mlt_property mlt_properties_share_property( mlt_properties self, const char *name );
 extern int mlt_properties_pass( mlt_properties self, mlt_properties that, const char *prefix );
 extern void mlt_properties_pass_property( mlt_properties self, mlt_properties that, const char *name );
 extern int mlt_properties_pass_list( mlt_properties self, mlt_properties that, const char *list );
@@ -90,6 +93,8 @@ extern void mlt_properties_lock( mlt_properties self );
 extern void mlt_properties_unlock( mlt_properties self );
 extern void mlt_properties_clear( mlt_properties self, const char *name );
 extern int mlt_properties_exists( mlt_properties self, const char *name );
+extern int64_t mlt_properties_generation( mlt_properties self );
+extern void mlt_properties_touch( mlt_properties self );
 
 extern char *mlt_properties_get_time( mlt_properties, const char* name, mlt_time_format );
 extern char *mlt_properties_frames_to_time( mlt_properties, mlt_position, mlt_time_format );
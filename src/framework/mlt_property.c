@@ -33,6 +33,7 @@
 #include <string.h>
 #include <locale.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <float.h>
 #include <math.h>
 
@@ -81,6 +82,9 @@ struct mlt_property_s
 
 	pthread_mutex_t mutex;
 	mlt_animation animation;
+
+	/// The number of property lists holding this property
+	atomic_int ref_count;
 };
 
 /** Construct a property and initialize it
@@ -91,7 +95,10 @@ mlt_property mlt_property_init( )
 {
 	mlt_property self = calloc( 1, sizeof( *self ) );
 	if ( self )
+	{
 		pthread_mutex_init( &self->mutex, NULL );
+		atomic_init( &self->ref_count, 1 );
+	}
 	return self;
 }
 
@@ -877,7 +884,54 @@ void *mlt_property_get_data( mlt_property self, int *length )
 	return result;
 }
 
-/** Destroy a property and free all related resources.
+/** Increment the reference count on a property.
+ *
+ * A property with more than one reference is shared by several property lists
+ * and must not be modified; see mlt_properties_clone().
+ * \public \memberof mlt_property_s
+ * \param self a property
+ * \return the new reference count
+ */
+
+int mlt_property_inc_ref( mlt_property self )
+{
+	return self ? atomic_fetch_add( &self->ref_count, 1 ) + 1 : 0;
+}
+
+/** Get the reference count of a property.
+ *
+ * \public \memberof mlt_property_s
+ * \param self a property
+ * \return the reference count
+ */
+
+int mlt_property_ref_count( mlt_property self )
+{
+	return self ? atomic_load( &self->ref_count ) : 0;
+}
+
+/** Determine if a property owns its binary data.
+ *
+ * \public \memberof mlt_property_s
+ * \param self a property
+ * \return true if the property holds data that it destroys with its value
+ */
+
+int mlt_property_owns_data( mlt_property self )
+{
+	int result = 0;
+	if ( self )
+	{
+		pthread_mutex_lock( &self->mutex );
+		result = ( self->types & mlt_prop_data ) && self->destructor != NULL;
+		pthread_mutex_unlock( &self->mutex );
+	}
+	return result;
+}
+
+/** Release a reference to a property.
+ *
+ * The property and all related resources are freed with the last reference.
  *
  * \public \memberof mlt_property_s
  * \param self a property
@@ -885,6 +939,8 @@ void *mlt_property_get_data( mlt_property self, int *length )
 
 void mlt_property_close( mlt_property self )
 {
+	if ( atomic_fetch_sub( &self->ref_count, 1 ) > 1 )
+		return;
 	clear_property( self );
 	pthread_mutex_destroy( &self->mutex );
 	free( self );
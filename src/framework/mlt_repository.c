@@ -25,6 +25,7 @@
 #include "mlt_tokeniser.h"
 #include "mlt_log.h"
 #include "mlt_factory.h"
+#include "mlt_version.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,12 +33,22 @@
 #include <string.h>
 #include <limits.h>
 #include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
 #include <sys/stat.h>
 
+#define CACHE_VERSION 1
+
 /** \brief Repository class
  *
  * The Repository is a collection of plugin modules and their services and service metadata.
  *
+ * The services of each module are kept in a cache file, so that a module is
+ * only loaded when one of its services is first created or queried. The cache
+ * is rebuilt by loading every module when a module file, or a path that a
+ * module watches with mlt_repository_watch(), changes.
+ *
  * \extends mlt_properties_s
  * \properties \p language a cached list of user locales
  */
@@ -49,8 +60,313 @@ struct mlt_repository_s
 	mlt_properties filters;         /// a list of entry points for filters
 	mlt_properties producers;       /// a list of entry points for producers
 	mlt_properties transitions;     /// a list of entry points for transitions
+	mlt_properties watches;         /// for each object file, the paths its services depend on
+	const char *loading;            /// the object file whose mlt_register is running
+	int on_demand;                  /// whether the object file is loaded for one of its services
+	char *cache;                    /// the path of the cache file or NULL
+	pthread_mutex_t mutex;          /// serializes loading object files on demand
 };
 
+/** Get the list of entry points for a service class.
+ *
+ * \private \memberof mlt_repository_s
+ * \param self a repository
+ * \param type a service class
+ * \return a properties list or NULL if error
+ */
+
+static mlt_properties service_list( mlt_repository self, mlt_service_type type )
+{
+	switch ( type )
+	{
+		case consumer_type:
+			return self->consumers;
+		case filter_type:
+			return self->filters;
+		case producer_type:
+			return self->producers;
+		case transition_type:
+			return self->transitions;
+		default:
+			return NULL;
+	}
+}
+
+/** Open an object file and let it register its services.
+ *
+ * \private \memberof mlt_repository_s
+ * \param self a repository
+ * \param object_name the full path of the object file
+ * \return 0 if registered, 1 if it is not a module, or -1 if it failed to load
+ */
+
+static int load_module( mlt_repository self, const char *object_name )
+{
+	int flags = RTLD_NOW;
+
+	// Very temporary hack to allow the quicktime plugins to work
+	// TODO: extend repository to allow this to be used on a case by case basis
+	if ( strstr( object_name, "libmltkino" ) )
+		flags |= RTLD_GLOBAL;
+
+	// Open the shared object
+	void *object = dlopen( object_name, flags );
+	if ( object != NULL )
+	{
+		// Get the registration function
+		mlt_repository_callback symbol_ptr = dlsym( object, "mlt_register" );
+
+		// Call the registration function
+		if ( symbol_ptr != NULL )
+		{
+			self->loading = object_name;
+			symbol_ptr( self );
+			self->loading = NULL;
+
+			// Register the object file for closure
+			mlt_properties_set_data( &self->parent, object_name, object, 0, ( mlt_destructor )dlclose, NULL );
+			return 0;
+		}
+		dlclose( object );
+		return 1;
+	}
+	else if ( strstr( object_name, "libmlt" ) )
+	{
+		mlt_log_warning( NULL, "%s: failed to dlopen %s\n  (%s)\n", __FUNCTION__, object_name, dlerror() );
+	}
+	return -1;
+}
+
+static int make_directories( char *path )
+{
+	char *p = path + 1;
+	struct stat st;
+
+	while ( 1 )
+	{
+		char c;
+		p += strcspn( p, "/" );
+		c = *p;
+		*p = '\0';
+		if ( stat( path, &st ) )
+		{
+#ifdef _WIN32
+			int error = mkdir( path );
+#else
+			int error = mkdir( path, 0755 );
+#endif
+			if ( error && stat( path, &st ) )
+			{
+				*p = c;
+				return 1;
+			}
+		}
+		*p = c;
+		if ( !c )
+			break;
+		p ++;
+	}
+	return 0;
+}
+
+/** Find the cache file for a module directory.
+ *
+ * The file is kept in the directory named by the environment variable
+ * MLT_REPOSITORY_CACHE, else in mlt in the user's cache directory. An empty
+ * MLT_REPOSITORY_CACHE disables the cache.
+ * \private \memberof mlt_repository_s
+ * \param directory the module directory
+ * \return a new string or NULL
+ */
+
+static char *cache_path( const char *directory )
+{
+	const char *base = getenv( "MLT_REPOSITORY_CACHE" );
+	char *dir = NULL;
+	char *path = NULL;
+	unsigned int hash = 2166136261u;
+	const char *s;
+
+	for ( s = directory; *s; s ++ )
+		hash = ( hash ^ (unsigned char) *s ) * 16777619u;
+
+	if ( !base )
+	{
+		const char *cache = getenv( "XDG_CACHE_HOME" );
+		const char *home = getenv( "HOME" );
+		if ( cache || home )
+		{
+			dir = malloc( strlen( cache ? cache : home ) + 20 );
+			sprintf( dir, cache ? "%s/mlt" : "%s/.cache/mlt", cache ? cache : home );
+		}
+	}
+	else if ( strcmp( base, "" ) )
+	{
+		dir = strdup( base );
+	}
+
+	if ( dir && !make_directories( dir ) )
+	{
+		path = malloc( strlen( dir ) + 32 );
+		sprintf( path, "%s/repository-%08x.txt", dir, hash );
+	}
+	free( dir );
+	return path;
+}
+
+/** Get the modification time of a file or -1 if it does not exist.
+*/
+
+static int64_t file_stamp( const char *path, int64_t *size )
+{
+	struct stat st;
+	if ( stat( path, &st ) )
+		return -1;
+	if ( size )
+		*size = st.st_size;
+	return st.st_mtime;
+}
+
+static char *read_line( char *line, int size, FILE *file )
+{
+	if ( !fgets( line, size, file ) )
+		return NULL;
+	line[ strcspn( line, "\n" ) ] = '\0';
+	return line;
+}
+
+/** Register the services of the modules from the cache.
+ *
+ * Modules that failed to load when the cache was made are tried again now.
+ * \private \memberof mlt_repository_s
+ * \param self a repository
+ * \param dir the list of object files in the module directory
+ * \param directory the module directory
+ * \return the number of modules or 0 if the cache is missing or out of date
+ */
+
+static int read_cache( mlt_repository self, mlt_properties dir, const char *directory )
+{
+	FILE *file = fopen( self->cache, "r" );
+	char line[ PATH_MAX + 64 ];
+	char header[ PATH_MAX + 64 ];
+	int modules = 0;
+	int valid = 1;
+	int i;
+
+	if ( !file )
+		return 0;
+
+	// Check the header, the object files, and the watched paths.
+	snprintf( header, sizeof( header ), "mlt-repository %d %s %s", CACHE_VERSION, mlt_version_get_string(), directory );
+	valid = read_line( line, sizeof( line ), file ) && !strcmp( line, header );
+	while ( valid && read_line( line, sizeof( line ), file ) )
+	{
+		long long mtime = 0, size = 0;
+		int64_t actual_size = -1;
+		int loaded = 0;
+		int offset = 0;
+
+		if ( sscanf( line, "M %d %lld %lld %n", &loaded, &mtime, &size, &offset ) == 3 && offset )
+		{
+			for ( i = 0; i < mlt_properties_count( dir ) && strcmp( mlt_properties_get_value( dir, i ), line + offset ); i ++ );
+			valid = i < mlt_properties_count( dir ) &&
+				file_stamp( line + offset, &actual_size ) == mtime && actual_size == size;
+			modules ++;
+		}
+		else if ( sscanf( line, "W %lld %n", &mtime, &offset ) == 1 && offset )
+		{
+			valid = file_stamp( line + offset, NULL ) == mtime;
+		}
+	}
+	valid = valid && modules == mlt_properties_count( dir );
+
+	// Register the services in the order that the modules would load.
+	if ( valid )
+	{
+		const char *module = NULL;
+		rewind( file );
+		read_line( line, sizeof( line ), file );
+		while ( read_line( line, sizeof( line ), file ) )
+		{
+			long long mtime, size;
+			int loaded = 0;
+			int type = 0;
+			int offset = 0;
+
+			if ( sscanf( line, "M %d %lld %lld %n", &loaded, &mtime, &size, &offset ) == 3 )
+			{
+				for ( i = 0; strcmp( mlt_properties_get_value( dir, i ), line + offset ); i ++ );
+				module = mlt_properties_get_value( dir, i );
+				if ( !loaded )
+				{
+					load_module( self, module );
+					module = NULL;
+				}
+			}
+			else if ( module && sscanf( line, "S %d %n", &type, &offset ) == 1 && offset && service_list( self, type ) )
+			{
+				mlt_properties properties = mlt_properties_new();
+				mlt_properties_set( properties, "module", module );
+				mlt_properties_set_data( service_list( self, type ), line + offset, properties, 0, ( mlt_destructor )mlt_properties_close, NULL );
+			}
+		}
+	}
+	fclose( file );
+
+	return valid ? modules : 0;
+}
+
+/** Write the services of the modules to the cache file.
+ *
+ * \private \memberof mlt_repository_s
+ * \param self a repository
+ * \param dir the list of object files in the module directory
+ * \param failed the object files that failed to load
+ * \param directory the module directory
+ */
+
+static void write_cache( mlt_repository self, mlt_properties dir, mlt_properties failed, const char *directory )
+{
+	static const mlt_service_type types[] = { consumer_type, filter_type, producer_type, transition_type };
+	char *temp = malloc( strlen( self->cache ) + 32 );
+	FILE *file;
+	int i, j, k;
+
+	// Write to a new file and rename it so that other processes never see a partial file.
+	sprintf( temp, "%s.%d", self->cache, (int) getpid() );
+	file = fopen( temp, "w" );
+	if ( file )
+	{
+		fprintf( file, "mlt-repository %d %s %s\n", CACHE_VERSION, mlt_version_get_string(), directory );
+		for ( i = 0; i < mlt_properties_count( dir ); i ++ )
+		{
+			const char *module = mlt_properties_get_value( dir, i );
+			mlt_properties watches = mlt_properties_get_data( self->watches, module, NULL );
+			int64_t size = 0;
+			int64_t mtime = file_stamp( module, &size );
+
+			fprintf( file, "M %d %lld %lld %s\n", !mlt_properties_get( failed, module ), (long long) mtime, (long long) size, module );
+			for ( j = 0; j < mlt_properties_count( watches ); j ++ )
+				fprintf( file, "W %s %s\n", mlt_properties_get_value( watches, j ), mlt_properties_get_name( watches, j ) );
+			for ( j = 0; j < 4; j ++ )
+			{
+				mlt_properties services = service_list( self, types[ j ] );
+				for ( k = 0; k < mlt_properties_count( services ); k ++ )
+				{
+					mlt_properties properties = mlt_properties_get_data_at( services, k, NULL );
+					const char *owner = mlt_properties_get( properties, "module" );
+					if ( owner && !strcmp( owner, module ) )
+						fprintf( file, "S %d %s\n", types[ j ], mlt_properties_get_name( services, k ) );
+				}
+			}
+		}
+		if ( fclose( file ) || rename( temp, self->cache ) )
+			remove( temp );
+	}
+	free( temp );
+}
+
 /** Construct a new repository.
  *
  * \public \memberof mlt_repository_s
@@ -71,13 +387,34 @@ mlt_repository mlt_repository_init( const char *directory )
 	self->filters = mlt_properties_new();
 	self->producers = mlt_properties_new();
 	self->transitions = mlt_properties_new();
-
-	// Get the directory list
+	self->watches = mlt_properties_new();
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init( &attr );
+	pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE );
+	pthread_mutex_init( &self->mutex, &attr );
+	pthread_mutexattr_destroy( &attr );
+
+	// Get the directory list, leaving out subdirectories
+	mlt_properties list = mlt_properties_new();
 	mlt_properties dir = mlt_properties_new();
-	int count = mlt_properties_dir_list( dir, directory, NULL, 0 );
+	int count = mlt_properties_dir_list( list, directory, NULL, 0 );
 	int i;
 	int plugin_count = 0;
 
+	for ( i = 0; i < count; i++ )
+	{
+		const char *object_name = mlt_properties_get_value( list, i );
+		struct stat st;
+		if ( stat( object_name, &st ) || !S_ISDIR( st.st_mode ) )
+		{
+			char key[ 20 ];
+			snprintf( key, sizeof( key ), "%d", mlt_properties_count( dir ) );
+			mlt_properties_set( dir, key, object_name );
+		}
+	}
+	count = mlt_properties_count( dir );
+	mlt_properties_close( list );
+
 #ifdef _WIN32
 	char *syspath = getenv("PATH");
 	char *exedir = mlt_environment( "MLT_APPDIR" );
@@ -96,42 +433,29 @@ mlt_repository mlt_repository_init( const char *directory )
 	free(newpath);
 #endif
 
-	// Iterate over files
-	for ( i = 0; i < count; i++ )
+	self->cache = cache_path( directory );
+	if ( self->cache )
+		plugin_count = read_cache( self, dir, directory );
+
+	// Without a valid cache, load every module now and save what they register
+	if ( !plugin_count )
 	{
-		int flags = RTLD_NOW;
-		const char *object_name = mlt_properties_get_value( dir, i);
-
-		// Very temporary hack to allow the quicktime plugins to work
-		// TODO: extend repository to allow this to be used on a case by case basis
-		if ( strstr( object_name, "libmltkino" ) )
-			flags |= RTLD_GLOBAL;
-	
-		// Open the shared object
-		void *object = dlopen( object_name, flags );
-		if ( object != NULL )
-		{
-			// Get the registration function
-			mlt_repository_callback symbol_ptr = dlsym( object, "mlt_register" );
+		mlt_properties failed = mlt_properties_new();
 
-			// Call the registration function
-			if ( symbol_ptr != NULL )
-			{
-				symbol_ptr( self );
+		// Iterate over files
+		for ( i = 0; i < count; i++ )
+		{
+			const char *object_name = mlt_properties_get_value( dir, i );
+			int error = load_module( self, object_name );
 
-				// Register the object file for closure
-				mlt_properties_set_data( &self->parent, object_name, object, 0, ( mlt_destructor )dlclose, NULL );
+			if ( error == 0 )
 				++plugin_count;
-			}
-			else
-			{
-				dlclose( object );
-			}
-		}
-		else if ( strstr( object_name, "libmlt" ) )
-		{
-			mlt_log_warning( NULL, "%s: failed to dlopen %s\n  (%s)\n", __FUNCTION__, object_name, dlerror() );
+			else if ( error < 0 )
+				mlt_properties_set( failed, object_name, "1" );
 		}
+		if ( self->cache && plugin_count )
+			write_cache( self, dir, failed, directory );
+		mlt_properties_close( failed );
 	}
 
 	if ( !plugin_count )
@@ -169,23 +493,53 @@ static mlt_properties new_service( void *symbol )
 
 void mlt_repository_register( mlt_repository self, mlt_service_type service_type, const char *service, mlt_register_callback symbol )
 {
-	// Add the entry point to the corresponding service list
-	switch ( service_type )
+	mlt_properties services = service_list( self, service_type );
+	mlt_properties properties;
+
+	if ( services == NULL )
+		return;
+	properties = mlt_properties_get_data( services, service, NULL );
+
+	if ( self->on_demand && properties )
 	{
-		case consumer_type:
-			mlt_properties_set_data( self->consumers, service, new_service( symbol ), 0, ( mlt_destructor )mlt_properties_close, NULL );
-			break;
-		case filter_type:
-			mlt_properties_set_data( self->filters, service, new_service( symbol ), 0, ( mlt_destructor )mlt_properties_close, NULL );
-			break;
-		case producer_type:
-			mlt_properties_set_data( self->producers, service, new_service( symbol ), 0, ( mlt_destructor )mlt_properties_close, NULL );
-			break;
-		case transition_type:
-			mlt_properties_set_data( self->transitions, service, new_service( symbol ), 0, ( mlt_destructor )mlt_properties_close, NULL );
-			break;
-		default:
-			break;
+		// Complete the entry from the cache; a later module may own the name.
+		const char *module = mlt_properties_get( properties, "module" );
+		if ( module && !strcmp( module, self->loading ) )
+			mlt_properties_set_data( properties, "symbol", symbol, 0, NULL, NULL );
+	}
+	else
+	{
+		// Add the entry point to the corresponding service list
+		properties = new_service( symbol );
+		if ( self->loading )
+			mlt_properties_set( properties, "module", self->loading );
+		mlt_properties_set_data( services, service, properties, 0, ( mlt_destructor )mlt_properties_close, NULL );
+	}
+}
+
+/** Declare that the services registered by a module depend on a file or directory.
+ *
+ * A module that registers services found at run time, such as plugins of
+ * another framework, must call this within its mlt_register() for each path
+ * that it scans, so that the cache of the repository is rebuilt when the
+ * path changes.
+ *
+ * \public \memberof mlt_repository_s
+ * \param self a repository
+ * \param path the full path of a file or directory
+ */
+
+void mlt_repository_watch( mlt_repository self, const char *path )
+{
+	if ( self && self->loading && path )
+	{
+		mlt_properties watches = mlt_properties_get_data( self->watches, self->loading, NULL );
+		if ( !watches )
+		{
+			watches = mlt_properties_new();
+			mlt_properties_set_data( self->watches, self->loading, watches, 0, ( mlt_destructor )mlt_properties_close, NULL );
+		}
+		mlt_properties_set_int64( watches, path, file_stamp( path, NULL ) );
 	}
 }
 
@@ -200,27 +554,42 @@ void mlt_repository_register( mlt_repository self, mlt_service_type service_type
 
 static mlt_properties get_service_properties( mlt_repository self, mlt_service_type type, const char *service )
 {
-	mlt_properties service_properties = NULL;
+	mlt_properties services = service_list( self, type );
+	return services ? mlt_properties_get_data( services, service, NULL ) : NULL;
+}
 
-	// Get the entry point from the corresponding service list
-	switch ( type )
+/** Get the repository properties for a service, loading its module if needed.
+ *
+ * \private \memberof mlt_repository_s
+ * \param self a repository
+ * \param type a service class
+ * \param service the name of a service
+ * \return a properties list or NULL if error
+ */
+
+static mlt_properties load_service_properties( mlt_repository self, mlt_service_type type, const char *service )
+{
+	mlt_properties properties = get_service_properties( self, type, service );
+
+	if ( properties && !mlt_properties_get_data( properties, "symbol", NULL ) )
 	{
-		case consumer_type:
-			service_properties = mlt_properties_get_data( self->consumers, service, NULL );
-			break;
-		case filter_type:
-			service_properties = mlt_properties_get_data( self->filters, service, NULL );
-			break;
-		case producer_type:
-			service_properties = mlt_properties_get_data( self->producers, service, NULL );
-			break;
-		case transition_type:
-			service_properties = mlt_properties_get_data( self->transitions, service, NULL );
-			break;
-		default:
-			break;
+		pthread_mutex_lock( &self->mutex );
+		const char *module = mlt_properties_get( properties, "module" );
+		if ( module && !mlt_properties_get_data( properties, "symbol", NULL ) &&
+			 !mlt_properties_get_data( &self->parent, module, NULL ) )
+		{
+			int on_demand = self->on_demand;
+			self->on_demand = 1;
+			load_module( self, module );
+			self->on_demand = on_demand;
+
+			// The module no longer provides the service: rebuild the cache next time.
+			if ( !mlt_properties_get_data( properties, "symbol", NULL ) && self->cache )
+				remove( self->cache );
+		}
+		pthread_mutex_unlock( &self->mutex );
 	}
-	return service_properties;
+	return properties;
 }
 
 /** Construct a new instance of a service.
@@ -235,7 +604,7 @@ static mlt_properties get_service_properties( mlt_repository self, mlt_service_t
 
 void *mlt_repository_create( mlt_repository self, mlt_profile profile, mlt_service_type type, const char *service, const void *input )
 {
-	mlt_properties properties = get_service_properties( self, type, service );
+	mlt_properties properties = load_service_properties( self, type, service );
 	if ( properties != NULL )
 	{
 		mlt_register_callback symbol_ptr = mlt_properties_get_data( properties, "symbol", NULL );
@@ -258,7 +627,10 @@ void mlt_repository_close( mlt_repository self )
 	mlt_properties_close( self->filters );
 	mlt_properties_close( self->producers );
 	mlt_properties_close( self->transitions );
+	mlt_properties_close( self->watches );
 	mlt_properties_close( &self->parent );
+	pthread_mutex_destroy( &self->mutex );
+	free( self->cache );
 	free( self );
 }
 
@@ -326,6 +698,14 @@ mlt_properties mlt_repository_transitions( mlt_repository self )
 void mlt_repository_register_metadata( mlt_repository self, mlt_service_type type, const char *service, mlt_metadata_callback callback, void *callback_data )
 {
 	mlt_properties service_properties = get_service_properties( self, type, service );
+
+	// When loading on demand, a later module may own the name.
+	if ( self->on_demand && service_properties )
+	{
+		const char *module = mlt_properties_get( service_properties, "module" );
+		if ( !module || strcmp( module, self->loading ) )
+			return;
+	}
 	mlt_properties_set_data( service_properties, "metadata_cb", callback, 0, NULL, NULL );
 	mlt_properties_set_data( service_properties, "metadata_cb_data", callback_data, 0, NULL, NULL );
 }
@@ -344,7 +724,7 @@ void mlt_repository_register_metadata( mlt_repository self, mlt_service_type typ
 mlt_properties mlt_repository_metadata( mlt_repository self, mlt_service_type type, const char *service )
 {
 	mlt_properties metadata = NULL;
-	mlt_properties properties = get_service_properties( self, type, service );
+	mlt_properties properties = load_service_properties( self, type, service );
 
 	// If this is a valid service
 	if ( properties )
@@ -55,6 +55,7 @@ typedef mlt_properties ( *mlt_metadata_callback )( mlt_service_type, const char
 
 extern mlt_repository mlt_repository_init( const char *directory );
 extern void mlt_repository_register( mlt_repository self, mlt_service_type service_type, const char *service, mlt_register_callback );
+extern void mlt_repository_watch( mlt_repository self, const char *path );
 extern void *mlt_repository_create( mlt_repository self, mlt_profile profile, mlt_service_type type, const char *service, const void *arg );
 extern void mlt_repository_close( mlt_repository self );
 extern mlt_properties mlt_repository_consumers( mlt_repository self );
@@ -669,7 +669,7 @@ static void mlt_service_filter_changed( mlt_service owner, mlt_service self )
 
 static void mlt_service_filter_property_changed( mlt_service owner, mlt_service self, char *name )
 {
-    mlt_events_fire( MLT_SERVICE_PROPERTIES( self ), "property-changed", name, NULL );
+    mlt_events_fire_id( MLT_SERVICE_PROPERTIES( self ), mlt_event_property_changed, name, NULL );
 }
 
 /** Attach a filter.
@@ -707,6 +707,7 @@ int mlt_service_attach( mlt_service self, mlt_filter filter )
 				mlt_properties_inc_ref( MLT_FILTER_PROPERTIES( filter ) );
 				base->filters[ base->filter_count ++ ] = filter;
 				mlt_properties_set_data( props, "service", self, 0, NULL, NULL );
+				mlt_properties_touch( properties );
 				mlt_events_fire( properties, "service-changed", NULL );
 				mlt_events_fire( props, "service-changed", NULL );
 				mlt_service cp = mlt_properties_get_data( properties, "_cut_parent", NULL );
@@ -753,6 +754,7 @@ int mlt_service_detach( mlt_service self, mlt_filter filter )
 			base->filter_count --;
 			mlt_events_disconnect( MLT_FILTER_PROPERTIES( filter ), self );
 			mlt_filter_close( filter );
+			mlt_properties_touch( properties );
 			mlt_events_fire( properties, "service-changed", NULL );
 		}
 	}
@@ -811,6 +813,7 @@ int mlt_service_move_filter( mlt_service self, int from, int to )
 					base->filters[i] = base->filters[i + 1];
 			}
 			base->filters[to] = filter;
+			mlt_properties_touch( MLT_SERVICE_PROPERTIES(self) );
 			mlt_events_fire( MLT_SERVICE_PROPERTIES(self), "service-changed", NULL );
 			error = 0;
 		}
@@ -918,8 +921,14 @@ void mlt_service_cache_purge( mlt_service self )
 	}
 }
 
+/** Serializes the lookup and creation of the service caches. */
+
+static pthread_mutex_t caches_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /** Lookup the cache object for a service.
  *
+ * Services may be created and used on several threads, which must all get
+ * the same cache for a name.
  * \private \memberof mlt_service_s
  * \param self a service
  * \param name a name for the object
@@ -929,8 +938,10 @@ void mlt_service_cache_purge( mlt_service self )
 static mlt_cache get_cache( mlt_service self, const char *name )
 {
 	mlt_cache result = NULL;
-	mlt_properties caches = mlt_properties_get_data( mlt_global_properties(), "caches", NULL );
+	mlt_properties caches;
 
+	pthread_mutex_lock( &caches_mutex );
+	caches = mlt_properties_get_data( mlt_global_properties(), "caches", NULL );
 	if ( !caches )
 	{
 		caches = mlt_properties_new();
@@ -945,7 +956,8 @@ static mlt_cache get_cache( mlt_service self, const char *name )
 			mlt_properties_set_data( caches, name, result, 0, ( mlt_destructor )mlt_cache_close, NULL );
 		}
 	}
-	
+	pthread_mutex_unlock( &caches_mutex );
+
 	return result;
 }
 
@@ -72,6 +72,9 @@ typedef enum
 }
 mlt_audio_format;
 
+/** Make a bit mask of audio formats for mlt_frame_choose_audio_format() */
+#define MLT_AUDIO_FORMAT_FLAG( format ) ( 1 << ( format ) )
+
 typedef enum
 {
 	mlt_channel_auto = 0,      /**< MLT will determine the default configuration based on channel number */
@@ -174,6 +177,20 @@ typedef struct {
 }
 mlt_rect;
 
+/** A summary of an alpha channel
+ *
+ * Every pixel outside the box is fully transparent.
+ */
+
+typedef struct {
+	int x;      /**< left edge of the box around the pixels that are not fully transparent */
+	int y;      /**< top edge of the box */
+	int width;  /**< width of the box, zero when every pixel is transparent */
+	int height; /**< height of the box, zero when every pixel is transparent */
+	int opaque; /**< whether every pixel is fully opaque */
+}
+mlt_alpha_summary;
+
 /** A tuple of color components */
 
 typedef struct {
@@ -186,6 +203,7 @@ mlt_color;
 
 typedef struct mlt_audio_s *mlt_audio;                  /**< pointer to Audio object */
 typedef struct mlt_frame_s *mlt_frame, **mlt_frame_ptr; /**< pointer to Frame object */
+typedef struct mlt_image_s *mlt_image;                  /**< pointer to Image object */
 typedef struct mlt_property_s *mlt_property;            /**< pointer to Property object */
 typedef struct mlt_properties_s *mlt_properties;        /**< pointer to Properties object */
 typedef struct mlt_event_struct *mlt_event;             /**< pointer to Event object */
@@ -1490,6 +1490,9 @@ static void *consumer_thread( void *arg )
 	long int frames = 0;
 	long int total_time = 0;
 
+	// Whether this run enabled audio_only on the consumer
+	int audio_only = 0;
+
 	// Determine the format
 	AVOutputFormat *fmt = NULL;
 	const char *filename = mlt_properties_get( properties, "target" );
@@ -1764,6 +1767,13 @@ static void *consumer_thread( void *arg )
 		goto on_fatal_error;
 	}
 
+	// Without a video stream the frames are only needed for their audio
+	if ( !enc_ctx->video_st && !mlt_properties_get( properties, "audio_only" ) )
+	{
+		mlt_properties_set_int( properties, "audio_only", 1 );
+		audio_only = 1;
+	}
+
 	// Allocate picture
 	enum AVPixelFormat pix_fmt;
 	if ( enc_ctx->video_st ) {
@@ -2260,6 +2270,10 @@ on_fatal_error:
 	// Free the stream
 	av_free( enc_ctx->oc );
 
+	// Leave audio_only as the application set it for the next run
+	if ( audio_only )
+		mlt_properties_clear( properties, "audio_only" );
+
 	// Just in case we terminated on pause
 	mlt_consumer_stopped( consumer );
 	mlt_properties_close( enc_ctx->frame_meta_properties );
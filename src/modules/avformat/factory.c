@@ -17,6 +17,10 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <string.h>
 #include <pthread.h>
 #include <limits.h>
@@ -39,12 +43,15 @@ extern mlt_filter filter_avfilter_init( mlt_profile, mlt_service_type, const cha
 #endif
 #ifdef AVFILTER
 #include <libavfilter/avfilter.h>
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
 #endif
 #include <libavutil/opt.h>
 
 
-// A static flag used to determine if avformat has been initialised
-static int avformat_initialised = 0;
+// Initialises avformat once, even when services are created on several threads
+static pthread_once_t avformat_initialised = PTHREAD_ONCE_INIT;
 
 static int avformat_lockmgr(void **mutex, enum AVLockOp op)
 {
@@ -81,31 +88,31 @@ static void unregister_lockmgr( void *p )
 	av_lockmgr_register( NULL );
 }
 
-static void avformat_init( )
+static void avformat_init_once( void )
 {
-	// Initialise avformat if necessary
-	if ( avformat_initialised == 0 )
-	{
-		avformat_initialised = 1;
-		av_lockmgr_register( &avformat_lockmgr );
-		mlt_factory_register_for_clean_up( &avformat_lockmgr, unregister_lockmgr );
-		av_register_all( );
+	av_lockmgr_register( &avformat_lockmgr );
+	mlt_factory_register_for_clean_up( &avformat_lockmgr, unregister_lockmgr );
+	av_register_all( );
 #ifdef AVDEVICE
-		avdevice_register_all();
+	avdevice_register_all();
 #endif
 #ifdef AVFILTER
-		avfilter_register_all();
+	avfilter_register_all();
 #endif
-		avformat_network_init();
-		av_log_set_level( mlt_log_get_level() );
-		if ( getenv("MLT_AVFORMAT_PRODUCER_CACHE") )
-		{
-			int n = atoi( getenv("MLT_AVFORMAT_PRODUCER_CACHE" )  );
-			mlt_service_cache_set_size( NULL, "producer_avformat", n );
-		}
+	avformat_network_init();
+	av_log_set_level( mlt_log_get_level() );
+	if ( getenv("MLT_AVFORMAT_PRODUCER_CACHE") )
+	{
+		int n = atoi( getenv("MLT_AVFORMAT_PRODUCER_CACHE" )  );
+		mlt_service_cache_set_size( NULL, "producer_avformat", n );
 	}
 }
 
+static void avformat_init( )
+{
+	pthread_once( &avformat_initialised, avformat_init_once );
+}
+
 static void *create_service( mlt_profile profile, mlt_service_type type, const char *id, void *arg )
 {
 	avformat_init( );
@@ -436,6 +443,13 @@ MLT_REPOSITORY
 	char dirname[PATH_MAX];
 	snprintf( dirname, PATH_MAX, "%s/avformat/blacklist.txt", mlt_environment( "MLT_DATA" ) );
 	mlt_properties blacklist = mlt_properties_load( dirname );
+	mlt_repository_watch( repository, dirname );
+#ifndef _WIN32
+	// The filters come from the installed libavfilter, so rebuild the cache when it changes.
+	Dl_info info;
+	if ( dladdr( (void*) avfilter_next, &info ) && info.dli_fname )
+		mlt_repository_watch( repository, info.dli_fname );
+#endif
 
 	// Load a list of parameters impacted by consumer scale into global properties.
 	snprintf(dirname, PATH_MAX, "%s/avformat/resolution_scale.yml", mlt_environment("MLT_DATA"));
@@ -60,7 +60,7 @@ static inline int convert_mlt_to_av_cs( mlt_image_format format )
 	return value;
 }
 
-static int filter_scale( mlt_frame frame, uint8_t **image, mlt_image_format *format, int iwidth, int iheight, int owidth, int oheight )
+static int filter_scale( mlt_frame frame, uint8_t **image, mlt_image_format *format, int iwidth, int iheight, int istride, int owidth, int oheight )
 {
 	// Get the properties
 	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
@@ -118,6 +118,7 @@ static int filter_scale( mlt_frame frame, uint8_t **image, mlt_image_format *for
 	uint8_t *outbuf = mlt_pool_alloc( out_size );
 
 	av_image_fill_arrays(in_data, in_stride, *image, avformat, iwidth, iheight, IMAGE_ALIGN);
+	in_stride[0] = istride;
 	av_image_fill_arrays(out_data, out_stride, outbuf, avformat, owidth, oheight, IMAGE_ALIGN);
 
 	// Create the context and output image
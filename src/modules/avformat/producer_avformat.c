@@ -1559,6 +1559,22 @@ static int allocate_buffer( mlt_frame frame, AVCodecContext *codec_context, uint
 /** Get an image from a frame.
 */
 
+/** Give a clone of a cached frame its own image and alpha if they will be modified.
+ *
+ * Clones share their buffers with the frame they were made from.
+ */
+
+static void writable_clone( mlt_frame clone, int writable )
+{
+	if ( writable )
+	{
+		uint8_t *image = NULL;
+		mlt_image_format format = mlt_image_none;
+		int width = 0, height = 0;
+		mlt_frame_get_image( clone, &image, &format, &width, &height, 1 );
+	}
+}
+
 static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_format *format, int *width, int *height, int writable )
 {
 	// Get the producer
@@ -1633,6 +1649,7 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 			mlt_properties orig_props = MLT_FRAME_PROPERTIES( original );
 			int size = 0;
 
+			writable_clone( original, writable );
 			*buffer = mlt_properties_get_data( orig_props, "alpha", &size );
 			if (*buffer)
 				mlt_frame_set_alpha( frame, *buffer, size, NULL );
@@ -1999,6 +2016,7 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 		mlt_properties orig_props = MLT_FRAME_PROPERTIES( original );
 		int size = 0;
 
+		writable_clone( original, writable );
 		*buffer = mlt_properties_get_data( orig_props, "alpha", &size );
 		if (*buffer)
 			mlt_frame_set_alpha( frame, *buffer, size, NULL );
@@ -26,6 +26,7 @@ extern mlt_consumer consumer_null_init( mlt_profile profile, mlt_service_type ty
 extern mlt_filter filter_audiochannels_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_audioconvert_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_audiomap_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
+extern mlt_filter filter_audioresample_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_audiowave_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_brightness_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_channelcopy_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
@@ -39,11 +40,13 @@ extern mlt_filter filter_imageconvert_init( mlt_profile profile, mlt_service_typ
 extern mlt_filter filter_luma_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_mask_apply_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_mask_start_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
+extern mlt_filter filter_mix_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_mirror_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_mono_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_obscure_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_panner_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_region_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
+extern mlt_filter filter_rendercache_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_rescale_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_resize_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_filter filter_transition_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
@@ -77,6 +80,7 @@ MLT_REPOSITORY
 	MLT_REGISTER( filter_type, "audiochannels", filter_audiochannels_init );
 	MLT_REGISTER( filter_type, "audioconvert", filter_audioconvert_init );
 	MLT_REGISTER( filter_type, "audiomap", filter_audiomap_init );
+	MLT_REGISTER( filter_type, "audioresample", filter_audioresample_init );
 	MLT_REGISTER( filter_type, "audiowave", filter_audiowave_init );
 	MLT_REGISTER( filter_type, "brightness", filter_brightness_init );
 	MLT_REGISTER( filter_type, "channelcopy", filter_channelcopy_init );
@@ -92,11 +96,13 @@ MLT_REPOSITORY
 	MLT_REGISTER( filter_type, "luma", filter_luma_init );
 	MLT_REGISTER( filter_type, "mask_apply", filter_mask_apply_init );
 	MLT_REGISTER( filter_type, "mask_start", filter_mask_start_init );
+	MLT_REGISTER( filter_type, "mix", filter_mix_init );
 	MLT_REGISTER( filter_type, "mirror", filter_mirror_init );
 	MLT_REGISTER( filter_type, "mono", filter_mono_init );
 	MLT_REGISTER( filter_type, "obscure", filter_obscure_init );
 	MLT_REGISTER( filter_type, "panner", filter_panner_init );
 	MLT_REGISTER( filter_type, "region", filter_region_init );
+	MLT_REGISTER( filter_type, "rendercache", filter_rendercache_init );
 	MLT_REGISTER( filter_type, "rescale", filter_rescale_init );
 	MLT_REGISTER( filter_type, "resize", filter_resize_init );
 	MLT_REGISTER( filter_type, "transition", filter_transition_init );
@@ -120,6 +126,7 @@ MLT_REPOSITORY
 
 	MLT_REGISTER_METADATA( consumer_type, "multi", metadata, "consumer_multi.yml" );
 	MLT_REGISTER_METADATA( filter_type, "audiomap", metadata, "filter_audiomap.yml" );
+	MLT_REGISTER_METADATA( filter_type, "audioresample", metadata, "filter_audioresample.yml" );
 	MLT_REGISTER_METADATA( filter_type, "audiowave", metadata, "filter_audiowave.yml" );
 	MLT_REGISTER_METADATA( filter_type, "brightness", metadata, "filter_brightness.yml" );
 	MLT_REGISTER_METADATA( filter_type, "channelcopy", metadata, "filter_channelcopy.yml" );
@@ -134,10 +141,12 @@ MLT_REPOSITORY
 	MLT_REGISTER_METADATA( filter_type, "mask_apply", metadata, "filter_mask_apply.yml" );
 	MLT_REGISTER_METADATA( filter_type, "mask_start", metadata, "filter_mask_start.yml" );
 	MLT_REGISTER_METADATA( filter_type, "mirror", metadata, "filter_mirror.yml" );
+	MLT_REGISTER_METADATA( filter_type, "mix", metadata, "filter_mix.yml" );
 	MLT_REGISTER_METADATA( filter_type, "mono", metadata, "filter_mono.yml" );
 	MLT_REGISTER_METADATA( filter_type, "obscure", metadata, "filter_obscure.yml" );
 	MLT_REGISTER_METADATA( filter_type, "panner", metadata, "filter_panner.yml" );
 	MLT_REGISTER_METADATA( filter_type, "region", metadata, "filter_region.yml" );
+	MLT_REGISTER_METADATA( filter_type, "rendercache", metadata, "filter_rendercache.yml" );
 	MLT_REGISTER_METADATA( filter_type, "rescale", metadata, "filter_rescale.yml" );
 	MLT_REGISTER_METADATA( filter_type, "resize", metadata, "filter_resize.yml" );
 	MLT_REGISTER_METADATA( filter_type, "transition", metadata, "filter_transition.yml" );
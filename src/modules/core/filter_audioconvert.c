@@ -20,544 +20,391 @@
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
 #include <framework/mlt_log.h>
+#include <framework/mlt_property.h>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Every audio format is a sample type in either an interleaved or a planar
+ * layout. A conversion changes the sample type with one kernel from a table
+ * and, if needed, the layout with an interleave or deinterleave pass. The two
+ * are fused block by block so the samples only travel through memory once.
+ */
+
+typedef enum
+{
+	sample_s16,
+	sample_s32,
+	sample_f32,
+	sample_u8,
+	sample_type_count
+} sample_type;
+
+typedef void ( *sample_convert_fn )( const void *src, void *dst, int count );
+
+struct audio_layout
+{
+	sample_type type;
+	int size;
+	int planar;
+};
+
+static const struct audio_layout *audio_layout( mlt_audio_format format )
+{
+	static const struct audio_layout layouts[] =
+	{
+		[mlt_audio_s16]   = { sample_s16, sizeof( int16_t ), 0 },
+		[mlt_audio_s32]   = { sample_s32, sizeof( int32_t ), 1 },
+		[mlt_audio_float] = { sample_f32, sizeof( float ),   1 },
+		[mlt_audio_s32le] = { sample_s32, sizeof( int32_t ), 0 },
+		[mlt_audio_f32le] = { sample_f32, sizeof( float ),   0 },
+		[mlt_audio_u8]    = { sample_u8,  sizeof( uint8_t ), 0 },
+	};
+	if ( format <= mlt_audio_none || format > mlt_audio_u8 )
+		return NULL;
+	return &layouts[ format ];
+}
+
+/** Define a scalar kernel that converts count samples with expr.
+ *
+ * The kernels may run in place when the output samples are not larger than the input ones.
+*/
+
+#define SAMPLE_KERNEL( name, in_type, out_type, expr ) \
+static void name( const void *src, void *dst, int count ) \
+{ \
+	const in_type *q = src; \
+	out_type *p = dst; \
+	int i; \
+	for ( i = 0; i < count; i++ ) \
+	{ \
+		in_type x = q[ i ]; \
+		p[ i ] = expr; \
+	} \
+}
+
+static inline int32_t float_to_s32( float f )
+{
+	f = CLAMP( f, -1.0f, 1.0f );
+	int64_t pcm = ( f > 0.0f ? 2147483647LL : 2147483648LL ) * f;
+	return CLAMP( pcm, -2147483648LL, 2147483647LL );
+}
+
+SAMPLE_KERNEL( s16_to_s32_c, int16_t, int32_t, (int32_t) x << 16 )
+SAMPLE_KERNEL( s16_to_f32_c, int16_t, float, (float) x / 32768.0f )
+SAMPLE_KERNEL( s16_to_u8, int16_t, uint8_t, ( x >> 8 ) + 128 )
+SAMPLE_KERNEL( s32_to_s16_c, int32_t, int16_t, x >> 16 )
+SAMPLE_KERNEL( s32_to_f32_c, int32_t, float, (float) x / 2147483648.0f )
+SAMPLE_KERNEL( s32_to_u8, int32_t, uint8_t, ( x >> 24 ) + 128 )
+SAMPLE_KERNEL( f32_to_s16_c, float, int16_t, 32767 * CLAMP( x, -1.0f, 1.0f ) )
+SAMPLE_KERNEL( f32_to_s32_c, float, int32_t, float_to_s32( x ) )
+SAMPLE_KERNEL( f32_to_u8, float, uint8_t, ( 127 * CLAMP( x, -1.0f, 1.0f ) ) + 128 )
+SAMPLE_KERNEL( u8_to_s16, uint8_t, int16_t, ( (int16_t) x - 128 ) << 8 )
+SAMPLE_KERNEL( u8_to_s32, uint8_t, int32_t, ( (int32_t) x - 128 ) << 24 )
+SAMPLE_KERNEL( u8_to_f32, uint8_t, float, ( (float) x - 128 ) / 256.0f )
+
+#if defined(__SSE2__)
+
+/* Each vector loop loads its inputs before it stores, so that converting in
+ * place to a sample of the same or a smaller size never overwrites unread input.
+ * The remainder goes to the scalar kernel, which gives the same results.
+ */
+
+static void s16_to_s32( const void *src, void *dst, int count )
+{
+	const int16_t *q = src;
+	int32_t *p = dst;
+	int i;
+	for ( i = 0; i + 8 <= count; i += 8 )
+	{
+		__m128i x = _mm_loadu_si128( (const __m128i*)( q + i ) );
+		_mm_storeu_si128( (__m128i*)( p + i ), _mm_unpacklo_epi16( _mm_setzero_si128(), x ) );
+		_mm_storeu_si128( (__m128i*)( p + i + 4 ), _mm_unpackhi_epi16( _mm_setzero_si128(), x ) );
+	}
+	s16_to_s32_c( q + i, p + i, count - i );
+}
+
+static void s16_to_f32( const void *src, void *dst, int count )
+{
+	const int16_t *q = src;
+	float *p = dst;
+	const __m128 scale = _mm_set1_ps( 1.0f / 32768.0f );
+	int i;
+	for ( i = 0; i + 8 <= count; i += 8 )
+	{
+		__m128i x = _mm_loadu_si128( (const __m128i*)( q + i ) );
+		__m128i lo = _mm_srai_epi32( _mm_unpacklo_epi16( x, x ), 16 );
+		__m128i hi = _mm_srai_epi32( _mm_unpackhi_epi16( x, x ), 16 );
+		_mm_storeu_ps( p + i, _mm_mul_ps( _mm_cvtepi32_ps( lo ), scale ) );
+		_mm_storeu_ps( p + i + 4, _mm_mul_ps( _mm_cvtepi32_ps( hi ), scale ) );
+	}
+	s16_to_f32_c( q + i, p + i, count - i );
+}
+
+static void s32_to_s16( const void *src, void *dst, int count )
+{
+	const int32_t *q = src;
+	int16_t *p = dst;
+	int i;
+	for ( i = 0; i + 8 <= count; i += 8 )
+	{
+		__m128i lo = _mm_srai_epi32( _mm_loadu_si128( (const __m128i*)( q + i ) ), 16 );
+		__m128i hi = _mm_srai_epi32( _mm_loadu_si128( (const __m128i*)( q + i + 4 ) ), 16 );
+		_mm_storeu_si128( (__m128i*)( p + i ), _mm_packs_epi32( lo, hi ) );
+	}
+	s32_to_s16_c( q + i, p + i, count - i );
+}
+
+static void s32_to_f32( const void *src, void *dst, int count )
+{
+	const int32_t *q = src;
+	float *p = dst;
+	const __m128 scale = _mm_set1_ps( 1.0f / 2147483648.0f );
+	int i;
+	for ( i = 0; i + 4 <= count; i += 4 )
+	{
+		__m128i x = _mm_loadu_si128( (const __m128i*)( q + i ) );
+		_mm_storeu_ps( p + i, _mm_mul_ps( _mm_cvtepi32_ps( x ), scale ) );
+	}
+	s32_to_f32_c( q + i, p + i, count - i );
+}
+
+static void f32_to_s16( const void *src, void *dst, int count )
+{
+	const float *q = src;
+	int16_t *p = dst;
+	const __m128 min = _mm_set1_ps( -1.0f );
+	const __m128 max = _mm_set1_ps( 1.0f );
+	const __m128 scale = _mm_set1_ps( 32767.0f );
+	int i;
+	for ( i = 0; i + 8 <= count; i += 8 )
+	{
+		__m128 lo = _mm_loadu_ps( q + i );
+		__m128 hi = _mm_loadu_ps( q + i + 4 );
+		lo = _mm_mul_ps( _mm_min_ps( _mm_max_ps( lo, min ), max ), scale );
+		hi = _mm_mul_ps( _mm_min_ps( _mm_max_ps( hi, min ), max ), scale );
+		_mm_storeu_si128( (__m128i*)( p + i ), _mm_packs_epi32( _mm_cvttps_epi32( lo ), _mm_cvttps_epi32( hi ) ) );
+	}
+	f32_to_s16_c( q + i, p + i, count - i );
+}
+
+static void f32_to_s32( const void *src, void *dst, int count )
+{
+	const float *q = src;
+	int32_t *p = dst;
+	const __m128 min = _mm_set1_ps( -1.0f );
+	const __m128 max = _mm_set1_ps( 1.0f );
+	const __m128 scale = _mm_set1_ps( 2147483648.0f );
+	int i;
+	for ( i = 0; i + 4 <= count; i += 4 )
+	{
+		__m128 x = _mm_mul_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( q + i ), min ), max ), scale );
+		// +1.0 overflows to INT32_MIN, flip it to INT32_MAX
+		__m128i overflow = _mm_castps_si128( _mm_cmpge_ps( x, scale ) );
+		_mm_storeu_si128( (__m128i*)( p + i ), _mm_xor_si128( _mm_cvttps_epi32( x ), overflow ) );
+	}
+	f32_to_s32_c( q + i, p + i, count - i );
+}
+
+/** Split interleaved 32-bit samples into planes of stride samples each.
+*/
+
+static void deinterleave32( const void *src, void *dst, int stride, int channels, int count )
+{
+	const float *q = src;
+	float *p = dst;
+	int i = 0, c;
+
+	if ( channels == 2 )
+	{
+		for ( ; i + 4 <= count; i += 4 )
+		{
+			__m128 a = _mm_loadu_ps( q + 2 * i );
+			__m128 b = _mm_loadu_ps( q + 2 * i + 4 );
+			_mm_storeu_ps( p + i, _mm_shuffle_ps( a, b, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+			_mm_storeu_ps( p + stride + i, _mm_shuffle_ps( a, b, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+		}
+	}
+	for ( c = 0; c < channels; c++ )
+	{
+		const float *s = q + i * channels + c;
+		float *d = p + c * stride;
+		int j;
+		for ( j = i; j < count; j++, s += channels )
+			d[ j ] = *s;
+	}
+}
+
+/** Merge planes of stride samples each into interleaved 32-bit samples.
+*/
+
+static void interleave32( const void *src, int stride, void *dst, int channels, int count )
+{
+	const float *q = src;
+	float *p = dst;
+	int i = 0, c;
+
+	if ( channels == 2 )
+	{
+		for ( ; i + 4 <= count; i += 4 )
+		{
+			__m128 l = _mm_loadu_ps( q + i );
+			__m128 r = _mm_loadu_ps( q + stride + i );
+			_mm_storeu_ps( p + 2 * i, _mm_unpacklo_ps( l, r ) );
+			_mm_storeu_ps( p + 2 * i + 4, _mm_unpackhi_ps( l, r ) );
+		}
+	}
+	for ( c = 0; c < channels; c++ )
+	{
+		const float *s = q + c * stride;
+		float *d = p + i * channels + c;
+		int j;
+		for ( j = i; j < count; j++, d += channels )
+			*d = s[ j ];
+	}
+}
+
+#else
+
+#define s16_to_s32 s16_to_s32_c
+#define s16_to_f32 s16_to_f32_c
+#define s32_to_s16 s32_to_s16_c
+#define s32_to_f32 s32_to_f32_c
+#define f32_to_s16 f32_to_s16_c
+#define f32_to_s32 f32_to_s32_c
+
+static void deinterleave32( const void *src, void *dst, int stride, int channels, int count )
+{
+	const int32_t *q = src;
+	int32_t *p = dst;
+	int c, i;
+	for ( c = 0; c < channels; c++ )
+		for ( i = 0; i < count; i++ )
+			p[ c * stride + i ] = q[ i * channels + c ];
+}
+
+static void interleave32( const void *src, int stride, void *dst, int channels, int count )
+{
+	const int32_t *q = src;
+	int32_t *p = dst;
+	int c, i;
+	for ( c = 0; c < channels; c++ )
+		for ( i = 0; i < count; i++ )
+			p[ i * channels + c ] = q[ c * stride + i ];
+}
+
+#endif
+
+// Indexed by source then destination sample type, NULL when the type does not change
+static const sample_convert_fn sample_converters[ sample_type_count ][ sample_type_count ] =
+{
+	[sample_s16] = { [sample_s32] = s16_to_s32, [sample_f32] = s16_to_f32, [sample_u8] = s16_to_u8 },
+	[sample_s32] = { [sample_s16] = s32_to_s16, [sample_f32] = s32_to_f32, [sample_u8] = s32_to_u8 },
+	[sample_f32] = { [sample_s16] = f32_to_s16, [sample_s32] = f32_to_s32, [sample_u8] = f32_to_u8 },
+	[sample_u8]  = { [sample_s16] = u8_to_s16,  [sample_s32] = u8_to_s32,  [sample_f32] = u8_to_f32 },
+};
+
+// Samples per channel converted at a time when the layout changes, sized to stay in cache
+#define BLOCK_SAMPLES 4096
+
+/** Determine if the audio of a frame may be overwritten.
+ *
+ * The buffer must be the frame's own: not shared with a clone and not
+ * borrowed from another frame, as a shallow clone does.
+*/
+
+static int audio_is_writable( mlt_properties properties, void *audio )
+{
+	int writable = 0;
+	if ( audio && audio == mlt_properties_get_data( properties, "audio", NULL ) && !mlt_properties_is_shared( properties, "audio" ) )
+	{
+		mlt_property property = mlt_properties_share_property( properties, "audio" );
+		writable = mlt_property_owns_data( property );
+		mlt_property_close( property );
+	}
+	return writable;
+}
 
 static int convert_audio( mlt_frame frame, void **audio, mlt_audio_format *format, mlt_audio_format requested_format )
 {
-	int error = 1;
 	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
 	int channels = mlt_properties_get_int( properties, "audio_channels" );
 	int samples = mlt_properties_get_int( properties, "audio_samples" );
 	int size = mlt_audio_format_size( requested_format, samples, channels );
+	const struct audio_layout *from = audio_layout( *format );
+	const struct audio_layout *to = audio_layout( requested_format );
+	sample_convert_fn convert;
+	uint8_t *buffer;
+
+	if ( *format == requested_format || !from || !to )
+		return 1;
 
-	if ( *format != requested_format )
+	mlt_log_debug( NULL, "[filter audioconvert] %s -> %s %d channels %d samples\n",
+		mlt_audio_format_name( *format ), mlt_audio_format_name( requested_format ),
+		channels, samples );
+	convert = sample_converters[ from->type ][ to->type ];
+
+	if ( from->planar == to->planar )
 	{
-		mlt_log_debug( NULL, "[filter audioconvert] %s -> %s %d channels %d samples\n",
-			mlt_audio_format_name( *format ), mlt_audio_format_name( requested_format ),
-			channels, samples );
-		switch ( *format )
+		if ( to->size <= from->size && audio_is_writable( properties, *audio ) )
 		{
-		case mlt_audio_s16:
-			switch ( requested_format )
-			{
-			case mlt_audio_s32:
-			{
-				int32_t *buffer = mlt_pool_alloc( size );
-				int32_t *p = buffer;
-				int c;
-				for ( c = 0; c < channels; c++ )
-				{
-					int16_t *q = (int16_t*) *audio + c;
-					int i = samples + 1;
-					while ( --i )
-					{
-						*p++ = (int32_t) *q << 16;
-						q += channels;
-					}
-				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_float:
-			{
-				float *buffer = mlt_pool_alloc( size );
-				float *p = buffer;
-				int c;
-				for ( c = 0; c < channels; c++ )
-				{
-					int16_t *q = (int16_t*) *audio + c;
-					int i = samples + 1;
-					while ( --i )
-					{
-						*p++ = (float)( *q ) / 32768.0;
-						q += channels;
-					}
-				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_s32le:
-			{
-				int32_t *buffer = mlt_pool_alloc( size );
-				int32_t *p = buffer;
-				int16_t *q = (int16_t*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-					*p++ = (int32_t) *q++ << 16;
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_f32le:
-			{
-				float *buffer = mlt_pool_alloc( size );
-				float *p = buffer;
-				int16_t *q = (int16_t*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-				{
-					float f = (float)( *q++ ) / 32768.0;
-					*p++ = CLAMP( f, -1.0f, 1.0f );
-				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_u8:
-			{
-				uint8_t *buffer = mlt_pool_alloc( size );
-				uint8_t *p = buffer;
-				int16_t *q = (int16_t*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-					*p++ = ( *q++ >> 8 ) + 128;
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			default:
-				break;
-			}
-			break;
-		case mlt_audio_s32:
-			switch ( requested_format )
-			{
-			case mlt_audio_s16:
-			{
-				int16_t *buffer = mlt_pool_alloc( size );
-				int16_t *p = buffer;
-				int32_t *q = (int32_t*) *audio;
-				int s, c;
-				for ( s = 0; s < samples; s++ )
-					for ( c = 0; c < channels; c++ )
-						*p++ = *( q + c * samples + s ) >> 16;
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_float:
-			{
-				float *buffer = mlt_pool_alloc( size );
-				float *p = buffer;
-				int32_t *q = (int32_t*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-					*p++ = (float)( *q++ ) / 2147483648.0;
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_s32le:
-			{
-				int32_t *buffer = mlt_pool_alloc( size );
-				int32_t *p = buffer;
-				int32_t *q = (int32_t*) *audio;
-				int s, c;
-				for ( s = 0; s < samples; s++ )
-					for ( c = 0; c < channels; c++ )
-						*p++ = *( q + c * samples + s );
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_f32le:
-			{
-				float *buffer = mlt_pool_alloc( size );
-				float *p = buffer;
-				int32_t *q = (int32_t*) *audio;
-				int s, c;
-				for ( s = 0; s < samples; s++ )
-					for ( c = 0; c < channels; c++ )
-					{
-						float f = (float)( *( q + c * samples + s ) ) / 2147483648.0;
-						*p++ = CLAMP( f, -1.0f, 1.0f );
-					}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_u8:
-			{
-				uint8_t *buffer = mlt_pool_alloc( size );
-				uint8_t *p = buffer;
-				int32_t *q = (int32_t*) *audio;
-				int s, c;
-				for ( s = 0; s < samples; s++ )
-					for ( c = 0; c < channels; c++ )
-						*p++ = ( q[c * samples + s] >> 24 ) + 128;
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			default:
-				break;
-			}
-			break;
-		case mlt_audio_float:
-			switch ( requested_format )
-			{
-			case mlt_audio_s16:
-			{
-				int16_t *buffer = mlt_pool_alloc( size );
-				int16_t *p = buffer;
-				float *q = (float*) *audio;
-				int s, c;
-				for ( s = 0; s < samples; s++ )
-					for ( c = 0; c < channels; c++ )
-					{
-						float f = *( q + c * samples + s );
-						f = CLAMP( f, -1.0f, 1.0f );
-						*p++ = 32767 * f;
-					}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_s32:
-			{
-				int32_t *buffer = mlt_pool_alloc( size );
-				int32_t *p = buffer;
-				float *q = (float*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-				{
-					float f = *q++;
-					f = CLAMP( f, -1.0f, 1.0f );
-					int64_t pcm = ( f > 0.0f ? 2147483647LL : 2147483648LL ) * f;
-					*p++ = CLAMP( pcm, -2147483648LL, 2147483647LL );
-				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_s32le:
-			{
-				int32_t *buffer = mlt_pool_alloc( size );
-				int32_t *p = buffer;
-				float *q = (float*) *audio;
-				int s, c;
-				for ( s = 0; s < samples; s++ )
-					for ( c = 0; c < channels; c++ )
-					{
-						float f = *( q + c * samples + s );
-						f = CLAMP( f, -1.0f, 1.0f );
-						int64_t pcm = ( f > 0.0f ? 2147483647LL : 2147483648LL ) * f;
-						*p++ = CLAMP( pcm, -2147483648LL, 2147483647LL );
-					}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_f32le:
-			{
-				float *buffer = mlt_pool_alloc( size );
-				float *p = buffer;
-				float *q = (float*) *audio;
-				int s, c;
-				for ( s = 0; s < samples; s++ )
-					for ( c = 0; c < channels; c++ )
-						*p++ = *( q + c * samples + s );
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_u8:
-			{
-				uint8_t *buffer = mlt_pool_alloc( size );
-				uint8_t *p = buffer;
-				float *q = (float*) *audio;
-				int s, c;
-				for ( s = 0; s < samples; s++ )
-					for ( c = 0; c < channels; c++ )
-					{
-						float f = *( q + c * samples + s );
-						f = CLAMP( f, -1.0f, 1.0f );
-						*p++ = ( 127 * f ) + 128;
-					}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			default:
-				break;
-			}
-			break;
-		case mlt_audio_s32le:
-			switch ( requested_format )
-			{
-			case mlt_audio_s16:
-			{
-				int16_t *buffer = mlt_pool_alloc( size );
-				int16_t *p = buffer;
-				int32_t *q = (int32_t*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-					*p++ = *q++ >> 16;
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_s32:
-			{
-				int32_t *buffer = mlt_pool_alloc( size );
-				int32_t *p = buffer;
-				int c;
-				for ( c = 0; c < channels; c++ )
-				{
-					int32_t *q = (int32_t*) *audio + c;
-					int i = samples + 1;
-					while ( --i )
-					{
-						*p++ = *q;
-						q += channels;
-					}
-				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_float:
-			{
-				float *buffer = mlt_pool_alloc( size );
-				float *p = buffer;
-				int c;
-				for ( c = 0; c < channels; c++ )
-				{
-					int32_t *q = (int32_t*) *audio + c;
-					int i = samples + 1;
-					while ( --i )
-					{
-						*p++ = (float)( *q ) / 2147483648.0;
-						q += channels;
-					}
-				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_f32le:
-			{
-				float *buffer = mlt_pool_alloc( size );
-				float *p = buffer;
-				int32_t *q = (int32_t*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-					*p++ = (float)( *q++ ) / 2147483648.0;
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_u8:
-			{
-				uint8_t *buffer = mlt_pool_alloc( size );
-				uint8_t *p = buffer;
-				int32_t *q = (int32_t*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-					*p++ = ( *q++ >> 24 ) + 128;
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			default:
-				break;
-			}
-			break;
-		case mlt_audio_f32le:
-			switch ( requested_format )
-			{
-			case mlt_audio_s16:
-			{
-				int16_t *buffer = mlt_pool_alloc( size );
-				int16_t *p = buffer;
-				float *q = (float*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-				{
-					float f = *q++;
-					f = CLAMP( f, -1.0f , 1.0f );
-					*p++ = 32767 * f;
-				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_float:
-			{
-				float *buffer = mlt_pool_alloc( size );
-				float *p = buffer;
-				int c;
-				for ( c = 0; c < channels; c++ )
-				{
-					float *q = (float*) *audio + c;
-					int i = samples + 1;
-					while ( --i )
-					{
-						*p++ = *q;
-						q += channels;
-					}
-				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_s32:
-			{
-				int32_t *buffer = mlt_pool_alloc( size );
-				int32_t *p = buffer;
-				int c;
-				for ( c = 0; c < channels; c++ )
-				{
-					float *q = (float*) *audio + c;
-					int i = samples + 1;
-					while ( --i )
-					{
-						float f = *q;
-						f = CLAMP( f, -1.0f , 1.0f );
-						int64_t pcm = ( f > 0.0f ? 2147483647LL : 2147483648LL ) * f;
-						*p++ = CLAMP( pcm, -2147483648LL, 2147483647LL );
-						q += channels;
-					}
-				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_s32le:
-			{
-				int32_t *buffer = mlt_pool_alloc( size );
-				int32_t *p = buffer;
-				float *q = (float*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-				{
-					float f = *q++;
-					f = CLAMP( f, -1.0f , 1.0f );
-					int64_t pcm = ( f > 0.0f ? 2147483647LL : 2147483648LL ) * f;
-					*p++ = CLAMP( pcm, -2147483648LL, 2147483647LL );
-				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_u8:
-			{
-				uint8_t *buffer = mlt_pool_alloc( size );
-				uint8_t *p = buffer;
-				float *q = (float*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-				{
-					float f = *q++;
-					f = CLAMP( f, -1.0f , 1.0f );
-					*p++ = ( 127 * f ) + 128;
-				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			default:
-				break;
-			}
-			break;
-		case mlt_audio_u8:
-			switch ( requested_format )
-			{
-			case mlt_audio_s32:
+			// Same layout and no larger samples in a buffer the frame owns: convert in place
+			if ( convert )
+				convert( *audio, *audio, samples * channels );
+			mlt_properties_set_int( properties, "audio_format", requested_format );
+			*format = requested_format;
+			return 0;
+		}
+		buffer = mlt_pool_alloc( size );
+		convert( *audio, buffer, samples * channels );
+	}
+	else
+	{
+		// Only 32-bit formats are planar, so the layout always changes on 32-bit samples
+		int block = MAX( 1, BLOCK_SAMPLES / MAX( 1, channels ) );
+		uint8_t *temp = convert ? mlt_pool_alloc( block * channels * sizeof( int32_t ) ) : NULL;
+		int s;
+
+		buffer = mlt_pool_alloc( size );
+		for ( s = 0; s < samples; s += block )
+		{
+			int count = MIN( block, samples - s );
+			if ( to->planar )
 			{
-				int32_t *buffer = mlt_pool_alloc( size );
-				int32_t *p = buffer;
-				int c;
-				for ( c = 0; c < channels; c++ )
+				const uint8_t *src = (const uint8_t*) *audio + s * channels * from->size;
+				if ( convert )
 				{
-					uint8_t *q = (uint8_t*) *audio + c;
-					int i = samples + 1;
-					while ( --i )
-					{
-						*p++ = ( (int32_t) *q - 128 ) << 24;
-						q += channels;
-					}
+					convert( src, temp, count * channels );
+					src = temp;
 				}
-				*audio = buffer;
-				error = 0;
-				break;
+				deinterleave32( src, (int32_t*) buffer + s, samples, channels, count );
 			}
-			case mlt_audio_float:
+			else
 			{
-				float *buffer = mlt_pool_alloc( size );
-				float *p = buffer;
-				int c;
-				for ( c = 0; c < channels; c++ )
+				uint8_t *dst = buffer + s * channels * to->size;
+				if ( convert )
 				{
-					uint8_t *q = (uint8_t*) *audio + c;
-					int i = samples + 1;
-					while ( --i )
-					{
-						*p++ = ( (float) *q - 128 ) / 256.0f;
-						q += channels;
-					}
+					interleave32( (int32_t*) *audio + s, samples, temp, channels, count );
+					convert( temp, dst, count * channels );
 				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_s16:
-			{
-				int16_t *buffer = mlt_pool_alloc( size );
-				int16_t *p = buffer;
-				uint8_t *q = (uint8_t*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-					*p++ = ( (int16_t) *q++ - 128 ) << 8;
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_s32le:
-			{
-				int32_t *buffer = mlt_pool_alloc( size );
-				int32_t *p = buffer;
-				uint8_t *q = (uint8_t*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
-					*p++ = ( (int32_t) *q++ - 128 ) << 24;
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			case mlt_audio_f32le:
-			{
-				float *buffer = mlt_pool_alloc( size );
-				float *p = buffer;
-				uint8_t *q = (uint8_t*) *audio;
-				int i = samples * channels + 1;
-				while ( --i )
+				else
 				{
-					float f = ( (float) *q++ - 128 ) / 256.0f;
-					*p++ = CLAMP( f, -1.0f, 1.0f );
+					interleave32( (int32_t*) *audio + s, samples, dst, channels, count );
 				}
-				*audio = buffer;
-				error = 0;
-				break;
-			}
-			default:
-				break;
 			}
-			break;
-		default:
-			break;
 		}
+		mlt_pool_release( temp );
 	}
-	if ( !error )
-	{
-		mlt_frame_set_audio( frame, *audio, requested_format, size, mlt_pool_release );
-		*format = requested_format;
-	}
-	return error;
+
+	mlt_frame_set_audio( frame, buffer, requested_format, size, mlt_pool_release );
+	*audio = buffer;
+	*format = requested_format;
+	return 0;
 }
 
 /** Filter processing.
@@ -0,0 +1,454 @@
+/*
+ * filter_audioresample.c -- adjust audio sample frequency
+ * Copyright (C) 2003-2018 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <framework/mlt_filter.h>
+#include <framework/mlt_frame.h>
+#include <framework/mlt_log.h>
+#include <framework/mlt_pool.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define MAX_STATES (4)
+#define BASE_TAPS (32)
+#define MAX_TAPS (1024)
+#define MAX_PHASES (1024)
+#define INTERPOLATED_PHASES (256)
+#define KAISER_BETA (8.0)
+#define ROLLOFF (0.95)
+
+#if defined(__GNUC__)
+typedef float sample_vector __attribute__((vector_size(16)));
+#endif
+
+/** The state of one conversion from an input to an output frequency.
+ *
+ * The output frequency is the input frequency times up / down. Output sample n
+ * lies at input time n * down / up and is interpolated with a windowed sinc
+ * of taps input samples. A bank of phases rows of coefficients covers the
+ * fractional positions; when up is small enough, as with 44.1 <-> 48 kHz
+ * (160 / 147), there is a row for every position, otherwise the two nearest
+ * rows are interpolated.
+ *
+ * The output is delayed by taps / 2 input samples, so it only depends on input
+ * already received. The last taps - 1 input samples of every channel are kept
+ * in front of the next block to filter across frame boundaries.
+ */
+
+typedef struct
+{
+	int in_frequency;
+	int out_frequency;
+	int channels;
+	int up;
+	int down;
+	int taps;
+	int phases;
+	float *coefficients;  // ( phases + 1 ) rows of taps
+	float *row;           // scratch row when interpolating
+	float *buffer;        // planar history and input
+	int capacity;         // input samples the buffer holds after the history
+	int64_t consumed;     // input samples since the last reset
+	mlt_position position;
+	int used;
+} resample_state;
+
+typedef struct
+{
+	resample_state states[MAX_STATES];
+	int clock;
+} private_data;
+
+static int gcd( int a, int b )
+{
+	while ( b )
+	{
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/** Zeroth order modified Bessel function of the first kind, for the Kaiser window.
+*/
+
+static double bessel_i0( double x )
+{
+	double sum = 1.0, term = 1.0;
+	int k;
+	for ( k = 1; k < 50 && term > sum * 1e-12; k++ )
+	{
+		term *= ( x / ( 2 * k ) ) * ( x / ( 2 * k ) );
+		sum += term;
+	}
+	return sum;
+}
+
+static void state_close( resample_state *state )
+{
+	mlt_pool_release( state->coefficients );
+	mlt_pool_release( state->row );
+	mlt_pool_release( state->buffer );
+	memset( state, 0, sizeof( *state ) );
+}
+
+/** Build the filter bank of a conversion.
+ * \return true if error
+ */
+
+static int state_init( resample_state *state, int in_frequency, int out_frequency, int channels )
+{
+	double ratio = MIN( 1.0, (double) out_frequency / in_frequency );
+	double cutoff = ROLLOFF * ratio;
+	double norm = bessel_i0( KAISER_BETA );
+	int g = gcd( in_frequency, out_frequency );
+	int taps, q, k;
+
+	// Widen the filter when decimating to keep the transition band in proportion.
+	taps = (int) ceil( BASE_TAPS / ratio );
+	taps = MIN( ( taps + 3 ) & ~3, MAX_TAPS );
+
+	state->in_frequency = in_frequency;
+	state->out_frequency = out_frequency;
+	state->channels = channels;
+	state->up = out_frequency / g;
+	state->down = in_frequency / g;
+	state->taps = taps;
+	state->phases = state->up <= MAX_PHASES ? state->up : INTERPOLATED_PHASES;
+	state->coefficients = mlt_pool_alloc( ( state->phases + 1 ) * taps * sizeof( float ) );
+	state->row = mlt_pool_alloc( taps * sizeof( float ) );
+	state->position = -1;
+	if ( !state->coefficients || !state->row )
+		return 1;
+
+	for ( q = 0; q <= state->phases; q++ )
+	{
+		float *row = state->coefficients + q * taps;
+		double sum = 0.0;
+		for ( k = 0; k < taps; k++ )
+		{
+			// Distance in input samples from the tap to the interpolated position.
+			double x = taps / 2 - 1 - k + (double) q / state->phases;
+			double w = x / ( taps / 2 );
+			double s = x == 0.0 ? cutoff : sin( M_PI * cutoff * x ) / ( M_PI * x );
+			row[k] = s * ( fabs( w ) < 1.0 ? bessel_i0( KAISER_BETA * sqrt( 1.0 - w * w ) ) / norm : 0.0 );
+			sum += row[k];
+		}
+		// Unity gain at DC for every phase.
+		for ( k = 0; k < taps; k++ )
+			row[k] /= sum;
+	}
+	return 0;
+}
+
+/** Make room for a block of input, keeping the history in front of it.
+ * \return true if error
+ */
+
+static int state_reserve( resample_state *state, int samples )
+{
+	int history = state->taps - 1;
+	if ( samples > state->capacity || !state->buffer )
+	{
+		int capacity = MAX( samples, state->capacity * 2 );
+		int stride = history + capacity;
+		float *buffer = mlt_pool_alloc( state->channels * stride * sizeof( float ) );
+		int c;
+		if ( !buffer )
+			return 1;
+		for ( c = 0; c < state->channels; c++ )
+		{
+			if ( state->buffer )
+				memcpy( buffer + c * stride, state->buffer + c * ( history + state->capacity ), history * sizeof( float ) );
+			else
+				memset( buffer + c * stride, 0, history * sizeof( float ) );
+		}
+		mlt_pool_release( state->buffer );
+		state->buffer = buffer;
+		state->capacity = capacity;
+	}
+	return 0;
+}
+
+/** Forget the input of an earlier, unrelated block.
+*/
+
+static void state_reset( resample_state *state )
+{
+	int c;
+	state->consumed = 0;
+	if ( state->buffer )
+		for ( c = 0; c < state->channels; c++ )
+			memset( state->buffer + c * ( state->taps - 1 + state->capacity ), 0, ( state->taps - 1 ) * sizeof( float ) );
+}
+
+/** Find the state of a conversion, reusing the least recently used slot for a new one.
+*/
+
+static resample_state *get_state( private_data *pdata, int in_frequency, int out_frequency, int channels )
+{
+	resample_state *state = &pdata->states[0];
+	int i;
+
+	for ( i = 0; i < MAX_STATES; i++ )
+	{
+		resample_state *s = &pdata->states[i];
+		if ( s->coefficients && s->in_frequency == in_frequency && s->out_frequency == out_frequency && s->channels == channels )
+		{
+			state = s;
+			break;
+		}
+		if ( s->used < state->used )
+			state = s;
+	}
+	if ( i == MAX_STATES )
+	{
+		state_close( state );
+		if ( state_init( state, in_frequency, out_frequency, channels ) )
+		{
+			state_close( state );
+			return NULL;
+		}
+	}
+	state->used = ++pdata->clock;
+	return state;
+}
+
+static inline float dot_product( const float *a, const float *b, int n )
+{
+	float result = 0.0f;
+	int i = 0;
+#if defined(__GNUC__)
+	sample_vector sum = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for ( ; i + 4 <= n; i += 4 )
+	{
+		sample_vector x, y;
+		memcpy( &x, a + i, sizeof( x ) );
+		memcpy( &y, b + i, sizeof( y ) );
+		sum += x * y;
+	}
+	result = sum[0] + sum[1] + sum[2] + sum[3];
+#endif
+	for ( ; i < n; i++ )
+		result += a[i] * b[i];
+	return result;
+}
+
+static inline int64_t ceil_div( int64_t a, int64_t b )
+{
+	return ( a + b - 1 ) / b;
+}
+
+/** Resample a block of 32-bit float audio.
+ *
+ * The number of output samples follows from the total input consumed, so the
+ * output of consecutive blocks neither drifts nor depends on the block sizes.
+ * \return the number of samples written to out
+ */
+
+static int resample_block( resample_state *state, float *out, int planar_out, const float *in, int planar_in, int samples )
+{
+	int history = state->taps - 1;
+	int stride = history + state->capacity;
+	int64_t first = ceil_div( state->consumed * state->up, state->down );
+	int64_t last = ceil_div( ( state->consumed + samples ) * state->up, state->down );
+	int out_samples = last - first;
+	int channels = state->channels;
+	int64_t n;
+	int c, i;
+
+	// Append the input to the history of each channel.
+	for ( c = 0; c < channels; c++ )
+	{
+		float *dest = state->buffer + c * stride + history;
+		if ( planar_in )
+			memcpy( dest, in + c * samples, samples * sizeof( float ) );
+		else
+			for ( i = 0; i < samples; i++ )
+				dest[i] = in[ i * channels + c ];
+	}
+
+	for ( n = first; n < last; n++ )
+	{
+		int64_t position = n * state->down;
+		int start = position / state->up - state->consumed;
+		int phase = position % state->up;
+		const float *row;
+		int j = n - first;
+
+		if ( state->phases == state->up )
+		{
+			row = state->coefficients + phase * state->taps;
+		}
+		else
+		{
+			int64_t fine = (int64_t) phase * state->phases;
+			const float *a = state->coefficients + ( fine / state->up ) * state->taps;
+			const float *b = a + state->taps;
+			float f = (float) ( fine % state->up ) / state->up;
+			for ( i = 0; i < state->taps; i++ )
+				state->row[i] = a[i] + f * ( b[i] - a[i] );
+			row = state->row;
+		}
+
+		for ( c = 0; c < channels; c++ )
+		{
+			float value = dot_product( state->buffer + c * stride + start, row, state->taps );
+			if ( planar_out )
+				out[ c * out_samples + j ] = value;
+			else
+				out[ j * channels + c ] = value;
+		}
+	}
+
+	// Keep the tail as the history of the next block.
+	for ( c = 0; c < channels; c++ )
+		memmove( state->buffer + c * stride, state->buffer + c * stride + samples, history * sizeof( float ) );
+	state->consumed += samples;
+
+	return out_samples;
+}
+
+/** Get the audio.
+*/
+
+static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples )
+{
+	mlt_filter filter = mlt_frame_pop_audio( frame );
+	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+	private_data *pdata = (private_data*) filter->child;
+	int output_rate = mlt_properties_get_int( properties, "frequency" );
+	mlt_audio_format requested = *format;
+	resample_state *state;
+	int error;
+
+	// If no resample frequency is specified, default to requested value
+	if ( output_rate <= 0 )
+		output_rate = *frequency;
+
+	// Get the producer's audio
+	error = mlt_frame_get_audio( frame, buffer, format, frequency, channels, samples );
+	if ( error || output_rate == *frequency || *frequency <= 0 || *channels <= 0 || *samples <= 0 || !*buffer )
+		return error;
+
+	// Do not convert to float unless we need to change the rate
+	if ( *format != mlt_audio_f32le && *format != mlt_audio_float )
+	{
+		mlt_audio_format float_format = mlt_frame_choose_audio_format( frame, requested, mlt_audio_f32le,
+			MLT_AUDIO_FORMAT_FLAG( mlt_audio_f32le ) | MLT_AUDIO_FORMAT_FLAG( mlt_audio_float ) );
+		if ( !frame->convert_audio || frame->convert_audio( frame, buffer, format, float_format ) )
+			return error;
+	}
+
+	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
+
+	state = get_state( pdata, *frequency, output_rate, *channels );
+	if ( state && !state_reserve( state, *samples ) )
+	{
+		int planar = *format == mlt_audio_float;
+		mlt_position position = mlt_frame_get_position( frame );
+		int64_t count;
+		int size;
+		float *output;
+
+		// Only consecutive frames continue the stream.
+		if ( position != state->position + 1 )
+			state_reset( state );
+		state->position = position;
+
+		count = ceil_div( ( state->consumed + *samples ) * state->up, state->down ) - ceil_div( state->consumed * state->up, state->down );
+		size = mlt_audio_format_size( *format, MAX( count, 1 ), *channels );
+		output = mlt_pool_alloc( size );
+		*samples = resample_block( state, output, planar, *buffer, planar, *samples );
+		*frequency = output_rate;
+		*buffer = output;
+		mlt_frame_set_audio( frame, output, *format, size, mlt_pool_release );
+
+		// The delay of the filter in samples at the output frequency
+		mlt_properties_set_double( properties, "latency", (double) ( state->taps / 2 ) * state->up / state->down );
+	}
+	else
+	{
+		mlt_log_error( MLT_FILTER_SERVICE( filter ), "cannot resample %d channels %d -> %d Hz\n", *channels, *frequency, output_rate );
+		error = 1;
+	}
+
+	mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+
+	return error;
+}
+
+/** Filter processing.
+*/
+
+static mlt_frame filter_process( mlt_filter filter, mlt_frame frame )
+{
+	if ( mlt_frame_is_test_audio( frame ) == 0 )
+	{
+		mlt_frame_push_audio( frame, filter );
+		mlt_frame_push_audio( frame, filter_get_audio );
+	}
+	return frame;
+}
+
+static void filter_close( mlt_filter filter )
+{
+	private_data *pdata = (private_data*) filter->child;
+	int i;
+
+	if ( pdata )
+	{
+		for ( i = 0; i < MAX_STATES; i++ )
+			state_close( &pdata->states[i] );
+		free( pdata );
+	}
+	filter->child = NULL;
+	filter->close = NULL;
+	filter->parent.close = NULL;
+	mlt_service_close( &filter->parent );
+}
+
+/** Constructor for the filter.
+*/
+
+mlt_filter filter_audioresample_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg )
+{
+	mlt_filter filter = mlt_filter_new( );
+	private_data *pdata = (private_data*) calloc( 1, sizeof( private_data ) );
+
+	if ( filter && pdata )
+	{
+		filter->process = filter_process;
+		filter->close = filter_close;
+		filter->child = pdata;
+		if ( arg != NULL )
+			mlt_properties_set_int( MLT_FILTER_PROPERTIES( filter ), "frequency", atoi( arg ) );
+	}
+	else
+	{
+		mlt_filter_close( filter );
+		free( pdata );
+		filter = NULL;
+	}
+	return filter;
+}
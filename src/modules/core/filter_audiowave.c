@@ -19,6 +19,7 @@
 
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
+#include <framework/mlt_peaks.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -53,6 +54,9 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 
 static mlt_frame filter_process( mlt_filter filter, mlt_frame frame )
 {
+	// Start or reuse the peak file of the clip so drawing needs no decoding
+	if ( mlt_properties_get_int( MLT_FILTER_PROPERTIES( filter ), "peaks" ) )
+		mlt_peaks_get( mlt_frame_get_original_producer( frame ) );
 	mlt_frame_push_get_image( frame, filter_get_image );
 	return frame;
 }
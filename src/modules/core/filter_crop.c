@@ -19,6 +19,7 @@
 
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
+#include <framework/mlt_image.h>
 #include <framework/mlt_log.h>
 #include <framework/mlt_profile.h>
 
@@ -27,21 +28,6 @@
 #include <stdlib.h>
 #include <math.h>
 
-static void crop( uint8_t *src, uint8_t *dest, int bpp, int width, int height, int left, int right, int top, int bottom )
-{
-	int src_stride = ( width  ) * bpp;
-	int dest_stride = ( width - left - right ) * bpp;
-	int y      = height - top - bottom + 1;
-	src += top * src_stride + left * bpp;
-
-	while ( --y )
-	{
-		memcpy( dest, src, dest_stride );
-		dest += dest_stride;
-		src += src_stride;
-	}
-}
-
 /** Do it :-).
 */
 
@@ -71,62 +57,55 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 		mlt_properties_set_int( properties, "rescale_width", mlt_properties_get_int( properties, "crop.original_width" ) );
 		mlt_properties_set_int( properties, "rescale_height", mlt_properties_get_int( properties, "crop.original_height" ) );
 	}
+	else
+	{
+		return mlt_frame_get_image( frame, image, format, width, height, writable );
+	}
 
-	// Now get the image
-	error = mlt_frame_get_image( frame, image, format, width, height, writable );
+	// Now get the image, which the crop only shows a region of
+	mlt_image input = NULL;
+	error = mlt_frame_get_shared_image( frame, &input, format, width, height );
 
 	int owidth  = *width - left - right;
 	int oheight = *height - top - bottom;
 	owidth = owidth < 0 ? 0 : owidth;
 	oheight = oheight < 0 ? 0 : oheight;
 
-	if ( ( owidth != *width || oheight != *height ) &&
-		error == 0 && *image != NULL && owidth > 0 && oheight > 0 )
+	if ( error == 0 && input && owidth > 0 && oheight > 0 )
 	{
-		int bpp;
+		mlt_image output = mlt_image_crop( input, left, top, owidth, oheight );
 
 		// Subsampled YUV is messy and less precise.
-		if ( *format == mlt_image_yuv422 && frame->convert_image && ( left & 1 ) )
+		if ( !output && frame->convert_image )
 		{
-			mlt_image_format requested_format = mlt_image_rgb24;
-			frame->convert_image( frame, image, format, requested_format );
+			mlt_image_close( input );
+			*format = mlt_image_rgb24;
+			error = mlt_frame_get_shared_image( frame, &input, format, width, height );
+			if ( !error && input )
+				output = mlt_image_crop( input, left, top, owidth, oheight );
 		}
-	
-		mlt_log_debug( NULL, "[filter crop] %s %dx%d -> %dx%d\n", mlt_image_format_name(*format),
-				 *width, *height, owidth, oheight);
-
-		if ( top % 2 )
-			mlt_properties_set_int( properties, "top_field_first", !mlt_properties_get_int( properties, "top_field_first" ) );
-		
-		// Create the output image
-		int size = mlt_image_format_size( *format, owidth, oheight, &bpp );
-		uint8_t *output = mlt_pool_alloc( size );
+
 		if ( output )
 		{
-			// Call the generic resize
-			crop( *image, output, bpp, *width, *height, left, right, top, bottom );
+			mlt_log_debug( NULL, "[filter crop] %s %dx%d -> %dx%d\n", mlt_image_format_name(*format),
+					 *width, *height, owidth, oheight);
+
+			if ( top % 2 )
+				mlt_properties_set_int( properties, "top_field_first", !mlt_properties_get_int( properties, "top_field_first" ) );
 
 			// Now update the frame
-			mlt_frame_set_image( frame, output, size, mlt_pool_release );
-			*image = output;
+			mlt_frame_set_shared_image( frame, output );
+			mlt_image_close( output );
+			*width = owidth;
+			*height = oheight;
 		}
-
-		// We should resize the alpha too
-		uint8_t *alpha = mlt_frame_get_alpha( frame );
-		int alpha_size = 0;
-		mlt_properties_get_data( properties, "alpha", &alpha_size );
-		if ( alpha && alpha_size >= ( *width * *height ) )
+		else
 		{
-			uint8_t *newalpha = mlt_pool_alloc( owidth * oheight );
-			if ( newalpha )
-			{
-				crop( alpha, newalpha, 1, *width, *height, left, right, top, bottom );
-				mlt_frame_set_alpha( frame, newalpha, owidth * oheight, mlt_pool_release );
-			}
+			mlt_log_error( NULL, "[filter crop] cannot crop %s\n", mlt_image_format_name( *format ) );
 		}
-		*width = owidth;
-		*height = oheight;
 	}
+	*image = mlt_properties_get_data( properties, "image", NULL );
+	mlt_image_close( input );
 
 	return error;
 }
@@ -291,19 +291,82 @@ static int convert_rgb24a_to_rgb24( uint8_t *rgba, uint8_t *rgb, uint8_t *alpha,
 	return 0;
 }
 
+static int convert_yuv422_to_yuv422p16( uint8_t *yuv, uint8_t *out, uint8_t *alpha, int width, int height )
+{
+	uint8_t *planes[4];
+	int strides[4];
+	int i, j;
+
+	mlt_image_format_planes( mlt_image_yuv422p16, width, height, out, planes, strides );
+	for ( i = 0; i < height; i++ )
+	{
+		uint16_t *y = (uint16_t*) ( planes[0] + i * strides[0] );
+		uint16_t *u = (uint16_t*) ( planes[1] + i * strides[1] );
+		uint16_t *v = (uint16_t*) ( planes[2] + i * strides[2] );
+
+		for ( j = 0; j < width / 2; j++ )
+		{
+			y[0] = yuv[0] << 8;
+			u[j] = yuv[1] << 8;
+			y[1] = yuv[2] << 8;
+			v[j] = yuv[3] << 8;
+			y += 2;
+			yuv += 4;
+		}
+		if ( width % 2 )
+		{
+			y[0] = yuv[0] << 8;
+			yuv += 2;
+		}
+	}
+	return 0;
+}
+
+static int convert_yuv422p16_to_yuv422( uint8_t *in, uint8_t *yuv, uint8_t *alpha, int width, int height )
+{
+	uint8_t *planes[4];
+	int strides[4];
+	int i, j;
+
+	mlt_image_format_planes( mlt_image_yuv422p16, width, height, in, planes, strides );
+	for ( i = 0; i < height; i++ )
+	{
+		uint16_t *y = (uint16_t*) ( planes[0] + i * strides[0] );
+		uint16_t *u = (uint16_t*) ( planes[1] + i * strides[1] );
+		uint16_t *v = (uint16_t*) ( planes[2] + i * strides[2] );
+
+		for ( j = 0; j < width / 2; j++ )
+		{
+			yuv[0] = MIN( y[0] + 0x80, 0xffff ) >> 8;
+			yuv[1] = MIN( u[j] + 0x80, 0xffff ) >> 8;
+			yuv[2] = MIN( y[1] + 0x80, 0xffff ) >> 8;
+			yuv[3] = MIN( v[j] + 0x80, 0xffff ) >> 8;
+			y += 2;
+			yuv += 4;
+		}
+		if ( width % 2 )
+		{
+			yuv[0] = MIN( y[0] + 0x80, 0xffff ) >> 8;
+			yuv[1] = 128;
+			yuv += 2;
+		}
+	}
+	return 0;
+}
+
 typedef int ( *conversion_function )( uint8_t *yuv, uint8_t *rgba, uint8_t *alpha, int width, int height );
 
 static conversion_function conversion_matrix[ mlt_image_invalid - 1 ][ mlt_image_invalid - 1 ] = {
-	{ NULL, convert_rgb24_to_rgb24a, convert_rgb24_to_yuv422, NULL, convert_rgb24_to_rgb24a, NULL },
-	{ convert_rgb24a_to_rgb24, NULL, convert_rgb24a_to_yuv422, NULL, NULL, NULL },
-	{ convert_yuv422_to_rgb24, convert_yuv422_to_rgb24a, NULL, NULL, convert_yuv422_to_rgb24a, NULL },
-	{ NULL, NULL, convert_yuv420p_to_yuv422, NULL, NULL, NULL },
-	{ convert_rgb24a_to_rgb24, NULL, convert_rgb24a_to_yuv422, NULL, NULL, NULL },
-	{ NULL, NULL, NULL, NULL, NULL, NULL },
+	{ NULL, convert_rgb24_to_rgb24a, convert_rgb24_to_yuv422, NULL, convert_rgb24_to_rgb24a, NULL, NULL, NULL },
+	{ convert_rgb24a_to_rgb24, NULL, convert_rgb24a_to_yuv422, NULL, NULL, NULL, NULL, NULL },
+	{ convert_yuv422_to_rgb24, convert_yuv422_to_rgb24a, NULL, NULL, convert_yuv422_to_rgb24a, NULL, NULL, convert_yuv422_to_yuv422p16 },
+	{ NULL, NULL, convert_yuv420p_to_yuv422, NULL, NULL, NULL, NULL, NULL },
+	{ convert_rgb24a_to_rgb24, NULL, convert_rgb24a_to_yuv422, NULL, NULL, NULL, NULL, NULL },
+	{ NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL },
+	{ NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL },
+	{ NULL, NULL, convert_yuv422p16_to_yuv422, NULL, NULL, NULL, NULL, NULL },
 };
 
-static uint8_t bpp_table[4] = { 3, 4, 2, 0 };
-
 static int convert_image( mlt_frame frame, uint8_t **buffer, mlt_image_format *format, mlt_image_format requested_format )
 {
 	int error = 0;
@@ -315,12 +378,22 @@ static int convert_image( mlt_frame frame, uint8_t **buffer, mlt_image_format *f
 	{
 		conversion_function converter = conversion_matrix[ *format - 1 ][ requested_format - 1 ];
 
+		// 16-bit planar is only converted directly to or from yuv422, so go through it.
+		if ( !converter && *format != mlt_image_yuv422 && requested_format != mlt_image_yuv422 &&
+		     ( *format == mlt_image_yuv422p16 || requested_format == mlt_image_yuv422p16 ) )
+		{
+			error = convert_image( frame, buffer, format, mlt_image_yuv422 );
+			if ( !error )
+				error = convert_image( frame, buffer, format, requested_format );
+			return error;
+		}
+
 		mlt_log_debug( NULL, "[filter imageconvert] %s -> %s @ %dx%d\n",
 			mlt_image_format_name( *format ), mlt_image_format_name( requested_format ),
 			width, height );
 		if ( converter )
 		{
-			int size = width * height * bpp_table[ requested_format - 1 ];
+			int size = mlt_image_format_size( requested_format, width, height, NULL );
 			int alpha_size = width * height;
 			uint8_t *image = mlt_pool_alloc( size );
 			uint8_t *alpha = ( *format == mlt_image_rgb24a ||
@@ -0,0 +1,148 @@
+/*
+ * filter_mix.c -- sum the audio of all tracks of a tractor
+ * Copyright (C) 2003-2018 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "transition_mix.h"
+
+#include <framework/mlt_filter.h>
+#include <framework/mlt_frame.h>
+#include <framework/mlt_log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Get the audio of a track frame of the tractor.
+ * \return true if the track contributes audio
+ */
+
+static int get_track_audio( mlt_frame track, float **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( track );
+
+	// Skip the terminating frame, fx only tracks and tracks without audio.
+	if ( mlt_properties_get_int( properties, "last_track" ) || mlt_properties_get_int( properties, "fx_cut" ) ||
+		 mlt_frame_is_test_audio( track ) || ( mlt_properties_get_int( properties, "hide" ) & 2 ) )
+		return 0;
+
+	if ( mlt_frame_get_audio( track, (void**) buffer, format, frequency, channels, samples ) || !*buffer || !*channels )
+		return 0;
+
+	if ( mlt_properties_get_int( properties, "silent_audio" ) )
+	{
+		mlt_properties_set_int( properties, "silent_audio", 0 );
+		return 0;
+	}
+	return 1;
+}
+
+/** Get the audio.
+*/
+
+static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
+	mlt_audio_format track_format = mlt_frame_choose_audio_format( frame, *format, mlt_audio_f32le,
+		MLT_AUDIO_FORMAT_FLAG( mlt_audio_f32le ) | MLT_AUDIO_FORMAT_FLAG( mlt_audio_float ) );
+	int planar = track_format == mlt_audio_float;
+	int count = mlt_properties_count( properties );
+	float *output = NULL;
+	int inputs = 0;
+	int i, j;
+
+	// The tractor keeps the frame of every track on its output frame, in track order.
+	for ( i = 0; i < count; i++ )
+	{
+		char *name = mlt_properties_get_name( properties, i );
+		mlt_frame track;
+		mlt_audio_format format_in = track_format;
+		float *buffer_in = NULL;
+		int frequency_in = *frequency;
+		int channels_in = *channels;
+		int samples_in = *samples;
+		int n;
+
+		if ( !name || strncmp( name, "mlt_tractor ", 12 ) )
+			continue;
+		track = mlt_properties_get_data_at( properties, i, NULL );
+		if ( track && !track->convert_audio )
+			track->convert_audio = frame->convert_audio;
+		if ( !track || !get_track_audio( track, &buffer_in, &format_in, &frequency_in, &channels_in, &samples_in ) )
+			continue;
+		if ( format_in != track_format )
+			continue;
+
+		if ( !output )
+		{
+			// The first audible track sets the layout of the mix.
+			int size = mlt_audio_format_size( track_format, samples_in, channels_in );
+			output = mlt_pool_alloc( size );
+			memcpy( output, buffer_in, size );
+			*frequency = frequency_in;
+			*channels = channels_in;
+			*samples = samples_in;
+			mlt_frame_set_audio( frame, output, track_format, size, mlt_pool_release );
+		}
+		else
+		{
+			// Sum the overlapping channels and samples at unity gain.
+			n = MIN( samples_in, *samples );
+			if ( planar )
+			{
+				for ( j = 0; j < MIN( channels_in, *channels ); j++ )
+					mix_audio_block( output + j * *samples, 1, buffer_in + j * samples_in, 1, 1, n, 1.0, 0.0, 1 );
+			}
+			else
+			{
+				mix_audio_block( output, *channels, buffer_in, channels_in, MIN( channels_in, *channels ), n, 1.0, 0.0, 1 );
+			}
+		}
+		inputs ++;
+	}
+
+	// Not a tractor frame or no audible track: the frame produces the audio itself.
+	if ( !inputs )
+		return mlt_frame_get_audio( frame, buffer, format, frequency, channels, samples );
+
+	*format = track_format;
+	*buffer = output;
+
+	return 0;
+}
+
+/** Filter processing.
+*/
+
+static mlt_frame filter_process( mlt_filter filter, mlt_frame frame )
+{
+	// Override the get_audio method
+	mlt_frame_push_audio( frame, filter_get_audio );
+
+	return frame;
+}
+
+/** Constructor for the filter.
+*/
+
+mlt_filter filter_mix_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg )
+{
+	mlt_filter filter = mlt_filter_new( );
+	if ( filter != NULL )
+		filter->process = filter_process;
+	return filter;
+}
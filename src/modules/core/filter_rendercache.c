@@ -0,0 +1,294 @@
+/*
+ * filter_rendercache.c -- keep the rendered images of a producer in memory
+ * Copyright (C) 2020 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <framework/mlt_filter.h>
+#include <framework/mlt_frame.h>
+#include <framework/mlt_cache.h>
+#include <framework/mlt_image.h>
+#include <framework/mlt_log.h>
+#include <framework/mlt_multitrack.h>
+#include <framework/mlt_playlist.h>
+#include <framework/mlt_tractor.h>
+#include <framework/mlt_transition.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** The frame properties that the image stack of a producer may change. */
+
+#define IMAGE_PROPERTIES "aspect_ratio, progressive, top_field_first, colorspace, full_luma, color_trc"
+
+/** Add a value to a 64-bit FNV-1a hash.
+*/
+
+static uint64_t hash_value( uint64_t hash, int64_t value )
+{
+	int i;
+	for ( i = 0; i < 8; i ++ )
+	{
+		hash ^= ( value >> ( i * 8 ) ) & 0xff;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/** Hash the filters attached to a service up to but excluding \p last.
+*/
+
+static uint64_t hash_filters( mlt_service service, mlt_filter last, uint64_t hash )
+{
+	mlt_filter filter = NULL;
+	int i;
+
+	for ( i = 0; ( filter = mlt_service_filter( service, i ) ) != NULL && filter != last; i ++ )
+	{
+		hash = hash_value( hash, mlt_properties_generation( MLT_FILTER_PROPERTIES( filter ) ) );
+		hash = hash_filters( MLT_FILTER_SERVICE( filter ), NULL, hash );
+	}
+	return hash;
+}
+
+/** Hash everything that the image of a service depends on at a position.
+ *
+ * Every service that contributes to the image adds the generation of its
+ * properties, which advances whenever they are edited, so the hash changes
+ * exactly when an edit affects the position. Containers do not add their own
+ * generation since they are touched by any edit of their contents; instead
+ * they add the services they show at the position. The position is relative
+ * to the in point of a producer, like mlt_producer_position().
+ */
+
+static uint64_t hash_service( mlt_service service, mlt_filter last, mlt_position position, uint64_t hash )
+{
+	mlt_properties properties = MLT_SERVICE_PROPERTIES( service );
+	mlt_service_type type = mlt_service_identify( service );
+	int i;
+
+	hash = hash_value( hash, type );
+	if ( type != filter_type && type != transition_type )
+		hash = hash_filters( service, last, hash );
+
+	if ( ( type == producer_type || type == tractor_type || type == playlist_type || type == multitrack_type )
+		 && mlt_producer_is_cut( MLT_PRODUCER( service ) ) )
+	{
+		// A cut shows its parent from its in point
+		mlt_producer cut = MLT_PRODUCER( service );
+		hash = hash_value( hash, mlt_properties_generation( properties ) );
+		return hash_service( MLT_PRODUCER_SERVICE( mlt_producer_cut_parent( cut ) ), NULL, position + mlt_producer_get_in( cut ), hash );
+	}
+
+	switch ( type )
+	{
+		case tractor_type:
+		{
+			// The tractor shows the output of the services planted in its field
+			mlt_service producer = mlt_service_producer( service );
+			if ( producer )
+				hash = hash_service( producer, NULL, position + mlt_producer_get_in( MLT_PRODUCER( service ) ), hash );
+			break;
+		}
+		case multitrack_type:
+		{
+			mlt_multitrack multitrack = MLT_MULTITRACK( service );
+			int count = mlt_multitrack_count( multitrack );
+			hash = hash_value( hash, count );
+			for ( i = 0; i < count; i ++ )
+			{
+				mlt_producer track = mlt_multitrack_track( multitrack, i );
+				hash = hash_value( hash, mlt_properties_get_int( MLT_PRODUCER_PROPERTIES( track ), "hide" ) );
+				hash = hash_service( MLT_PRODUCER_SERVICE( track ), NULL, position, hash );
+			}
+			break;
+		}
+		case playlist_type:
+		{
+			mlt_playlist playlist = MLT_PLAYLIST( service );
+			mlt_playlist_clip_info info;
+			position += mlt_producer_get_in( MLT_PRODUCER( service ) );
+			i = mlt_playlist_get_clip_index_at( playlist, position );
+			if ( mlt_playlist_get_clip_info( playlist, &info, i ) || mlt_playlist_is_blank( playlist, i ) )
+			{
+				// Past the end or in a blank, nothing is shown
+				hash = hash_value( hash, -1 );
+			}
+			else
+			{
+				int count = info.frame_count / ( info.repeat > 0 ? info.repeat : 1 );
+				position -= info.start;
+				hash = hash_service( MLT_PRODUCER_SERVICE( info.cut ), NULL, count > 0 ? position % count : position, hash );
+			}
+			break;
+		}
+		case producer_type:
+			hash = hash_value( hash, mlt_properties_generation( properties ) );
+			hash = hash_value( hash, position );
+			break;
+		case filter_type:
+		case transition_type:
+		{
+			// Services planted in a field only contribute within their range
+			mlt_position in = mlt_properties_get_position( properties, "in" );
+			mlt_position out = mlt_properties_get_position( properties, "out" );
+			if ( mlt_properties_get_int( properties, "always_active" ) || ( position >= in && ( out == 0 || position <= out ) ) )
+			{
+				hash = hash_value( hash, mlt_properties_generation( properties ) );
+				hash = hash_filters( service, NULL, hash );
+			}
+		}
+		// fall through
+		default:
+		{
+			mlt_service producer = mlt_service_producer( service );
+			if ( type != consumer_type && type != filter_type && type != transition_type )
+				hash = hash_value( hash, mlt_properties_generation( properties ) );
+			if ( producer )
+				hash = hash_service( producer, NULL, position, hash );
+			break;
+		}
+	}
+	return hash;
+}
+
+/** Add the request of a consumer to the key of a frame.
+*/
+
+static uint64_t hash_request( mlt_frame frame, uint64_t hash, mlt_image_format format, int width, int height )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
+	const char *interp = mlt_properties_get( properties, "rescale.interp" );
+
+	hash = hash_value( hash, format );
+	hash = hash_value( hash, width );
+	hash = hash_value( hash, height );
+	hash = hash_value( hash, mlt_properties_get_int( properties, "consumer_deinterlace" ) );
+	while ( interp && *interp )
+		hash = hash_value( hash, *interp ++ );
+	return hash;
+}
+
+/** Get the image from the cache or render and store it.
+*/
+
+static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format *format, int *width, int *height, int writable )
+{
+	mlt_filter filter = mlt_frame_pop_service( frame );
+	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
+	mlt_properties unique = mlt_frame_get_unique_properties( frame, MLT_FILTER_SERVICE( filter ) );
+	mlt_cache cache = mlt_properties_get_data( MLT_FILTER_PROPERTIES( filter ), "_cache", NULL );
+	mlt_position position = mlt_frame_get_position( frame );
+	uint64_t key = hash_request( frame, mlt_properties_get_int64( unique, "key" ), *format, *width, *height );
+	mlt_frame cached = mlt_cache_get_frame( cache, position );
+	mlt_image shared = NULL;
+	int error = 0;
+
+	if ( cached && (uint64_t) mlt_properties_get_int64( MLT_FRAME_PROPERTIES( cached ), "key" ) == key )
+	{
+		// Show the stored image without running the rest of the image stack
+		mlt_properties cached_properties = MLT_FRAME_PROPERTIES( cached );
+		shared = mlt_properties_get_data( cached_properties, "_image", NULL );
+		mlt_frame_set_shared_image( frame, shared );
+		mlt_properties_pass_list( properties, cached_properties, IMAGE_PROPERTIES );
+		*format = shared->format;
+		*width = shared->width;
+		*height = shared->height;
+		shared = NULL;
+		mlt_log_debug( MLT_FILTER_SERVICE( filter ), "hit %d\n", position );
+	}
+	else
+	{
+		error = mlt_frame_get_shared_image( frame, &shared, format, width, height );
+		if ( !error && shared && !mlt_properties_get_int( properties, "test_image" ) )
+		{
+			// Store a frame that only holds the image so that the frames it
+			// was composited from are not kept as well
+			mlt_frame stored = mlt_frame_init( NULL );
+			mlt_properties stored_properties = MLT_FRAME_PROPERTIES( stored );
+			mlt_frame_set_shared_image( stored, shared );
+			mlt_properties_pass_list( stored_properties, properties, IMAGE_PROPERTIES );
+			mlt_properties_set_position( stored_properties, "original_position", position );
+			mlt_properties_set_int64( stored_properties, "key", (int64_t) key );
+			mlt_cache_put_frame( cache, stored );
+			mlt_frame_close( stored );
+			mlt_log_debug( MLT_FILTER_SERVICE( filter ), "miss %d\n", position );
+		}
+	}
+	*image = mlt_properties_get_data( properties, "image", NULL );
+	mlt_image_close( shared );
+	mlt_frame_close( cached );
+
+	return error;
+}
+
+/** Filter processing.
+*/
+
+static mlt_frame filter_process( mlt_filter filter, mlt_frame frame )
+{
+	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+	mlt_service service = mlt_properties_get_data( properties, "service", NULL );
+	mlt_position position = mlt_frame_get_position( frame );
+	mlt_filter last = filter;
+
+	// A filter planted in a field is not attached but connected to its input
+	if ( !service )
+	{
+		service = mlt_service_producer( MLT_FILTER_SERVICE( filter ) );
+		last = NULL;
+	}
+
+	if ( service )
+	{
+		mlt_cache cache = mlt_properties_get_data( properties, "_cache", NULL );
+		mlt_service_type type = mlt_service_identify( service );
+		uint64_t key = 0xcbf29ce484222325ULL;
+
+		mlt_cache_set_size( cache, mlt_properties_get_int( properties, "size" ) );
+		if ( type == producer_type || type == tractor_type || type == playlist_type || type == multitrack_type )
+			position -= mlt_producer_get_in( MLT_PRODUCER( service ) );
+		key = hash_service( service, last, position, key );
+		mlt_properties_set_int64( mlt_frame_unique_properties( frame, MLT_FILTER_SERVICE( filter ) ), "key", (int64_t) key );
+
+		mlt_frame_push_service( frame, filter );
+		mlt_frame_push_get_image( frame, filter_get_image );
+	}
+
+	return frame;
+}
+
+/** Constructor for the filter.
+*/
+
+mlt_filter filter_rendercache_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg )
+{
+	mlt_filter filter = mlt_filter_new( );
+	mlt_cache cache = mlt_cache_init( );
+	if ( filter != NULL && cache != NULL )
+	{
+		filter->process = filter_process;
+		mlt_properties_set_int( MLT_FILTER_PROPERTIES( filter ), "size", arg ? atoi( arg ) : 25 );
+		mlt_properties_set_data( MLT_FILTER_PROPERTIES( filter ), "_cache", cache, 0, ( mlt_destructor )mlt_cache_close, NULL );
+	}
+	else
+	{
+		mlt_filter_close( filter );
+		mlt_cache_close( cache );
+		filter = NULL;
+	}
+	return filter;
+}
@@ -19,6 +19,7 @@
 
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
+#include <framework/mlt_image.h>
 #include <framework/mlt_log.h>
 #include <framework/mlt_profile.h>
 
@@ -35,17 +36,19 @@
  * rgb24a -> rgb24a
  * rgb24 -> yuv422
  * rgb24a -> yuv422
+ *
+ * The rows of the input image are istride bytes apart, which may be more than
+ * the width of the image when it is a view of a larger one.
  */
 
-typedef int ( *image_scaler )( mlt_frame frame, uint8_t **image, mlt_image_format *format, int iwidth, int iheight, int owidth, int oheight );
+typedef int ( *image_scaler )( mlt_frame frame, uint8_t **image, mlt_image_format *format, int iwidth, int iheight, int istride, int owidth, int oheight );
 
-static int filter_scale( mlt_frame frame, uint8_t **image, mlt_image_format *format, int iwidth, int iheight, int owidth, int oheight )
+static int filter_scale( mlt_frame frame, uint8_t **image, mlt_image_format *format, int iwidth, int iheight, int istride, int owidth, int oheight )
 {
 	// Create the output image
 	uint8_t *output = mlt_pool_alloc( owidth * ( oheight + 1 ) * 2 );
 
 	// Calculate strides
-	int istride = iwidth * 2;
 	int ostride = owidth * 2;
 	iwidth = iwidth - ( iwidth % 4 );
 
@@ -217,8 +220,21 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 		if ( scaler_method == filter_scale )
 			*format = mlt_image_yuv422;
 
-		// Get the image as requested
-		mlt_frame_get_image( frame, image, format, &iwidth, &iheight, writable );
+		// Get the image as requested, reading a shared image in place unless it is to be written
+		mlt_image input = NULL;
+		int istride = 0;
+		if ( writable )
+		{
+			int bpp = 0;
+			mlt_frame_get_image( frame, image, format, &iwidth, &iheight, writable );
+			mlt_image_format_size( *format, iwidth, iheight, &bpp );
+			istride = iwidth * bpp;
+		}
+		else if ( !mlt_frame_get_shared_image( frame, &input, format, &iwidth, &iheight ) && input )
+		{
+			*image = input->planes[0];
+			istride = input->strides[0];
+		}
 
 		// Get rescale interpretation again, in case the producer wishes to override scaling
 		interps = mlt_properties_get( properties, "rescale.interp" );
@@ -233,7 +249,7 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 			     *format == mlt_image_rgb24a || *format == mlt_image_opengl )
 			{
 				// Call the virtual function
-				scaler_method( frame, image, format, iwidth, iheight, owidth, oheight );
+				scaler_method( frame, image, format, iwidth, iheight, istride, owidth, oheight );
 				*width = owidth;
 				*height = oheight;
 			}
@@ -248,6 +264,10 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 			*width = iwidth;
 			*height = iheight;
 		}
+
+		// An image that was not scaled is still the shared image of the frame,
+		// which mlt_frame_get_image() packs before handing it out
+		mlt_image_close( input );
 	}
 	else
 	{
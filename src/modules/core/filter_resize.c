@@ -128,6 +128,45 @@ static void resize_image( uint8_t *output, int owidth, int oheight, uint8_t *inp
 	}
 }
 
+static void resize_plane16( uint8_t *output, int owidth, int oheight, uint8_t *input, int iwidth, int iheight, int offset_x, uint16_t value )
+{
+	uint16_t *out = (uint16_t*) output;
+	int offset_y = MAX( ( oheight - iheight ) / 2, 0 );
+	int width = MIN( iwidth, owidth );
+	int height = MIN( iheight, oheight );
+	int i;
+
+	for ( i = 0; i < owidth * oheight; i++ )
+		out[i] = value;
+
+	out += offset_y * owidth + MAX( offset_x, 0 );
+	for ( i = 0; i < height; i++ )
+	{
+		memcpy( out, input, width * 2 );
+		input += iwidth * 2;
+		out += owidth;
+	}
+}
+
+static void resize_image_planar16( uint8_t *output, int owidth, int oheight, uint8_t *input, int iwidth, int iheight )
+{
+	uint8_t *in_planes[4], *out_planes[4];
+	int in_strides[4], out_strides[4];
+	int offset_x = ( owidth - iwidth ) / 2;
+
+	if ( output == NULL || input == NULL || ( owidth <= 6 || oheight <= 6 || iwidth <= 6 || iheight <= 6 ) )
+		return;
+
+	// Keep the chroma sites aligned with luma
+	offset_x -= offset_x % 2;
+
+	mlt_image_format_planes( mlt_image_yuv422p16, iwidth, iheight, input, in_planes, in_strides );
+	mlt_image_format_planes( mlt_image_yuv422p16, owidth, oheight, output, out_planes, out_strides );
+	resize_plane16( out_planes[0], owidth, oheight, in_planes[0], iwidth, iheight, offset_x, 16 << 8 );
+	resize_plane16( out_planes[1], owidth / 2, oheight, in_planes[1], iwidth / 2, iheight, offset_x / 2, 128 << 8 );
+	resize_plane16( out_planes[2], owidth / 2, oheight, in_planes[2], iwidth / 2, iheight, offset_x / 2, 128 << 8 );
+}
+
 /** A padding function for frames - this does not rescale, but simply
 	resizes.
 */
@@ -153,13 +192,17 @@ static uint8_t *frame_resize_image( mlt_frame frame, int owidth, int oheight, ml
 	{
 		uint8_t alpha_value = mlt_properties_get_int( properties, "resize_alpha" );
 		// Create the output image
-		uint8_t *output = mlt_pool_alloc( owidth * ( oheight + 1 ) * bpp );
+		int size = mlt_image_format_size( format, owidth, oheight, NULL );
+		uint8_t *output = mlt_pool_alloc( size );
 
 		// Call the generic resize
-		resize_image( output, owidth, oheight, input, iwidth, iheight, bpp, format, alpha_value );
+		if ( format == mlt_image_yuv422p16 )
+			resize_image_planar16( output, owidth, oheight, input, iwidth, iheight );
+		else
+			resize_image( output, owidth, oheight, input, iwidth, iheight, bpp, format, alpha_value );
 
 		// Now update the frame
-		mlt_frame_set_image( frame, output, owidth * ( oheight + 1 ) * bpp, mlt_pool_release );
+		mlt_frame_set_image( frame, output, size, mlt_pool_release );
 
 		// We should resize the alpha too
 		if ( format != mlt_image_rgb24a && alpha && alpha_size >= iwidth * iheight )
@@ -276,7 +319,7 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 	}
 
 	// Now get the image
-	if ( *format == mlt_image_yuv422 )
+	if ( *format == mlt_image_yuv422 || *format == mlt_image_yuv422p16 )
 		owidth -= owidth % 2;
 	error = mlt_frame_get_image( frame, image, format, &owidth, &oheight, writable );
 
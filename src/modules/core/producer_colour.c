@@ -19,6 +19,7 @@
 
 #include <framework/mlt_producer.h>
 #include <framework/mlt_frame.h>
+#include <framework/mlt_image.h>
 #include <framework/mlt_pool.h>
 #include <framework/mlt_log.h>
 
@@ -70,12 +71,8 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 	char *now = mlt_properties_get( producer_props, "resource" );
 	char *then = mlt_properties_get( producer_props, "_resource" );
 
-	// Get the current image and dimensions cached in the producer
-	int size = 0;
-	uint8_t *image = mlt_properties_get_data( producer_props, "image", &size );
-	int current_width = mlt_properties_get_int( producer_props, "_width" );
-	int current_height = mlt_properties_get_int( producer_props, "_height" );
-	mlt_image_format current_format = mlt_properties_get_int( producer_props, "_format" );
+	// Get the current image cached in the producer
+	mlt_image image = mlt_properties_get_data( producer_props, "_image", NULL );
 
 	// Parse the colour
 	if ( now && strchr( now, '/' ) )
@@ -103,24 +100,18 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 		*format = mlt_image_rgb24a;
 
 	// See if we need to regenerate
-	if ( !now || ( then && strcmp( now, then ) ) || *width != current_width || *height != current_height || *format != current_format )
+	if ( !image || !now || ( then && strcmp( now, then ) ) || *width != image->width || *height != image->height || *format != image->format )
 	{
 		// Color the image
 		int i = *width * *height + 1;
-		int bpp;
 
-		// Allocate the image
-		size = mlt_image_format_size( *format, *width, *height, &bpp );
-		uint8_t *p = image = mlt_pool_alloc( size );
-
-		// Update the producer
-		mlt_properties_set_data( producer_props, "image", image, size, mlt_pool_release, NULL );
-		mlt_properties_set_int( producer_props, "_width", *width );
-		mlt_properties_set_int( producer_props, "_height", *height );
-		mlt_properties_set_int( producer_props, "_format", *format );
-		mlt_properties_set( producer_props, "_resource", now );
-
-		mlt_service_unlock( MLT_PRODUCER_SERVICE( producer ) );
+		// Allocate the image, which is shared read-only and solid
+		image = mlt_image_new();
+		image->writable = 0;
+		image->solid = 1;
+		mlt_image_set_values( image, NULL, *format, *width, *height );
+		mlt_image_alloc_data( image );
+		uint8_t *p = image->data;
 
 		switch ( *format )
 		{
@@ -133,7 +124,7 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 			memset(p + 0, y, plane_size);
 			memset(p + plane_size, u, plane_size/4);
 			memset(p + plane_size + plane_size/4, v, plane_size/4);
-			mlt_properties_set_int( properties, "colorspace", 601 );
+			image->colorspace = 601;
 			break;
 		}
 		case mlt_image_yuv422:
@@ -160,7 +151,7 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 					*p ++ = u;
 				}
 			}
-			mlt_properties_set_int( properties, "colorspace", 601 );
+			image->colorspace = 601;
 			break;
 		}
 		case mlt_image_rgb24:
@@ -173,7 +164,7 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 			break;
 		case mlt_image_glsl:
 		case mlt_image_glsl_texture:
-			memset(p, 0, size);
+			memset(p, 0, mlt_image_calculate_size( image ));
 			break;
 		case mlt_image_rgb24a:
 			while ( --i )
@@ -188,35 +179,25 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 			mlt_log_error( MLT_PRODUCER_SERVICE( producer ),
 				"invalid image format %s\n", mlt_image_format_name( *format ) );
 		}
-	}
-	else
-	{
-		mlt_service_unlock( MLT_PRODUCER_SERVICE( producer ) );
-	}
 
-	// Create the alpha channel
-	int alpha_size = 0;
-	uint8_t *alpha = NULL;
-
-	// Initialise the alpha
-	if (color.a < 255 || *format == mlt_image_rgb24a) {
-		alpha_size = *width * *height;
-		alpha = mlt_pool_alloc( alpha_size );
-		if ( alpha )
-			memset( alpha, color.a, alpha_size );
-		else
-			alpha_size = 0;
-	}
+		// Initialise the alpha
+		if ( color.a < 255 || *format == mlt_image_rgb24a )
+		{
+			mlt_image_alloc_alpha( image );
+			memset( image->alpha, color.a, *width * *height );
+		}
 
-	// Clone our image
-	if (buffer && image && size > 0) {
-		*buffer = mlt_pool_alloc( size );
-		memcpy( *buffer, image, size );
+		// Update the producer
+		mlt_properties_set_data( producer_props, "_image", image, 0, ( mlt_destructor )mlt_image_close, NULL );
+		mlt_properties_set( producer_props, "_resource", now );
 	}
 
-	// Now update properties so we free the copy after
-	mlt_frame_set_image( frame, *buffer, size, mlt_pool_release );
-	mlt_frame_set_alpha( frame, alpha, alpha_size, mlt_pool_release );
+	// Share the image with the frame rather than copying it
+	mlt_frame_set_shared_image( frame, image );
+	*buffer = image->data;
+
+	mlt_service_unlock( MLT_PRODUCER_SERVICE( producer ) );
+
 	mlt_properties_set_double( properties, "aspect_ratio", mlt_properties_get_double( producer_props, "aspect_ratio" ) );
 	mlt_properties_set_int( properties, "meta.media.width", *width );
 	mlt_properties_set_int( properties, "meta.media.height", *height );
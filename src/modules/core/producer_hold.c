@@ -85,43 +85,43 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 	mlt_frame real_frame = mlt_frame_pop_service( frame );
 
 	// Get the image from the real frame
-	int size = 0;
-	*buffer = mlt_properties_get_data( MLT_FRAME_PROPERTIES( real_frame ), "image", &size );
-	*width = mlt_properties_get_int( MLT_FRAME_PROPERTIES( real_frame ), "width" );
-	*height = mlt_properties_get_int( MLT_FRAME_PROPERTIES( real_frame ), "height" );
+	mlt_properties real_properties = MLT_FRAME_PROPERTIES( real_frame );
+	mlt_image image = NULL;
 
 	// If this is the first time, get it from the producer
-	if ( *buffer == NULL )
+	if ( mlt_properties_get_data( real_properties, "image", NULL ) == NULL )
 	{
-		mlt_properties_pass( MLT_FRAME_PROPERTIES( real_frame ), properties, "" );
+		mlt_properties_pass( real_properties, properties, "" );
 
 		// We'll deinterlace on the downstream deinterlacer
-		mlt_properties_set_int( MLT_FRAME_PROPERTIES( real_frame ), "consumer_deinterlace", 1 );
+		mlt_properties_set_int( real_properties, "consumer_deinterlace", 1 );
 
 		// We want distorted to ensure we don't hit the resize filter twice
-		mlt_properties_set_int( MLT_FRAME_PROPERTIES( real_frame ), "distort", 1 );
-
-		// Get the image
-		mlt_frame_get_image( real_frame, buffer, format, width, height, writable );
-	
-		// Make sure we get the size
-		*buffer = mlt_properties_get_data( MLT_FRAME_PROPERTIES( real_frame ), "image", &size );
+		mlt_properties_set_int( real_properties, "distort", 1 );
 	}
+	else
+	{
+		// Take the image as it was produced the first time
+		*format = mlt_image_none;
+	}
+
+	// Get the image, shared by every frame that holds it
+	mlt_frame_get_shared_image( real_frame, &image, format, width, height );
 
-	mlt_properties_pass( properties, MLT_FRAME_PROPERTIES( real_frame ), "" );
+	mlt_properties_pass( properties, real_properties, "" );
 
 	// Set the values obtained on the frame
-	if ( *buffer != NULL )
+	if ( image != NULL )
 	{
-		uint8_t *image = mlt_pool_alloc( size );
-		memcpy( image, *buffer, size );
-		*buffer = image;
-		mlt_frame_set_image( frame, *buffer, size, mlt_pool_release );
+		mlt_frame_set_shared_image( frame, image );
+		*buffer = image->data;
+		mlt_image_close( image );
 	}
 	else
 	{
 		// Pass the current image as is
-		mlt_frame_set_image( frame, *buffer, size, NULL );
+		*buffer = NULL;
+		mlt_frame_set_image( frame, *buffer, 0, NULL );
 	}
 
 	// Make sure that no further scaling is done
@@ -23,11 +23,13 @@
 #include <ctype.h>
 #include <fnmatch.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include <framework/mlt.h>
 
 static mlt_properties dictionary = NULL;
 static mlt_properties normalisers = NULL;
+static pthread_mutex_t load_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static mlt_producer create_from( mlt_profile profile, char *file, char *services )
 {
@@ -89,7 +91,8 @@ static mlt_producer create_producer( mlt_profile profile, char *file )
 		// Make backup of profile for determining if we need to use 'consumer' producer.
 		mlt_profile backup_profile = mlt_profile_clone( profile );
 
-		// We only need to load the dictionary once
+		// We only need to load the dictionary once, which may happen on several threads
+		pthread_mutex_lock( &load_mutex );
 		if ( dictionary == NULL )
 		{
 			char temp[ 1024 ];
@@ -97,6 +100,7 @@ static mlt_producer create_producer( mlt_profile profile, char *file )
 			dictionary = mlt_properties_load( temp );
 			mlt_factory_register_for_clean_up( dictionary, ( mlt_destructor )mlt_properties_close );
 		}
+		pthread_mutex_unlock( &load_mutex );
 
 		// Convert the lookup string to lower case
 		while ( *p )
@@ -186,7 +190,8 @@ static void attach_normalisers( mlt_profile profile, mlt_producer producer )
 	// Tokeniser
 	mlt_tokeniser tokeniser = mlt_tokeniser_init( );
 
-	// We only need to load the normalising properties once
+	// We only need to load the normalising properties once, which may happen on several threads
+	pthread_mutex_lock( &load_mutex );
 	if ( normalisers == NULL )
 	{
 		char temp[ 1024 ];
@@ -194,6 +199,7 @@ static void attach_normalisers( mlt_profile profile, mlt_producer producer )
 		normalisers = mlt_properties_load( temp );
 		mlt_factory_register_for_clean_up( normalisers, ( mlt_destructor )mlt_properties_close );
 	}
+	pthread_mutex_unlock( &load_mutex );
 
 	// Apply normalisers
 	for ( i = 0; i < mlt_properties_count( normalisers ); i ++ )
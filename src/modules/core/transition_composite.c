@@ -220,6 +220,11 @@ static inline uint8_t sample_mix( uint8_t dest, uint8_t src, int mix )
 	return ( src * mix + dest * ( ( 1 << 16 ) - mix ) ) >> 16;
 }
 
+static inline uint16_t sample_mix16( uint16_t dest, uint16_t src, uint32_t mix )
+{
+	return ( src * mix + dest * ( ( 1 << 16 ) - mix ) ) >> 16;
+}
+
 /** Composite a source line over a destination line
 */
 #if defined(USE_SSE) && defined(ARCH_X86_64)
@@ -329,6 +334,7 @@ struct sliced_composite_desc
 	int stride_dest;
 	int alpha_b_stride;
 	int alpha_a_stride;
+	int luma_stride;
 	composite_line_fn line_fn;
 };
 
@@ -350,49 +356,54 @@ static int sliced_composite_proc( int id, int idx, int jobs, void* cookie )
 		if ( ctx.alpha_a )
 			ctx.alpha_a += ctx.alpha_a_stride;
 		if ( ctx.p_luma )
-			ctx.p_luma += ctx.alpha_b_stride;
+			ctx.p_luma += ctx.luma_stride;
 	}
 
 
 	return 0;
 }
 
-/** Composite function.
+/** The part of the b frame that lands on the a frame after positioning and cropping.
 */
 
-static int composite_yuv( uint8_t *p_dest, int width_dest, int height_dest, uint8_t *p_src, int width_src, int height_src, uint8_t *alpha_b, uint8_t *alpha_a, struct geometry_s geometry, int field, uint16_t *p_luma, double softness, composite_line_fn line_fn, int sliced )
+struct composite_region
 {
-	int ret = 0;
-	int i;
-	int x_src = -geometry.x_src, y_src = -geometry.y_src;
+	int x;          // left edge in the destination
+	int y;          // top edge in the destination
+	int x_src;      // left edge in the source
+	int y_src;      // top edge in the source
+	int width_src;  // width of the overlapping area
+	int height_src; // height of the overlapping area
+	int uneven;     // whether the source and destination chroma are misaligned
+};
+
+/** Calculate the overlapping region, returning false if there is nothing to composite.
+*/
+
+static int composite_region_calculate( struct geometry_s *geometry, int width_dest, int height_dest, int width_src, int height_src, struct composite_region *r )
+{
+	int x_src = -geometry->x_src, y_src = -geometry->y_src;
 	int uneven_x_src = ( x_src % 2 );
-	int step = ( field > -1 ) ? 2 : 1;
-	int bpp = 2;
-	int stride_src = geometry.sw * bpp;
-	int stride_dest = width_dest * bpp;
-	int i_softness = ( 1 << 16 ) * softness;
-	int weight = ( ( 1 << 16 ) * geometry.item.mix + 50 ) / 100;
-	uint32_t luma_step = ( ( ( 1 << 16 ) - 1 ) * geometry.item.mix + 50 ) / 100 * ( 1.0 + softness );
 
 	// Adjust to consumer scale
-	int x = rint( geometry.item.x * width_dest / geometry.nw );
-	int y = rint( geometry.item.y * height_dest / geometry.nh );
+	int x = rint( geometry->item.x * width_dest / geometry->nw );
+	int y = rint( geometry->item.y * height_dest / geometry->nh );
 	int uneven_x = ( x % 2 );
 
 	// optimization points - no work to do
 	if ( width_src <= 0 || height_src <= 0 || y_src >= height_src || x_src >= width_src )
-		return ret;
+		return 0;
 
 	if ( ( x < 0 && -x >= width_src ) || ( y < 0 && -y >= height_src ) )
-		return ret;
+		return 0;
 
 	// cropping affects the source width
 	if ( x_src > 0 )
 	{
 		width_src -= x_src;
 		// and it implies cropping
-		if ( width_src > geometry.item.w )
-			width_src = geometry.item.w;
+		if ( width_src > geometry->item.w )
+			width_src = geometry->item.w;
 	}
 
 	// cropping affects the source height
@@ -400,8 +411,8 @@ static int composite_yuv( uint8_t *p_dest, int width_dest, int height_dest, uint
 	{
 		height_src -= y_src;
 		// and it implies cropping
-		if ( height_src > geometry.item.h )
-			height_src = geometry.item.h;
+		if ( height_src > geometry->item.h )
+			height_src = geometry->item.h;
 	}
 
 	// crop overlay off the left edge of frame
@@ -428,29 +439,97 @@ static int composite_yuv( uint8_t *p_dest, int width_dest, int height_dest, uint
 	if ( y + height_src > height_dest )
 		height_src = height_dest - y;
 
+	r->x = x;
+	r->y = y;
+	r->x_src = x_src;
+	r->y_src = y_src;
+	r->width_src = width_src;
+	r->height_src = height_src;
+	r->uneven = uneven_x != uneven_x_src;
+
+	return 1;
+}
+
+/** Narrow the area to composite to the part of the source that is not fully transparent.
+ *
+ * x_src and y_src are the source coordinates of the first pixel. On return,
+ * skip_x and skip_rows tell how many pixels and lines of the field to skip.
+ * Returns false if nothing visible is left.
+*/
+
+static int composite_trim( const mlt_alpha_summary *summary, int x_src, int y_src, int step, int *width, int *height, int *skip_x, int *skip_rows )
+{
+	int x0 = MAX( 0, summary->x - x_src );
+	int x1 = MIN( *width, summary->x + summary->width - x_src );
+	int y0 = MAX( 0, summary->y - y_src );
+	int y1 = MIN( *height, summary->y + summary->height - y_src );
+
+	// Start on a line of the current field
+	y0 = ( y0 + step - 1 ) / step * step;
+	if ( x1 <= x0 || y1 <= y0 )
+		return 0;
+
+	*skip_x = x0;
+	*skip_rows = y0 / step;
+	*width = x1 - x0;
+	*height = y1 - y0;
+	return 1;
+}
+
+/** Copy a fully opaque source line at full weight, which is what composite_line_yuv would do.
+*/
+
+static void composite_line_yuv_copy( uint8_t *dest, uint8_t *src, int width, uint8_t *alpha_b, uint8_t *alpha_a, int weight, uint16_t *luma, int soft, uint32_t step )
+{
+	memcpy( dest, src, width * 2 );
+	if ( alpha_a )
+		memset( alpha_a, 255, width );
+}
+
+/** Composite function.
+*/
+
+static int composite_yuv( uint8_t *p_dest, int width_dest, int height_dest, uint8_t *p_src, int width_src, int height_src, uint8_t *alpha_b, uint8_t *alpha_a, struct geometry_s geometry, int field, uint16_t *p_luma, double softness, composite_line_fn line_fn, const mlt_alpha_summary *summary, int solid, int sliced )
+{
+	int ret = 0;
+	int i;
+	int step = ( field > -1 ) ? 2 : 1;
+	int bpp = 2;
+	int stride_src = geometry.sw * bpp;
+	int stride_dest = width_dest * bpp;
+	int i_softness = ( 1 << 16 ) * softness;
+	int weight = ( ( 1 << 16 ) * geometry.item.mix + 50 ) / 100;
+	uint32_t luma_step = ( ( ( 1 << 16 ) - 1 ) * geometry.item.mix + 50 ) / 100 * ( 1.0 + softness );
+	struct composite_region r;
+
+	if ( !composite_region_calculate( &geometry, width_dest, height_dest, width_src, height_src, &r ) )
+		return ret;
+	width_src = r.width_src;
+	height_src = r.height_src;
+
 	// offset pointer into overlay buffer based on cropping
-	p_src += x_src * bpp + y_src * stride_src;
+	p_src += r.x_src * bpp + r.y_src * stride_src;
 
 	// offset pointer into frame buffer based upon positive coordinates only!
-	p_dest += x * bpp + y * stride_dest;
+	p_dest += r.x * bpp + r.y * stride_dest;
 
 	// offset pointer into alpha channel based upon cropping
 	if ( alpha_b )
-		alpha_b += x_src + y_src * stride_src / bpp;
+		alpha_b += r.x_src + r.y_src * stride_src / bpp;
 	if ( alpha_a )
-		alpha_a += x + y * stride_dest / bpp;
+		alpha_a += r.x + r.y * stride_dest / bpp;
 
 	// offset pointer into luma channel based upon cropping
 	if ( p_luma )
-		p_luma += x_src + y_src * stride_src / bpp;
+		p_luma += r.x_src + r.y_src * stride_src / bpp;
 	
 	// Assuming lower field first
 	// Special care is taken to make sure the b_frame is aligned to the correct field.
 	// field 0 = lower field and y should be odd (y is 0-based).
 	// field 1 = upper field and y should be even.
-	if ( ( field > -1 ) && ( y % 2 == field ) )
+	if ( ( field > -1 ) && ( r.y % 2 == field ) )
 	{
-		if ( ( field == 1 && y < height_dest - 1 ) || ( field == 0 && y == 0 ) )
+		if ( ( field == 1 && r.y < height_dest - 1 ) || ( field == 0 && r.y == 0 ) )
 			p_dest += stride_dest;
 		else
 			p_dest -= stride_dest;
@@ -473,13 +552,45 @@ static int composite_yuv( uint8_t *p_dest, int width_dest, int height_dest, uint
 	int alpha_a_stride = stride_dest / bpp;
 
 	// Align chroma of source and destination
-	if ( uneven_x != uneven_x_src )
+	if ( r.uneven )
 	{
 		p_src += 2;
 		if ( alpha_b )
 			alpha_b += 1;
 	}
 
+	// Transparent source pixels leave the destination alone when compositing over it
+	if ( summary && line_fn == composite_line_yuv )
+	{
+		int skip_x, skip_rows;
+
+		// Aligning chroma reads the source a pixel to the right, so the last
+		// column blended is past the region; trim from the unshifted edge
+		if ( !composite_trim( summary, r.x_src, r.y_src + ( field == 1 ), step,
+				&width_src, &height_src, &skip_x, &skip_rows ) )
+			return ret;
+		p_src += skip_x * bpp + skip_rows * stride_src;
+		p_dest += skip_x * bpp + skip_rows * stride_dest;
+		if ( alpha_b )
+			alpha_b += skip_x + skip_rows * alpha_b_stride;
+		if ( alpha_a )
+			alpha_a += skip_x + skip_rows * alpha_a_stride;
+		if ( p_luma )
+			p_luma += skip_x + skip_rows * alpha_b_stride;
+
+		// and opaque ones at full weight simply replace it
+		if ( summary->opaque && !p_luma && weight == ( 1 << 16 ) )
+			line_fn = composite_line_yuv_copy;
+	}
+
+	// A solid source fills the region with its first line, which stays in the cache
+	int luma_stride = alpha_b_stride;
+	if ( solid )
+	{
+		stride_src = 0;
+		alpha_b_stride = 0;
+	}
+
 	// now do the compositing only to cropped extents
 	if ( !sliced )
 	{
@@ -494,7 +605,7 @@ static int composite_yuv( uint8_t *p_dest, int width_dest, int height_dest, uint
 		if ( alpha_a )
 			alpha_a += alpha_a_stride;
 		if ( p_luma )
-			p_luma += alpha_b_stride;
+			p_luma += luma_stride;
 	}
 	}
 	else
@@ -516,6 +627,7 @@ static int composite_yuv( uint8_t *p_dest, int width_dest, int height_dest, uint
 			.stride_dest = stride_dest,
 			.alpha_b_stride = alpha_b_stride,
 			.alpha_a_stride = alpha_a_stride,
+			.luma_stride = luma_stride,
 			.line_fn = line_fn,
 		};
 
@@ -525,32 +637,191 @@ static int composite_yuv( uint8_t *p_dest, int width_dest, int height_dest, uint
 	return ret;
 }
 
+/** Composite a 16-bit planar source line over a destination line.
+ *
+ * The planes point at the start of the rows and x_dest/x_src give the first
+ * pixel, so 4:2:2 chroma is always taken from the sample covering the pixel
+ * and no realignment of the source is needed.
+*/
+
+void composite_line_yuv16( uint16_t *dest[3], int x_dest, uint16_t *src[3], int x_src, int width, uint8_t *alpha_b, uint8_t *alpha_a, int weight, uint16_t *luma, int soft, uint32_t step, int op )
+{
+	int j;
+
+	for ( j = 0; j < width; j ++ )
+	{
+		int a = alpha_b ? alpha_b[j] : 255;
+		int xd = x_dest + j;
+		int xs = x_src + j;
+		uint32_t mix;
+
+		if ( op == composite_op_or )
+			a |= alpha_a ? alpha_a[j] : 255;
+		else if ( op == composite_op_and )
+			a &= alpha_a ? alpha_a[j] : 255;
+		else if ( op == composite_op_xor )
+			a ^= alpha_a ? alpha_a[j] : 255;
+		mix = calculate_mix( luma, j, soft, weight, a, step );
+
+		dest[0][xd] = sample_mix16( dest[0][xd], src[0][xs], mix );
+		if ( xd & 1 )
+			dest[2][xd >> 1] = sample_mix16( dest[2][xd >> 1], src[2][xs >> 1], mix );
+		else
+			dest[1][xd >> 1] = sample_mix16( dest[1][xd >> 1], src[1][xs >> 1], mix );
+		if ( alpha_a )
+			alpha_a[j] = op == composite_op_over ? ( mix >> 8 ) | alpha_a[j] : mix >> 8;
+	}
+}
+
+struct composite16_desc
+{
+	uint8_t *dest[3];
+	uint8_t *src[3];
+	int stride_dest[3];
+	int stride_src[3];
+	int x_dest;
+	int x_src;
+	int width_src;
+	int height_src;
+	int step;
+	uint8_t *alpha_b;
+	uint8_t *alpha_a;
+	int alpha_b_stride;
+	int alpha_a_stride;
+	int weight;
+	uint16_t *p_luma;
+	int i_softness;
+	uint32_t luma_step;
+	int op;
+};
+
+static void composite_rows16( struct composite16_desc *ctx, int start, int end )
+{
+	int i, n;
+
+	for ( i = start; i < end && i < ctx->height_src; i += ctx->step )
+	{
+		uint16_t *dest[3], *src[3];
+		int row = i / ctx->step;
+
+		for ( n = 0; n < 3; n++ )
+		{
+			dest[n] = (uint16_t*) ( ctx->dest[n] + row * ctx->stride_dest[n] );
+			src[n] = (uint16_t*) ( ctx->src[n] + row * ctx->stride_src[n] );
+		}
+		composite_line_yuv16( dest, ctx->x_dest, src, ctx->x_src, ctx->width_src,
+			ctx->alpha_b ? ctx->alpha_b + row * ctx->alpha_b_stride : NULL,
+			ctx->alpha_a ? ctx->alpha_a + row * ctx->alpha_a_stride : NULL,
+			ctx->weight, ctx->p_luma ? ctx->p_luma + row * ctx->alpha_b_stride : NULL,
+			ctx->i_softness, ctx->luma_step, ctx->op );
+	}
+}
+
+static int sliced_composite16_proc( int id, int idx, int jobs, void* cookie )
+{
+	struct composite16_desc *ctx = cookie;
+	int hs = ( ctx->height_src + jobs - 1 ) / jobs;
+
+	// Keep slice boundaries on a line of the current field
+	hs += ( ctx->step - hs % ctx->step ) % ctx->step;
+	composite_rows16( ctx, hs * idx, hs * ( idx + 1 ) );
+
+	return 0;
+}
 
-/** Scale 16bit greyscale luma map using nearest neighbor.
+/** Composite function for planar 16-bit YUV 4:2:2.
 */
 
-static inline void
-scale_luma ( uint16_t *dest_buf, int dest_width, int dest_height, const uint16_t *src_buf, int src_width, int src_height, int invert )
+static int composite_yuv16( uint8_t *p_dest, int width_dest, int height_dest, uint8_t *p_src, int width_src, int height_src, int image_height_src, uint8_t *alpha_b, uint8_t *alpha_a, struct geometry_s geometry, int field, uint16_t *p_luma, double softness, int op, const mlt_alpha_summary *summary, int sliced )
 {
-	register int i, j;
-	register int x_step = ( src_width << 16 ) / dest_width;
-	register int y_step = ( src_height << 16 ) / dest_height;
-	register int x, y = 0;
+	int n;
+	int step = ( field > -1 ) ? 2 : 1;
+	int y_dest;
+	int y_src;
+	uint8_t *planes_dest[4], *planes_src[4];
+	int strides_dest[4], strides_src[4];
+	struct composite_region r;
+	struct composite16_desc ctx;
+
+	if ( !composite_region_calculate( &geometry, width_dest, height_dest, width_src, height_src, &r ) )
+		return 0;
+
+	// The source rows are laid out using the scaled width, like composite_yuv,
+	// but the planes follow the full height even when cropping
+	mlt_image_format_planes( mlt_image_yuv422p16, width_dest, height_dest, p_dest, planes_dest, strides_dest );
+	mlt_image_format_planes( mlt_image_yuv422p16, geometry.sw, image_height_src, p_src, planes_src, strides_src );
+
+	y_dest = r.y;
+	y_src = r.y_src;
 
-	for ( i = 0; i < dest_height; i++ )
+	// Align the b_frame to the correct field (see composite_yuv)
+	if ( ( field > -1 ) && ( r.y % 2 == field ) )
 	{
-		const uint16_t *src = src_buf + ( y >> 16 ) * src_width;
-		x = 0;
-		
-		for ( j = 0; j < dest_width; j++ )
+		if ( ( field == 1 && r.y < height_dest - 1 ) || ( field == 0 && r.y == 0 ) )
+			y_dest ++;
+		else
+			y_dest --;
+	}
+	if ( field == 1 )
+	{
+		y_src ++;
+		alpha_a = alpha_a ? alpha_a + width_dest : NULL;
+		r.height_src --;
+	}
+
+	for ( n = 0; n < 3; n++ )
+	{
+		ctx.dest[n] = planes_dest[n] + y_dest * strides_dest[n];
+		ctx.src[n] = planes_src[n] + y_src * strides_src[n];
+		ctx.stride_dest[n] = strides_dest[n] * step;
+		ctx.stride_src[n] = strides_src[n] * step;
+	}
+	ctx.x_dest = r.x;
+	ctx.x_src = r.x_src;
+	ctx.width_src = r.width_src;
+	ctx.height_src = r.height_src;
+	ctx.step = step;
+	ctx.alpha_b = alpha_b ? alpha_b + r.x_src + y_src * geometry.sw : NULL;
+	ctx.alpha_a = alpha_a ? alpha_a + r.x + r.y * width_dest : NULL;
+	ctx.alpha_b_stride = geometry.sw * step;
+	ctx.alpha_a_stride = width_dest * step;
+	ctx.weight = ( ( 1 << 16 ) * geometry.item.mix + 50 ) / 100;
+	ctx.p_luma = p_luma ? p_luma + r.x_src + r.y_src * geometry.sw : NULL;
+	ctx.i_softness = ( 1 << 16 ) * softness;
+	ctx.luma_step = ( ( ( 1 << 16 ) - 1 ) * geometry.item.mix + 50 ) / 100 * ( 1.0 + softness );
+	ctx.op = op;
+
+	// Transparent source pixels leave the destination alone when compositing over it
+	if ( summary && op == composite_op_over )
+	{
+		int skip_x, skip_rows;
+
+		if ( !composite_trim( summary, r.x_src, y_src, step, &ctx.width_src, &ctx.height_src, &skip_x, &skip_rows ) )
+			return 0;
+		for ( n = 0; n < 3; n++ )
 		{
-			*dest_buf++ = src[ x >> 16 ] ^ invert;
-			x += x_step;
+			ctx.dest[n] += skip_rows * ctx.stride_dest[n];
+			ctx.src[n] += skip_rows * ctx.stride_src[n];
 		}
-		y += y_step;
+		ctx.x_dest += skip_x;
+		ctx.x_src += skip_x;
+		if ( ctx.alpha_b )
+			ctx.alpha_b += skip_x + skip_rows * ctx.alpha_b_stride;
+		if ( ctx.alpha_a )
+			ctx.alpha_a += skip_x + skip_rows * ctx.alpha_a_stride;
+		if ( ctx.p_luma )
+			ctx.p_luma += skip_x + skip_rows * ctx.alpha_b_stride;
 	}
+
+	if ( sliced )
+		mlt_slices_run_normal( 0, sliced_composite16_proc, &ctx );
+	else
+		composite_rows16( &ctx, 0, ctx.height_src );
+
+	return 0;
 }
 
+
 static uint16_t* get_luma( mlt_transition self, mlt_properties properties, int width, int height )
 {
 	// The cached luma map information
@@ -592,16 +863,12 @@ static uint16_t* get_luma( mlt_transition self, mlt_properties properties, int w
 		int old_invert = mlt_properties_get_int( properties, "_luma_invert" );
 
 		if ( invert != old_invert || ( old_luma && old_luma[0] && strcmp( resource, old_luma ) ) )
-		{
-			mlt_properties_set_data( properties, "_luma.orig_bitmap", NULL, 0, NULL, NULL );
 			luma_bitmap = NULL;
-		}
 	}
 	else {
 		char *old_luma = mlt_properties_get( properties, "_luma" );
 		if ( old_luma && old_luma[0] )
 		{
-			mlt_properties_set_data( properties, "_luma.orig_bitmap", NULL, 0, NULL, NULL );
 			mlt_properties_set_data( properties, "_luma.bitmap", NULL, 0, NULL, NULL );
 			luma_bitmap = NULL;
 			mlt_properties_set( properties, "_luma", NULL);
@@ -610,17 +877,16 @@ static uint16_t* get_luma( mlt_transition self, mlt_properties properties, int w
 
 	if ( resource && resource[0] && ( luma_bitmap == NULL || luma_width != width || luma_height != height ) )
 	{
-		uint16_t *orig_bitmap = mlt_properties_get_data( properties, "_luma.orig_bitmap", NULL );
-		luma_width = mlt_properties_get_int( properties, "_luma.orig_width" );
-		luma_height = mlt_properties_get_int( properties, "_luma.orig_height" );
+		// Scaled maps are shared by all transitions using the same luma
+		luma_bitmap = mlt_luma_map_cache_get_scaled( resource, width, height, invert );
 
 		// Load the original luma once
-		if ( orig_bitmap == NULL )
+		if ( luma_bitmap == NULL )
 		{
+			uint16_t *orig_bitmap = NULL;
 			char *extension = strrchr( resource, '.' );
 			
 			// See if it is a PGM
-			int lumaLoaded = 0;
 			if ( extension != NULL && strcmp( extension, ".pgm" ) == 0 )
 			{
 				// Load from PGM
@@ -631,20 +897,13 @@ static uint16_t* get_luma( mlt_transition self, mlt_properties properties, int w
 						luma->w = profile->width;
 						luma->h = profile->height;
 					}
-					luma_bitmap = mlt_luma_map_render(luma);
+					orig_bitmap = mlt_luma_map_render(luma);
 					luma_width = luma->w;
 					luma_height = luma->h;
 					free(luma);
 				}
-				if ( luma_width > 0 && luma_height > 0 ) {
-					// Remember the original size for subsequent scaling
-					mlt_properties_set_data( properties, "_luma.orig_bitmap", orig_bitmap, luma_width * luma_height * 2, mlt_pool_release, NULL );
-					mlt_properties_set_int( properties, "_luma.orig_width", luma_width );
-					mlt_properties_set_int( properties, "_luma.orig_height", luma_height );
-					lumaLoaded = 1;
-				}
 			}
-			if ( !lumaLoaded )
+			if ( orig_bitmap == NULL )
 			{
 				// Get the factory producer service
 				char *factory = mlt_properties_get( properties, "factory" );
@@ -680,11 +939,6 @@ static uint16_t* get_luma( mlt_transition self, mlt_properties properties, int w
 						// Generate the luma map
 						if ( luma_image != NULL && luma_format == mlt_image_yuv422 )
 							mlt_luma_map_from_yuv422( luma_image, &orig_bitmap, luma_width, luma_height );
-	
-						// Remember the original size for subsequent scaling
-						mlt_properties_set_data( properties, "_luma.orig_bitmap", orig_bitmap, luma_width * luma_height * 2, mlt_pool_release, NULL );
-						mlt_properties_set_int( properties, "_luma.orig_width", luma_width );
-						mlt_properties_set_int( properties, "_luma.orig_height", luma_height );
 						
 						// Cleanup the luma frame
 						mlt_frame_close( luma_frame );
@@ -693,23 +947,25 @@ static uint16_t* get_luma( mlt_transition self, mlt_properties properties, int w
 					// Cleanup the luma producer
 					mlt_producer_close( producer );
 				}
-				else
-				{
-					luma_width = 0;
-					luma_height = 0;
-				}
+			}
+			if ( orig_bitmap && luma_width > 0 && luma_height > 0 )
+			{
+				// Remember the original for subsequent scaling
+				orig_bitmap = mlt_luma_map_cache_put( resource, 0, 0, 0, orig_bitmap, luma_width, luma_height );
+				luma_bitmap = mlt_luma_map_cache_get_scaled( resource, width, height, invert );
+				mlt_luma_map_cache_release( orig_bitmap );
+			}
+			else
+			{
+				mlt_pool_release( orig_bitmap );
 			}
 		}
-		if ( orig_bitmap && luma_width > 0 && luma_height > 0 )
+		if ( luma_bitmap )
 		{
-			// Scale luma map
-			luma_bitmap = mlt_pool_alloc( width * height * sizeof( uint16_t ) );
-			scale_luma( luma_bitmap, width, height, orig_bitmap, luma_width, luma_height, invert * ( ( 1 << 16 ) - 1 ) );
-
 			// Remember the scaled luma size to prevent unnecessary scaling
 			mlt_properties_set_int( properties, "_luma.width", width );
 			mlt_properties_set_int( properties, "_luma.height", height );
-			mlt_properties_set_data( properties, "_luma.bitmap", luma_bitmap, width * height * 2, mlt_pool_release, NULL );
+			mlt_properties_set_data( properties, "_luma.bitmap", luma_bitmap, width * height * 2, mlt_luma_map_cache_release, NULL );
 			mlt_properties_set( properties, "_luma", resource );
 			mlt_properties_set_int( properties, "_luma_invert", invert );
 		}
@@ -720,10 +976,10 @@ static uint16_t* get_luma( mlt_transition self, mlt_properties properties, int w
 /** Get the properly sized image from b_frame.
 */
 
-static int get_b_frame_image( mlt_transition self, mlt_frame b_frame, uint8_t **image, int *width, int *height, struct geometry_s *geometry )
+static int get_b_frame_image( mlt_transition self, mlt_frame b_frame, uint8_t **image, mlt_image_format format, int *width, int *height, struct geometry_s *geometry, int writable )
 {
 	int error = 0;
-	mlt_image_format format = mlt_image_yuv422;
+	mlt_image_format requested_format = format;
 
 	// Get the properties objects
 	mlt_properties b_props = MLT_FRAME_PROPERTIES( b_frame );
@@ -843,7 +1099,11 @@ static int get_b_frame_image( mlt_transition self, mlt_frame b_frame, uint8_t **
 // fprintf(stderr, "%s: scaled %dx%d norm %dx%d resize %dx%d\n", __FILE__,
 // geometry->sw, geometry->sh, geometry->nw, geometry->nh, *width, *height);
 
-	error = mlt_frame_get_image( b_frame, image, &format, width, height, 1 );
+	error = mlt_frame_get_image( b_frame, image, &format, width, height, writable );
+
+	// The compositor needs both frames in the same format
+	if ( !error && format != requested_format )
+		error = 1;
 
 	// composite_yuv uses geometry->sw to determine source stride, which
 	// should equal the image width if not using crop property.
@@ -1114,8 +1374,9 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 		b_frame = c;
 	}
 
-	// This compositer is yuv422 only
-	*format = mlt_image_yuv422;
+	// This compositer is yuv422 with a native path for planar 16-bit
+	if ( *format != mlt_image_yuv422p16 )
+		*format = mlt_image_yuv422;
 
 	if ( b_frame != NULL )
 	{
@@ -1168,7 +1429,7 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 		if ( a_frame == b_frame )
 		{
 			double aspect_ratio = mlt_frame_get_aspect_ratio( b_frame );
-			get_b_frame_image( self, b_frame, &image_b, &width_b, &height_b, &result );
+			get_b_frame_image( self, b_frame, &image_b, *format, &width_b, &height_b, &result, 1 );
 			alpha_b = mlt_frame_get_alpha( b_frame );
 			mlt_properties_set_double( a_props, "aspect_ratio", aspect_ratio );
 		}
@@ -1204,8 +1465,22 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 			height_b = mlt_properties_get_int( a_props, "dest_height" );
 		}
 
-		if ( *image != image_b && ( image_b ||
-			get_b_frame_image( self, b_frame, &image_b, &width_b, &height_b, &result ) ) )
+		int b_ready = *image != image_b && ( image_b ||
+			get_b_frame_image( self, b_frame, &image_b, *format, &width_b, &height_b, &result, 0 ) );
+
+		// Fall back to yuv422 when the b frame cannot be delivered in yuv422p16
+		if ( !b_ready && image_b && *image != image_b && *format == mlt_image_yuv422p16 )
+		{
+			mlt_image_format b_format = mlt_image_yuv422;
+			*format = mlt_image_yuv422;
+			b_ready = !mlt_frame_get_image( a_frame, image, format, width, height, 1 ) && *format == mlt_image_yuv422 &&
+				!mlt_frame_get_image( b_frame, &image_b, &b_format, &width_b, &height_b, 0 ) && b_format == mlt_image_yuv422;
+			alpha_a = mlt_frame_get_alpha( a_frame );
+			if ( !b_ready )
+				mlt_log_error( MLT_TRANSITION_SERVICE( self ), "cannot composite the b frame in yuv422p16 or yuv422\n" );
+		}
+
+		if ( b_ready )
 		{
 			int progressive = 
 					mlt_properties_get_int( a_props, "consumer_deinterlace" ) ||
@@ -1223,24 +1498,56 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 			alpha_b = alpha_b == NULL ? mlt_frame_get_alpha( b_frame ) : alpha_b;
 
 			composite_line_fn line_fn = composite_line_yuv;
+			int op = composite_op_over;
 
 			// Replacement and override
 			if ( operator != NULL )
 			{
 				if ( !strcmp( operator, "or" ) )
+				{
 					line_fn = composite_line_yuv_or;
+					op = composite_op_or;
+				}
 				if ( !strcmp( operator, "and" ) )
+				{
 					line_fn = composite_line_yuv_and;
+					op = composite_op_and;
+				}
 				if ( !strcmp( operator, "xor" ) )
+				{
 					line_fn = composite_line_yuv_xor;
+					op = composite_op_xor;
+				}
 			}
 
 			// Allow the user to completely obliterate the alpha channels from both frames
 			if ( mlt_properties_get( properties, "alpha_a" ) && alpha_a )
 				memset( alpha_a, mlt_properties_get_int( properties, "alpha_a" ), *width * *height );
 
-			if ( mlt_properties_get( properties, "alpha_b" ) && alpha_b )
+			if ( mlt_properties_get( properties, "alpha_b" ) && alpha_b && a_frame == b_frame )
+			{
 				memset( alpha_b, mlt_properties_get_int( properties, "alpha_b" ), width_b * height_b );
+			}
+			else if ( mlt_properties_get( properties, "alpha_b" ) && alpha_b )
+			{
+				// The b frame image was only read, so replace its alpha rather than writing to it
+				int size = width_b * height_b;
+				alpha_b = mlt_pool_alloc( size );
+				memset( alpha_b, mlt_properties_get_int( properties, "alpha_b" ), size );
+				mlt_frame_set_alpha( b_frame, alpha_b, size, mlt_pool_release );
+			}
+
+			// A solid b frame has the same pixels on every line
+			int solid = a_frame != b_frame && mlt_frame_is_solid( b_frame );
+
+			// Find the transparent and opaque parts of the b frame once for both fields
+			mlt_alpha_summary alpha_summary;
+			const mlt_alpha_summary *summary = NULL;
+			if ( alpha_b == mlt_frame_get_alpha( b_frame ) && !mlt_properties_get( properties, "alpha_b" ) )
+			{
+				mlt_frame_get_alpha_summary( b_frame, &alpha_summary );
+				summary = &alpha_summary;
+			}
 
 			for ( field = 0; field < ( progressive ? 1 : 2 ); field++ )
 			{
@@ -1290,11 +1597,24 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 					alignment_calculate( &result );
 				}
 
+				// The summary only applies while the alpha rows are the b frame's own rows
+				const mlt_alpha_summary *field_summary =
+					result.sw == mlt_properties_get_int( b_props, "width" ) ? summary : NULL;
+
 				// Composite the b_frame on the a_frame
 				mlt_log_timings_begin()
-				composite_yuv( *image, *width, *height, image_b, width_b, height_b, alpha_b, alpha_a, result, field_id, luma_bitmap, luma_softness, line_fn, sliced );
+				if ( *format == mlt_image_yuv422p16 )
+					composite_yuv16( *image, *width, *height, image_b, width_b, height_b,
+						mlt_properties_get_int( b_props, "height" ), alpha_b, alpha_a, result,
+						field_id, luma_bitmap, luma_softness, op, field_summary, sliced );
+				else
+					composite_yuv( *image, *width, *height, image_b, width_b, height_b, alpha_b, alpha_a, result, field_id, luma_bitmap, luma_softness, line_fn, field_summary, solid, sliced );
 				mlt_log_timings_end( NULL, "composite_yuv" )
 			}
+
+			// The a frame alpha was written in place
+			if ( alpha_a )
+				mlt_properties_set_data( a_props, "_alpha_summary", NULL, 0, NULL, NULL );
 		}
 	}
 	else
@@ -29,4 +29,16 @@ extern mlt_frame composite_copy_region( mlt_transition, mlt_frame, mlt_position
 extern void composite_line_yuv( uint8_t *dest, uint8_t *src, int width, uint8_t *alpha_b,
                                 uint8_t *alpha_a, int weight, uint16_t *luma, int soft, uint32_t step );
 
+// Alpha operators for the 16-bit planar compositor
+enum
+{
+	composite_op_over = 0,
+	composite_op_or,
+	composite_op_and,
+	composite_op_xor
+};
+
+extern void composite_line_yuv16( uint16_t *dest[3], int x_dest, uint16_t *src[3], int x_src, int width, uint8_t *alpha_b,
+                                  uint8_t *alpha_a, int weight, uint16_t *luma, int soft, uint32_t step, int op );
+
 #endif
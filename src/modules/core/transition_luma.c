@@ -30,12 +30,11 @@
 #include <math.h>
 #include "transition_composite.h"
 
-static inline int is_opaque( uint8_t *alpha_channel, int width, int height )
+static inline int is_opaque( mlt_frame frame )
 {
-	int n = width * height + 1;
-	while ( --n )
-		if ( *alpha_channel++ != 0xff ) return 0;
-	return 1;
+	mlt_alpha_summary summary;
+	mlt_frame_get_alpha_summary( frame, &summary );
+	return summary.opaque;
 }
 
 static inline float calculate_mix( float weight, float alpha )
@@ -48,6 +47,11 @@ static inline uint8_t sample_mix( uint8_t dest, uint8_t src, float mix )
 	return src * mix + dest * ( 1.f - mix );
 }
 
+static inline uint16_t sample_mix16( uint16_t dest, uint16_t src, float mix )
+{
+	return src * mix + dest * ( 1.f - mix );
+}
+
 static void composite_line_yuv_float( uint8_t *dest, uint8_t *src, int width, uint8_t *alpha_b, uint8_t *alpha_a, float weight )
 {
 	register int j = 0;
@@ -104,12 +108,97 @@ static int dissolve_slice( int id, int index, int count, void *context )
 	return 0;
 }
 
-static inline int dissolve_yuv( mlt_frame frame, mlt_frame that, float weight, int width, int height, int threads, int alpha_over )
+static void composite_line_yuv16_float( uint16_t *dest[3], uint16_t *src[3], int width, uint8_t *alpha_b, uint8_t *alpha_a, float weight )
+{
+	int j;
+	float mix_a, mix_b;
+
+	for ( j = 0; j < width; j ++ )
+	{
+		mix_a = calculate_mix( 1.0f - weight, alpha_a? alpha_a[j] : 255 );
+		mix_b = calculate_mix( weight, alpha_b? alpha_b[j] : 255 );
+		if (alpha_a) {
+			float mix2 = mix_b + mix_a - mix_b * mix_a;
+			alpha_a[j] = 255 * mix2;
+			if (mix2 != 0.f) mix_b /= mix2;
+		}
+		dest[0][j] = sample_mix16( dest[0][j], src[0][j], mix_b );
+		if ( j & 1 )
+			dest[2][j >> 1] = sample_mix16( dest[2][j >> 1], src[2][j >> 1], mix_b );
+		else
+			dest[1][j >> 1] = sample_mix16( dest[1][j >> 1], src[1][j >> 1], mix_b );
+	}
+}
+
+struct dissolve16_slice_context {
+	uint8_t *dst_planes[4];
+	uint8_t *src_planes[4];
+	int dst_strides[4];
+	int src_strides[4];
+	uint8_t *dst_alpha;
+	uint8_t *src_alpha;
+	int dst_width;
+	int src_width;
+	int width;
+	int height;
+	float weight;
+	int translucent;
+};
+
+static int dissolve16_slice( int id, int index, int count, void *context )
+{
+	struct dissolve16_slice_context *ctx = context;
+	int slice_height = (ctx->height + count - 1) / count;
+	int start = index * slice_height;
+	int end = MIN(start + slice_height, ctx->height);
+	int mix = ctx->weight * ( 1 << 16 );
+	int i, n;
+
+	for (i = start; i < end; i++) {
+		uint16_t *dst[3], *src[3];
+		uint8_t *dst_alpha = ctx->dst_alpha? ctx->dst_alpha + i * ctx->dst_width : NULL;
+		uint8_t *src_alpha = ctx->src_alpha? ctx->src_alpha + i * ctx->src_width : NULL;
+
+		for (n = 0; n < 3; n++) {
+			dst[n] = (uint16_t*) (ctx->dst_planes[n] + i * ctx->dst_strides[n]);
+			src[n] = (uint16_t*) (ctx->src_planes[n] + i * ctx->src_strides[n]);
+		}
+		if (ctx->translucent)
+			composite_line_yuv16_float( dst, src, ctx->width, src_alpha, dst_alpha, ctx->weight );
+		else
+			composite_line_yuv16( dst, 0, src, 0, ctx->width, src_alpha, dst_alpha, mix, NULL, 0, 0, composite_op_over );
+	}
+	return 0;
+}
+
+/** Get the images of the frames in one format.
+ *
+ * When the b frame cannot be delivered in yuv422p16, both frames fall back to
+ * yuv422.
+ * \return true if the frames still differ in format
+ */
+
+static int get_images( mlt_frame a_frame, uint8_t **p_dest, mlt_image_format *format_dest, int *width_dest, int *height_dest,
+					   mlt_frame b_frame, uint8_t **p_src, mlt_image_format *format_src, int *width_src, int *height_src )
+{
+	mlt_frame_get_image( a_frame, p_dest, format_dest, width_dest, height_dest, 1 );
+	mlt_frame_get_image( b_frame, p_src, format_src, width_src, height_src, 0 );
+	if ( *format_src != *format_dest )
+	{
+		*format_dest = *format_src = mlt_image_yuv422;
+		mlt_frame_get_image( a_frame, p_dest, format_dest, width_dest, height_dest, 1 );
+		mlt_frame_get_image( b_frame, p_src, format_src, width_src, height_src, 0 );
+	}
+	return *format_src != *format_dest ||
+		( *format_dest != mlt_image_yuv422 && *format_dest != mlt_image_yuv422p16 );
+}
+
+static inline int dissolve_yuv( mlt_frame frame, mlt_frame that, float weight, int width, int height, int threads, int alpha_over, mlt_image_format *format )
 {
 	int ret = 0;
 	int i = height + 1;
 	int width_src = width, height_src = height;
-	mlt_image_format format = mlt_image_yuv422;
+	mlt_image_format format_src = *format;
 	uint8_t *p_src, *p_dest;
 	uint8_t *alpha_src;
 	uint8_t *alpha_dst;
@@ -117,12 +206,30 @@ static inline int dissolve_yuv( mlt_frame frame, mlt_frame that, float weight, i
 
 	if ( mlt_properties_get( &frame->parent, "distort" ) )
 		mlt_properties_set( &that->parent, "distort", mlt_properties_get( &frame->parent, "distort" ) );
-	mlt_frame_get_image( frame, &p_dest, &format, &width, &height, 1 );
+	if ( get_images( frame, &p_dest, format, &width, &height, that, &p_src, &format_src, &width_src, &height_src ) )
+		return 1;
 	alpha_dst = mlt_frame_get_alpha_mask( frame );
-	mlt_frame_get_image( that, &p_src, &format, &width_src, &height_src, 0 );
 	alpha_src = mlt_frame_get_alpha_mask( that );
-	int is_translucent = ( alpha_dst && !is_opaque(alpha_dst, width, height) )
-	                  || ( alpha_src && !is_opaque(alpha_src, width_src, height_src) );
+	int is_translucent = ( alpha_dst && !is_opaque( frame ) )
+	                  || ( alpha_src && !is_opaque( that ) );
+
+	if ( *format == mlt_image_yuv422p16 )
+	{
+		struct dissolve16_slice_context context = {
+			.dst_alpha = alpha_dst,
+			.src_alpha = alpha_src,
+			.dst_width = width,
+			.src_width = width_src,
+			.width = MIN(width_src, width),
+			.height = MIN(height_src, height),
+			.weight = weight,
+			.translucent = is_translucent && alpha_over
+		};
+		mlt_image_format_planes( *format, width, height, p_dest, context.dst_planes, context.dst_strides );
+		mlt_image_format_planes( *format, width_src, height_src, p_src, context.src_planes, context.src_strides );
+		mlt_slices_run_normal(threads, dissolve16_slice, &context);
+		return ret;
+	}
 
 	// Pick the lesser of two evils ;-)
 	width_src = width_src > width ? width : width_src;
@@ -185,17 +292,65 @@ static float smoothstep_float( float edge1, float edge2, float a )
 	return ( a * a )  * ( 3 - ( 2 * a ) );
 }
 
+/** Wipe one line of planar 16-bit YUV 4:2:2 using the luma map.
+*/
+
+static void luma_line16( uint16_t *q[3], uint16_t *p[3], int width, uint16_t *l, int32_t x_diff, float field_pos,
+						 float softness, int translucent, int invert, uint8_t **alpha_dest, uint8_t **alpha_src )
+{
+	int32_t x_offset = 0;
+	uint32_t i_softness = softness * ( 1 << 16 );
+	float mix_a, mix_b;
+	int j;
+
+	for ( j = 0; j < width; j++, x_offset += x_diff )
+	{
+		uint16_t *qc = ( j & 1 ) ? &q[2][j >> 1] : &q[1][j >> 1];
+		uint16_t pc = ( j & 1 ) ? p[2][j >> 1] : p[1][j >> 1];
+
+		if ( translucent )
+		{
+			uint8_t *a_dest = *alpha_dest;
+			uint8_t *a_src = *alpha_src;
+			float weight = l[ x_offset >> 16 ] / 65535.f;
+			float value = smoothstep_float( weight, softness + weight, field_pos );
+			mix_a = calculate_mix( 1.0f - value, a_dest? *a_dest : 255 );
+			mix_b = calculate_mix( value, a_src? *a_src : 255 );
+			if (invert && a_src) {
+				float mix2 = mix_b + mix_a - mix_b * mix_a;
+				*a_src = 255 * mix2;
+				if (mix2 != 0.f) mix_b /= mix2;
+			} else if (!invert && a_dest) {
+				float mix2 = mix_b + mix_a - mix_b * mix_a;
+				*a_dest = 255 * mix2;
+				if (mix2 != 0.f) mix_b /= mix2;
+			}
+			q[0][j] = sample_mix16( q[0][j], p[0][j], mix_b );
+			*qc = sample_mix16( *qc, pc, mix_b );
+			if ( a_dest ) (*alpha_dest) ++;
+			if ( a_src ) (*alpha_src) ++;
+		}
+		else
+		{
+			uint16_t weight = l[ x_offset >> 16 ];
+			uint64_t value = smoothstep( weight, i_softness + weight, (1 << 16) * field_pos );
+			q[0][j] = ( p[0][j] * value + q[0][j] * ((1 << 16) - value) ) >> 16;
+			*qc = ( pc * value + *qc * ((1 << 16) - value) ) >> 16;
+		}
+	}
+}
+
 /** powerful stuff
 
     \param field_order -1 = progressive, 0 = lower field first, 1 = top field first
 */
-static void luma_composite( mlt_frame a_frame, mlt_frame b_frame, int luma_width, int luma_height,
+static int luma_composite( mlt_frame a_frame, mlt_frame b_frame, int luma_width, int luma_height,
 							uint16_t *luma_bitmap, float pos, float frame_delta, float softness, int field_order,
-							int *width, int *height, int invert )
+							int *width, int *height, int invert, mlt_image_format *format )
 {
 	int width_src = *width, height_src = *height;
 	int width_dest = *width, height_dest = *height;
-	mlt_image_format format_src = mlt_image_yuv422, format_dest = mlt_image_yuv422;
+	mlt_image_format format_src = *format, format_dest = *format;
 	uint8_t *p_src, *p_dest;
 	uint8_t *alpha_src, *alpha_dest;
 	int i, j;
@@ -204,16 +359,27 @@ static void luma_composite( mlt_frame a_frame, mlt_frame b_frame, int luma_width
 
 	if ( mlt_properties_get( &a_frame->parent, "distort" ) )
 		mlt_properties_set( &b_frame->parent, "distort", mlt_properties_get( &a_frame->parent, "distort" ) );
-	mlt_frame_get_image( a_frame, &p_dest, &format_dest, &width_dest, &height_dest, 1 );
+	int error = get_images( a_frame, &p_dest, &format_dest, &width_dest, &height_dest, b_frame, &p_src, &format_src, &width_src, &height_src );
+	*format = format_dest;
+	if ( error )
+		return 1;
 	alpha_dest = mlt_frame_get_alpha_mask( a_frame );
-	mlt_frame_get_image( b_frame, &p_src, &format_src, &width_src, &height_src, 0 );
 	alpha_src = mlt_frame_get_alpha_mask( b_frame );
 
 	if ( *width == 0 || *height == 0 )
-		return;
+		return 0;
 
-	int is_translucent = ( alpha_dest && !is_opaque(alpha_dest, width_dest, height_dest) )
-	                  || ( alpha_src  && !is_opaque(alpha_src,  width_src,  height_src ) );
+	int is_translucent = ( alpha_dest && !is_opaque( a_frame ) )
+	                  || ( alpha_src  && !is_opaque( b_frame ) );
+
+	// The planes of 16-bit images follow the full image size
+	uint8_t *planes_src[4], *planes_dest[4];
+	int strides_src[4], strides_dest[4];
+	if ( format_dest == mlt_image_yuv422p16 )
+	{
+		mlt_image_format_planes( format_src, width_src, height_src, p_src, planes_src, strides_src );
+		mlt_image_format_planes( format_dest, width_dest, height_dest, p_dest, planes_dest, strides_dest );
+	}
 
 	// Pick the lesser of two evils ;-)
 	width_src = width_src > width_dest ? width_dest : width_src;
@@ -259,7 +425,19 @@ static void luma_composite( mlt_frame a_frame, mlt_frame b_frame, int luma_width
 			x_offset = 0;
 			j = width_src;
 
-			if (is_translucent)
+			if ( format_dest == mlt_image_yuv422p16 )
+			{
+				uint16_t *p16[3], *q16[3];
+				int n;
+				for ( n = 0; n < 3; n++ )
+				{
+					p16[n] = (uint16_t*) ( planes_src[n] + i * strides_src[n] );
+					q16[n] = (uint16_t*) ( planes_dest[n] + i * strides_dest[n] );
+				}
+				luma_line16( q16, p16, width_src, l, x_diff, field_pos[ field ], softness,
+							 is_translucent, invert, &alpha_dest, &alpha_src );
+			}
+			else if (is_translucent)
 			{
 				while( j -- )
 				{
@@ -306,6 +484,7 @@ static void luma_composite( mlt_frame a_frame, mlt_frame b_frame, int luma_width
 
 		field ++;
 	}
+	return 0;
 }
 
 void yuv422_to_luma16(uint8_t *image, uint16_t **map, int width, int height, int full_range)
@@ -344,8 +523,9 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 	// Get the properties of the b frame
 	mlt_properties b_props = MLT_FRAME_PROPERTIES( b_frame );
 
-	// This compositer is yuv422 only
-	*format = mlt_image_yuv422;
+	// This compositer is yuv422 with a native path for planar 16-bit
+	if ( *format != mlt_image_yuv422p16 )
+		*format = mlt_image_yuv422;
 
 	mlt_service_lock( MLT_TRANSITION_SERVICE( transition ) );
 
@@ -354,6 +534,8 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 	int luma_height = mlt_properties_get_int( properties, "height" );
 	uint16_t *luma_bitmap = mlt_properties_get_data( properties, "bitmap", NULL );
 	char *current_resource = mlt_properties_get( properties, "_resource" );
+	int cached_width = 0;
+	int cached_height = 0;
 	mlt_producer producer = mlt_properties_get_data(properties, "producer", NULL);
 	
 	// If the filename property changed, reload the map
@@ -388,29 +570,38 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 			extension = strrchr( resource, '.' );
 		}
 
+		// Composite caches the first frame of any producer under its resource, even
+		// of a clip, so the stills found here are cached under a key of their own
+		char *still_key = malloc( strlen( resource ) + sizeof( "still:" ) );
+		sprintf( still_key, "still:%s", resource );
+
 		// See if it is a PGM
 		if ( extension != NULL && strcmp( extension, ".pgm" ) == 0 )
 		{
-			// Load from PGM
-			luma_bitmap = NULL;
-			if (mlt_luma_map_from_pgm(resource, &luma_bitmap, &luma_width, &luma_height)) {
-				// Failed to read file; generate it.
-				mlt_luma_map luma = mlt_luma_map_new(orig_resource);
-				if (profile) {
-					luma->w = profile->width;
-					luma->h = profile->height;
+			// Load from PGM unless another transition already did
+			luma_width = luma_height = 0;
+			luma_bitmap = mlt_luma_map_cache_get(resource, &luma_width, &luma_height, 0);
+			if (!luma_bitmap) {
+				if (mlt_luma_map_from_pgm(resource, &luma_bitmap, &luma_width, &luma_height)) {
+					// Failed to read file; generate it.
+					mlt_luma_map luma = mlt_luma_map_new(orig_resource);
+					if (profile) {
+						luma->w = profile->width;
+						luma->h = profile->height;
+					}
+					luma_bitmap = mlt_luma_map_render(luma);
+					luma_width = luma->w;
+					luma_height = luma->h;
+					free(luma);
 				}
-				luma_bitmap = mlt_luma_map_render(luma);
-				luma_width = luma->w;
-				luma_height = luma->h;
-				free(luma);
+				luma_bitmap = mlt_luma_map_cache_put(resource, 0, 0, 0, luma_bitmap, luma_width, luma_height);
 			}
 
 			// Set the transition properties
 			mlt_properties_set_int( properties, "width", luma_width );
 			mlt_properties_set_int( properties, "height", luma_height );
 			mlt_properties_set( properties, "_resource", orig_resource );
-			mlt_properties_set_data( properties, "bitmap", luma_bitmap, luma_width * luma_height * 2, mlt_pool_release, NULL );
+			mlt_properties_set_data( properties, "bitmap", luma_bitmap, luma_width * luma_height * 2, mlt_luma_map_cache_release, NULL );
 			mlt_properties_clear(properties, "producer");
 		}
 		else if (!*resource) 
@@ -420,6 +611,16 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 		    mlt_properties_set_data( properties, "bitmap", luma_bitmap, 0, mlt_pool_release, NULL );
 			mlt_properties_clear(properties, "producer");
 		}
+		else if (!producer && (luma_bitmap = mlt_luma_map_cache_get(still_key, &cached_width, &cached_height, 0)))
+		{
+			// A still image already loaded by another luma transition
+			luma_width = cached_width;
+			luma_height = cached_height;
+			mlt_properties_set_int( properties, "width", luma_width );
+			mlt_properties_set_int( properties, "height", luma_height );
+			mlt_properties_set( properties, "_resource", resource );
+			mlt_properties_set_data( properties, "bitmap", luma_bitmap, luma_width * luma_height * 2, mlt_luma_map_cache_release, NULL );
+		}
 		else
 		{
 			if (!producer || !current_resource || strcmp(resource, current_resource)) {
@@ -474,13 +675,16 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 								mlt_properties_get_int(MLT_FRAME_PROPERTIES(luma_frame), "full_luma"));
 						} else {
 							mlt_luma_map_from_yuv422(luma_image, &luma_bitmap, luma_width, luma_height);
+							// Still images are shared with other transitions
+							luma_bitmap = mlt_luma_map_cache_put(still_key, 0, 0, 0, luma_bitmap, luma_width, luma_height);
 						}
 					}
 					
 					// Set the transition properties
 					mlt_properties_set_int( properties, "width", luma_width );
 					mlt_properties_set_int( properties, "height", luma_height );
-					mlt_properties_set_data( properties, "bitmap", luma_bitmap, luma_width * luma_height * 2, mlt_pool_release, NULL );
+					mlt_properties_set_data( properties, "bitmap", luma_bitmap, luma_width * luma_height * 2,
+						is_clip ? mlt_pool_release : mlt_luma_map_cache_release, NULL );
 
 					// Cleanup the luma frame
 					mlt_frame_close( luma_frame );
@@ -496,6 +700,7 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 				}
 			}
 		}
+		free( still_key );
 	}
 
 	// Arbitrary composite defaults
@@ -532,16 +737,21 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 		mix = reverse ? 1 - mix : mix;
 		frame_delta *= reverse ? -1.0 : 1.0;
 		// Composite the frames using a luma map
-		luma_composite( !invert ? a_frame : b_frame, !invert ? b_frame : a_frame, luma_width, luma_height, luma_bitmap, mix, frame_delta,
-			luma_softness, progressive ? -1 : top_field_first, width, height, invert );
+		if ( luma_composite( !invert ? a_frame : b_frame, !invert ? b_frame : a_frame, luma_width, luma_height, luma_bitmap, mix, frame_delta,
+			luma_softness, progressive ? -1 : top_field_first, width, height, invert, format ) )
+			mlt_log_error( MLT_TRANSITION_SERVICE( transition ), "cannot get the frames in yuv422p16 or yuv422\n" );
 	}
 	else
 	{
 		mix = ( reverse || invert ) ? 1 - mix : mix;
 		invert = 0;
 		// Dissolve the frames using the time offset for mix value
-		dissolve_yuv( a_frame, b_frame, mix, *width, *height, threads, alpha_over );
+		if ( dissolve_yuv( a_frame, b_frame, mix, *width, *height, threads, alpha_over, format ) )
+			mlt_log_error( MLT_TRANSITION_SERVICE( transition ), "cannot get the frames in yuv422p16 or yuv422\n" );
 	}
+	// The alpha channels were blended in place
+	mlt_properties_set_data( a_props, "_alpha_summary", NULL, 0, NULL, NULL );
+	mlt_properties_set_data( b_props, "_alpha_summary", NULL, 0, NULL, NULL );
 	if (producer) {
 		mlt_service_unlock( MLT_TRANSITION_SERVICE( transition ) );
 	}
@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include "transition_mix.h"
+
 #include <framework/mlt_transition.h>
 #include <framework/mlt_frame.h>
 #include <framework/mlt_log.h>
@@ -29,84 +31,203 @@
 #define MAX_CHANNELS (6)
 #define MAX_SAMPLES  (192000)
 #define SAMPLE_BYTES(samples, channels) ((samples) * (channels) * sizeof(float))
-#define MAX_BYTES    SAMPLE_BYTES( MAX_SAMPLES, MAX_CHANNELS )
+
+#if defined(__GNUC__)
+typedef float sample_vector __attribute__((vector_size(16)));
+#endif
+
+/** A ring of interleaved 32-bit float samples.
+ *
+ * Samples are appended at the end and consumed from the start, so neither
+ * buffering nor consuming moves the samples already held. Only the audio pull
+ * of the transition touches a ring, which needs no locking.
+ */
+
+typedef struct
+{
+	float *data;
+	int size;       // capacity in floats
+	int channels;
+	int capacity;   // capacity in samples for the current channel count
+	int start;      // index of the oldest sample
+	int count;      // number of samples held
+} sample_ring;
 
 typedef struct transition_mix_s
 {
 	mlt_transition parent;
 	float src_buffer[MAX_SAMPLES *  MAX_CHANNELS];
 	float dest_buffer[MAX_SAMPLES * MAX_CHANNELS];
-	int src_buffer_count;
-	int dest_buffer_count;
+	sample_ring src;
+	sample_ring dest;
 } *transition_mix;
 
-static void mix_audio( double weight_start, double weight_end, float *buffer_a,
-	float *buffer_b, int channels_a, int channels_b, int channels_out, int samples )
+static void ring_init( sample_ring *ring, float *data, int size )
 {
-	int i, j;
-	double a, b, v;
+	memset( ring, 0, sizeof( *ring ) );
+	ring->data = data;
+	ring->size = size;
+}
+
+static void ring_consume( sample_ring *ring, int samples )
+{
+	samples = MIN( samples, ring->count );
+	ring->count -= samples;
+	ring->start = ring->count ? ( ring->start + samples ) % ring->capacity : 0;
+}
+
+/** Get the contiguous run of samples that starts at offset.
+ * \return the number of samples in the run
+ */
+
+static int ring_span( sample_ring *ring, int offset, float **data )
+{
+	int index = ( ring->start + offset ) % ring->capacity;
+	*data = ring->data + index * ring->channels;
+	return MIN( ring->count - offset, ring->capacity - index );
+}
 
-	// Compute a smooth ramp over start to end
-	double mix = weight_start;
-	double mix_step = ( weight_end - weight_start ) / samples;
+static void ring_write( mlt_transition transition, sample_ring *ring, const char *name,
+	const float *buffer, int channels, int samples )
+{
+	int end, run;
 
-	for ( i = 0; i < samples; i++ )
+	// A change of layout invalidates whatever is buffered.
+	if ( channels != ring->channels )
 	{
-		for ( j = 0; j < channels_out; j++ )
+		ring->channels = channels;
+		ring->capacity = ring->size / channels;
+		ring->start = ring->count = 0;
+	}
+
+	// Prevent overflow by discarding the oldest samples.
+	if ( samples > ring->capacity )
+	{
+		buffer += ( samples - ring->capacity ) * channels;
+		samples = ring->capacity;
+	}
+	if ( ring->count + samples > ring->capacity )
+	{
+		mlt_log_verbose( MLT_TRANSITION_SERVICE(transition), "buffer overflow: %s_buffer_count %d\n",
+			name, ring->count );
+		ring_consume( ring, ring->count + samples - ring->capacity );
+	}
+
+	end = ( ring->start + ring->count ) % ring->capacity;
+	run = MIN( samples, ring->capacity - end );
+	memcpy( ring->data + end * channels, buffer, SAMPLE_BYTES( run, channels ) );
+	memcpy( ring->data, buffer + run * channels, SAMPLE_BYTES( samples - run, channels ) );
+	ring->count += samples;
+}
+
+/** Copy the oldest samples out of the ring, keeping the first channels of each.
+*/
+
+static void ring_read( sample_ring *ring, float *buffer, int channels, int samples )
+{
+	int offset, run, i;
+	float *data;
+
+	for ( offset = 0; offset < samples; offset += run )
+	{
+		run = MIN( ring_span( ring, offset, &data ), samples - offset );
+		if ( channels == ring->channels )
+		{
+			memcpy( buffer + offset * channels, data, SAMPLE_BYTES( run, channels ) );
+		}
+		else
 		{
-			a = (double) buffer_a[ i * channels_a + j ];
-			b = (double) buffer_b[ i * channels_b + j ];
-			v = mix * b + (1.0 - mix) * a;
-			buffer_a[ i * channels_a + j ] = v;
+			for ( i = 0; i < run; i++ )
+				memcpy( buffer + ( offset + i ) * channels, data + i * ring->channels, SAMPLE_BYTES( 1, channels ) );
 		}
-		mix += mix_step;
 	}
 }
 
-static void sum_audio( double weight_start, double weight_end, float *buffer_a,
-	float *buffer_b, int channels_a, int channels_b, int channels_out, int samples )
+void mix_audio_block( float *dest, int dest_channels, const float *src, int src_channels,
+	int channels, int samples, double weight, double step, int sum )
 {
-	int i, j;
-	double a, b;
+	// dest keeps all of its level when summing and fades out against src otherwise.
+	float fade = sum ? 0.0f : 1.0f;
+	int i = 0, j = 0;
 
-	// Compute a smooth ramp over start to end
-	double mix = weight_start;
-	double mix_step = ( weight_end - weight_start ) / samples;
+#if defined(__GNUC__)
+	if ( channels > 0 && 4 % channels == 0 && dest_channels == channels && src_channels == channels )
+	{
+		// A vector holds whole samples, so each lane needs the weight of its own sample.
+		int per_vector = 4 / channels;
+		sample_vector lane, d, s, w;
 
-	for ( i = 0; i < samples; i++ )
+		for ( j = 0; j < 4; j++ )
+			lane[j] = j / channels * step;
+		for ( ; i + per_vector <= samples; i += per_vector )
+		{
+			w = lane + (float) ( weight + i * step );
+			memcpy( &d, dest + i * channels, sizeof( d ) );
+			memcpy( &s, src + i * channels, sizeof( s ) );
+			d = d * ( 1.0f - fade * w ) + w * s;
+			memcpy( dest + i * channels, &d, sizeof( d ) );
+		}
+	}
+	else if ( channels >= 4 )
 	{
-		for ( j = 0; j < channels_out; j++ )
+		// Wider layouts are vectorised across the channels of each sample.
+		for ( ; i < samples; i++ )
 		{
-			a = (double) buffer_a[ i * channels_a + j ];
-			b = (double) buffer_b[ i * channels_b + j ];
-			buffer_a[ i * channels_a + j ] = mix * b + a;
+			float *d_ptr = dest + i * dest_channels;
+			const float *s_ptr = src + i * src_channels;
+			float w = weight + i * step;
+			sample_vector d, s;
+
+			for ( j = 0; j + 4 <= channels; j += 4 )
+			{
+				memcpy( &d, d_ptr + j, sizeof( d ) );
+				memcpy( &s, s_ptr + j, sizeof( s ) );
+				d = d * ( 1.0f - fade * w ) + w * s;
+				memcpy( d_ptr + j, &d, sizeof( d ) );
+			}
+			for ( ; j < channels; j++ )
+				d_ptr[j] = d_ptr[j] * ( 1.0f - fade * w ) + w * s_ptr[j];
 		}
-		mix += mix_step;
+	}
+#endif
+
+	for ( ; i < samples; i++ )
+	{
+		float *d_ptr = dest + i * dest_channels;
+		const float *s_ptr = src + i * src_channels;
+		float w = weight + i * step;
+
+		for ( j = 0; j < channels; j++ )
+			d_ptr[j] = d_ptr[j] * ( 1.0f - fade * w ) + w * s_ptr[j];
 	}
 }
 
 // This filter uses an inline low pass filter to allow mixing without volume hacking.
-static void combine_audio( double weight, float *buffer_a, float *buffer_b,
-	int channels_a, int channels_b, int channels_out, int samples )
+static void combine_audio( double weight, float *buffer_a, sample_ring *ring_b, int channels_out, int samples )
 {
-	int i, j;
+	int i, j, offset, run;
 	double Fc = 0.5;
 	double B = exp(-2.0 * M_PI * Fc);
 	double A = 1.0 - B;
 	double a, b, v;
 	double v_prev[MAX_CHANNELS];
+	float *buffer_b;
 
 	for ( j = 0; j < channels_out; j++ )
 		v_prev[j] = (double) buffer_a[j];
 
-	for ( i = 0; i < samples; i++ )
+	for ( offset = 0; offset < samples; offset += run )
 	{
-		for ( j = 0; j < channels_out; j++ )
+		run = MIN( ring_span( ring_b, offset, &buffer_b ), samples - offset );
+		for ( i = 0; i < run; i++ )
 		{
-			a = (double) buffer_a[ i * channels_a + j ];
-			b = (double) buffer_b[ i * channels_b + j ];
-			v = weight * a + b;
-			v_prev[j] = buffer_a[ i * channels_a + j ] = v * A + v_prev[j] * B;
+			for ( j = 0; j < channels_out; j++ )
+			{
+				a = (double) buffer_a[ ( offset + i ) * channels_out + j ];
+				b = (double) buffer_b[ i * ring_b->channels + j ];
+				v = weight * a + b;
+				v_prev[j] = buffer_a[ ( offset + i ) * channels_out + j ] = v * A + v_prev[j] * B;
+			}
 		}
 	}
 }
@@ -132,6 +253,7 @@ static int transition_get_audio( mlt_frame frame_a, void **buffer, mlt_audio_for
 	int frequency_b = *frequency, frequency_a = *frequency;
 	int channels_b = *channels, channels_a = *channels;
 	int samples_b = *samples, samples_a = *samples;
+	int sum = mlt_properties_get_int( MLT_TRANSITION_PROPERTIES(transition), "sum" );
 
 	// We can only mix interleaved 32-bit float.
 	*format = mlt_audio_f32le;
@@ -161,66 +283,35 @@ static int transition_get_audio( mlt_frame frame_a, void **buffer, mlt_audio_for
 	if ( silent )
 		memset( buffer_b, 0, samples_b * channels_b * sizeof( float ) );
 
+	// Buffer the new samples.
+	ring_write( transition, &self->src, "src", buffer_b, channels_b, samples_b );
+	ring_write( transition, &self->dest, "dest", buffer_a, channels_a, samples_a );
+
 	// determine number of samples to process
-	*samples = MIN( self->src_buffer_count + samples_b, self->dest_buffer_count + samples_a );
+	*samples = MIN( self->src.count, self->dest.count );
 	*channels = MIN( MIN( channels_b, channels_a ), MAX_CHANNELS );
 	*frequency = frequency_a;
 
-	// Prevent src buffer overflow by discarding oldest samples.
-	samples_b = MIN( samples_b, MAX_SAMPLES * MAX_CHANNELS / channels_b );
-	size_t bytes = SAMPLE_BYTES( samples_b, channels_b );
-	if ( SAMPLE_BYTES( self->src_buffer_count + samples_b, channels_b ) > MAX_BYTES ) {
-		mlt_log_verbose( MLT_TRANSITION_SERVICE(transition), "buffer overflow: src_buffer_count %d\n",
-					  self->src_buffer_count );
-		self->src_buffer_count = MAX_SAMPLES * MAX_CHANNELS / channels_b - samples_b;
-		memmove( self->src_buffer, &self->src_buffer[MAX_SAMPLES * MAX_CHANNELS - samples_b * channels_b],
-				 SAMPLE_BYTES( samples_b, channels_b ) );
-	}
-	// Buffer new src samples.
-	memcpy( &self->src_buffer[self->src_buffer_count * channels_b], buffer_b, bytes );
-	self->src_buffer_count += samples_b;
-	buffer_b = self->src_buffer;
-
-	// Prevent dest buffer overflow by discarding oldest samples.
-	samples_a = MIN( samples_a, MAX_SAMPLES * MAX_CHANNELS / channels_a );
-	bytes = SAMPLE_BYTES( samples_a, channels_a );
-	if ( SAMPLE_BYTES( self->dest_buffer_count + samples_a, channels_a ) > MAX_BYTES ) {
-		mlt_log_verbose( MLT_TRANSITION_SERVICE(transition), "buffer overflow: dest_buffer_count %d\n",
-					  self->dest_buffer_count );
-		self->dest_buffer_count = MAX_SAMPLES * MAX_CHANNELS / channels_a - samples_a;
-		memmove( self->dest_buffer, &self->dest_buffer[MAX_SAMPLES * MAX_CHANNELS - samples_a * channels_a],
-				 SAMPLE_BYTES( samples_a, channels_a ) );
-	}
-	// Buffer the new dest samples.
-	memcpy( &self->dest_buffer[self->dest_buffer_count * channels_a], buffer_a, bytes );
-	self->dest_buffer_count += samples_a;
-	buffer_a = self->dest_buffer;
+	// The output starts as the dest samples and the src samples are mixed into it.
+	int size = SAMPLE_BYTES( *samples, *channels );
+	float *output = mlt_pool_alloc( size );
+	ring_read( &self->dest, output, *channels, *samples );
 
 	// Do the mixing.
-	if ( mlt_properties_get_int( MLT_TRANSITION_PROPERTIES(transition), "sum" ) )
-	{
-		double mix_start = 1.0, mix_end = 1.0;
-		if ( mlt_properties_get( b_props, "audio.previous_mix" ) )
-			mix_start = mlt_properties_get_double( b_props, "audio.previous_mix" );
-		if ( mlt_properties_get( b_props, "audio.mix" ) )
-			mix_end = mlt_properties_get_double( b_props, "audio.mix" );
-		if ( mlt_properties_get_int( b_props, "audio.reverse" ) )
-		{
-			mix_start = 1.0 - mix_start;
-			mix_end = 1.0 - mix_end;
-		}
-		sum_audio( mix_start, mix_end, buffer_a, buffer_b, channels_a, channels_b, *channels, *samples );
-	}
-	else if ( mlt_properties_get_int( MLT_TRANSITION_PROPERTIES(transition), "combine" ) )
+	if ( !sum && mlt_properties_get_int( MLT_TRANSITION_PROPERTIES(transition), "combine" ) )
 	{
 		double weight = 1.0;
 		if ( mlt_properties_get_int( MLT_FRAME_PROPERTIES( frame_a ), "meta.mixdown" ) )
 			weight = 1.0 - mlt_properties_get_double( MLT_FRAME_PROPERTIES( frame_a ), "meta.volume" );
-		combine_audio( weight, buffer_a, buffer_b, channels_a, channels_b, *channels, *samples );
+		if ( *samples > 0 )
+			combine_audio( weight, output, &self->src, *channels, *samples );
 	}
 	else
 	{
-		double mix_start = 0.5, mix_end = 0.5;
+		double mix_start = sum ? 1.0 : 0.5;
+		double mix_end = mix_start;
+		int offset, run;
+
 		if ( mlt_properties_get( b_props, "audio.previous_mix" ) )
 			mix_start = mlt_properties_get_double( b_props, "audio.previous_mix" );
 		if ( mlt_properties_get( b_props, "audio.mix" ) )
@@ -230,47 +321,44 @@ static int transition_get_audio( mlt_frame frame_a, void **buffer, mlt_audio_for
 			mix_start = 1.0 - mix_start;
 			mix_end = 1.0 - mix_end;
 		}
-		mix_audio( mix_start, mix_end, buffer_a, buffer_b, channels_a, channels_b, *channels, *samples );
+
+		// Compute a smooth ramp over start to end, one contiguous run of the ring at a time.
+		double mix_step = ( mix_end - mix_start ) / MAX( *samples, 1 );
+		for ( offset = 0; offset < *samples; offset += run )
+		{
+			run = MIN( ring_span( &self->src, offset, &buffer_b ), *samples - offset );
+			mix_audio_block( output + offset * *channels, *channels, buffer_b, channels_b, *channels,
+				run, mix_start + offset * mix_step, mix_step, sum );
+		}
 	}
 
 	// Copy the audio into the frame.
-	bytes = SAMPLE_BYTES( *samples, *channels );
-	*buffer = mlt_pool_alloc( bytes );
-	memcpy( *buffer, buffer_a, bytes );
-	mlt_frame_set_audio( frame_a, *buffer, *format, bytes, mlt_pool_release );
+	*buffer = output;
+	mlt_frame_set_audio( frame_a, *buffer, *format, size, mlt_pool_release );
 
 	if ( mlt_properties_get_int( b_props, "_speed" ) == 0 )
 	{
 		// Flush the buffer when paused and scrubbing.
-		samples_b = self->src_buffer_count;
-		samples_a = self->dest_buffer_count;
+		samples_b = self->src.count;
+		samples_a = self->dest.count;
 	}
 	else
 	{
 		// Determine the maximum amount of latency permitted in the buffer.
 		int max_latency = CLAMP( *frequency / 1000, 0, MAX_SAMPLES ); // samples in 1ms
 		// samples_b becomes the new target src buffer count.
-		samples_b = CLAMP( self->src_buffer_count - *samples, 0, max_latency );
+		samples_b = CLAMP( self->src.count - *samples, 0, max_latency );
 		// samples_b becomes the number of samples to consume: difference between actual and the target.
-		samples_b = self->src_buffer_count - samples_b;
+		samples_b = self->src.count - samples_b;
 		// samples_a becomes the new target dest buffer count.
-		samples_a = CLAMP( self->dest_buffer_count - *samples, 0, max_latency );
+		samples_a = CLAMP( self->dest.count - *samples, 0, max_latency );
 		// samples_a becomes the number of samples to consume: difference between actual and the target.
-		samples_a = self->dest_buffer_count - samples_a;
+		samples_a = self->dest.count - samples_a;
 	}
 
-	// Consume the src buffer.
-	self->src_buffer_count -= samples_b;
-	if ( self->src_buffer_count ) {
-		memmove( self->src_buffer, &self->src_buffer[samples_b * channels_b],
-			SAMPLE_BYTES( self->src_buffer_count, channels_b ));
-	}
-	// Consume the dest buffer.
-	self->dest_buffer_count -= samples_a;
-	if ( self->dest_buffer_count > 0 ) {
-		memmove( self->dest_buffer, &self->dest_buffer[samples_a * channels_a],
-			SAMPLE_BYTES( self->dest_buffer_count, channels_a ));
-	}
+	// Consume the buffers.
+	ring_consume( &self->src, samples_b );
+	ring_consume( &self->dest, samples_a );
 
 	return error;
 }
@@ -386,6 +474,8 @@ mlt_transition transition_mix_init( mlt_profile profile, mlt_service_type type,
 	if ( mix && transition && !mlt_transition_init( transition, mix ) )
 	{
 		mix->parent = transition;
+		ring_init( &mix->src, mix->src_buffer, MAX_SAMPLES * MAX_CHANNELS );
+		ring_init( &mix->dest, mix->dest_buffer, MAX_SAMPLES * MAX_CHANNELS );
 		transition->close = transition_close;
 		transition->process = transition_process;
 		if ( arg )
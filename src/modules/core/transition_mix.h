@@ -0,0 +1,35 @@
+/*
+ * transition_mix.h -- mix two audio streams
+ * Copyright (C) 2003-2018 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _TRANSITION_MIX_H_
+#define _TRANSITION_MIX_H_
+
+/** Blend a block of 32-bit float samples from src into dest.
+ *
+ * The first \p channels channels of each sample are processed; the strides of the
+ * two buffers may differ. The weight applied to src ramps linearly, starting at
+ * \p weight for the first sample and advancing by \p step per sample. When \p sum
+ * is set, the weighted src is added to dest, otherwise dest is crossfaded to src.
+ * Planar audio is handled by calling this once per plane with one channel.
+ */
+
+extern void mix_audio_block( float *dest, int dest_channels, const float *src, int src_channels,
+	int channels, int samples, double weight, double step, int sum );
+
+#endif
@@ -417,6 +417,7 @@ MLT_REPOSITORY
 	char dirname[PATH_MAX];
 	snprintf(dirname, PATH_MAX, "%s/frei0r/blacklist.txt", mlt_environment("MLT_DATA"));
 	mlt_properties blacklist = mlt_properties_load(dirname);
+	mlt_repository_watch(repository, dirname);
 
 	// Load a param name map into global properties for backwards compatibility when
 	// param names change and setting frei0r params by name instead of index.
@@ -438,6 +439,7 @@ MLT_REPOSITORY
 			snprintf(dirname, PATH_MAX, "%s", directory);
 		else
 			snprintf(dirname, PATH_MAX, "%s%s", getenv("HOME"), strchr(directory, '/'));
+		mlt_repository_watch(repository, dirname);
 		mlt_properties_dir_list(direntries, dirname ,"*" LIBSUF, 1);
 
 		for (i = 0; i < mlt_properties_count(direntries); i++) {
@@ -28,7 +28,7 @@
 #include <stdlib.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 
-static int filter_scale( mlt_frame this, uint8_t **image, mlt_image_format *format, int iwidth, int iheight, int owidth, int oheight )
+static int filter_scale( mlt_frame this, uint8_t **image, mlt_image_format *format, int iwidth, int iheight, int istride, int owidth, int oheight )
 {
 	// Get the properties
 	mlt_properties properties = MLT_FRAME_PROPERTIES( this );
@@ -58,7 +58,6 @@ static int filter_scale( mlt_frame this, uint8_t **image, mlt_image_format *form
 		uint8_t *output = mlt_pool_alloc( size );
 
 		// Calculate strides
-		int istride = iwidth * 2;
 		int ostride = owidth * 2;
 
 		yuv422_scale_simple( output, owidth, oheight, ostride, *image, iwidth, iheight, istride, interp );
@@ -80,7 +79,7 @@ static int filter_scale( mlt_frame this, uint8_t **image, mlt_image_format *form
 			uint8_t *output = mlt_pool_alloc( size );
 			GdkPixbuf *pixbuf = gdk_pixbuf_new_from_data( *image, GDK_COLORSPACE_RGB,
 				( *format == mlt_image_rgb24a || *format == mlt_image_opengl ), 8, iwidth, iheight,
-				iwidth * bpp, NULL, NULL );
+				istride, NULL, NULL );
 			GdkPixbuf *scaled = gdk_pixbuf_scale_simple( pixbuf, owidth, oheight, interp );
 			g_object_unref( pixbuf );
 
@@ -19,6 +19,7 @@
 
 #include <framework/mlt_producer.h>
 #include <framework/mlt_frame.h>
+#include <framework/mlt_image.h>
 #include <framework/mlt_cache.h>
 #include <framework/mlt_log.h>
 #include <framework/mlt_tokeniser.h>
@@ -65,6 +66,25 @@ struct producer_pixbuf_s
 	mlt_image_format format;
 };
 
+/** An image that holds on to the buffers cached by the producer
+*/
+
+typedef struct
+{
+	struct mlt_image_s image;
+	mlt_cache_item image_cache;
+	mlt_cache_item alpha_cache;
+}
+cached_image;
+
+static void cached_image_close( void *ptr )
+{
+	cached_image *self = ptr;
+	mlt_cache_item_close( self->image_cache );
+	mlt_cache_item_close( self->alpha_cache );
+	free( self );
+}
+
 static void load_filenames( producer_pixbuf self, mlt_properties producer_properties );
 static int refresh_pixbuf( producer_pixbuf self, mlt_frame frame );
 static int producer_get_frame( mlt_producer parent, mlt_frame_ptr frame, int index );
@@ -711,30 +731,24 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 	*height = self->height;
 	*format = self->format;
 
-	// NB: Cloning is necessary with this producer (due to processing of images ahead of use)
-	// The fault is not in the design of mlt, but in the implementation of the pixbuf producer...
+	// The cached buffers are replaced rather than modified when the image is refreshed,
+	// so the frame can share them read-only for as long as it holds their cache items
 	if ( self->image )
 	{
-		// Clone the image
-		int image_size = mlt_image_format_size( self->format, self->width, self->height, NULL );
-		uint8_t *image_copy = mlt_pool_alloc( image_size );
-		// We use height-1 because mlt_image_format_size() uses height + 1.
-		// XXX Remove -1 when mlt_image_format_size() is changed.
-		memcpy( image_copy, self->image,
-			mlt_image_format_size( self->format, self->width, self->height - 1, NULL ) );
-		// Now update properties so we free the copy after
-		mlt_frame_set_image( frame, image_copy, image_size, mlt_pool_release );
-		// We're going to pass the copy on
-		*buffer = image_copy;
+		cached_image *shared = calloc( 1, sizeof( cached_image ) );
+		mlt_image_set_values( &shared->image, self->image, self->format, self->width, self->height );
+		shared->image.alpha = self->alpha;
+		shared->image.ref_count = 1;
+		shared->image.close = cached_image_close;
+		shared->image_cache = self->image_cache;
+		shared->alpha_cache = self->alpha_cache;
+		self->image_cache = NULL;
+		self->alpha_cache = NULL;
+		mlt_frame_set_shared_image( frame, &shared->image );
+		mlt_image_close( &shared->image );
+		*buffer = self->image;
 		mlt_log_debug( MLT_PRODUCER_SERVICE( &self->parent ), "%dx%d (%s)\n",
 			self->width, self->height, mlt_image_format_name( *format ) );
-		// Clone the alpha channel
-		if ( self->alpha )
-		{
-			image_copy = mlt_pool_alloc( self->width * self->height );
-			memcpy( image_copy, self->alpha, self->width * self->height );
-			mlt_frame_set_alpha( frame, image_copy, self->width * self->height, mlt_pool_release );
-		}
 	}
 	else
 	{
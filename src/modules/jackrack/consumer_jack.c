@@ -22,10 +22,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <sys/time.h>
 #include <unistd.h>
 #include <jack/jack.h>
-#include <jack/ringbuffer.h>
 
 #define BUFFER_LEN (204800 * 6)
 
@@ -52,7 +52,8 @@ struct consumer_jack_s
 	pthread_mutex_t refresh_mutex;
 	int refresh_count;
 	int counter;
-	jack_ringbuffer_t **ringbuffers;
+	int channels;
+	_Atomic( mlt_audio_ring* ) ringbuffers;
 	jack_port_t **ports;
 };
 
@@ -197,17 +198,17 @@ static int consumer_stop( mlt_consumer parent )
 		// Cleanup JACK
 		if ( self->playing )
 			jack_deactivate( self->jack );
-		if ( self->ringbuffers )
+		mlt_audio_ring *ringbuffers = atomic_exchange( &self->ringbuffers, NULL );
+		if ( ringbuffers )
 		{
-			int n = mlt_properties_get_int( MLT_CONSUMER_PROPERTIES( parent ), "channels" );
+			int n = self->channels;
 			while ( n-- )
 			{
-				jack_ringbuffer_free( self->ringbuffers[n] );
+				mlt_audio_ring_close( ringbuffers[n] );
 				jack_port_unregister( self->jack, self->ports[n] );
 			}
-			mlt_pool_release( self->ringbuffers );
+			mlt_pool_release( ringbuffers );
 		}
-		self->ringbuffers = NULL;
 		if ( self->ports )
 			mlt_pool_release( self->ports );
 		self->ports = NULL;
@@ -226,28 +227,20 @@ static int jack_process( jack_nframes_t frames, void * data )
 {
 	int error = 0;
 	consumer_jack self = (consumer_jack) data;
-	mlt_properties properties = MLT_CONSUMER_PROPERTIES( &self->parent );
-	int channels = mlt_properties_get_int( properties, "channels" );
+	mlt_audio_ring *ringbuffers = atomic_load_explicit( &self->ringbuffers, memory_order_acquire );
 	int i;
 
-	if ( !self->ringbuffers )
+	if ( !ringbuffers )
 		return 1;
 
-	for ( i = 0; i < channels; i++ )
-	{
-		size_t jack_size = ( frames * sizeof(float) );
-		size_t ring_size = jack_ringbuffer_read_space( self->ringbuffers[i] );
-		char *dest = jack_port_get_buffer( self->ports[i], frames );
-
-		jack_ringbuffer_read( self->ringbuffers[i], dest, ring_size < jack_size ? ring_size : jack_size );
-		if ( ring_size < jack_size )
-			memset( dest + ring_size, 0, jack_size - ring_size );
-	}
+	// The rings pad any shortfall with silence
+	for ( i = 0; i < self->channels; i++ )
+		mlt_audio_ring_read( ringbuffers[i], jack_port_get_buffer( self->ports[i], frames ), frames );
 
 	return error;
 }
 
-static void initialise_jack_ports( consumer_jack self )
+static int initialise_jack_ports( consumer_jack self )
 {
 	int i;
 	char mlt_name[20], con_name[30];
@@ -256,9 +249,26 @@ static void initialise_jack_ports( consumer_jack self )
 
 	// Propagate these for the Jack processing callback
 	int channels = mlt_properties_get_int( properties, "channels" );
+	mlt_audio_ring *ringbuffers = mlt_pool_alloc( sizeof( mlt_audio_ring ) * channels );
+	self->channels = channels;
 
 	// Allocate buffers and ports
-	self->ringbuffers = mlt_pool_alloc( sizeof( jack_ringbuffer_t *) * channels );
+	for ( i = 0; ringbuffers && i < channels; i++ )
+	{
+		ringbuffers[i] = mlt_audio_ring_new( sizeof(float), BUFFER_LEN );
+		if ( !ringbuffers[i] )
+		{
+			while ( i-- )
+				mlt_audio_ring_close( ringbuffers[i] );
+			mlt_pool_release( ringbuffers );
+			ringbuffers = NULL;
+		}
+	}
+	if ( !ringbuffers )
+	{
+		mlt_log_error( MLT_CONSUMER_SERVICE( &self->parent ), "failed to allocate the audio buffers\n" );
+		return 1;
+	}
 	self->ports = mlt_pool_alloc( sizeof(jack_port_t *) * channels );
 
 	// Start Jack processing - required before registering ports
@@ -270,12 +280,14 @@ static void initialise_jack_ports( consumer_jack self )
 	// Register Jack ports
 	for ( i = 0; i < channels; i++ )
 	{
-		self->ringbuffers[i] = jack_ringbuffer_create( BUFFER_LEN * sizeof(float) );
 		snprintf( mlt_name, sizeof( mlt_name ), "out_%d", i + 1 );
 		self->ports[i] = jack_port_register( self->jack, mlt_name, JACK_DEFAULT_AUDIO_TYPE,
 				JackPortIsOutput | JackPortIsTerminal, 0 );
 	}
 
+	// The processing callback starts reading once the ports and rings exist
+	atomic_store_explicit( &self->ringbuffers, ringbuffers, memory_order_release );
+
 	// Establish connections
 	for ( i = 0; i < channels; i++ )
 	{
@@ -297,6 +309,8 @@ static void initialise_jack_ports( consumer_jack self )
 	}
 	if ( ports )
 		jack_free( ports );
+
+	return 0;
 }
 
 static int consumer_play_audio( consumer_jack self, mlt_frame frame, int init_audio, int *duration )
@@ -325,14 +339,14 @@ static int consumer_play_audio( consumer_jack self, mlt_frame frame, int init_au
 	if ( init_audio == 1 )
 	{
 		self->playing = 0;
-		initialise_jack_ports( self );
-		init_audio = 0;
+		// Play without audio if the ports cannot be set up
+		init_audio = initialise_jack_ports( self ) ? 2 : 0;
 	}
 
 	if ( init_audio == 0 && ( speed == 1.0 || speed == 0.0 ) )
 	{
+		mlt_audio_ring *ringbuffers = atomic_load( &self->ringbuffers );
 		int i;
-		size_t mlt_size = samples * sizeof(float);
 		float volume = mlt_properties_get_double( properties, "volume" );
 
 		if ( !scrub && speed == 0.0 )
@@ -346,13 +360,14 @@ static int consumer_play_audio( consumer_jack self, mlt_frame frame, int init_au
 				*p++ *= volume;
 		}
 
-		// Write into output ringbuffer
-		for ( i = 0; i < channels; i++ )
-		{
-			size_t ring_size = jack_ringbuffer_write_space( self->ringbuffers[i] );
-			if ( ring_size >= mlt_size )
-				jack_ringbuffer_write( self->ringbuffers[i], (char*)( buffer + i * samples ), mlt_size );
-		}
+		// Write into output ringbuffer, all channels or none to keep them aligned
+		if ( mlt_audio_ring_space( ringbuffers[0] ) >= samples )
+			for ( i = 0; i < self->channels; i++ )
+				mlt_audio_ring_write( ringbuffers[i], i < channels ? buffer + i * samples : NULL, samples );
+
+		// Report the state of the audio output for monitoring
+		mlt_properties_set_int64( properties, "audio_underruns", mlt_audio_ring_underruns( ringbuffers[0] ) );
+		mlt_properties_set_double( properties, "audio_latency", 1000.0 * mlt_audio_ring_available( ringbuffers[0] ) / frequency );
 	}
 
 	return init_audio;
@@ -182,8 +182,13 @@ MLT_REPOSITORY
 {
 #ifdef GPL
 	GSList *list;
+	int i;
 	g_jackrack_plugin_mgr = plugin_mgr_new();
 
+	// The LADSPA plugins are found at run time.
+	for ( i = 0; i < mlt_properties_count( g_jackrack_plugin_mgr->paths ); i++ )
+		mlt_repository_watch( repository, mlt_properties_get_name( g_jackrack_plugin_mgr->paths, i ) );
+
 	for ( list = g_jackrack_plugin_mgr->all_plugins; list; list = g_slist_next( list ) )
 	{
 		plugin_desc_t *desc = (plugin_desc_t *) list->data;
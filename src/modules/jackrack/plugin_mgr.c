@@ -167,6 +167,7 @@ plugin_mgr_get_dir_plugins (plugin_mgr_t * plugin_mgr, const char * dir)
   int err;
   size_t dirlen;
   
+  mlt_properties_set (plugin_mgr->paths, dir, "1");
   dir_stream = opendir (dir);
   if (!dir_stream)
     {
@@ -263,9 +264,11 @@ plugin_mgr_new ()
   pm->all_plugins = NULL;  
   pm->plugins = NULL;
   pm->plugin_count = 0;
+  pm->paths = mlt_properties_new ();
 
   snprintf (dirname, PATH_MAX, "%s/jackrack/blacklist.txt", mlt_environment ("MLT_DATA"));
   pm->blacklist = mlt_properties_load (dirname);
+  mlt_properties_set (pm->paths, dirname, "1");
   plugin_mgr_get_path_plugins (pm);
   
   if (!pm->all_plugins)
@@ -287,6 +290,7 @@ plugin_mgr_destroy (plugin_mgr_t * plugin_mgr)
   g_slist_free (plugin_mgr->plugins);
   g_slist_free (plugin_mgr->all_plugins);
   mlt_properties_close(plugin_mgr->blacklist);
+  mlt_properties_close(plugin_mgr->paths);
   free (plugin_mgr);
 }
 
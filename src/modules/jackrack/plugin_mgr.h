@@ -39,6 +39,7 @@ struct _plugin_mgr
   GSList * plugins;
   unsigned long plugin_count;
   mlt_properties blacklist;
+  mlt_properties paths; /* the files and directories that were scanned */
 };
 
 struct _ui;
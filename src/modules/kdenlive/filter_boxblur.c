@@ -21,71 +21,170 @@
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
 #include <framework/mlt_profile.h>
+#include <framework/mlt_slices.h>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 
-static void PreCompute(uint8_t *image, int32_t *rgba, int width, int height)
+/* The blur is separable: a horizontal running sum over each row followed by
+ * a vertical running sum over each column. Like the summed-area table this
+ * replaces, the window of a pixel spans (clamp(x - radius), clamp(x + radius)]
+ * on each axis and the divisor is always the full window size. The row sums
+ * are kept at full precision and the result is divided once, so the output
+ * is the same as the table's. The four channels of a pixel are accumulated
+ * together in one vector.
+ */
+
+#if defined(__GNUC__)
+typedef uint32_t rgba_sum __attribute__((vector_size(16)));
+#define RGBA_LOAD(p) ((rgba_sum) { (p)[0], (p)[1], (p)[2], (p)[3] })
+#else
+typedef struct { uint32_t v[4]; } rgba_sum;
+#endif
+
+typedef struct
 {
-	register int x, y, z;
-	int32_t pts[4];
-	
-	for (y = 0; y < height; y++)
+	uint8_t *image;
+	rgba_sum *rows;
+	uint8_t *output;
+	int width;
+	int height;
+	int boxw;
+	int boxh;
+} boxblur_desc;
+
+static inline void rgba_add( rgba_sum *sum, const uint8_t *p )
+{
+#if defined(__GNUC__)
+	*sum += RGBA_LOAD( p );
+#else
+	int z;
+	for ( z = 0; z < 4; z++ ) sum->v[z] += p[z];
+#endif
+}
+
+static inline void rgba_sub( rgba_sum *sum, const uint8_t *p )
+{
+#if defined(__GNUC__)
+	*sum -= RGBA_LOAD( p );
+#else
+	int z;
+	for ( z = 0; z < 4; z++ ) sum->v[z] -= p[z];
+#endif
+}
+
+static inline void rgba_add_sum( rgba_sum *sum, const rgba_sum *p )
+{
+#if defined(__GNUC__)
+	*sum += *p;
+#else
+	int z;
+	for ( z = 0; z < 4; z++ ) sum->v[z] += p->v[z];
+#endif
+}
+
+static inline void rgba_sub_sum( rgba_sum *sum, const rgba_sum *p )
+{
+#if defined(__GNUC__)
+	*sum -= *p;
+#else
+	int z;
+	for ( z = 0; z < 4; z++ ) sum->v[z] -= p->v[z];
+#endif
+}
+
+static inline void rgba_store( uint8_t *p, const rgba_sum *sum, float mul )
+{
+	int z;
+#if defined(__GNUC__)
+	for ( z = 0; z < 4; z++ ) p[z] = (*sum)[z] * mul;
+#else
+	for ( z = 0; z < 4; z++ ) p[z] = sum->v[z] * mul;
+#endif
+}
+
+static void slice_range( int total, int idx, int jobs, int *start, int *end )
+{
+	int size = ( total + jobs - 1 ) / jobs;
+	*start = MIN( idx * size, total );
+	*end = MIN( *start + size, total );
+}
+
+static int blur_rows_slice( int id, int idx, int jobs, void *cookie )
+{
+	boxblur_desc *desc = (boxblur_desc*) cookie;
+	int width = desc->width;
+	int radius = desc->boxw;
+	int y, y_start, y_end;
+
+	slice_range( desc->height, idx, jobs, &y_start, &y_end );
+	for ( y = y_start; y < y_end; y++ )
 	{
-		for (x = 0; x < width; x++)
+		const uint8_t *src = desc->image + y * width * 4;
+		rgba_sum *dst = desc->rows + y * width;
+		rgba_sum sum;
+		int lo = 0, hi = 0;
+		int x;
+
+		memset( &sum, 0, sizeof(sum) );
+		for ( x = 0; x < width; x++ )
 		{
-			pts[0] = image[0];
-			pts[1] = image[1];
-			pts[2] = image[2];
-			pts[3] = image[3];
-			for (z = 0; z < 4; z++)
-			{
-				if (x > 0) pts[z] += rgba[-4];
-				if (y > 0) pts[z] += rgba[width * -4];
-				if (x>0 && y>0) pts[z] -= rgba[(width + 1) * -4];
-				*rgba++ = pts[z];
-			}
-			image += 4;
+			int x_hi = CLAMP( x + radius, 0, width - 1 );
+			int x_lo = CLAMP( x - radius, 0, width - 1 );
+			while ( hi < x_hi )
+				rgba_add( &sum, src + ( ++hi ) * 4 );
+			while ( lo < x_lo )
+				rgba_sub( &sum, src + ( ++lo ) * 4 );
+			dst[x] = sum;
 		}
 	}
+	return 0;
 }
 
-static inline int32_t GetRGBA(int32_t *rgba, unsigned int w, unsigned int h, unsigned int x, int offsetx, unsigned int y, int offsety, unsigned int z)
+static int blur_columns_slice( int id, int idx, int jobs, void *cookie )
 {
-	int xtheo = x + offsetx;
-	int ytheo = y + offsety;
-	return rgba[4 * (CLAMP(xtheo, 0, w-1) + CLAMP(ytheo, 0, h-1) * w) + z];
-}
+	boxblur_desc *desc = (boxblur_desc*) cookie;
+	int width = desc->width;
+	int height = desc->height;
+	int radius = desc->boxh;
+	float mul = 1.f / ( ( desc->boxw * 2 ) * ( radius * 2 ) );
+	int x_start, x_end, x, y;
+	int lo = 0, hi = 0;
+	rgba_sum *sums;
 
-static void DoBoxBlur(uint8_t *image, int32_t *rgba, unsigned int width, unsigned int height, unsigned int boxw, unsigned int boxh)
-{
-	register int x, y;
-	float mul = 1.f / ((boxw*2) * (boxh*2));
+	slice_range( width, idx, jobs, &x_start, &x_end );
+	if ( x_start >= x_end )
+		return 0;
 
-	for (y = 0; y < height; y++)
+	// One running sum per column of this slice, advanced a row at a time
+	sums = mlt_pool_alloc( ( x_end - x_start ) * sizeof(*sums) );
+	memset( sums, 0, ( x_end - x_start ) * sizeof(*sums) );
+	for ( y = 0; y < height; y++ )
 	{
-		for (x = 0; x < width; x++)
+		uint8_t *dst = desc->output + ( y * width + x_start ) * 4;
+		int y_hi = CLAMP( y + radius, 0, height - 1 );
+		int y_lo = CLAMP( y - radius, 0, height - 1 );
+
+		while ( hi < y_hi )
+		{
+			const rgba_sum *add = desc->rows + ( ++hi ) * width + x_start;
+			for ( x = 0; x < x_end - x_start; x++ )
+				rgba_add_sum( &sums[x], &add[x] );
+		}
+		while ( lo < y_lo )
 		{
-			*image++ = (GetRGBA(rgba, width, height, x, +boxw, y, +boxh, 0)
-			          + GetRGBA(rgba, width, height, x, -boxw, y, -boxh, 0)
-			          - GetRGBA(rgba, width, height, x, -boxw, y, +boxh, 0)
-			          - GetRGBA(rgba, width, height, x, +boxw, y, -boxh, 0)) * mul;
-			*image++ = (GetRGBA(rgba, width, height, x, +boxw, y, +boxh, 1)
-			          + GetRGBA(rgba, width, height, x, -boxw, y, -boxh, 1)
-			          - GetRGBA(rgba, width, height, x, -boxw, y, +boxh, 1)
-			          - GetRGBA(rgba, width, height, x, +boxw, y, -boxh, 1)) * mul;
-			*image++ = (GetRGBA(rgba, width, height, x, +boxw, y, +boxh, 2)
-			          + GetRGBA(rgba, width, height, x, -boxw, y, -boxh, 2)
-			          - GetRGBA(rgba, width, height, x, -boxw, y, +boxh, 2)
-			          - GetRGBA(rgba, width, height, x, +boxw, y, -boxh, 2)) * mul;
-			*image++ = (GetRGBA(rgba, width, height, x, +boxw, y, +boxh, 3)
-			          + GetRGBA(rgba, width, height, x, -boxw, y, -boxh, 3)
-			          - GetRGBA(rgba, width, height, x, -boxw, y, +boxh, 3)
-			          - GetRGBA(rgba, width, height, x, +boxw, y, -boxh, 3)) * mul;
+			const rgba_sum *sub = desc->rows + ( ++lo ) * width + x_start;
+			for ( x = 0; x < x_end - x_start; x++ )
+				rgba_sub_sum( &sums[x], &sub[x] );
 		}
+		for ( x = 0; x < x_end - x_start; x++ )
+			rgba_store( dst + x * 4, &sums[x], mul );
 	}
+	mlt_pool_release( sums );
+	return 0;
 }
 
 static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format *format, int *width, int *height, int writable )
@@ -137,10 +236,20 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 			boxh *= mlt_profile_scale_height(profile, *height);
 			if (boxw || boxh) {
 				int size = mlt_image_format_size( *format, *width, *height, NULL );
-				int32_t *rgba = mlt_pool_alloc( 4 * size );
-				PreCompute( *image, rgba, *width, *height );
-				DoBoxBlur( *image, rgba, *width, *height, MAX(1, boxw), MAX(1, boxh) );
-				mlt_pool_release( rgba );
+				boxblur_desc desc = {
+					.image = *image,
+					.rows = mlt_pool_alloc( *width * *height * sizeof(rgba_sum) ),
+					.output = mlt_pool_alloc( size ),
+					.width = *width,
+					.height = *height,
+					.boxw = MAX(1, boxw),
+					.boxh = MAX(1, boxh)
+				};
+				mlt_slices_run_normal( 0, blur_rows_slice, &desc );
+				mlt_slices_run_normal( 0, blur_columns_slice, &desc );
+				mlt_pool_release( desc.rows );
+				mlt_frame_set_image( frame, desc.output, size, mlt_pool_release );
+				*image = desc.output;
 			}
 		}
 	}
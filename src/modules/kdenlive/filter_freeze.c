@@ -23,6 +23,7 @@
 #include <framework/mlt_service.h>
 #include <framework/mlt_factory.h>
 #include <framework/mlt_property.h>
+#include <framework/mlt_image.h>
 
 #include <stdio.h>
 #include <string.h>
@@ -70,26 +71,18 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 			mlt_properties_set_data( properties, "freeze_frame", freeze_frame, 0, ( mlt_destructor )mlt_frame_close, NULL );
 			mlt_properties_set_position( properties, "_frame", pos );
 		}
-		mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
-
-		// Get frozen image
-		uint8_t *buffer = NULL;
-		int error = mlt_frame_get_image( freeze_frame, &buffer, format, width, height, 1 );
 
-		// Copy it to current frame
-		int size = mlt_image_format_size( *format, *width, *height, NULL );
-		uint8_t *image_copy = mlt_pool_alloc( size );
-		memcpy( image_copy, buffer, size );
-		*image = image_copy;
-		mlt_frame_set_image( frame, *image, size, mlt_pool_release );
+		// Get frozen image, shared by every frame that shows it
+		mlt_image frozen = NULL;
+		int error = mlt_frame_get_shared_image( freeze_frame, &frozen, format, width, height );
+		mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
 
-		uint8_t *alpha_buffer = mlt_frame_get_alpha( freeze_frame );
-		if ( alpha_buffer )
+		// Share it with the current frame
+		if ( frozen )
 		{
-			int alphasize = *width * *height;
-			uint8_t *alpha_copy = mlt_pool_alloc( alphasize );
-			memcpy( alpha_copy, alpha_buffer, alphasize );
-			mlt_frame_set_alpha( frame, alpha_copy, alphasize, mlt_pool_release );
+			mlt_frame_set_shared_image( frame, frozen );
+			*image = frozen->data;
+			mlt_image_close( frozen );
 		}
 		return error;
 	}
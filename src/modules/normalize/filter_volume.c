@@ -77,33 +77,83 @@ static inline double limiter( double x, double lmtr_lvl )
 }
 
 
-/** Takes a full smoothing window, and returns the value of the center
-    element, smoothed.
+/** A window of the power of the last frames with a running sum.
 
-    Currently, just does a mean filter, but we could do a median or
-    gaussian filter here instead.
+    Replacing a value adjusts the sum, so the mean of the window takes
+    constant time. Slots that were never written do not count. The sum is
+    recomputed whenever the index wraps so rounding errors do not build up.
 */
-static inline double get_smoothed_data( double *buf, int count )
+typedef struct
 {
-	int i, j;
-	double smoothed = 0;
+	double *values;
+	int window;
+	int index;
+	int count;
+	double sum;
+} smooth_ring;
+
+static void smooth_ring_close( smooth_ring *ring )
+{
+	if ( ring )
+		free( ring->values );
+	free( ring );
+}
 
-	for ( i = 0, j = 0; i < count; i++ )
+static smooth_ring *smooth_ring_new( int window )
+{
+	smooth_ring *ring = calloc( 1, sizeof( smooth_ring ) );
+	if ( ring )
 	{
-		if ( buf[ i ] != -1.0 )
+		ring->values = calloc( window, sizeof( double ) );
+		ring->window = window;
+		if ( !ring->values )
 		{
-			smoothed += buf[ i ];
-			j++;
+			free( ring );
+			ring = NULL;
 		}
 	}
-	if (j) smoothed /= j;
+	return ring;
+}
 
-	return smoothed;
+/** Put the power of a frame in the current slot.
+    The slot only advances for frames that are not silent.
+*/
+static inline void smooth_ring_put( smooth_ring *ring, double value, int advance )
+{
+	int i;
+
+	if ( ring->index >= ring->count )
+		ring->count = ring->index + 1;
+	else
+		ring->sum -= ring->values[ ring->index ];
+	ring->values[ ring->index ] = value;
+	ring->sum += value;
+
+	if ( advance )
+	{
+		ring->index = ( ring->index + 1 ) % ring->window;
+		if ( ring->index == 0 )
+		{
+			ring->sum = 0;
+			for ( i = 0; i < ring->count; i++ )
+				ring->sum += ring->values[ i ];
+		}
+	}
+}
+
+/** Get the mean of the window.
+
+    Currently, just does a mean filter, but we could do a median or
+    gaussian filter here instead.
+*/
+static inline double smooth_ring_mean( smooth_ring *ring )
+{
+	return ring->count ? ring->sum / ring->count : 0;
 }
 
 /** Get the max power level (using RMS) and peak level of the audio segment.
  */
-double signal_max_power( int16_t *buffer, int channels, int samples, int16_t *peak )
+static double signal_max_power( int16_t *buffer, int channels, int samples, double *peak )
 {
 	// Determine numeric limits
 	int bytes_per_samp = (samp_width - 1) / 8 + 1;
@@ -129,7 +179,7 @@ double signal_max_power( int16_t *buffer, int channels, int samples, int16_t *pe
 			/* track peak */
 			if ( sample > max_sample )
 				max_sample = sample;
-			else if ( sample < min_sample )
+			if ( sample < min_sample )
 				min_sample = sample;
 		}
 	}
@@ -155,6 +205,138 @@ double signal_max_power( int16_t *buffer, int channels, int samples, int16_t *pe
 
 /* ------ End normalize functions --------------------------------------- */
 
+/** Get the max power level (using RMS) and peak level of float audio.
+ */
+static double signal_max_power_float( float *buffer, int planar, int channels, int samples, double *peak )
+{
+	double maxpow = 0;
+	float max_sample = 0;
+	int c, i;
+
+	for ( c = 0; c < channels; c++ )
+	{
+		float *p = planar ? buffer + c * samples : buffer + c;
+		int stride = planar ? 1 : channels;
+		double sum = 0;
+		for ( i = 0; i < samples; i++, p += stride )
+		{
+			float sample = *p;
+			sum += (double) sample * sample;
+			if ( fabsf( sample ) > max_sample )
+				max_sample = fabsf( sample );
+		}
+		if ( samples > 0 && sum / samples > maxpow )
+			maxpow = sum / samples;
+	}
+	*peak = max_sample;
+
+	return sqrt( maxpow );
+}
+
+#if defined(__GNUC__)
+typedef float gain_vector __attribute__((vector_size(16)));
+typedef int32_t mask_vector __attribute__((vector_size(16)));
+#endif
+
+/** Multiply a run of samples that share one gain ramp, such as a plane.
+ */
+static void apply_gain_plane( float *p, int samples, double gain, double step )
+{
+	int i = 0;
+#if defined(__GNUC__)
+	gain_vector g = { gain, gain + step, gain + 2 * step, gain + 3 * step };
+	gain_vector g_step = { 4 * step, 4 * step, 4 * step, 4 * step };
+	for ( ; i + 4 <= samples; i += 4, g += g_step )
+	{
+		gain_vector v;
+		memcpy( &v, p + i, sizeof( v ) );
+		v *= g;
+		memcpy( p + i, &v, sizeof( v ) );
+	}
+#endif
+	for ( ; i < samples; i++ )
+		p[i] *= gain + step * i;
+}
+
+/** Multiply interleaved samples by a gain ramp, one gain per sample of all channels.
+ */
+static void apply_gain_interleaved( float *p, int channels, int samples, double gain, double step )
+{
+	int i = 0, j;
+
+	if ( channels == 1 )
+	{
+		apply_gain_plane( p, samples, gain, step );
+		return;
+	}
+#if defined(__GNUC__)
+	if ( channels == 2 )
+	{
+		// A vector holds two stereo samples.
+		gain_vector g = { gain, gain, gain + step, gain + step };
+		gain_vector g_step = { 2 * step, 2 * step, 2 * step, 2 * step };
+		for ( ; i + 2 <= samples; i += 2, g += g_step )
+		{
+			gain_vector v;
+			memcpy( &v, p + i * 2, sizeof( v ) );
+			v *= g;
+			memcpy( p + i * 2, &v, sizeof( v ) );
+		}
+	}
+	else if ( channels % 4 == 0 )
+	{
+		for ( ; i < samples; i++ )
+		{
+			float g = gain + step * i;
+			gain_vector gv = { g, g, g, g };
+			for ( j = 0; j < channels; j += 4 )
+			{
+				gain_vector v;
+				memcpy( &v, p + i * channels + j, sizeof( v ) );
+				v *= gv;
+				memcpy( p + i * channels + j, &v, sizeof( v ) );
+			}
+		}
+	}
+#endif
+	for ( ; i < samples; i++ )
+	{
+		float g = gain + step * i;
+		for ( j = 0; j < channels; j++ )
+			p[ i * channels + j ] *= g;
+	}
+}
+
+/** Apply the limiter to float samples that exceed its level.
+ *
+ * Each vector of samples is checked before it is touched, so runs below the
+ * level cost one comparison per vector.
+ */
+static void limit_float( float *p, int count, double limiter_level )
+{
+	float level2 = limiter_level * limiter_level;
+	int i = 0, j;
+#if defined(__GNUC__)
+	gain_vector l = { level2, level2, level2, level2 };
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		gain_vector v;
+		mask_vector over;
+		memcpy( &v, p + i, sizeof( v ) );
+		over = v * v > l;
+		if ( over[0] | over[1] | over[2] | over[3] )
+		{
+			for ( j = i; j < i + 4; j++ )
+				if ( p[j] * p[j] > level2 )
+					p[j] = limiter( p[j], limiter_level );
+		}
+	}
+#endif
+	for ( ; i < count; i++ )
+		if ( p[i] * p[i] > level2 )
+			p[i] = limiter( p[i], limiter_level );
+}
+
 /** Get the audio.
 */
 
@@ -177,7 +359,7 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 	double amplitude =  mlt_properties_get_double( instance_props, "amplitude" );
 	int i, j;
 	double sample;
-	int16_t peak;
+	double peak = 1.0;
 
 	// Use animated value for gain if "level" property is set 
 	char* level_property = mlt_properties_get( filter_props, "level" );
@@ -192,35 +374,41 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 	if ( mlt_properties_get( instance_props, "limiter" ) != NULL )
 		limiter_level = mlt_properties_get_double( instance_props, "limiter" );
 	
-	// Get the producer's audio
-	*format = normalise? mlt_audio_s16 : mlt_audio_f32le;
+	// Get the producer's audio, in float unless 16-bit is requested for normalisation
+	if ( normalise )
+		*format = mlt_frame_choose_audio_format( frame, *format, mlt_audio_f32le,
+			MLT_AUDIO_FORMAT_FLAG( mlt_audio_s16 ) | MLT_AUDIO_FORMAT_FLAG( mlt_audio_f32le ) | MLT_AUDIO_FORMAT_FLAG( mlt_audio_float ) );
+	else
+		*format = mlt_frame_choose_audio_format( frame, *format, mlt_audio_f32le,
+			MLT_AUDIO_FORMAT_FLAG( mlt_audio_f32le ) | MLT_AUDIO_FORMAT_FLAG( mlt_audio_float ) );
 	mlt_frame_get_audio( frame, buffer, format, frequency, channels, samples );
 
 	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
 
 	if ( normalise )
 	{
-		int window = mlt_properties_get_int( filter_props, "window" );
-		double *smooth_buffer = mlt_properties_get_data( filter_props, "smooth_buffer", NULL );
+		smooth_ring *ring = mlt_properties_get_data( filter_props, "smooth_buffer", NULL );
+		double power;
 
-		if ( window > 0 && smooth_buffer != NULL )
-		{
-			int smooth_index = mlt_properties_get_int( filter_props, "_smooth_index" );
-			
-			// Compute the signal power and put into smoothing buffer
-			smooth_buffer[ smooth_index ] = signal_max_power( *buffer, *channels, *samples, &peak );
+		// Compute the signal power
+		if ( *format == mlt_audio_s16 )
+			power = signal_max_power( *buffer, *channels, *samples, &peak );
+		else
+			power = signal_max_power_float( *buffer, *format == mlt_audio_float, *channels, *samples, &peak );
 
-			if ( smooth_buffer[ smooth_index ] > EPSILON )
+		if ( ring != NULL )
+		{
+			// Put it into the smoothing window
+			smooth_ring_put( ring, power, power > EPSILON );
+			if ( power > EPSILON )
 			{
-				mlt_properties_set_int( filter_props, "_smooth_index", ( smooth_index + 1 ) % window );
-
 				// Smooth the data and compute the gain
-				gain *= amplitude / get_smoothed_data( smooth_buffer, window );
+				gain *= amplitude / smooth_ring_mean( ring );
 			}
 		}
 		else
 		{
-			gain *= amplitude / signal_max_power( *buffer, *channels, *samples, &peak );
+			gain *= amplitude / power;
 		}
 	}
 
@@ -246,11 +434,19 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 
 	mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
 
+	// The limiter can only change samples whose level exceeds it after the gain.
+	int limit = normalise && MAX( previous_gain, gain ) > 1.0
+		&& peak * MAX( previous_gain, gain ) * 32768.0 / 32767.0 > limiter_level;
+
 	// Ramp from the previous gain to the current
 	gain = previous_gain;
 
 	// Apply the gain
-	if ( normalise )
+	if ( gain == 1.0 && gain_step == 0.0 )
+	{
+		// Unity gain leaves the audio as it is.
+	}
+	else if ( *format == mlt_audio_s16 )
 	{
 		int16_t *p = *buffer;
 		// Determine numeric limits
@@ -261,7 +457,7 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 			for ( j = 0; j < *channels; j++ ) {
 				sample = *p * gain;
 				*p = ROUND( sample );
-				if ( gain > 1.0 && normalise ) {
+				if ( gain > 1.0 && limit ) {
 					/* use limiter function instead of clipping */
 					*p = ROUND( samplemax * limiter( sample / (double) samplemax, limiter_level ) );
 				}
@@ -271,11 +467,34 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 	}
 	else
 	{
-		float *p = *buffer;
-		for ( i = 0; i < *samples; i++, gain += gain_step ) {
-			for ( j = 0; j < *channels; j++, p++ ) {
-				p[0] *= gain;
-			}
+		int planar = *format == mlt_audio_float;
+		int first = 0, last = 0;
+
+		if ( planar )
+		{
+			// Each plane ramps over the same gains
+			for ( j = 0; j < *channels; j++ )
+				apply_gain_plane( (float*) *buffer + j * *samples, *samples, gain, gain_step );
+		}
+		else
+		{
+			apply_gain_interleaved( *buffer, *channels, *samples, gain, gain_step );
+		}
+
+		if ( limit )
+		{
+			// The ramp is linear, so the samples with a gain above 1 form one run.
+			if ( gain_step == 0.0 )
+				last = *samples;
+			else if ( gain_step > 0.0 )
+				first = MAX( 0, MIN( *samples, (int) floor( ( 1.0 - gain ) / gain_step ) + 1 ) ), last = *samples;
+			else
+				last = MAX( 0, MIN( *samples, (int) ceil( ( 1.0 - gain ) / gain_step ) ) );
+			if ( planar )
+				for ( j = 0; j < *channels; j++ )
+					limit_float( (float*) *buffer + j * *samples + first, last - first, limiter_level );
+			else
+				limit_float( (float*) *buffer + first * *channels, ( last - first ) * *channels, limiter_level );
 		}
 	}
 	return 0;
@@ -420,14 +639,20 @@ static mlt_frame filter_process( mlt_filter filter, mlt_frame frame )
 
 	// Parse the window property and allocate smoothing buffer if needed
 	int window = mlt_properties_get_int( filter_props, "window" );
-	if ( mlt_properties_get( filter_props, "smooth_buffer" ) == NULL && window > 1 )
+	smooth_ring *ring = mlt_properties_get_data( filter_props, "smooth_buffer", NULL );
+	if ( window > 1 && ( ring == NULL || ring->window != window ) )
 	{
 		// Create a smoothing buffer for the calculated "max power" of frame of audio used in normalisation
-		double *smooth_buffer = (double*) calloc( window, sizeof( double ) );
-		int i;
-		for ( i = 0; i < window; i++ )
-			smooth_buffer[ i ] = -1.0;
-		mlt_properties_set_data( filter_props, "smooth_buffer", smooth_buffer, 0, free, NULL );
+		mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
+		ring = smooth_ring_new( window );
+		mlt_properties_set_data( filter_props, "smooth_buffer", ring, 0, (mlt_destructor) smooth_ring_close, NULL );
+		mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+	}
+	else if ( window <= 1 && ring != NULL )
+	{
+		mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
+		mlt_properties_set_data( filter_props, "smooth_buffer", NULL, 0, NULL, NULL );
+		mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
 	}
 	
 	// Push the filter onto the stack
@@ -844,6 +844,29 @@ int ebur128_set_max_history(ebur128_state* st, unsigned long history)
   return EBUR128_SUCCESS;
 }
 
+void ebur128_clear_blocks(ebur128_state* st) {
+  struct ebur128_dq_entry* entry;
+  while (!STAILQ_EMPTY(&st->d->block_list)) {
+    entry = STAILQ_FIRST(&st->d->block_list);
+    STAILQ_REMOVE_HEAD(&st->d->block_list, entries);
+    free(entry);
+  }
+  while (!STAILQ_EMPTY(&st->d->short_term_block_list)) {
+    entry = STAILQ_FIRST(&st->d->short_term_block_list);
+    STAILQ_REMOVE_HEAD(&st->d->short_term_block_list, entries);
+    free(entry);
+  }
+  st->d->block_list_size = 0;
+  st->d->st_block_list_size = 0;
+  if (st->d->use_histogram) {
+    size_t i;
+    for (i = 0; i < 1000; ++i) {
+      st->d->block_energy_histogram[i] = 0;
+      st->d->short_term_block_energy_histogram[i] = 0;
+    }
+  }
+}
+
 static int ebur128_energy_shortterm(ebur128_state* st, double* out);
 #define EBUR128_ADD_FRAMES(type)                                               \
 int ebur128_add_frames_##type(ebur128_state* st,                               \
@@ -930,8 +953,6 @@ static int ebur128_calc_relative_threshold(ebur128_state* st,
                                            double* relative_threshold) {
   struct ebur128_dq_entry* it;
   size_t i;
-  *relative_threshold = 0.0;
-  *above_thresh_counter = 0;
 
   if (st->d->use_histogram) {
     for (i = 0; i < 1000; ++i) {
@@ -946,11 +967,6 @@ static int ebur128_calc_relative_threshold(ebur128_state* st,
     }
   }
 
-  if (*above_thresh_counter != 0) {
-    *relative_threshold /= (double) *above_thresh_counter;
-    *relative_threshold *= relative_gate_factor;
-  }
-
   return EBUR128_SUCCESS;
 }
 
@@ -977,6 +993,9 @@ static int ebur128_gated_loudness(ebur128_state** sts, size_t size,
     return EBUR128_SUCCESS;
   }
 
+  relative_threshold /= (double) above_thresh_counter;
+  relative_threshold *= relative_gate_factor;
+
   above_thresh_counter = 0;
   if (relative_threshold < histogram_energy_boundaries[0]) {
     start_index = 0;
@@ -1013,8 +1032,8 @@ static int ebur128_gated_loudness(ebur128_state** sts, size_t size,
 }
 
 int ebur128_relative_threshold(ebur128_state* st, double* out) {
-  double relative_threshold;
-  size_t above_thresh_counter;
+  double relative_threshold = 0.0;
+  size_t above_thresh_counter = 0;
 
   if (st && (st->mode & EBUR128_MODE_I) != EBUR128_MODE_I)
     return EBUR128_ERROR_INVALID_MODE;
@@ -1026,6 +1045,9 @@ int ebur128_relative_threshold(ebur128_state* st, double* out) {
       return EBUR128_SUCCESS;
   }
 
+  relative_threshold /= (double) above_thresh_counter;
+  relative_threshold *= relative_gate_factor;
+
   *out = ebur128_energy_to_loudness(relative_threshold);
   return EBUR128_SUCCESS;
 }
@@ -207,6 +207,16 @@ int ebur128_set_max_window(ebur128_state* st, unsigned long window);
  */
 int ebur128_set_max_history(ebur128_state* st, unsigned long history);
 
+/** \brief Forget the gating blocks measured so far.
+ *
+ *  The filter state and the buffered audio are kept, so the blocks measured
+ *  after this call are the same as without it. This lets a measurement start
+ *  part way through a programme after feeding some audio ahead of it.
+ *
+ *  @param st library state.
+ */
+void ebur128_clear_blocks(ebur128_state* st);
+
 /** \brief Add frames to be processed.
  *
  *  @param st library state.
@@ -20,7 +20,9 @@
 #include <framework/mlt.h>
 #include <stdlib.h> // calloc(), free()
 #include <string.h> // memset(), memmove()
+#include <stdio.h>  // snprintf()
 #include <math.h>   // sqrt()
+#include <pthread.h>
 #include <fftw3.h>
 
 // Private Constants
@@ -29,21 +31,117 @@ static const int MIN_WINDOW_SIZE = 500;
 static const double PI = 3.14159265358979323846;
 
 // Private Types
+
+/** A plan and window shared by all the filters with the same window size.
+ *
+ * FFTW plans may be executed concurrently on different arrays, but creating
+ * and destroying them is not thread safe, so that is serialised here.
+ */
+typedef struct fft_plan_s
+{
+	struct fft_plan_s* next;
+	int window_size;
+	int refcount;
+	fftw_plan plan;
+	float* hann;
+} fft_plan;
+
+/** The transform of a frame, cached on the frame for other fft filters.
+ *
+ * The fingerprint identifies the audio that was analysed so a filter that
+ * sees the audio after it was modified does not use it. The sample window is
+ * kept so a filter that uses the result can continue its own stream.
+ */
+typedef struct
+{
+	uint64_t fingerprint;
+	int bin_count;
+	int sample_buff_count;
+	float* bins;
+	float* sample_buff;
+} fft_result;
+
 typedef struct
 {
 	int initialized;
 	unsigned int window_size;
+	int channel;
 	double* fft_in;
 	fftw_complex* fft_out;
-	fftw_plan fft_plan;
+	fft_plan* plan;
 	int bin_count;
 	int sample_buff_count;
 	float* sample_buff;
-	float* hann;
 	float* out_bins;
 	mlt_position expected_pos;
 } private_data;
 
+static pthread_mutex_t g_plan_mutex = PTHREAD_MUTEX_INITIALIZER;
+static fft_plan* g_plans = NULL;
+
+static fft_plan* get_plan( int window_size )
+{
+	fft_plan* plan = NULL;
+
+	pthread_mutex_lock( &g_plan_mutex );
+	for( plan = g_plans; plan && plan->window_size != window_size; plan = plan->next );
+	if( !plan )
+	{
+		// The plan is created on scratch arrays and executed on the arrays of each filter.
+		double* in = fftw_alloc_real( window_size );
+		fftw_complex* out = fftw_alloc_complex( window_size / 2 + 1 );
+		plan = calloc( 1, sizeof(*plan) );
+		if( plan && in && out )
+		{
+			plan->window_size = window_size;
+			plan->plan = fftw_plan_dft_r2c_1d( window_size, in, out, FFTW_ESTIMATE );
+			plan->hann = malloc( window_size * sizeof(*plan->hann) );
+		}
+		if( plan && plan->plan && plan->hann )
+		{
+			int i = 0;
+			for ( i = 0; i < window_size; i++ )
+			{
+				plan->hann[i] = 0.5 * (1 - cos( 2 * PI * i / window_size ) );
+			}
+			plan->next = g_plans;
+			g_plans = plan;
+		}
+		else if( plan )
+		{
+			if( plan->plan ) fftw_destroy_plan( plan->plan );
+			free( plan->hann );
+			free( plan );
+			plan = NULL;
+		}
+		fftw_free( in );
+		fftw_free( out );
+	}
+	if( plan )
+	{
+		plan->refcount++;
+	}
+	pthread_mutex_unlock( &g_plan_mutex );
+	return plan;
+}
+
+static void release_plan( fft_plan* plan )
+{
+	fft_plan** p = NULL;
+
+	if( !plan ) return;
+	pthread_mutex_lock( &g_plan_mutex );
+	if( --plan->refcount == 0 )
+	{
+		for( p = &g_plans; *p && *p != plan; p = &(*p)->next );
+		if( *p ) *p = plan->next;
+		fftw_destroy_plan( plan->plan );
+		free( plan->hann );
+		free( plan );
+	}
+	pthread_mutex_unlock( &g_plan_mutex );
+}
+
 static int initFft( mlt_filter filter )
 {
 	int error = 0;
@@ -52,6 +150,7 @@ static int initFft( mlt_filter filter )
 	if( private->window_size < MIN_WINDOW_SIZE )
 	{
 		private->window_size = mlt_properties_get_int( filter_properties, "window_size" );
+		private->channel = mlt_properties_get_int( filter_properties, "channel" );
 		if( private->window_size >= MIN_WINDOW_SIZE )
 		{
 			private->initialized = 1;
@@ -66,21 +165,13 @@ static int initFft( mlt_filter filter )
 			// Initialize fftw variables
 			private->fft_in = fftw_alloc_real( private->window_size );
 			private->fft_out = fftw_alloc_complex( private->bin_count );
-			private->fft_plan = fftw_plan_dft_r2c_1d( private->window_size, private->fft_in, private->fft_out, FFTW_ESTIMATE );
-
-			// Initialize the hanning window function
-			private->hann = mlt_pool_alloc( private->window_size * sizeof(*private->hann));
-			int i = 0;
-			for ( i = 0; i < private->window_size; i++ )
-			{
-				private->hann[i] = 0.5 * (1 - cos( 2 * PI * i / private->window_size ) );
-			}
+			private->plan = get_plan( private->window_size );
 
 			mlt_properties_set_int( filter_properties, "bin_count", private->bin_count );
 			mlt_properties_set_data( filter_properties, "bins", private->out_bins, 0, 0, 0 );
 		}
 
-		if( private->window_size < MIN_WINDOW_SIZE || !private->fft_in || !private->fft_out || !private->fft_plan )
+		if( private->window_size < MIN_WINDOW_SIZE || !private->fft_in || !private->fft_out || !private->plan )
 		{
 			mlt_log_error( MLT_FILTER_SERVICE( filter ), "Unable to initialize FFT\n" );
 			error = 1;
@@ -90,13 +181,147 @@ static int initFft( mlt_filter filter )
 	return error;
 }
 
+static uint64_t audio_fingerprint( void* buffer, mlt_audio_format format, int channels, int samples )
+{
+	const uint8_t* p = buffer;
+	int size = mlt_audio_format_size( format, samples, channels );
+	uint64_t hash = 0xcbf29ce484222325ULL ^ ( (uint64_t)format << 48 ) ^ ( (uint64_t)channels << 32 ) ^ samples;
+	int i = 0;
+
+	// Hash whole words; the tail of an odd size is left out.
+	for( i = 0; i + 8 <= size; i += 8 )
+	{
+		uint64_t word;
+		memcpy( &word, p + i, sizeof(word) );
+		hash = ( hash ^ word ) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static void result_close( fft_result* result )
+{
+	mlt_pool_release( result );
+}
+
+/** Add the audio of a frame to the sample window and transform it.
+*/
+
+static void analyze_audio( mlt_filter filter, mlt_frame frame, void* buffer, mlt_audio_format format, int channels, int samples )
+{
+	private_data* private = (private_data*)filter->child;
+	int c = 0;
+	int s = 0;
+
+	if( private->expected_pos != mlt_frame_get_position( frame ) )
+	{
+		// Reset the sample buffer when seeking occurs.
+		memset( private->sample_buff, 0, sizeof(*private->sample_buff) * private->window_size );
+		private->sample_buff_count = 0;
+		mlt_log_info( MLT_FILTER_SERVICE(filter), "Buffer Reset %d:%d\n",
+						private->expected_pos,
+						mlt_frame_get_position( frame ) );
+		private->expected_pos = mlt_frame_get_position( frame );
+	}
+
+	int new_samples = 0;
+	int old_samples = 0;
+	if( samples >= private->window_size )
+	{
+		// Ignore samples that don't fit in the window
+		new_samples = private->window_size;
+		old_samples = 0;
+	}
+	else
+	{
+		new_samples = samples;
+		// Shift the previous samples (discarding oldest samples)
+		old_samples = private->window_size - new_samples;
+		memmove( private->sample_buff, private->sample_buff + new_samples, sizeof(*private->sample_buff) * old_samples);
+	}
+
+	// Zero out the space for the new samples
+	memset( private->sample_buff + old_samples, 0, sizeof(*private->sample_buff) * new_samples );
+
+	// Copy the new samples into the sample buffer: one channel, or the average of all of them
+	int first_channel = private->channel >= 0 && private->channel < channels ? private->channel : 0;
+	int last_channel = private->channel >= 0 && private->channel < channels ? private->channel + 1 : channels;
+	double count = last_channel - first_channel;
+	if( format == mlt_audio_s16 )
+	{
+		int16_t* aud = (int16_t*)buffer;
+		// For each sample, add all channels
+		for( c = first_channel; c < last_channel; c++ )
+		{
+			for( s = 0; s < new_samples; s++ )
+			{
+				double sample = aud[s * channels + c];
+				// Scale to +/-1
+				sample /= MAX_S16_AMPLITUDE;
+				sample /= count;
+				private->sample_buff[old_samples + s] += sample;
+			}
+		}
+	}
+	else if( format == mlt_audio_float )
+	{
+		float* aud = (float*)buffer;
+		// For each sample, add all channels
+		for( c = first_channel; c < last_channel; c++ )
+		{
+			for( s = 0; s < new_samples; s++ )
+			{
+				double sample = aud[c * samples + s];
+				sample /= count;
+				private->sample_buff[old_samples + s] += sample;
+			}
+		}
+	}
+	else
+	{
+		mlt_log_error( MLT_FILTER_SERVICE(filter), "Unsupported format %d\n", format );
+	}
+	private->sample_buff_count += samples;
+	if( private->sample_buff_count > private->window_size )
+	{
+		private->sample_buff_count = private->window_size;
+	}
+
+	// Copy samples to fft input while applying window function
+	// (a plain loop over restrict pointers that the compiler vectorizes)
+	{
+		double* restrict in = private->fft_in;
+		const float* restrict samples_in = private->sample_buff;
+		const float* restrict hann = private->plan->hann;
+		int n = private->window_size;
+		for (s = 0; s < n; s++)
+		{
+			in[s] = samples_in[s] * hann[s];
+		}
+	}
+
+	// Perform the FFT on the arrays of this filter with the shared plan
+	fftw_execute_dft_r2c( private->plan->plan, private->fft_in, private->fft_out );
+
+	// Convert to magnitudes
+	int bin = 0;
+	for( bin = 0; bin < private->bin_count; bin++ )
+	{
+		// Convert FFT output to magnitudes
+		private->out_bins[bin] = sqrt( private->fft_out[bin][0] * private->fft_out[bin][0]
+											+ private->fft_out[bin][1] * private->fft_out[bin][1] );
+		// Scale to 0.0 - 1.0
+		private->out_bins[bin] = (4.0 * private->out_bins[bin]) / (float)private->window_size;
+	}
+
+	private->expected_pos++;
+}
+
 static int filter_get_audio( mlt_frame frame, void** buffer, mlt_audio_format* format, int* frequency, int* channels, int* samples )
 {
 	mlt_filter filter = (mlt_filter)mlt_frame_pop_audio( frame );
 	mlt_properties filter_properties = MLT_FILTER_PROPERTIES( filter );
+	mlt_properties frame_properties = MLT_FRAME_PROPERTIES( frame );
 	private_data* private = (private_data*)filter->child;
-	int c = 0;
-	int s = 0;
 
 	// Sanity
 	if ( *format != mlt_audio_s16 && *format != mlt_audio_float )
@@ -114,100 +339,41 @@ static int filter_get_audio( mlt_frame frame, void** buffer, mlt_audio_format* f
 		private->expected_pos = mlt_frame_get_position( frame );
 	}
 
-	if( !initFft( filter ) )
+	if( !initFft( filter ) && *buffer )
 	{
-		if( private->expected_pos != mlt_frame_get_position( frame ) )
-		{
-			// Reset the sample buffer when seeking occurs.
-			memset( private->sample_buff, 0, sizeof(*private->sample_buff) * private->window_size );
-			private->sample_buff_count = 0;
-			mlt_log_info( MLT_FILTER_SERVICE(filter), "Buffer Reset %d:%d\n",
-							private->expected_pos,
-							mlt_frame_get_position( frame ) );
-			private->expected_pos = mlt_frame_get_position( frame );
-		}
-
-		int new_samples = 0;
-		int old_samples = 0;
-		if( *samples >= private->window_size )
+		char key[64];
+		uint64_t fingerprint = audio_fingerprint( *buffer, *format, *channels, *samples );
+		fft_result* result = NULL;
+
+		// Another fft filter with the same settings may have analysed this audio already.
+		snprintf( key, sizeof(key), "_fft.%u.hann.%d", private->window_size, private->channel );
+		result = mlt_properties_get_data( frame_properties, key, NULL );
+		if( result && result->fingerprint == fingerprint && result->bin_count == private->bin_count )
 		{
-			// Ignore samples that don't fit in the window
-			new_samples = private->window_size;
-			old_samples = 0;
+			memcpy( private->out_bins, result->bins, sizeof(*private->out_bins) * private->bin_count );
+			memcpy( private->sample_buff, result->sample_buff, sizeof(*private->sample_buff) * private->window_size );
+			private->sample_buff_count = result->sample_buff_count;
+			private->expected_pos = mlt_frame_get_position( frame ) + 1;
 		}
 		else
 		{
-			new_samples = *samples;
-			// Shift the previous samples (discarding oldest samples)
-			old_samples = private->window_size - new_samples;
-			memmove( private->sample_buff, private->sample_buff + new_samples, sizeof(*private->sample_buff) * old_samples);
-		}
+			analyze_audio( filter, frame, *buffer, *format, *channels, *samples );
 
-		// Zero out the space for the new samples
-		memset( private->sample_buff + old_samples, 0, sizeof(*private->sample_buff) * new_samples );
-
-		// Copy the new samples into the sample buffer
-		if( *format == mlt_audio_s16 )
-		{
-			int16_t* aud = (int16_t*)*buffer;
-			// For each sample, add all channels
-			for( c = 0; c < *channels; c++ )
+			// Share the result with the other fft filters that see this frame
+			int size = sizeof(*result) + sizeof(float) * ( private->bin_count + private->window_size );
+			result = mlt_pool_alloc( size );
+			if( result )
 			{
-				for( s = 0; s < new_samples; s++ )
-				{
-					double sample = aud[s * *channels + c];
-					// Scale to +/-1
-					sample /= MAX_S16_AMPLITUDE;
-					sample /= (double)*channels;
-					private->sample_buff[old_samples + s] += sample;
-				}
+				result->fingerprint = fingerprint;
+				result->bin_count = private->bin_count;
+				result->sample_buff_count = private->sample_buff_count;
+				result->bins = (float*)( result + 1 );
+				result->sample_buff = result->bins + private->bin_count;
+				memcpy( result->bins, private->out_bins, sizeof(float) * private->bin_count );
+				memcpy( result->sample_buff, private->sample_buff, sizeof(float) * private->window_size );
+				mlt_properties_set_data( frame_properties, key, result, size, (mlt_destructor)result_close, NULL );
 			}
 		}
-		else if( *format == mlt_audio_float )
-		{
-			float* aud = (float*)*buffer;
-			// For each sample, add all channels
-			for( c = 0; c < *channels; c++ )
-			{
-				for( s = 0; s < new_samples; s++ )
-				{
-					double sample = aud[c * *samples + s];
-					sample /= (double)*channels;
-					private->sample_buff[old_samples + s] += sample;
-				}
-			}
-		}
-		else
-		{
-			mlt_log_error( MLT_FILTER_SERVICE(filter), "Unsupported format %d\n", *format );
-		}
-		private->sample_buff_count += *samples;
-		if( private->sample_buff_count > private->window_size )
-		{
-			private->sample_buff_count = private->window_size;
-		}
-
-		// Copy samples to fft input while applying window function
-		for (s = 0; s < private->window_size; s++)
-		{
-			private->fft_in[s] = private->sample_buff[s] * private->hann[s];
-		}
-
-		// Perform the FFT
-		fftw_execute( private->fft_plan );
-
-		// Convert to magnitudes
-		int bin = 0;
-		for( bin = 0; bin < private->bin_count; bin++ )
-		{
-			// Convert FFT output to magnitudes
-			private->out_bins[bin] = sqrt( private->fft_out[bin][0] * private->fft_out[bin][0]
-												+ private->fft_out[bin][1] * private->fft_out[bin][1] );
-			// Scale to 0.0 - 1.0
-			private->out_bins[bin] = (4.0 * private->out_bins[bin]) / (float)private->window_size;
-		}
-
-		private->expected_pos++;
 	}
 
 	mlt_properties_set_double( filter_properties, "bin_width", (double)*frequency / (double)private->window_size );
@@ -236,9 +402,8 @@ static void filter_close( mlt_filter filter )
 	{
 		fftw_free( private->fft_in );
 		fftw_free( private->fft_out );
-		fftw_destroy_plan( private->fft_plan );
+		release_plan( private->plan );
 		mlt_pool_release( private->sample_buff );
-		mlt_pool_release( private->hann );
 		mlt_pool_release( private->out_bins );
 		free( private );
 	}
@@ -260,6 +425,7 @@ mlt_filter filter_fft_init( mlt_profile profile, mlt_service_type type, const ch
 		mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
 		mlt_properties_set_int( properties, "_filter_private", 1 );
 		mlt_properties_set_int( properties, "window_size", 2048 );
+		mlt_properties_set_int( properties, "channel", -1 );
 		mlt_properties_set_double( properties, "window_level", 0.0 );
 		mlt_properties_set_double( properties, "bin_width", 0.0 );
 		mlt_properties_set_int( properties, "bin_count", 0 );
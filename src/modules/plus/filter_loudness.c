@@ -43,8 +43,27 @@ typedef struct
 	analyze_data* analyze;
 	apply_data* apply;
 	mlt_position last_position;
+	int pass_through;
 } private_data;
 
+/** A range of the program measured by one job of the parallel analysis.
+*/
+
+typedef struct
+{
+	mlt_producer producer;
+	mlt_position offset;
+	mlt_position preroll;
+	mlt_position start;
+	mlt_position end;
+	int skip;
+	double fps;
+	int channels;
+	int frequency;
+	ebur128_state* state;
+	int error;
+} analysis_range;
+
 static void destroy_analyze_data( mlt_filter filter )
 {
 	private_data* private = (private_data*)filter->child;
@@ -90,6 +109,236 @@ static void init_apply_data( mlt_filter filter )
 	}
 }
 
+static void store_results( mlt_filter filter, double loudness, double range, double peak )
+{
+	char result[MAX_RESULT_SIZE];
+	snprintf( result, MAX_RESULT_SIZE, "L: %lf\tR: %lf\tP %lf", loudness, range, peak );
+	result[ MAX_RESULT_SIZE - 1 ] = '\0';
+	mlt_log_info( MLT_FILTER_SERVICE( filter ), "Stored results: %s\n", result );
+	mlt_properties_set( MLT_FILTER_PROPERTIES( filter ), "results", result );
+}
+
+/** Load a private copy of the service the filter is attached to.
+ *
+ * Only the filters attached ahead of the marked copy of this filter are kept,
+ * so the copy produces exactly the audio this filter receives.
+ */
+
+static mlt_producer load_analysis_copy( mlt_profile profile, const char* xml )
+{
+	mlt_producer producer = mlt_factory_producer( profile, "xml-string", xml );
+	mlt_service service = MLT_PRODUCER_SERVICE( producer );
+	mlt_filter filter = NULL;
+	int i = 0;
+
+	if ( !producer )
+		return NULL;
+	while ( ( filter = mlt_service_filter( service, i ) ) &&
+			!mlt_properties_get_int( MLT_FILTER_PROPERTIES( filter ), "loudness.analysis_copy" ) )
+		i++;
+	if ( !filter )
+	{
+		mlt_producer_close( producer );
+		return NULL;
+	}
+	while ( ( filter = mlt_service_filter( service, i ) ) )
+		mlt_service_detach( service, filter );
+	return producer;
+}
+
+/** Measure one range of the program.
+ *
+ * Frames are requested for their audio only, so no image is ever rendered.
+ * The audio from the preroll position warms up the filters and short-term
+ * window, and the blocks it produces are dropped when the range starts.
+ */
+
+static int analyze_range( int id, int index, int jobs, void* cookie )
+{
+	analysis_range* range = (analysis_range*)cookie + index;
+	mlt_producer producer = range->producer;
+	mlt_position pos;
+
+	for ( pos = range->preroll; pos < range->end && !range->error; pos++ )
+	{
+		mlt_frame frame = NULL;
+		mlt_audio_format format = mlt_audio_f32le;
+		int frequency = range->frequency;
+		int channels = range->channels;
+		int samples = mlt_sample_calculator( range->fps, frequency, range->offset + pos );
+		void* buffer = NULL;
+
+		mlt_producer_seek( producer, range->offset + pos - mlt_producer_get_in( producer ) );
+		if ( mlt_service_get_frame( MLT_PRODUCER_SERVICE( producer ), &frame, 0 ) || !frame )
+		{
+			range->error = 1;
+			break;
+		}
+		mlt_frame_get_audio( frame, &buffer, &format, &frequency, &channels, &samples );
+		if ( buffer && format == mlt_audio_f32le && channels == range->channels && frequency == range->frequency )
+		{
+			int skip = pos == range->preroll ? MIN( range->skip, samples ) : 0;
+			if ( pos == range->start && range->preroll < range->start )
+				ebur128_clear_blocks( range->state );
+			ebur128_add_frames_float( range->state, (float*) buffer + skip * channels, samples - skip );
+		}
+		else
+		{
+			range->error = 1;
+		}
+		mlt_frame_close( frame );
+	}
+	return 0;
+}
+
+/** Choose where a range starts measuring.
+ *
+ * Gating blocks end every 100ms and short-term blocks every second from the
+ * start of the program, so the preroll begins on a whole second at least 3
+ * seconds before the range. It starts part way into a frame when needed.
+ */
+
+static void set_preroll( analysis_range* range )
+{
+	int64_t base = mlt_sample_calculator_to_now( range->fps, range->frequency, range->offset );
+	int64_t start = mlt_sample_calculator_to_now( range->fps, range->frequency, range->offset + range->start ) - base;
+	int64_t second = ( range->frequency + 5 ) / 10 * 10;
+	int64_t preroll = start > 3 * second ? ( start - 3 * second ) / second * second : 0;
+
+	range->preroll = range->start;
+	while ( range->preroll > 0 &&
+			mlt_sample_calculator_to_now( range->fps, range->frequency, range->offset + range->preroll ) - base > preroll )
+		range->preroll--;
+	range->skip = preroll - ( mlt_sample_calculator_to_now( range->fps, range->frequency, range->offset + range->preroll ) - base );
+}
+
+/** Analyze the whole program at once, splitting it into ranges measured in parallel.
+ *
+ * Each range is measured on its own copy of the producer and the gating blocks
+ * of all ranges are merged. Every range but the first starts measuring at
+ * least 3 seconds early, on a whole second of the program, so its blocks line
+ * up with those of a single pass and the ones ending inside the range are all
+ * measured. The result matches the frame by frame analysis up to rounding.
+ * \return true on error, in which case the frame by frame analysis is used
+ */
+
+static int analyze_parallel( mlt_filter filter, mlt_frame frame, int channels, int frequency )
+{
+	private_data* private = (private_data*)filter->child;
+	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+	mlt_service service = mlt_properties_get_data( properties, "service", NULL );
+	mlt_profile profile = mlt_service_profile( MLT_FILTER_SERVICE( filter ) );
+	mlt_position length = mlt_filter_get_length2( filter, frame );
+	int jobs = mlt_properties_get_int( properties, "analysis_threads" );
+	analysis_range* ranges = NULL;
+	ebur128_state** states = NULL;
+	mlt_consumer consumer = NULL;
+	mlt_profile copy_profile = NULL;
+	int error = 1;
+	int i, j;
+
+	if ( jobs < 0 )
+		jobs = mlt_slices_count_normal();
+	if ( !service || !profile || channels < 1 || frequency < 1 )
+		return error;
+	// Keep every range at least as long as its preroll
+	jobs = MIN( jobs, length / ( 3 * mlt_profile_fps( profile ) ) );
+	if ( jobs < 1 )
+		return error;
+	switch ( mlt_service_identify( service ) )
+	{
+		case producer_type:
+		case playlist_type:
+		case tractor_type:
+			break;
+		default:
+			return error;
+	}
+
+	// Serialize what the filter is attached to and mark this filter to find its copy.
+	consumer = mlt_factory_consumer( profile, "xml", "string" );
+	if ( !consumer )
+		return error;
+	mlt_properties_set_int( MLT_CONSUMER_PROPERTIES( consumer ), "no_meta", 1 );
+	mlt_properties_set_int( properties, "loudness.analysis_copy", 1 );
+	mlt_consumer_connect( consumer, service );
+	mlt_consumer_start( consumer );
+	mlt_properties_clear( properties, "loudness.analysis_copy" );
+
+	// The copies may rewrite their profile while loading.
+	copy_profile = mlt_profile_clone( profile );
+	copy_profile->is_explicit = 1;
+	ranges = calloc( jobs, sizeof( *ranges ) );
+	states = calloc( jobs, sizeof( *states ) );
+	if ( ranges && states && mlt_properties_get( MLT_CONSUMER_PROPERTIES( consumer ), "string" ) )
+	{
+		error = 0;
+		for ( i = 0; i < jobs && !error; i++ )
+		{
+			ranges[i].producer = load_analysis_copy( copy_profile, mlt_properties_get( MLT_CONSUMER_PROPERTIES( consumer ), "string" ) );
+			ranges[i].offset = mlt_frame_get_position( frame ) - mlt_filter_get_position( filter, frame );
+			ranges[i].start = length * i / jobs;
+			ranges[i].end = length * ( i + 1 ) / jobs;
+			ranges[i].fps = mlt_profile_fps( profile );
+			ranges[i].channels = channels;
+			ranges[i].frequency = frequency;
+			set_preroll( &ranges[i] );
+			ranges[i].state = states[i] = ebur128_init( (unsigned int)channels, (unsigned long)frequency,
+				EBUR128_MODE_I | EBUR128_MODE_LRA | EBUR128_MODE_SAMPLE_PEAK );
+			error = !ranges[i].producer || !ranges[i].state;
+		}
+	}
+
+	if ( !error )
+	{
+		mlt_slices_run_normal( jobs, analyze_range, ranges );
+		for ( i = 0; i < jobs; i++ )
+			error |= ranges[i].error;
+	}
+
+	if ( !error )
+	{
+		double loudness = 0.0;
+		double range = 0.0;
+		double tmpPeak = 0.0;
+		double peak = 0.0;
+
+		ebur128_loudness_global_multiple( states, jobs, &loudness );
+		ebur128_loudness_range_multiple( states, jobs, &range );
+		for ( i = 0; i < jobs; i++ )
+		{
+			for ( j = 0; j < channels; j++ )
+			{
+				ebur128_sample_peak( states[i], j, &tmpPeak );
+				if( tmpPeak > peak )
+				{
+					peak = tmpPeak;
+				}
+			}
+		}
+		store_results( filter, loudness, range, peak );
+		private->pass_through = 1;
+		private->last_position = mlt_filter_get_position( filter, frame );
+	}
+	else
+	{
+		mlt_log_warning( MLT_FILTER_SERVICE( filter ), "Parallel analysis failed, analyzing frame by frame\n" );
+	}
+
+	for ( i = 0; ranges && i < jobs; i++ )
+	{
+		mlt_producer_close( ranges[i].producer );
+		if ( ranges[i].state )
+			ebur128_destroy( &ranges[i].state );
+	}
+	free( ranges );
+	free( states );
+	mlt_profile_close( copy_profile );
+	mlt_consumer_close( consumer );
+
+	return error;
+}
+
 static void analyze( mlt_filter filter, mlt_frame frame, void **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples )
 {
 	private_data* private = (private_data*)filter->child;
@@ -105,6 +354,11 @@ static void analyze( mlt_filter filter, mlt_frame frame, void **buffer, mlt_audi
 	// Analyze Audio
 	if( !private->analyze && pos == 0 )
 	{
+		if ( mlt_properties_get_int( MLT_FILTER_PROPERTIES( filter ), "analysis_threads" ) &&
+			 !analyze_parallel( filter, frame, *channels, *frequency ) )
+		{
+			return;
+		}
 		init_analyze_data( filter, *channels, *frequency );
 	}
 
@@ -114,13 +368,11 @@ static void analyze( mlt_filter filter, mlt_frame frame, void **buffer, mlt_audi
 
 		if ( pos + 1 == mlt_filter_get_length2( filter, frame ) )
 		{
-			mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
 			double loudness = 0.0;
 			double range = 0.0;
 			double tmpPeak = 0.0;
 			double peak = 0.0;
 			int i = 0;
-			char result[MAX_RESULT_SIZE];
 			ebur128_loudness_global( private->analyze->state, &loudness );
 			ebur128_loudness_range( private->analyze->state, &range );
 
@@ -133,10 +385,7 @@ static void analyze( mlt_filter filter, mlt_frame frame, void **buffer, mlt_audi
 				}
 			}
 
-			snprintf( result, MAX_RESULT_SIZE, "L: %lf\tR: %lf\tP %lf", loudness, range, peak );
-			result[ MAX_RESULT_SIZE - 1 ] = '\0';
-			mlt_log_info( MLT_FILTER_SERVICE( filter ), "Stored results: %s\n", result );
-			mlt_properties_set( properties, "results", result );
+			store_results( filter, loudness, range, peak );
 			destroy_analyze_data( filter );
 		}
 
@@ -177,6 +426,7 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 {
 	mlt_filter filter = mlt_frame_pop_audio( frame );
 	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+	private_data* private = (private_data*)filter->child;
 
 	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
 
@@ -184,6 +434,20 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 	*format = mlt_audio_f32le;
 	mlt_frame_get_audio( frame, buffer, format, frequency, channels, samples );
 
+	if( private->pass_through )
+	{
+		// The results were computed up front, so the rest of the analysis pass is left untouched.
+		mlt_position pos = mlt_filter_get_position( filter, frame );
+		if( pos == private->last_position + 1 )
+		{
+			private->last_position = pos;
+			private->pass_through = pos + 1 < mlt_filter_get_length2( filter, frame );
+			mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+			return 0;
+		}
+		private->pass_through = 0;
+	}
+
 	char* results = mlt_properties_get( properties, "results" );
 	if( results && strcmp( results, "" ) )
 	{
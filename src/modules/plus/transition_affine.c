@@ -395,7 +395,7 @@ struct sliced_desc
 	double dz, mix;
 	double x_offset, y_offset;
 	int b_alpha;
-	double minima, xmax, ymax;
+	double xmin, ymin, xmax, ymax;
 };
 
 static int sliced_proc( int id, int index, int jobs, void* cookie )
@@ -414,7 +414,7 @@ static int sliced_proc( int id, int index, int jobs, void* cookie )
 			for (j = 0, x = ctx.lower_x; j < ctx.a_width; j++, x++) {
 				dx = MapX( ctx.affine.matrix, x, y ) / ctx.dz + ctx.x_offset;
 				dy = MapY( ctx.affine.matrix, x, y ) / ctx.dz + ctx.y_offset;
-				if (dx >= ctx.minima && dx <= ctx.xmax && dy >= ctx.minima && dy <= ctx.ymax)
+				if (dx >= ctx.xmin && dx <= ctx.xmax && dy >= ctx.ymin && dy <= ctx.ymax)
 					ctx.interp(ctx.b_image, ctx.b_width, ctx.b_height, dx, dy, ctx.mix, ctx.a_image, ctx.b_alpha);
 				ctx.a_image += 4;
 			}
@@ -617,7 +617,8 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 			.y_offset = (double) b_height / 2.0,
 			.b_alpha = mlt_properties_get_int( properties, "b_alpha" ),
 			// Affine boundaries
-			.minima = 0,
+			.xmin = 0,
+			.ymin = 0,
 			.xmax = b_width - 1,
 			.ymax = b_height - 1
 		};
@@ -694,7 +695,8 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 		{
 			desc.interp = interpNN_b32;
 			// uses lrintf. Values should be >= -0.5 and < max + 0.5
-			desc.minima -= 0.5;
+			desc.xmin -= 0.5;
+			desc.ymin -= 0.5;
 			desc.xmax += 0.49;
 			desc.ymax += 0.49;
 		}
@@ -709,10 +711,30 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 			// TODO: spline 4x4 or 6x6
 			desc.interp = interpBC_b32;
 			// uses ceilf. Values should be > -1 and <= max.
-			desc.minima -= 1;
+			desc.xmin -= 1;
+			desc.ymin -= 1;
 		}
 		free( interps );
 
+		// Transparent parts of the b frame leave the a frame alone unless its alpha is copied
+		if ( !desc.b_alpha )
+		{
+			mlt_alpha_summary summary;
+			mlt_frame_get_alpha_summary( b_frame, &summary );
+			if ( summary.width == 0 || summary.height == 0 )
+			{
+				mlt_frame_set_image( b_frame, NULL, 0, NULL );
+				if (threads != 1)
+					mlt_service_unlock( MLT_TRANSITION_SERVICE( transition ) );
+				return 0;
+			}
+			// Leave room for the interpolation kernel
+			desc.xmin = MAX( desc.xmin, summary.x - 2 );
+			desc.ymin = MAX( desc.ymin, summary.y - 2 );
+			desc.xmax = MIN( desc.xmax, summary.x + summary.width + 1 );
+			desc.ymax = MIN( desc.ymax, summary.y + summary.height + 1 );
+		}
+
 		// Do the transform with interpolation
 		if (threads == 1)
 			sliced_proc(0, 0, 1, &desc);
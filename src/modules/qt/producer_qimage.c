@@ -23,6 +23,7 @@
 #include <framework/mlt_cache.h>
 #include <framework/mlt_events.h>
 #include "qimage_wrapper.h"
+#include <framework/mlt_image.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,6 +33,25 @@
 #include <unistd.h>
 #include <ctype.h>
 
+/** An image that holds on to the buffers cached by the producer
+*/
+
+typedef struct
+{
+	struct mlt_image_s image;
+	mlt_cache_item image_cache;
+	mlt_cache_item alpha_cache;
+}
+cached_image;
+
+static void cached_image_close( void *ptr )
+{
+	cached_image *self = ptr;
+	mlt_cache_item_close( self->image_cache );
+	mlt_cache_item_close( self->alpha_cache );
+	free( self );
+}
+
 static void load_filenames( producer_qimage self, mlt_properties producer_properties );
 static int producer_get_frame( mlt_producer parent, mlt_frame_ptr frame, int index );
 static void producer_close( mlt_producer parent );
@@ -248,29 +268,24 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 	*height = mlt_properties_get_int( properties, "height" );
 	*format = self->format;
 
-	// NB: Cloning is necessary with this producer (due to processing of images ahead of use)
-	// The fault is not in the design of mlt, but in the implementation of the qimage producer...
+	// A refresh puts new buffers in the cache rather than modifying the cached ones,
+	// so the frame shares them read-only while it holds references to their cache items
 	if ( self->current_image )
 	{
-		// Clone the image and the alpha
-		int image_size = mlt_image_format_size( self->format, self->current_width, self->current_height, NULL );
-		uint8_t *image_copy = mlt_pool_alloc( image_size );
-		memcpy( image_copy, self->current_image, image_size );
-		// Now update properties so we free the copy after
-		mlt_frame_set_image( frame, image_copy, image_size, mlt_pool_release );
-		// We're going to pass the copy on
-		*buffer = image_copy;
+		cached_image *shared = calloc( 1, sizeof( cached_image ) );
+		mlt_image_set_values( &shared->image, self->current_image, self->format, self->current_width, self->current_height );
+		shared->image.alpha = self->current_alpha;
+		shared->image.ref_count = 1;
+		shared->image.close = cached_image_close;
+		shared->image_cache = self->image_cache;
+		shared->alpha_cache = self->alpha_cache;
+		self->image_cache = NULL;
+		self->alpha_cache = NULL;
+		mlt_frame_set_shared_image( frame, &shared->image );
+		mlt_image_close( &shared->image );
+		*buffer = self->current_image;
 		mlt_log_debug( MLT_PRODUCER_SERVICE( &self->parent ), "%dx%d (%s)\n",
 			self->current_width, self->current_height, mlt_image_format_name( *format ) );
-		// Clone the alpha channel
-		if ( self->current_alpha )
-		{
-            if ( !self->alpha_size )
-                self->alpha_size = self->current_width * self->current_height;
-			uint8_t * alpha_copy = mlt_pool_alloc( self->alpha_size );
-			memcpy( alpha_copy, self->current_alpha, self->alpha_size );
-			mlt_frame_set_alpha( frame, alpha_copy, self->alpha_size, mlt_pool_release );
-		}
 	}
 	else
 	{
@@ -244,8 +244,25 @@ static int get_image( mlt_frame a_frame, uint8_t **image, mlt_image_format *form
 	painter.setTransform(transform);
 	painter.setOpacity(opacity);
 
-	// Composite top frame
-	painter.drawImage(0, 0, topImg);
+	// Composite top frame, skipping its transparent border when drawing over
+	if ( mlt_properties_get_int( transition_properties, "compositing" ) == 0 )
+	{
+		mlt_alpha_summary summary;
+		mlt_frame_get_alpha_summary( b_frame, &summary );
+		if ( summary.width > 0 && summary.height > 0 )
+		{
+			// Keep a transparent pixel around the visible part for smooth scaling
+			int x = MAX( 0, summary.x - 1 );
+			int y = MAX( 0, summary.y - 1 );
+			int w = MIN( b_width, summary.x + summary.width + 1 ) - x;
+			int h = MIN( b_height, summary.y + summary.height + 1 ) - y;
+			painter.drawImage( QPointF( x, y ), topImg, QRectF( x, y, w, h ) );
+		}
+	}
+	else
+	{
+		painter.drawImage(0, 0, topImg);
+	}
 
 	// finish Qt drawing
 	painter.end();
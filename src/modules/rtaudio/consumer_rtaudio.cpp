@@ -22,12 +22,16 @@
 #include <string.h>
 #include <pthread.h>
 #include <sys/time.h>
+#include <atomic>
 #ifdef USE_INTERNAL_RTAUDIO
 #include "RtAudio.h"
 #else
 #include <RtAudio.h>
 #endif
 
+// The size in bytes of the audio queued for the device
+#define AUDIO_RING_SIZE ( 4096 * 10 )
+
 static void consumer_refresh_cb( mlt_consumer sdl, mlt_consumer consumer, char *name );
 static int  rtaudio_callback( void *outputBuffer, void *inputBuffer,
 	unsigned int nFrames, double streamTime, RtAudioStreamStatus status, void *userData );
@@ -63,10 +67,8 @@ public:
 	int                   joined;
 	int                   running;
 	int                   out_channels;
-	uint8_t               audio_buffer[4096 * 10];
-	int                   audio_avail;
-	pthread_mutex_t       audio_mutex;
-	pthread_cond_t        audio_cond;
+	mlt_audio_ring        audio_ring;
+	std::atomic<double>   volume;
 	pthread_mutex_t       video_mutex;
 	pthread_cond_t        video_cond;
 	int                   playing;
@@ -84,7 +86,8 @@ public:
 		, queue(NULL)
 		, joined(0)
 		, running(0)
-		, audio_avail(0)
+		, audio_ring(NULL)
+		, volume(1.0)
 		, playing(0)
 		, refresh_count(0)
 		, is_purge(false)
@@ -98,8 +101,6 @@ public:
 		mlt_deque_close( queue );
 
 		// Destroy mutexes
-		pthread_mutex_destroy( &audio_mutex );
-		pthread_cond_destroy( &audio_cond );
 		pthread_mutex_destroy( &video_mutex );
 		pthread_cond_destroy( &video_cond );
 		pthread_mutex_destroy( &refresh_mutex );
@@ -109,6 +110,8 @@ public:
 			rt->closeStream();
 		delete rt;
 		rt = NULL;
+
+		mlt_audio_ring_close( audio_ring );
 	}
 
 	bool create_rtaudio( RtAudio::Api api, int channels, int frequency )
@@ -118,6 +121,11 @@ public:
 		unsigned int bufferFrames = mlt_properties_get_int( properties, "audio_buffer" );
 
 		mlt_log_info( getConsumer(), "Attempt to open RtAudio: %s\t%d\t%d\n", rtaudio_api_str( api ), channels, frequency );
+
+		// Close any previous stream first, as its callback reads the ring replaced below
+		if ( rt && rt->isStreamOpen() )
+			rt->closeStream();
+		delete rt;
 		rt = new RtAudio( api );
 
 		if( !rt )
@@ -181,10 +189,18 @@ public:
 			}
 		}
 
+		// The callback reads from the ring as soon as the stream starts
+		mlt_audio_ring_close( audio_ring );
+		audio_ring = mlt_audio_ring_new( channels * sizeof( int16_t ), AUDIO_RING_SIZE / ( channels * sizeof( int16_t ) ) );
+		if ( !audio_ring )
+		{
+			mlt_log_error( getConsumer(), "Failed to allocate the audio ring\n" );
+			delete rt;
+			rt = NULL;
+			return false;
+		}
+
 		try {
-			if ( rt->isStreamOpen() ) {
-				 rt->closeStream();
-			}
 			rt->openStream( &parameters, NULL, RTAUDIO_SINT16,
 				frequency, &bufferFrames, &rtaudio_callback, this, &options );
 			rt->startStream();
@@ -272,8 +288,6 @@ public:
 		mlt_properties_set_double( properties, "volume", 1.0 );
 
 		// This is the initialisation of the consumer
-		pthread_mutex_init( &audio_mutex, NULL );
-		pthread_cond_init( &audio_cond, NULL);
 		pthread_mutex_init( &video_mutex, NULL );
 		pthread_cond_init( &video_cond, NULL);
 
@@ -335,11 +349,6 @@ public:
 			pthread_cond_broadcast( &video_cond );
 			pthread_mutex_unlock( &video_mutex );
 
-			// Unlatch the audio callback
-			pthread_mutex_lock( &audio_mutex );
-			pthread_cond_broadcast( &audio_cond );
-			pthread_mutex_unlock( &audio_mutex );
-
 			if ( rt && rt->isStreamOpen() )
 			try {
 				// Stop the stream
@@ -506,44 +515,20 @@ public:
 		while( mlt_deque_count( queue ) )
 			mlt_frame_close( (mlt_frame) mlt_deque_pop_back( queue ) );
 
-		audio_avail = 0;
+		if ( audio_ring )
+			mlt_audio_ring_flush( audio_ring );
 	}
 
 	int callback( int16_t *outbuf, int16_t *inbuf,
 		unsigned int samples, double streamTime, RtAudioStreamStatus status )
 	{
-		mlt_properties properties = MLT_CONSUMER_PROPERTIES( getConsumer() );
-		double volume = mlt_properties_get_double( properties, "volume" );
-		int len = mlt_audio_format_size( mlt_audio_s16, samples, out_channels );
+		double volume = this->volume;
 
-		pthread_mutex_lock( &audio_mutex );
-
-		// Block until audio received
-		while ( running && len > audio_avail )
-			pthread_cond_wait( &audio_cond, &audio_mutex );
-
-		if ( audio_avail >= len )
-		{
-			// Place in the audio buffer
-			memcpy( outbuf, audio_buffer, len );
-
-			// Remove len from the audio available
-			audio_avail -= len;
-
-			// Remove the samples
-			memmove( audio_buffer, audio_buffer + len, audio_avail );
-		}
+		// Take what the render thread has queued without waiting for it
+		if ( audio_ring )
+			mlt_audio_ring_read( audio_ring, outbuf, samples );
 		else
-		{
-			// Just to be safe, wipe the stream first
-			memset( outbuf, 0, len );
-
-			// Copy what we have
-			memcpy( outbuf, audio_buffer, audio_avail );
-
-			// No audio left
-			audio_avail = 0;
-		}
+			memset( outbuf, 0, mlt_audio_format_size( mlt_audio_s16, samples, out_channels ) );
 
 		if ( volume != 1.0 )
 		{
@@ -556,9 +541,6 @@ public:
 		// We're definitely playing now
 		playing = 1;
 
-		pthread_cond_broadcast( &audio_cond );
-		pthread_mutex_unlock( &audio_mutex );
-
 		return 0;
 	}
 
@@ -606,17 +588,15 @@ public:
 			int samples_copied = 0;
 			int dst_stride = out_channels * sizeof( *pcm );
 
-			pthread_mutex_lock( &audio_mutex );
+			volume = mlt_properties_get_double( MLT_CONSUMER_PROPERTIES( getConsumer() ), "volume" );
 
 			while ( running && samples_copied < samples )
 			{
-				int sample_space = ( sizeof( audio_buffer ) - audio_avail ) / dst_stride;
+				int sample_space = mlt_audio_ring_space( audio_ring );
 
+				// The callback does not signal, so poll until it has consumed some samples
 				while ( running && sample_space == 0 )
-				{
-					pthread_cond_wait( &audio_cond, &audio_mutex );
-					sample_space = ( sizeof( audio_buffer ) - audio_avail ) / dst_stride;
-				}
+					sample_space = mlt_audio_ring_wait_space( audio_ring, samples - samples_copied, 100 );
 				if ( running )
 				{
 					int samples_to_copy = samples - samples_copied;
@@ -624,18 +604,18 @@ public:
 					{
 						samples_to_copy = sample_space;
 					}
+					int16_t *dest = (int16_t*) mlt_audio_ring_write_begin( audio_ring, &samples_to_copy );
 					int dst_bytes = samples_to_copy * dst_stride;
 
 					if ( scrub || mlt_properties_get_double( properties, "_speed" ) == 1 )
 					{
 						if ( channels == out_channels )
 						{
-							memcpy( &audio_buffer[ audio_avail ], pcm, dst_bytes );
+							memcpy( dest, pcm, dst_bytes );
 							pcm += samples_to_copy * channels;
 						}
 						else
 						{
-							int16_t *dest = (int16_t*) &audio_buffer[ audio_avail ];
 							int i = samples_to_copy + 1;
 							while ( --i )
 							{
@@ -647,15 +627,17 @@ public:
 					}
 					else
 					{
-						memset( &audio_buffer[ audio_avail ], 0, dst_bytes );
+						memset( dest, 0, dst_bytes );
 						pcm += samples_to_copy * channels;
 					}
-					audio_avail += dst_bytes;
+					mlt_audio_ring_write_end( audio_ring, samples_to_copy );
 					samples_copied += samples_to_copy;
 				}
-				pthread_cond_broadcast( &audio_cond );
 			}
-			pthread_mutex_unlock( &audio_mutex );
+
+			// Report the state of the audio output for monitoring
+			mlt_properties_set_int64( MLT_CONSUMER_PROPERTIES( getConsumer() ), "audio_underruns", mlt_audio_ring_underruns( audio_ring ) );
+			mlt_properties_set_double( MLT_CONSUMER_PROPERTIES( getConsumer() ), "audio_latency", 1000.0 * mlt_audio_ring_available( audio_ring ) / frequency );
 		}
 
 		return init_audio;
@@ -25,6 +25,7 @@
 #include <framework/mlt_factory.h>
 #include <framework/mlt_filter.h>
 #include <framework/mlt_log.h>
+#include <framework/mlt_audio_ring.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,6 +36,11 @@
 
 extern pthread_mutex_t mlt_sdl_mutex;
 
+/** The size in bytes of the audio queued for the device.
+*/
+
+#define AUDIO_RING_SIZE ( 4096 * 10 )
+
 /** This classes definition.
 */
 
@@ -48,10 +54,8 @@ struct consumer_sdl_s
 	pthread_t thread;
 	int joined;
 	atomic_int running;
-	uint8_t audio_buffer[ 4096 * 10 ];
-	int audio_avail;
-	pthread_mutex_t audio_mutex;
-	pthread_cond_t audio_cond;
+	mlt_audio_ring audio_ring;
+	_Atomic double volume;
 	pthread_mutex_t video_mutex;
 	pthread_cond_t video_cond;
 	int out_channels;
@@ -104,10 +108,9 @@ mlt_consumer consumer_sdl2_audio_init( mlt_profile profile, mlt_service_type typ
 
 		// Set the default volume
 		mlt_properties_set_double( self->properties, "volume", 1.0 );
+		self->volume = 1.0;
 
 		// This is the initialisation of the consumer
-		pthread_mutex_init( &self->audio_mutex, NULL );
-		pthread_cond_init( &self->audio_cond, NULL);
 		pthread_mutex_init( &self->video_mutex, NULL );
 		pthread_cond_init( &self->video_cond, NULL);
 
@@ -221,10 +224,6 @@ int consumer_stop( mlt_consumer parent )
 		pthread_cond_broadcast( &self->video_cond );
 		pthread_mutex_unlock( &self->video_mutex );
 
-		// Unlatch the audio callback
-		pthread_mutex_lock( &self->audio_mutex );
-		pthread_cond_broadcast( &self->audio_cond );
-		pthread_mutex_unlock( &self->audio_mutex );
 #ifdef _WIN32
 		if ( !self->no_quit_subsystem )
 #endif
@@ -264,39 +263,27 @@ static void sdl_fill_audio( void *udata, uint8_t *stream, int len )
 	consumer_sdl self = udata;
 
 	// Get the volume
-	double volume = mlt_properties_get_double( self->properties, "volume" );
+	double volume = self->volume;
 
 	// Wipe the stream first
 	memset( stream, 0, len );
 
-	pthread_mutex_lock( &self->audio_mutex );
-	int bytes = MIN(len, self->audio_avail);
+	// Take what the render thread has queued without waiting for it
+	if ( self->audio_ring )
+		mlt_audio_ring_read( self->audio_ring, stream, len / ( self->out_channels * sizeof( int16_t ) ) );
 
-	// Place in the audio buffer
 	if ( volume != 1.0 ) {
-		// Adjust the volume while copying.
-		int16_t *src = (int16_t*) self->audio_buffer;
+		// Adjust the volume in place.
 		int16_t *dst = (int16_t*) stream;
-		int i = bytes / sizeof(*dst) + 1;
+		int i = len / sizeof(*dst) + 1;
 		while (--i) {
-			*dst++ = CLAMP(volume * src[0], -32768, 32767);
-			src++;
+			*dst = CLAMP(volume * dst[0], -32768, 32767);
+			dst++;
 		}
-	} else {
-		memcpy( stream, self->audio_buffer, bytes );
 	}
 
-	// Remove len from the audio available
-	self->audio_avail -= bytes;
-
-	// Remove the samples
-	memmove( self->audio_buffer, self->audio_buffer + bytes, self->audio_avail );
-
 	// We're definitely playing now
 	self->playing = 1;
-
-	pthread_cond_broadcast( &self->audio_cond );
-	pthread_mutex_unlock( &self->audio_mutex );
 }
 
 static int consumer_play_audio( consumer_sdl self, mlt_frame frame, int init_audio, int64_t *duration )
@@ -354,9 +341,24 @@ static int consumer_play_audio( consumer_sdl self, mlt_frame frame, int init_aud
 				mlt_log_info( MLT_CONSUMER_SERVICE( self ), "Unable to output %d channels. Change to %d\n", request.channels, got.channels );
 			}
 				mlt_log_info( MLT_CONSUMER_SERVICE( self ), "Audio Opened: driver=%s channels=%d frequency=%d\n", SDL_GetCurrentAudioDriver(), got.channels, got.freq );
-			SDL_PauseAudioDevice( dev, 0 );
-			init_audio = 0;
-			self->out_channels = got.channels;
+			// The device stays paused until the ring is in place
+			if ( !self->audio_ring || self->out_channels != got.channels )
+			{
+				mlt_audio_ring_close( self->audio_ring );
+				self->audio_ring = mlt_audio_ring_new( got.channels * sizeof( int16_t ), AUDIO_RING_SIZE / ( got.channels * sizeof( int16_t ) ) );
+			}
+			if ( !self->audio_ring )
+			{
+				mlt_log_error( MLT_CONSUMER_SERVICE( self ), "Failed to allocate the audio ring\n" );
+				SDL_CloseAudioDevice( dev );
+				init_audio = 2;
+			}
+			else
+			{
+				self->out_channels = got.channels;
+				SDL_PauseAudioDevice( dev, 0 );
+				init_audio = 0;
+			}
 		}
 	}
 
@@ -365,27 +367,21 @@ static int consumer_play_audio( consumer_sdl self, mlt_frame frame, int init_aud
 		mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
 		int samples_copied = 0;
 		int dst_stride = self->out_channels * sizeof( *pcm );
+		int waited = 0;
 
-		pthread_mutex_lock( &self->audio_mutex );
+		self->volume = mlt_properties_get_double( self->properties, "volume" );
 
 		while ( self->running && samples_copied < samples )
 		{
-			int sample_space = ( sizeof( self->audio_buffer ) - self->audio_avail ) / dst_stride;
+			int sample_space = mlt_audio_ring_space( self->audio_ring );
 			while ( self->running && sample_space == 0 )
 			{
-				struct timeval now;
-				struct timespec tm;
-
-				gettimeofday( &now, NULL );
-				tm.tv_sec = now.tv_sec + 1;
-				tm.tv_nsec = now.tv_usec * 1000;
-				pthread_cond_timedwait( &self->audio_cond, &self->audio_mutex, &tm );
-				sample_space = ( sizeof( self->audio_buffer ) - self->audio_avail ) / dst_stride;
+				// The audio callback does not signal, so poll until it has consumed some samples
+				sample_space = mlt_audio_ring_wait_space( self->audio_ring, samples - samples_copied, 100 );
 
-				if ( sample_space == 0 )
+				if ( sample_space == 0 && ++waited == 10 )
 				{
 					mlt_log_warning( MLT_CONSUMER_SERVICE(&self->parent), "audio timed out\n" );
-					pthread_mutex_unlock( &self->audio_mutex );
 #ifdef _WIN32
 					self->no_quit_subsystem = 1;
 #endif
@@ -399,18 +395,18 @@ static int consumer_play_audio( consumer_sdl self, mlt_frame frame, int init_aud
 				{
 					samples_to_copy = sample_space;
 				}
+				int16_t *dest = mlt_audio_ring_write_begin( self->audio_ring, &samples_to_copy );
 				int dst_bytes = samples_to_copy * dst_stride;
 
 				if ( scrub || mlt_properties_get_double( properties, "_speed" ) == 1 )
 				{
 					if ( channels == self->out_channels )
 					{
-						memcpy( &self->audio_buffer[ self->audio_avail ], pcm, dst_bytes );
+						memcpy( dest, pcm, dst_bytes );
 						pcm += samples_to_copy * channels;
 					}
 					else
 					{
-						int16_t *dest = (int16_t*) &self->audio_buffer[ self->audio_avail ];
 						int i = samples_to_copy + 1;
 						while ( --i )
 						{
@@ -422,15 +418,17 @@ static int consumer_play_audio( consumer_sdl self, mlt_frame frame, int init_aud
 				}
 				else
 				{
-					memset( &self->audio_buffer[ self->audio_avail ], 0, dst_bytes );
+					memset( dest, 0, dst_bytes );
 					pcm += samples_to_copy * channels;
 				}
-				self->audio_avail += dst_bytes;
+				mlt_audio_ring_write_end( self->audio_ring, samples_to_copy );
 				samples_copied += samples_to_copy;
 			}
-			pthread_cond_broadcast( &self->audio_cond );
 		}
-		pthread_mutex_unlock( &self->audio_mutex );
+
+		// Report the state of the audio output for monitoring
+		mlt_properties_set_int64( self->properties, "audio_underruns", mlt_audio_ring_underruns( self->audio_ring ) );
+		mlt_properties_set_double( self->properties, "audio_latency", 1000.0 * mlt_audio_ring_available( self->audio_ring ) / frequency );
 	}
 	else
 	{
@@ -691,9 +689,8 @@ static void *consumer_thread( void *arg )
 		frame = NULL;
 	}
 
-	pthread_mutex_lock( &self->audio_mutex );
-	self->audio_avail = 0;
-	pthread_mutex_unlock( &self->audio_mutex );
+	if ( self->audio_ring )
+		mlt_audio_ring_flush( self->audio_ring );
 
 	return NULL;
 }
@@ -716,8 +713,7 @@ static void consumer_close( mlt_consumer parent )
 	mlt_deque_close( self->queue );
 
 	// Destroy mutexes
-	pthread_mutex_destroy( &self->audio_mutex );
-	pthread_cond_destroy( &self->audio_cond );
+	mlt_audio_ring_close( self->audio_ring );
 	pthread_mutex_destroy( &self->video_mutex );
 	pthread_cond_destroy( &self->video_cond );
 	pthread_mutex_destroy( &self->refresh_mutex );
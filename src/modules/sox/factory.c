@@ -17,12 +17,19 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <framework/mlt.h>
 
 #include <string.h>
 #include <limits.h>
 #ifdef SOX14
 #include <sox.h>
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
 #endif
 
 extern mlt_filter filter_sox_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
@@ -73,6 +80,12 @@ MLT_REPOSITORY
 	int i;
 	const sox_effect_handler_t *e;
 	char name[64] = "sox.";
+#ifndef _WIN32
+	// The effects come from the installed libsox, so rebuild the cache when it changes.
+	Dl_info info;
+	if ( sox_effect_fns[0] && dladdr( (void*) sox_effect_fns[0], &info ) && info.dli_fname )
+		mlt_repository_watch( repository, info.dli_fname );
+#endif
 	for ( i = 0; sox_effect_fns[i]; i++ )
 	{
 		e = sox_effect_fns[i]();
@@ -21,6 +21,7 @@
 #include <framework/mlt_log.h>
 #include <framework/mlt_producer.h>
 #include <framework/mlt_events.h>
+#include <framework/mlt_slices.h>
 #include "deinterlace.h"
 #include "yadif.h"
 
@@ -36,13 +37,7 @@ static yadif_filter *init_yadif( int width, int height )
 {
 	yadif_filter *yadif = mlt_pool_alloc( sizeof( *yadif ) );
 
-	yadif->cpu = 0; // Pure C
-#ifdef USE_SSE
-	yadif->cpu |= AVS_CPU_INTEGER_SSE;
-#endif
-#ifdef USE_SSE2
-	yadif->cpu |= AVS_CPU_SSE2;
-#endif
+	yadif->cpu = yadif_cpu_flags();
 	// Create intermediate planar planes
 	yadif->yheight = height;
 	yadif->ywidth  = width;
@@ -98,6 +93,122 @@ static void close_yadif(yadif_filter *yadif)
 #endif
 }
 
+struct yadif_slice_desc
+{
+	int mode;
+	int parity;
+	int tff;
+	int cpu;
+	int is16;
+	struct
+	{
+		uint8_t *dst;
+		const uint8_t *prev, *cur, *next;
+		int stride; // in samples
+		int width, height;
+	} planes[3];
+};
+
+static int yadif_slice_proc( int id, int idx, int jobs, void* cookie )
+{
+	struct yadif_slice_desc *desc = (struct yadif_slice_desc*) cookie;
+	int i;
+
+	for ( i = 0; i < 3; i++ )
+	{
+		int h = desc->planes[i].height;
+		int size = ( h + jobs - 1 ) / jobs;
+		int y_start = idx * size;
+		int y_end = y_start + size;
+
+		if ( desc->is16 )
+			filter_plane16_slice( desc->mode, (uint16_t*) desc->planes[i].dst, desc->planes[i].stride,
+				(const uint16_t*) desc->planes[i].prev, (const uint16_t*) desc->planes[i].cur, (const uint16_t*) desc->planes[i].next,
+				desc->planes[i].stride, desc->planes[i].width, h, desc->parity, desc->tff, y_start, y_end );
+		else
+			filter_plane_slice( desc->mode, desc->planes[i].dst, desc->planes[i].stride,
+				desc->planes[i].prev, desc->planes[i].cur, desc->planes[i].next,
+				desc->planes[i].stride, desc->planes[i].width, h, desc->parity, desc->tff, desc->cpu, y_start, y_end );
+	}
+	return 0;
+}
+
+static void set_slice_plane( struct yadif_slice_desc *desc, int i, uint8_t *dst, const uint8_t *prev, const uint8_t *cur, const uint8_t *next, int stride, int width, int height )
+{
+	desc->planes[i].dst = dst;
+	desc->planes[i].prev = prev;
+	desc->planes[i].cur = cur;
+	desc->planes[i].next = next;
+	desc->planes[i].stride = stride;
+	desc->planes[i].width = width;
+	desc->planes[i].height = height;
+}
+
+/** Deinterlace a planar image in place of its native format.
+ *
+ * Returns false, with the image request restored, when the current and next
+ * frames cannot be delivered in the format and size of the previous one.
+*/
+
+static int deinterlace_yadif_planar( mlt_frame frame, uint8_t *previous_image, int previous_width, int previous_height, uint8_t **image, mlt_image_format *format, int *width, int *height, int mode, int *error )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
+	mlt_frame next_frame = mlt_properties_get_data( properties, "next frame", NULL );
+	mlt_image_format requested = *format;
+	int requested_width = *width;
+	int requested_height = *height;
+	uint8_t *next_image = NULL;
+	int next_width = *width;
+	int next_height = *height;
+
+	*error = mlt_frame_get_image( frame, image, format, width, height, 0 );
+
+	if ( !*error && *image && *format == requested )
+		*error = mlt_frame_get_image( next_frame, &next_image, format, &next_width, &next_height, 0 );
+
+	if ( *error )
+		return 1;
+
+	if ( !*image || !next_image || *format != requested ||
+		*width != previous_width || *height != previous_height ||
+		next_width != *width || next_height != *height )
+	{
+		*format = requested;
+		*width = requested_width;
+		*height = requested_height;
+		return 0;
+	}
+
+	int size = mlt_image_format_size( *format, *width, *height, NULL );
+	uint8_t *new_image = mlt_pool_alloc( size );
+	uint8_t *dst[4], *prev[4], *cur[4], *next[4];
+	int strides[4];
+	int is16 = *format == mlt_image_yuv422p16;
+	int chroma_height = is16 ? *height : *height / 2;
+	struct yadif_slice_desc desc;
+	int i;
+
+	mlt_image_format_planes( *format, *width, *height, new_image, dst, strides );
+	mlt_image_format_planes( *format, *width, *height, previous_image, prev, strides );
+	mlt_image_format_planes( *format, *width, *height, *image, cur, strides );
+	mlt_image_format_planes( *format, *width, *height, next_image, next, strides );
+
+	desc.mode = mode;
+	desc.parity = 0;
+	desc.tff = mlt_properties_get_int( properties, "top_field_first" );
+	desc.cpu = yadif_cpu_flags();
+	desc.is16 = is16;
+	for ( i = 0; i < 3; i++ )
+		set_slice_plane( &desc, i, dst[i], prev[i], cur[i], next[i], strides[i] >> is16,
+			i ? *width / 2 : *width, i ? chroma_height : *height );
+	mlt_slices_run_normal( 0, yadif_slice_proc, &desc );
+
+	mlt_frame_set_image( frame, new_image, size, mlt_pool_release );
+	*image = new_image;
+
+	return 1;
+}
+
 static int deinterlace_yadif( mlt_frame frame, mlt_filter filter, uint8_t **image, mlt_image_format *format, int *width, int *height, int mode )
 {
 	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
@@ -125,10 +236,27 @@ static int deinterlace_yadif( mlt_frame frame, mlt_filter filter, uint8_t **imag
 	int progressive = mlt_properties_get_int( MLT_FRAME_PROPERTIES( previous_frame ), "progressive" );
 
 	// Check that we aren't already progressive
-	if ( !error && previous_image && !progressive )
+	int planar = !error && previous_image && !progressive &&
+		( *format == mlt_image_yuv420p || *format == mlt_image_yuv422p16 );
+
+	if ( planar )
+	{
+		// Planar formats are filtered directly without repacking
+		mlt_service_unlock( MLT_FILTER_SERVICE(filter) );
+		planar = deinterlace_yadif_planar( frame, previous_image, previous_width, previous_height, image, format, width, height, mode, &error );
+		if ( !planar )
+		{
+			mlt_log_debug( MLT_FILTER_SERVICE(filter), "frames differ from the previous %s image, using yuv422\n", mlt_image_format_name( *format ) );
+			mlt_service_lock( MLT_FILTER_SERVICE(filter) );
+		}
+	}
+
+	if ( !planar && !error && previous_image && !progressive )
 	{
 		// OK, now we know we have work to do and can request the image in our format
-		frame->convert_image( previous_frame, &previous_image, format, mlt_image_yuv422 );
+		if ( frame->convert_image )
+			frame->convert_image( previous_frame, &previous_image, format, mlt_image_yuv422 );
+		int previous_packed = *format == mlt_image_yuv422;
 
 		mlt_service_unlock( MLT_FILTER_SERVICE(filter) );
 
@@ -136,7 +264,9 @@ static int deinterlace_yadif( mlt_frame frame, mlt_filter filter, uint8_t **imag
 		*format = mlt_image_yuv422;
 		error = mlt_frame_get_image( frame, image, format, width, height, 1 );
 
-		if ( !error && *image && *format == mlt_image_yuv422 )
+		if ( !error && *image && ( *format != mlt_image_yuv422 || !previous_packed ) )
+			mlt_log_error( MLT_FILTER_SERVICE(filter), "cannot convert the images to yuv422\n" );
+		else if ( !error && *image )
 		{
 			// Get the following frame's image
 			error = mlt_frame_get_image( next_frame, &next_image, format, &next_width, &next_height, 0 );
@@ -149,6 +279,7 @@ static int deinterlace_yadif( mlt_frame frame, mlt_filter filter, uint8_t **imag
 					const int order = mlt_properties_get_int( properties, "top_field_first" );
 					const int pitch = *width << 1;
 					const int parity = 0;
+					struct yadif_slice_desc desc;
 
 					// Convert packed to planar
 					YUY2ToPlanes( *image, pitch, *width, *height, yadif->ysrc,
@@ -159,12 +290,18 @@ static int deinterlace_yadif( mlt_frame frame, mlt_filter filter, uint8_t **imag
 						yadif->ypitch, yadif->unext, yadif->vnext, yadif->uvpitch, yadif->cpu );
 
 					// Deinterlace each plane
-					filter_plane( mode, yadif->ydest, yadif->ypitch, yadif->yprev, yadif->ysrc,
-						yadif->ynext, yadif->ypitch, *width, *height, parity, order, yadif->cpu);
-					filter_plane( mode, yadif->udest, yadif->uvpitch,yadif->uprev, yadif->usrc,
-						yadif->unext, yadif->uvpitch, *width >> 1, *height, parity, order, yadif->cpu);
-					filter_plane( mode, yadif->vdest, yadif->uvpitch, yadif->vprev, yadif->vsrc,
-						yadif->vnext, yadif->uvpitch, *width >> 1, *height, parity, order, yadif->cpu);
+					desc.mode = mode;
+					desc.parity = parity;
+					desc.tff = order;
+					desc.cpu = yadif->cpu;
+					desc.is16 = 0;
+					set_slice_plane( &desc, 0, yadif->ydest, yadif->yprev, yadif->ysrc, yadif->ynext,
+						yadif->ypitch, *width, *height );
+					set_slice_plane( &desc, 1, yadif->udest, yadif->uprev, yadif->usrc, yadif->unext,
+						yadif->uvpitch, *width >> 1, *height );
+					set_slice_plane( &desc, 2, yadif->vdest, yadif->vprev, yadif->vsrc, yadif->vnext,
+						yadif->uvpitch, *width >> 1, *height );
+					mlt_slices_run_normal( 0, yadif_slice_proc, &desc );
 
 					// Convert planar to packed
 					YUY2FromPlanes( *image, pitch, *width, *height, yadif->ydest,
@@ -175,7 +312,7 @@ static int deinterlace_yadif( mlt_frame frame, mlt_filter filter, uint8_t **imag
 			}
 		}
 	}
-	else
+	else if ( !planar )
 	{
 		mlt_service_unlock( MLT_FILTER_SERVICE(filter) );
 
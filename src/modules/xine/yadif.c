@@ -33,7 +33,7 @@
 #define MIN3(a,b,c) MIN(MIN(a,b),c)
 #define MAX3(a,b,c) MAX(MAX(a,b),c)
 
-static void (*filter_line)(int mode, uint8_t *dst, const uint8_t *prev, const uint8_t *cur, const uint8_t *next, int w, int refs, int parity);
+typedef void (*filter_line_fn)(int mode, uint8_t *dst, const uint8_t *prev, const uint8_t *cur, const uint8_t *next, int w, int refs, int parity);
 
 #if defined(__GNUC__) && defined(USE_SSE)
 
@@ -265,17 +265,6 @@ static void filter_line_mmx2(int mode, uint8_t *dst, const uint8_t *prev, const
 #define DECLARE_ALIGNED(n,t,v)       t v __attribute__ ((aligned (n)))
 #endif
 
-// ================= SSE2 =================
-#if defined(USE_SSE2) && defined(ARCH_X86_64)
-#define PABS(tmp,dst) \
-            "pxor     "#tmp", "#tmp" \n\t"\
-            "psubw    "#dst", "#tmp" \n\t"\
-            "pmaxsw   "#tmp", "#dst" \n\t"
-
-#define FILTER_LINE_FUNC_NAME filter_line_sse2
-#include "vf_yadif_template.h"
-#endif
-
 // ================ SSSE3 =================
 #ifdef USE_SSE3
 #define PABS(tmp,dst) \
@@ -288,137 +277,129 @@ static void filter_line_mmx2(int mode, uint8_t *dst, const uint8_t *prev, const
 #endif // GCC 4.2+
 #endif // GNUC, USE_SSE
 
-static void filter_line_c(int mode, uint8_t *dst, const uint8_t *prev, const uint8_t *cur, const uint8_t *next, int w, int refs, int parity){
-    int x;
-    const uint8_t *prev2= parity ? prev : cur ;
-    const uint8_t *next2= parity ? cur  : next;
-    for(x=0; x<w; x++){
-        int c= cur[-refs];
-        int d= (prev2[0] + next2[0])>>1;
-        int e= cur[+refs];
-        int temporal_diff0= ABS(prev2[0] - next2[0]);
-        int temporal_diff1=( ABS(prev[-refs] - c) + ABS(prev[+refs] - e) )>>1;
-        int temporal_diff2=( ABS(next[-refs] - c) + ABS(next[+refs] - e) )>>1;
-        int diff= MAX3(temporal_diff0>>1, temporal_diff1, temporal_diff2);
-        int spatial_pred= (c+e)>>1;
-        int spatial_score= ABS(cur[-refs-1] - cur[+refs-1]) + ABS(c-e)
-                         + ABS(cur[-refs+1] - cur[+refs+1]) - 1;
-
-#define CHECK(j)\
-    {   int score= ABS(cur[-refs-1+ j] - cur[+refs-1- j])\
-                 + ABS(cur[-refs  + j] - cur[+refs  - j])\
-                 + ABS(cur[-refs+1+ j] - cur[+refs+1- j]);\
-        if(score < spatial_score){\
-            spatial_score= score;\
-            spatial_pred= (cur[-refs  + j] + cur[+refs  - j])>>1;\
-
-        CHECK(-1) CHECK(-2) }} }}
-        CHECK( 1) CHECK( 2) }} }}
-
-        if(mode<2){
-            int b= (prev2[-2*refs] + next2[-2*refs])>>1;
-            int f= (prev2[+2*refs] + next2[+2*refs])>>1;
-#if 0
-            int a= cur[-3*refs];
-            int g= cur[+3*refs];
-            int max= MAX3(d-e, d-c, MIN3(MAX(b-c,f-e),MAX(b-c,b-a),MAX(f-g,f-e)) );
-            int min= MIN3(d-e, d-c, MAX3(MIN(b-c,f-e),MIN(b-c,b-a),MIN(f-g,f-e)) );
-#else
-            int max= MAX3(d-e, d-c, MIN(b-c, f-e));
-            int min= MIN3(d-e, d-c, MAX(b-c, f-e));
-#endif
-
-            diff= MAX3(diff, min, -max);
-        }
+#define PIXEL uint8_t
+#define FILTER_LINE_C_NAME filter_line_c
+#define INTERPOLATE_NAME interpolate
+#define FILTER_PLANE_ROWS_NAME filter_plane_rows
+#include "yadif_plane_template.h"
 
-        if(spatial_pred > d + diff)
-           spatial_pred = d + diff;
-        else if(spatial_pred < d - diff)
-           spatial_pred = d - diff;
+#define PIXEL uint16_t
+#define FILTER_LINE_C_NAME filter_line_c16
+#define INTERPOLATE_NAME interpolate16
+#define FILTER_PLANE_ROWS_NAME filter_plane_rows16
+#include "yadif_plane_template.h"
 
-        dst[0] = spatial_pred;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__SSE2__))
+#include <immintrin.h>
 
-        dst++;
-        cur++;
-        prev++;
-        next++;
-        prev2++;
-        next2++;
-    }
-}
+// ================= SSE2 =================
+#define FILTER_LINE_FUNC_NAME filter_line_sse2
+#define FUNC_ATTR __attribute__((target("sse2")))
+#define VEC __m128i
+#define VW 8
+#define V_LOAD(p) _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (p)), _mm_setzero_si128())
+#define V_STORE(p, v) _mm_storel_epi64((__m128i*) (p), _mm_packus_epi16(v, v))
+#define V_SET1 _mm_set1_epi16
+#define V_ADD _mm_add_epi16
+#define V_SUB _mm_sub_epi16
+#define V_MIN _mm_min_epi16
+#define V_MAX _mm_max_epi16
+#define V_SRA1(a) _mm_srai_epi16(a, 1)
+#define V_CMPGT _mm_cmpgt_epi16
+#define V_AND _mm_and_si128
+#define V_ANDNOT _mm_andnot_si128
+#define V_OR _mm_or_si128
+#include "yadif_intrin_template.h"
+
+// ================= AVX2 =================
+#define HAVE_YADIF_AVX2
+#define FILTER_LINE_FUNC_NAME filter_line_avx2
+#define FUNC_ATTR __attribute__((target("avx2")))
+#define VEC __m256i
+#define VW 16
+#define V_LOAD(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (p)))
+#define V_STORE(p, v) _mm_storeu_si128((__m128i*) (p), _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0xd8)))
+#define V_SET1 _mm256_set1_epi16
+#define V_ADD _mm256_add_epi16
+#define V_SUB _mm256_sub_epi16
+#define V_MIN _mm256_min_epi16
+#define V_MAX _mm256_max_epi16
+#define V_SRA1(a) _mm256_srai_epi16(a, 1)
+#define V_CMPGT _mm256_cmpgt_epi16
+#define V_AND _mm256_and_si256
+#define V_ANDNOT _mm256_andnot_si256
+#define V_OR _mm256_or_si256
+#include "yadif_intrin_template.h"
+
+#define HAVE_YADIF_SSE2
+#endif
 
-static void interpolate(uint8_t *dst, const uint8_t *cur0,  const uint8_t *cur2, int w)
+/** Detect the instruction sets usable by the line filters.
+*/
+int yadif_cpu_flags(void)
 {
-    int x;
-    for (x=0; x<w; x++) {
-        dst[x] = (cur0[x] + cur2[x] + 1)>>1; // simple average
-    }
+	int cpu = 0;
+#ifdef USE_SSE
+	cpu |= AVS_CPU_INTEGER_SSE;
+#endif
+#ifdef HAVE_YADIF_SSE2
+	if (__builtin_cpu_supports("sse2"))
+		cpu |= AVS_CPU_SSE2;
+#endif
+#ifdef HAVE_YADIF_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		cpu |= AVS_CPU_AVX2;
+#endif
+	return cpu;
 }
 
-void filter_plane(int mode, uint8_t *dst, int dst_stride, const uint8_t *prev0, const uint8_t *cur0, const uint8_t *next0, int refs, int w, int h, int parity, int tff, int cpu){
-
-	int y;
-	filter_line = filter_line_c;
+static filter_line_fn select_filter_line(int cpu)
+{
+#ifdef HAVE_YADIF_AVX2
+	if (cpu & AVS_CPU_AVX2)
+		return filter_line_avx2;
+#endif
+#ifdef HAVE_YADIF_SSE2
+	if (cpu & AVS_CPU_SSE2)
+		return filter_line_sse2;
+#endif
 #ifdef __GNUC__
 #if (__GNUC__ > 4 || __GNUC__ == 4 && __GNUC_MINOR__>1)
 #ifdef USE_SSE3
 	if (cpu & AVS_CPU_SSSE3)
-		filter_line = filter_line_ssse3;
-	else
-#endif
-#if defined(USE_SSE2) && defined(ARCH_X86_64)
-	if (cpu & AVS_CPU_SSE2)
-		filter_line = filter_line_sse2;
-	else
+		return filter_line_ssse3;
 #endif
 #endif // GCC 4.2+
 #ifdef USE_SSE
 	if (cpu & AVS_CPU_INTEGER_SSE)
-		filter_line = filter_line_mmx2;
+		return filter_line_mmx2;
 #endif
 #endif // GNUC
-        y=0;
-        if(((y ^ parity) & 1)){
-            memcpy(dst, cur0 + refs, w);// duplicate 1
-        }else{
-            memcpy(dst, cur0, w);
-        }
-        y=1;
-        if(((y ^ parity) & 1)){
-            interpolate(dst + dst_stride, cur0, cur0 + refs*2, w);   // interpolate 0 and 2
-        }else{
-            memcpy(dst + dst_stride, cur0 + refs, w); // copy original
-        }
-        for(y=2; y<h-2; y++){
-            if(((y ^ parity) & 1)){
-                const uint8_t *prev= prev0 + y*refs;
-                const uint8_t *cur = cur0 + y*refs;
-                const uint8_t *next= next0 + y*refs;
-                uint8_t *dst2= dst + y*dst_stride;
-                filter_line(mode, dst2, prev, cur, next, w, refs, (parity ^ tff));
-            }else{
-                memcpy(dst + y*dst_stride, cur0 + y*refs, w); // copy original
-            }
-        }
-       y=h-2;
-        if(((y ^ parity) & 1)){
-            interpolate(dst + (h-2)*dst_stride, cur0 + (h-3)*refs, cur0 + (h-1)*refs, w);   // interpolate h-3 and h-1
-        }else{
-            memcpy(dst + (h-2)*dst_stride, cur0 + (h-2)*refs, w); // copy original
-        }
-        y=h-1;
-        if(((y ^ parity) & 1)){
-            memcpy(dst + (h-1)*dst_stride, cur0 + (h-2)*refs, w); // duplicate h-2
-        }else{
-            memcpy(dst + (h-1)*dst_stride, cur0 + (h-1)*refs, w); // copy original
-        }
+	return filter_line_c;
+}
+
+void filter_plane_slice(int mode, uint8_t *dst, int dst_stride, const uint8_t *prev0, const uint8_t *cur0, const uint8_t *next0, int refs, int w, int h, int parity, int tff, int cpu, int y_start, int y_end)
+{
+	filter_line_fn filter_line = select_filter_line(cpu);
+
+	filter_plane_rows(mode, dst, dst_stride, prev0, cur0, next0, refs, w, h, parity, tff, filter_line, y_start, y_end);
 
 #if defined(__GNUC__) && defined(USE_SSE)
-	if (cpu >= AVS_CPU_INTEGER_SSE)
+	if (filter_line == filter_line_mmx2)
 		asm volatile("emms");
 #endif
 }
 
+void filter_plane(int mode, uint8_t *dst, int dst_stride, const uint8_t *prev0, const uint8_t *cur0, const uint8_t *next0, int refs, int w, int h, int parity, int tff, int cpu)
+{
+	filter_plane_slice(mode, dst, dst_stride, prev0, cur0, next0, refs, w, h, parity, tff, cpu, 0, h);
+}
+
+void filter_plane16_slice(int mode, uint16_t *dst, int dst_stride, const uint16_t *prev0, const uint16_t *cur0, const uint16_t *next0, int refs, int w, int h, int parity, int tff, int y_start, int y_end)
+{
+	filter_plane_rows16(mode, dst, dst_stride, prev0, cur0, next0, refs, w, h, parity, tff, filter_line_c16, y_start, y_end);
+}
+
 #if defined(__GNUC__) && defined(USE_SSE) && !defined(PIC)
 static attribute_align_arg void  YUY2ToPlanes_mmx(const unsigned char *srcYUY2, int pitch_yuy2, int width, int height,
                     unsigned char *py, int pitch_y,
@@ -30,6 +30,7 @@
 #define AVS_CPU_INTEGER_SSE 0x1
 #define AVS_CPU_SSE2 0x2
 #define AVS_CPU_SSSE3 0x4
+#define AVS_CPU_AVX2 0x8
 
 typedef struct yadif_filter  {
 	int cpu; // optimization
@@ -52,6 +53,9 @@ typedef struct yadif_filter  {
 	unsigned char *vdest;
 } yadif_filter;
 
+int yadif_cpu_flags(void);
+void filter_plane_slice(int mode, uint8_t *dst, int dst_stride, const uint8_t *prev0, const uint8_t *cur0, const uint8_t *next0, int refs, int w, int h, int parity, int tff, int cpu, int y_start, int y_end);
+void filter_plane16_slice(int mode, uint16_t *dst, int dst_stride, const uint16_t *prev0, const uint16_t *cur0, const uint16_t *next0, int refs, int w, int h, int parity, int tff, int y_start, int y_end);
 void filter_plane(int mode, uint8_t *dst, int dst_stride, const uint8_t *prev0, const uint8_t *cur0, const uint8_t *next0, int refs, int w, int h, int parity, int tff, int cpu);
 void YUY2ToPlanes(const unsigned char *pSrcYUY2, int nSrcPitchYUY2, int nWidth, int nHeight,
 							   unsigned char * pSrcY, int srcPitchY,
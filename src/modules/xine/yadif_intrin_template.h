@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2006 Michael Niedermayer <michaelni@gmx.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* 8-bit line filter written with compiler intrinsics, instantiated once per
+ * vector width. Samples are widened to signed 16-bit lanes, so the arithmetic
+ * matches filter_line_c exactly. Only whole vectors inside the line are
+ * processed; the remainder goes to the C version so no sample past w is
+ * written, which keeps concurrent slices on neighbouring rows independent.
+ *
+ * Define before including:
+ *   FILTER_LINE_FUNC_NAME  name of the function
+ *   FUNC_ATTR              function attributes, such as the target ISA
+ *   VEC                    the vector type
+ *   VW                     samples per vector
+ *   V_LOAD(p)              load VW bytes from p widened to 16-bit lanes
+ *   V_STORE(p, v)          store VW lanes to p narrowed to bytes
+ *   V_SET1, V_ADD, V_SUB, V_MIN, V_MAX, V_SRA1, V_CMPGT, V_AND, V_ANDNOT, V_OR
+ */
+
+#define V_ABSDIFF(a, b) V_MAX(V_SUB(a, b), V_SUB(b, a))
+#define V_BLEND(mask, a, b) V_OR(V_AND(mask, a), V_ANDNOT(mask, b))
+
+#define CHECK_SCORE(j) \
+    V_ADD(V_ADD(V_ABSDIFF(V_LOAD(cur + x - refs - 1 + (j)), V_LOAD(cur + x + refs - 1 - (j))), \
+                V_ABSDIFF(V_LOAD(cur + x - refs + (j)), V_LOAD(cur + x + refs - (j)))), \
+                V_ABSDIFF(V_LOAD(cur + x - refs + 1 + (j)), V_LOAD(cur + x + refs + 1 - (j))))
+
+#define CHECK_PRED(j) \
+    V_SRA1(V_ADD(V_LOAD(cur + x - refs + (j)), V_LOAD(cur + x + refs - (j))))
+
+FUNC_ATTR
+static void FILTER_LINE_FUNC_NAME(int mode, uint8_t *dst, const uint8_t *prev, const uint8_t *cur, const uint8_t *next, int w, int refs, int parity)
+{
+    const uint8_t *prev2 = parity ? prev : cur;
+    const uint8_t *next2 = parity ? cur  : next;
+    const VEC one = V_SET1(1);
+    const VEC zero = V_SET1(0);
+    int x;
+
+    for (x = 0; x + VW <= w; x += VW) {
+        VEC c = V_LOAD(cur + x - refs);
+        VEC e = V_LOAD(cur + x + refs);
+        VEC p2 = V_LOAD(prev2 + x);
+        VEC n2 = V_LOAD(next2 + x);
+        VEC d = V_SRA1(V_ADD(p2, n2));
+        VEC temporal_diff0 = V_ABSDIFF(p2, n2);
+        VEC temporal_diff1 = V_SRA1(V_ADD(V_ABSDIFF(V_LOAD(prev + x - refs), c), V_ABSDIFF(V_LOAD(prev + x + refs), e)));
+        VEC temporal_diff2 = V_SRA1(V_ADD(V_ABSDIFF(V_LOAD(next + x - refs), c), V_ABSDIFF(V_LOAD(next + x + refs), e)));
+        VEC diff = V_MAX(V_MAX(V_SRA1(temporal_diff0), temporal_diff1), temporal_diff2);
+        VEC spatial_pred = V_SRA1(V_ADD(c, e));
+        VEC spatial_score = V_SUB(V_ADD(V_ADD(V_ABSDIFF(V_LOAD(cur + x - refs - 1), V_LOAD(cur + x + refs - 1)), V_ABSDIFF(c, e)),
+                                        V_ABSDIFF(V_LOAD(cur + x - refs + 1), V_LOAD(cur + x + refs + 1))), one);
+        VEC score, mask, mask2;
+
+        // The second direction only counts where the first one improved the score
+        score = CHECK_SCORE(-1);
+        mask = V_CMPGT(spatial_score, score);
+        spatial_score = V_BLEND(mask, score, spatial_score);
+        spatial_pred = V_BLEND(mask, CHECK_PRED(-1), spatial_pred);
+        score = CHECK_SCORE(-2);
+        mask2 = V_AND(mask, V_CMPGT(spatial_score, score));
+        spatial_score = V_BLEND(mask2, score, spatial_score);
+        spatial_pred = V_BLEND(mask2, CHECK_PRED(-2), spatial_pred);
+
+        score = CHECK_SCORE(1);
+        mask = V_CMPGT(spatial_score, score);
+        spatial_score = V_BLEND(mask, score, spatial_score);
+        spatial_pred = V_BLEND(mask, CHECK_PRED(1), spatial_pred);
+        score = CHECK_SCORE(2);
+        mask2 = V_AND(mask, V_CMPGT(spatial_score, score));
+        spatial_pred = V_BLEND(mask2, CHECK_PRED(2), spatial_pred);
+
+        if (mode < 2) {
+            VEC b = V_SRA1(V_ADD(V_LOAD(prev2 + x - 2 * refs), V_LOAD(next2 + x - 2 * refs)));
+            VEC f = V_SRA1(V_ADD(V_LOAD(prev2 + x + 2 * refs), V_LOAD(next2 + x + 2 * refs)));
+            VEC de = V_SUB(d, e);
+            VEC dc = V_SUB(d, c);
+            VEC bc = V_SUB(b, c);
+            VEC fe = V_SUB(f, e);
+            VEC max = V_MAX(V_MAX(de, dc), V_MIN(bc, fe));
+            VEC min = V_MIN(V_MIN(de, dc), V_MAX(bc, fe));
+            diff = V_MAX(V_MAX(diff, min), V_SUB(zero, max));
+        }
+
+        spatial_pred = V_MIN(spatial_pred, V_ADD(d, diff));
+        spatial_pred = V_MAX(spatial_pred, V_SUB(d, diff));
+        V_STORE(dst + x, spatial_pred);
+    }
+
+    if (x < w)
+        filter_line_c(mode, dst + x, prev + x, cur + x, next + x, w - x, refs, parity);
+}
+
+#undef V_ABSDIFF
+#undef V_BLEND
+#undef CHECK_SCORE
+#undef CHECK_PRED
+#undef FILTER_LINE_FUNC_NAME
+#undef FUNC_ATTR
+#undef VEC
+#undef VW
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_MIN
+#undef V_MAX
+#undef V_SRA1
+#undef V_CMPGT
+#undef V_AND
+#undef V_ANDNOT
+#undef V_OR
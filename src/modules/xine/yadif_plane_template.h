@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2006 Michael Niedermayer <michaelni@gmx.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Generic C line filter and plane driver, instantiated once per sample size.
+ *
+ * Define before including:
+ *   PIXEL                  the sample type
+ *   FILTER_LINE_C_NAME     name of the C line filter
+ *   INTERPOLATE_NAME       name of the line averaging helper
+ *   FILTER_PLANE_ROWS_NAME name of the plane driver
+ *
+ * Strides and refs are in samples, not bytes.
+ */
+
+static void FILTER_LINE_C_NAME(int mode, PIXEL *dst, const PIXEL *prev, const PIXEL *cur, const PIXEL *next, int w, int refs, int parity){
+    int x;
+    const PIXEL *prev2= parity ? prev : cur ;
+    const PIXEL *next2= parity ? cur  : next;
+    for(x=0; x<w; x++){
+        int c= cur[-refs];
+        int d= (prev2[0] + next2[0])>>1;
+        int e= cur[+refs];
+        int temporal_diff0= ABS(prev2[0] - next2[0]);
+        int temporal_diff1=( ABS(prev[-refs] - c) + ABS(prev[+refs] - e) )>>1;
+        int temporal_diff2=( ABS(next[-refs] - c) + ABS(next[+refs] - e) )>>1;
+        int diff= MAX3(temporal_diff0>>1, temporal_diff1, temporal_diff2);
+        int spatial_pred= (c+e)>>1;
+        int spatial_score= ABS(cur[-refs-1] - cur[+refs-1]) + ABS(c-e)
+                         + ABS(cur[-refs+1] - cur[+refs+1]) - 1;
+
+#define CHECK(j)\
+    {   int score= ABS(cur[-refs-1+ j] - cur[+refs-1- j])\
+                 + ABS(cur[-refs  + j] - cur[+refs  - j])\
+                 + ABS(cur[-refs+1+ j] - cur[+refs+1- j]);\
+        if(score < spatial_score){\
+            spatial_score= score;\
+            spatial_pred= (cur[-refs  + j] + cur[+refs  - j])>>1;\
+
+        CHECK(-1) CHECK(-2) }} }}
+        CHECK( 1) CHECK( 2) }} }}
+#undef CHECK
+
+        if(mode<2){
+            int b= (prev2[-2*refs] + next2[-2*refs])>>1;
+            int f= (prev2[+2*refs] + next2[+2*refs])>>1;
+            int max= MAX3(d-e, d-c, MIN(b-c, f-e));
+            int min= MIN3(d-e, d-c, MAX(b-c, f-e));
+
+            diff= MAX3(diff, min, -max);
+        }
+
+        if(spatial_pred > d + diff)
+           spatial_pred = d + diff;
+        else if(spatial_pred < d - diff)
+           spatial_pred = d - diff;
+
+        dst[0] = spatial_pred;
+
+        dst++;
+        cur++;
+        prev++;
+        next++;
+        prev2++;
+        next2++;
+    }
+}
+
+static void INTERPOLATE_NAME(PIXEL *dst, const PIXEL *cur0, const PIXEL *cur2, int w)
+{
+    int x;
+    for (x=0; x<w; x++) {
+        dst[x] = (cur0[x] + cur2[x] + 1)>>1; // simple average
+    }
+}
+
+/* Deinterlace the rows y_start to y_end - 1 of a plane.
+ * Every output row only depends on the inputs, so disjoint row ranges may run concurrently.
+ */
+static void FILTER_PLANE_ROWS_NAME(int mode, PIXEL *dst, int dst_stride, const PIXEL *prev0, const PIXEL *cur0, const PIXEL *next0, int refs, int w, int h, int parity, int tff,
+    void (*filter_line)(int mode, PIXEL *dst, const PIXEL *prev, const PIXEL *cur, const PIXEL *next, int w, int refs, int parity),
+    int y_start, int y_end)
+{
+    int y;
+    for (y = y_start; y < y_end && y < h; y++) {
+        PIXEL *dst2 = dst + y*dst_stride;
+        if (!((y ^ parity) & 1)) {
+            memcpy(dst2, cur0 + y*refs, w * sizeof(PIXEL)); // copy original
+        } else if (y == 0) {
+            memcpy(dst2, cur0 + refs, w * sizeof(PIXEL)); // duplicate 1
+        } else if (y == 1) {
+            INTERPOLATE_NAME(dst2, cur0, cur0 + refs*2, w); // interpolate 0 and 2
+        } else if (y == h-2) {
+            INTERPOLATE_NAME(dst2, cur0 + (h-3)*refs, cur0 + (h-1)*refs, w); // interpolate h-3 and h-1
+        } else if (y == h-1) {
+            memcpy(dst2, cur0 + (h-2)*refs, w * sizeof(PIXEL)); // duplicate h-2
+        } else {
+            filter_line(mode, dst2, prev0 + y*refs, cur0 + y*refs, next0 + y*refs, w, refs, (parity ^ tff));
+        }
+    }
+}
+
+#undef PIXEL
+#undef FILTER_LINE_C_NAME
+#undef INTERPOLATE_NAME
+#undef FILTER_PLANE_ROWS_NAME
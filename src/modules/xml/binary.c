@@ -0,0 +1,213 @@
+/*
+ * binary.c -- the binary form of MLT XML documents
+ * Copyright (C) 2020 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "common.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Strings up to this length are shared through the string table
+#define SHARED_STRING_MAX (256)
+
+struct binary_writer_s
+{
+	uint8_t *strings;
+	size_t strings_size;
+	size_t strings_alloc;
+	uint8_t *events;
+	size_t events_size;
+	size_t events_alloc;
+	uint32_t *hash;         // open addressing table of string offsets plus one
+	size_t hash_size;
+	size_t hash_count;
+	int error;
+};
+typedef struct binary_writer_s *binary_writer;
+
+static uint8_t *grow( uint8_t *buffer, size_t *alloc, size_t needed )
+{
+	if ( needed > *alloc )
+	{
+		size_t size = *alloc ? *alloc : 4096;
+		while ( size < needed )
+			size *= 2;
+		buffer = realloc( buffer, size );
+		*alloc = size;
+	}
+	return buffer;
+}
+
+static uint32_t string_hash( const char *s, size_t length )
+{
+	uint32_t hash = 2166136261u;
+	size_t i;
+	for ( i = 0; i < length; i++ )
+		hash = ( hash ^ (uint8_t) s[i] ) * 16777619u;
+	return hash;
+}
+
+static uint32_t append_string( binary_writer self, const char *s, size_t length )
+{
+	uint32_t offset = self->strings_size;
+	self->strings = grow( self->strings, &self->strings_alloc, self->strings_size + length + 1 );
+	memcpy( self->strings + offset, s, length );
+	self->strings[ offset + length ] = 0;
+	self->strings_size += length + 1;
+	return offset;
+}
+
+/** Get the offset of a string in the table, adding it if needed.
+*/
+
+static uint32_t add_string( binary_writer self, const char *s )
+{
+	size_t length = strlen( s );
+	size_t i, mask;
+
+	if ( length > SHARED_STRING_MAX )
+		return append_string( self, s, length );
+
+	// Keep the table at most half full
+	if ( ( self->hash_count + 1 ) * 2 > self->hash_size )
+	{
+		uint32_t *old = self->hash;
+		size_t old_size = self->hash_size;
+		self->hash_size = old_size ? old_size * 2 : 1024;
+		self->hash = calloc( self->hash_size, sizeof( uint32_t ) );
+		mask = self->hash_size - 1;
+		for ( i = 0; i < old_size; i++ )
+		{
+			if ( old[i] )
+			{
+				const char *t = (const char*) self->strings + old[i] - 1;
+				size_t j = string_hash( t, strlen( t ) ) & mask;
+				while ( self->hash[j] )
+					j = ( j + 1 ) & mask;
+				self->hash[j] = old[i];
+			}
+		}
+		free( old );
+	}
+
+	mask = self->hash_size - 1;
+	for ( i = string_hash( s, length ) & mask; self->hash[i]; i = ( i + 1 ) & mask )
+	{
+		if ( !strcmp( (const char*) self->strings + self->hash[i] - 1, s ) )
+			return self->hash[i] - 1;
+	}
+	self->hash[i] = append_string( self, s, length ) + 1;
+	self->hash_count ++;
+	return self->hash[i] - 1;
+}
+
+static void put_word( binary_writer self, uint32_t word )
+{
+	uint8_t *p;
+	self->events = grow( self->events, &self->events_alloc, self->events_size + 4 );
+	p = self->events + self->events_size;
+	p[0] = word & 0xff;
+	p[1] = ( word >> 8 ) & 0xff;
+	p[2] = ( word >> 16 ) & 0xff;
+	p[3] = word >> 24;
+	self->events_size += 4;
+}
+
+static void put_nodes( binary_writer self, xmlNodePtr node )
+{
+#ifdef _WIN32
+	xmlFreeFunc xmlFree = NULL;
+	xmlMemGet( &xmlFree, NULL, NULL, NULL );
+#endif
+	for ( ; node != NULL; node = node->next )
+	{
+		if ( node->type == XML_ELEMENT_NODE )
+		{
+			uint32_t name = add_string( self, (const char*) node->name );
+			xmlAttrPtr attr;
+			uint32_t count = 0;
+
+			for ( attr = node->properties; attr != NULL; attr = attr->next )
+				count ++;
+			put_word( self, mlt_binary_start | count << 2 );
+			put_word( self, name );
+			for ( attr = node->properties; attr != NULL; attr = attr->next )
+			{
+				xmlChar *value = xmlGetProp( node, attr->name );
+				put_word( self, add_string( self, (const char*) attr->name ) );
+				put_word( self, add_string( self, value ? (const char*) value : "" ) );
+				xmlFree( value );
+			}
+			put_nodes( self, node->children );
+			put_word( self, mlt_binary_end );
+		}
+		else if ( ( node->type == XML_TEXT_NODE || node->type == XML_CDATA_SECTION_NODE ) && node->content )
+		{
+			size_t length = strlen( (const char*) node->content );
+			// The count of an event has 30 bits
+			if ( length >> 30 )
+			{
+				self->error = 1;
+				return;
+			}
+			put_word( self, mlt_binary_text | length << 2 );
+			put_word( self, add_string( self, (const char*) node->content ) );
+		}
+	}
+}
+
+/** Convert a document to its binary form.
+ * \return a buffer to be released with free, or NULL on error
+ */
+
+uint8_t *mlt_xml_binary_make( xmlDocPtr doc, size_t *size )
+{
+	struct binary_writer_s writer;
+	uint8_t *result = NULL;
+
+	memset( &writer, 0, sizeof( writer ) );
+	put_nodes( &writer, xmlDocGetRootElement( doc ) );
+
+	// Pad the string table to a whole word
+	while ( writer.strings_size % 4 )
+		append_string( &writer, "", 0 );
+
+	if ( !writer.error && writer.events_size && writer.strings_size + writer.events_size < UINT32_MAX )
+	{
+		*size = MLT_BINARY_HEADER_SIZE + writer.strings_size + writer.events_size;
+		result = malloc( *size );
+	}
+	if ( result )
+	{
+		struct binary_writer_s header;
+		memset( &header, 0, sizeof( header ) );
+		memcpy( result, MLT_BINARY_MAGIC, 8 );
+		put_word( &header, MLT_BINARY_VERSION );
+		put_word( &header, writer.strings_size );
+		put_word( &header, writer.events_size );
+		memcpy( result + 8, header.events, header.events_size );
+		memcpy( result + MLT_BINARY_HEADER_SIZE, writer.strings, writer.strings_size );
+		memcpy( result + MLT_BINARY_HEADER_SIZE + writer.strings_size, writer.events, writer.events_size );
+		free( header.events );
+	}
+
+	free( writer.strings );
+	free( writer.events );
+	free( writer.hash );
+	return result;
+}
@@ -1,27 +1,59 @@
-/*
- * Copyright (C) 2016 Meltytech, LLC
- *
- * This library is free software; you can redistribute it and/or
- * modify it under the terms of the GNU Lesser General Public
- * License as published by the Free Software Foundation; either
- * version 2.1 of the License, or (at your option) any later version.
- *
- * This library is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
- * Lesser General Public License for more details.
- *
- * You should have received a copy of the GNU Lesser General Public
- * License along with this library; if not, write to the Free Software
- * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
- */
-
-#ifndef MLT_XML_COMMON_H
-#define MLT_XML_COMMON_H
-
-#include <framework/mlt_properties.h>
-
-size_t mlt_xml_prefix_size( mlt_properties properties, const char *name, const char *value );
-
-#endif // MLT_XML_COMMON_H
-
+/*
+ * Copyright (C) 2016 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef MLT_XML_COMMON_H
+#define MLT_XML_COMMON_H
+
+#include <framework/mlt_properties.h>
+#include <libxml/tree.h>
+#include <stdint.h>
+
+/* The binary form of a document used by the mlt_binary consumer and producer.
+ *
+ * It holds the same elements, attributes and text as the XML form, so the two
+ * convert into each other without loss. All numbers are 32-bit little-endian
+ * words. After the header comes the string table - NUL-terminated strings
+ * padded to a whole word - and then the events in document order. Each event
+ * starts with a word holding its type in the low two bits and a count above
+ * them. A start event is followed by the offset of the element name in the
+ * string table and count pairs of attribute name and value offsets. An end
+ * event closes the last open element and has nothing more. A text event is
+ * followed by the offset of count bytes of text.
+ */
+
+#define MLT_BINARY_MAGIC "MLTGRAPH"
+#define MLT_BINARY_VERSION (1)
+#define MLT_BINARY_HEADER_SIZE (20) /* magic, version, strings size, events size */
+
+enum mlt_binary_event
+{
+	mlt_binary_start,
+	mlt_binary_end,
+	mlt_binary_text
+};
+
+static inline uint32_t mlt_binary_word( const uint8_t *p )
+{
+	return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (uint32_t) p[3] << 24 );
+}
+
+size_t mlt_xml_prefix_size( mlt_properties properties, const char *name, const char *value );
+uint8_t *mlt_xml_binary_make( xmlDocPtr doc, size_t *size );
+
+#endif // MLT_XML_COMMON_H
+
@@ -30,14 +30,28 @@
 
 #define ID_SIZE 128
 #define TIME_PROPERTY "_consumer_xml"
+#define FRAGMENT_PROPERTY "_xml_fragment"
 
 #define _x (const xmlChar*)
 #define _s (const char*)
 
+// An id given to a service in the document
+typedef struct
+{
+	mlt_service service;
+	char *id;
+	int hide;
+}
+xml_id;
+
 // This maintains counters for adding ids to elements
 struct serialise_context_s
 {
-	mlt_properties id_map;
+	xml_id *ids;
+	int id_count;
+	int *id_by_service;
+	int *id_by_name;
+	int id_table_size;
 	int producer_count;
 	int multitrack_count;
 	int playlist_count;
@@ -45,7 +59,6 @@ struct serialise_context_s
 	int filter_count;
 	int transition_count;
 	int pass;
-	mlt_properties hide_map;
 	char *root;
 	char *store;
 	int no_meta;
@@ -76,29 +89,101 @@ typedef enum
 }
 xml_type;
 
+static inline unsigned int hash_service( mlt_service service )
+{
+	return (unsigned int)( ( (uintptr_t) service >> 4 ) * 2654435761u );
+}
+
+static inline unsigned int hash_name( const char *name )
+{
+	unsigned int hash = 5381;
+	while ( *name )
+		hash = hash * 33 + (unsigned char) *name ++;
+	return hash;
+}
+
+/** Find the index of a service in the id map or -1.
+*/
+
+static int xml_find_service( serialise_context context, mlt_service service )
+{
+	unsigned int mask = context->id_table_size - 1;
+	unsigned int i;
+	if ( context->id_table_size == 0 )
+		return -1;
+	for ( i = hash_service( service ) & mask; context->id_by_service[ i ]; i = ( i + 1 ) & mask )
+		if ( context->ids[ context->id_by_service[ i ] - 1 ].service == service )
+			return context->id_by_service[ i ] - 1;
+	return -1;
+}
+
+/** Find the index of an id in the id map or -1.
+*/
+
+static int xml_find_id( serialise_context context, const char *id )
+{
+	unsigned int mask = context->id_table_size - 1;
+	unsigned int i;
+	if ( context->id_table_size == 0 )
+		return -1;
+	for ( i = hash_name( id ) & mask; context->id_by_name[ i ]; i = ( i + 1 ) & mask )
+		if ( !strcmp( context->ids[ context->id_by_name[ i ] - 1 ].id, id ) )
+			return context->id_by_name[ i ] - 1;
+	return -1;
+}
+
+static void xml_index_id( serialise_context context, int index )
+{
+	unsigned int mask = context->id_table_size - 1;
+	unsigned int i;
+	for ( i = hash_service( context->ids[ index ].service ) & mask; context->id_by_service[ i ]; i = ( i + 1 ) & mask );
+	context->id_by_service[ i ] = index + 1;
+	for ( i = hash_name( context->ids[ index ].id ) & mask; context->id_by_name[ i ]; i = ( i + 1 ) & mask );
+	context->id_by_name[ i ] = index + 1;
+}
+
+/** Add a service to the id map, keeping the tables at most half full.
+*/
+
+static char *xml_add_id( serialise_context context, mlt_service service, const char *id )
+{
+	int i;
+	if ( ( context->id_count + 1 ) * 2 > context->id_table_size )
+	{
+		context->id_table_size = context->id_table_size ? context->id_table_size * 2 : 256;
+		context->ids = realloc( context->ids, context->id_table_size / 2 * sizeof( xml_id ) );
+		free( context->id_by_service );
+		free( context->id_by_name );
+		context->id_by_service = calloc( context->id_table_size, sizeof( int ) );
+		context->id_by_name = calloc( context->id_table_size, sizeof( int ) );
+		for ( i = 0; i < context->id_count; i ++ )
+			xml_index_id( context, i );
+	}
+	i = context->id_count ++;
+	context->ids[ i ].service = service;
+	context->ids[ i ].id = strdup( id );
+	context->ids[ i ].hide = 0;
+	xml_index_id( context, i );
+	return context->ids[ i ].id;
+}
+
 /** Create or retrieve an id associated to this service.
 */
 
 static char *xml_get_id( serialise_context context, mlt_service service, xml_type type )
 {
 	char *id = NULL;
-	int i = 0;
-	mlt_properties map = context->id_map;
-
-	// Search the map for the service
-	for ( i = 0; i < mlt_properties_count( map ); i ++ )
-		if ( mlt_properties_get_data_at( map, i, NULL ) == service )
-			break;
+	int i = xml_find_service( context, service );
 
 	// If the service is not in the map, and the type indicates a new id is needed...
-	if ( i >= mlt_properties_count( map ) && type != xml_existing )
+	if ( i < 0 && type != xml_existing )
 	{
 		// Attempt to reuse existing id
 		id = mlt_properties_get( MLT_SERVICE_PROPERTIES( service ), "id" );
 
 		// If no id, or the id is used in the map (for another service), then
 		// create a new one.
-		if ( id == NULL || mlt_properties_get_data( map, id, NULL ) != NULL )
+		if ( id == NULL || xml_find_id( context, id ) >= 0 )
 		{
 			char temp[ ID_SIZE ];
 			do
@@ -128,28 +213,40 @@ static char *xml_get_id( serialise_context context, mlt_service service, xml_typ
 						break;
 				}
 			}
-			while( mlt_properties_get_data( map, temp, NULL ) != NULL );
-
-			// Set the data at the generated name
-			mlt_properties_set_data( map, temp, service, 0, NULL, NULL );
+			while( xml_find_id( context, temp ) >= 0 );
 
-			// Get the pointer to the name (i is the end of the list)
-			id = mlt_properties_get_name( map, i );
+			id = xml_add_id( context, service, temp );
 		}
 		else
 		{
 			// Store the existing id in the map
-			mlt_properties_set_data( map, id, service, 0, NULL, NULL );
+			id = xml_add_id( context, service, id );
 		}
 	}
-	else if ( type == xml_existing )
+	else if ( type == xml_existing && i >= 0 )
 	{
-		id = mlt_properties_get_name( map, i );
+		id = context->ids[ i ].id;
 	}
 
 	return id;
 }
 
+/** Remember the hide flags of a producer or playlist by its id.
+*/
+
+static void xml_set_hide( serialise_context context, const char *id, int hide )
+{
+	int i = xml_find_id( context, id );
+	if ( i >= 0 )
+		context->ids[ i ].hide = hide;
+}
+
+static int xml_get_hide( serialise_context context, const char *id )
+{
+	int i = id ? xml_find_id( context, id ) : -1;
+	return i >= 0 ? context->ids[ i ].hide : 0;
+}
+
 /** This is what will be called by the factory - anything can be passed in
 	via the argument, but keep it simple.
 */
@@ -304,6 +401,192 @@ static inline void serialise_service_filters( serialise_context context, mlt_ser
 	}
 }
 
+/** A serialised producer element kept on the producer for the next save.
+ *
+ * The element is reused while the producer, the cut it was serialised from,
+ * and all of their filters are unchanged and the document settings that
+ * affect the values are the same.
+*/
+
+typedef struct
+{
+	mlt_service service;
+	int64_t generation;
+}
+xml_stamp;
+
+typedef struct
+{
+	xmlNodePtr node;
+	xml_stamp *stamps;
+	int count;
+	char *root;
+	int no_meta;
+	mlt_time_format time_format;
+	int frame_rate_num;
+	int frame_rate_den;
+}
+xml_fragment_s, *xml_fragment;
+
+static pthread_mutex_t fragment_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void fragment_close( xml_fragment fragment )
+{
+	xmlFreeNode( fragment->node );
+	free( fragment->stamps );
+	free( fragment->root );
+	free( fragment );
+}
+
+static void fragment_add_filters( mlt_service service, xml_stamp **stamps, int *count, int *size )
+{
+	mlt_filter filter = NULL;
+	int i;
+
+	// Follow the order in which serialise_service_filters assigns ids.
+	for ( i = 0; ( filter = mlt_service_filter( service, i ) ) != NULL; i ++ )
+	{
+		mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+		if ( mlt_properties_get_int( properties, "_loader" ) == 0 )
+		{
+			if ( *count == *size )
+			{
+				*size = *size ? *size * 2 : 8;
+				*stamps = realloc( *stamps, *size * sizeof( xml_stamp ) );
+			}
+			( *stamps )[ *count ].service = MLT_FILTER_SERVICE( filter );
+			( *stamps )[ *count ].generation = mlt_properties_generation( properties );
+			( *count ) ++;
+			fragment_add_filters( MLT_FILTER_SERVICE( filter ), stamps, count, size );
+		}
+	}
+}
+
+/** Collect the services a producer element depends on with their generations.
+ *
+ * \return the number of stamps, the first one or two being the producer and cut
+*/
+
+static int fragment_stamps( mlt_service parent, mlt_service service, xml_stamp **stamps )
+{
+	int count = 0;
+	int size = 8;
+
+	*stamps = malloc( size * sizeof( xml_stamp ) );
+	( *stamps )[ count ].service = parent;
+	( *stamps )[ count ++ ].generation = mlt_properties_generation( MLT_SERVICE_PROPERTIES( parent ) );
+	if ( service != parent )
+	{
+		( *stamps )[ count ].service = service;
+		( *stamps )[ count ++ ].generation = mlt_properties_generation( MLT_SERVICE_PROPERTIES( service ) );
+	}
+	fragment_add_filters( service, stamps, &count, &size );
+
+	return count;
+}
+
+static void collect_filter_nodes( xmlNodePtr node, xmlNodePtr *nodes, int *count, int size )
+{
+	for ( node = node->children; node != NULL; node = node->next )
+	{
+		if ( node->type == XML_ELEMENT_NODE && !xmlStrcmp( node->name, _x("filter") ) )
+		{
+			if ( *count < size )
+				nodes[ *count ] = node;
+			( *count ) ++;
+			collect_filter_nodes( node, nodes, count, size );
+		}
+	}
+}
+
+/** Add a copy of the cached element of a producer if it is still valid.
+ *
+ * The ids are assigned again since they depend on the rest of the document.
+ * \return the new element or NULL if the producer must be serialised
+*/
+
+static xmlNodePtr fragment_reuse( serialise_context context, mlt_service parent, mlt_service service, xmlNode *node, const char *id )
+{
+	xmlNodePtr result = NULL;
+	xml_stamp *stamps = NULL;
+	int count = fragment_stamps( parent, service, &stamps );
+	int first = service != parent ? 2 : 1;
+	xml_fragment fragment;
+	int i, j;
+
+	pthread_mutex_lock( &fragment_mutex );
+	fragment = mlt_properties_get_data( MLT_SERVICE_PROPERTIES( parent ), FRAGMENT_PROPERTY, NULL );
+	if ( fragment && fragment->count == count &&
+		 !memcmp( fragment->stamps, stamps, count * sizeof( xml_stamp ) ) &&
+		 !strcmp( fragment->root, context->root ) &&
+		 fragment->no_meta == context->no_meta &&
+		 fragment->time_format == context->time_format &&
+		 ( !context->profile || ( fragment->frame_rate_num == context->profile->frame_rate_num &&
+								  fragment->frame_rate_den == context->profile->frame_rate_den ) ) )
+	{
+		// The filters must all get new ids, as they did when the element was made.
+		for ( i = first; i < count; i ++ )
+		{
+			if ( xml_find_service( context, stamps[ i ].service ) >= 0 )
+				break;
+			for ( j = first; j < i && stamps[ j ].service != stamps[ i ].service; j ++ );
+			if ( j < i )
+				break;
+		}
+		if ( i == count )
+			result = xmlDocCopyNode( fragment->node, node->doc, 1 );
+	}
+	pthread_mutex_unlock( &fragment_mutex );
+
+	if ( result )
+	{
+		xmlNodePtr filters[ count ];
+		int filter_count = 0;
+
+		collect_filter_nodes( result, filters, &filter_count, count );
+		if ( filter_count == count - first )
+		{
+			xmlAddChild( node, result );
+			xmlSetProp( result, _x("id"), _x(id) );
+			for ( i = first; i < count; i ++ )
+				xmlSetProp( filters[ i - first ], _x("id"), _x( xml_get_id( context, stamps[ i ].service, xml_filter ) ) );
+		}
+		else
+		{
+			xmlFreeNode( result );
+			result = NULL;
+		}
+	}
+	free( stamps );
+
+	return result;
+}
+
+/** Keep a copy of a producer element on the producer.
+ *
+ * \param stamps the stamps collected before the element was made, owned by the fragment
+*/
+
+static void fragment_store( serialise_context context, mlt_service parent, xml_stamp *stamps, int count, xmlNode *node )
+{
+	xml_fragment fragment = calloc( 1, sizeof( xml_fragment_s ) );
+
+	fragment->node = xmlDocCopyNode( node, NULL, 1 );
+	fragment->stamps = stamps;
+	fragment->count = count;
+	fragment->root = strdup( context->root );
+	fragment->no_meta = context->no_meta;
+	fragment->time_format = context->time_format;
+	if ( context->profile )
+	{
+		fragment->frame_rate_num = context->profile->frame_rate_num;
+		fragment->frame_rate_den = context->profile->frame_rate_den;
+	}
+	pthread_mutex_lock( &fragment_mutex );
+	mlt_properties_set_data( MLT_SERVICE_PROPERTIES( parent ), FRAGMENT_PROPERTY, fragment, 0, ( mlt_destructor )fragment_close, NULL );
+	pthread_mutex_unlock( &fragment_mutex );
+}
+
 static void serialise_producer( serialise_context context, mlt_service service, xmlNode *node )
 {
 	xmlNode *child = node;
@@ -314,9 +597,27 @@ static void serialise_producer( serialise_context context, mlt_service service,
 		mlt_properties properties = MLT_SERVICE_PROPERTIES( parent );
 		// Get a new id - if already allocated, do nothing
 		char *id = xml_get_id( context, parent, xml_producer );
+		xml_stamp *stamps = NULL;
+		int count;
 		if ( id == NULL )
 			return;
 
+		// If the xml producer fails to load a producer, it creates a text producer that says INVALID
+		// and sets the xml_mlt_service property to the original service.
+		const char *xml_mlt_service = mlt_properties_get(properties, "_xml_mlt_service");
+		if (xml_mlt_service) {
+			// We should not serialize this as a text producer but using the original mlt_service.
+			mlt_properties_set(properties, "mlt_service", xml_mlt_service);
+		}
+
+		// Reuse the element from the last save if nothing it depends on has changed.
+		if ( fragment_reuse( context, parent, service, node, id ) )
+		{
+			xml_set_hide( context, id, mlt_properties_get_int( properties, "hide" ) );
+			return;
+		}
+		count = fragment_stamps( parent, service, &stamps );
+
 		child = xmlNewChild( node, NULL, _x("producer"), NULL );
 
 		// Set the id
@@ -326,19 +627,12 @@ static void serialise_producer( serialise_context context, mlt_service service,
 		xmlNewProp( child, _x("in"), _x(mlt_properties_get_time( properties, "in", context->time_format )) );
 		xmlNewProp( child, _x("out"), _x(mlt_properties_get_time( properties, "out", context->time_format )) );
 
-		// If the xml producer fails to load a producer, it creates a text producer that says INVALID
-		// and sets the xml_mlt_service property to the original service.
-		const char *xml_mlt_service = mlt_properties_get(properties, "_xml_mlt_service");
-		if (xml_mlt_service) {
-			// We should not serialize this as a text producer but using the original mlt_service.
-			mlt_properties_set(properties, "mlt_service", xml_mlt_service);
-		}
-
 		serialise_properties( context, properties, child );
 		serialise_service_filters( context, service, child );
+		fragment_store( context, parent, stamps, count, child );
 
 		// Add producer to the map
-		mlt_properties_set_int( context->hide_map, id, mlt_properties_get_int( properties, "hide" ) );
+		xml_set_hide( context, id, mlt_properties_get_int( properties, "hide" ) );
 	}
 	else
 	{
@@ -395,7 +689,7 @@ static void serialise_multitrack( serialise_context context, mlt_service service
 				serialise_service_filters( context, MLT_PRODUCER_SERVICE( producer ), track );
 			}
 
-			hide = mlt_properties_get_int( context->hide_map, id );
+			hide = xml_get_hide( context, id );
 			if ( hide )
 				xmlNewProp( track, _x("hide"), _x( hide == 1 ? "video" : ( hide == 2 ? "audio" : "both" ) ) );
 		}
@@ -449,7 +743,7 @@ static void serialise_playlist( serialise_context context, mlt_service service,
 			serialise_store_properties( context, properties, child, "meta." );
 
 		// Add producer to the map
-		mlt_properties_set_int( context->hide_map, id, mlt_properties_get_int( properties, "hide" ) );
+		xml_set_hide( context, id, mlt_properties_get_int( properties, "hide" ) );
 
 		// Iterate over the playlist entries
 		for ( i = 0; i < mlt_playlist_count( MLT_PLAYLIST( service ) ); i++ )
@@ -718,6 +1012,7 @@ xmlDocPtr xml_make_doc( mlt_consumer consumer, mlt_service service )
 	struct serialise_context_s *context = calloc( 1, sizeof( struct serialise_context_s ) );
 	mlt_profile profile = mlt_service_profile( MLT_CONSUMER_SERVICE( consumer ) );
 	char tmpstr[ 32 ];
+	int i;
 
 	xmlDocSetRootElement( doc, root );
 
@@ -802,10 +1097,6 @@ xmlDocPtr xml_make_doc( mlt_consumer consumer, mlt_service service )
 		context->profile = profile;
 	}
 
-	// Construct the context maps
-	context->id_map = mlt_properties_new();
-	context->hide_map = mlt_properties_new();
-
 	// Ensure producer is a framework producer
 	mlt_properties_set( MLT_SERVICE_PROPERTIES( service ), "mlt_type", "mlt_producer" );
 
@@ -821,8 +1112,11 @@ xmlDocPtr xml_make_doc( mlt_consumer consumer, mlt_service service )
 	serialise_service( context, service, root );
 
 	// Cleanup resource
-	mlt_properties_close( context->id_map );
-	mlt_properties_close( context->hide_map );
+	for ( i = 0; i < context->id_count; i ++ )
+		free( context->ids[ i ].id );
+	free( context->ids );
+	free( context->id_by_service );
+	free( context->id_by_name );
 	free( context->root );
 	free( context );
 
@@ -830,6 +1124,38 @@ xmlDocPtr xml_make_doc( mlt_consumer consumer, mlt_service service )
 }
 
 
+/** Write the binary form of the document.
+*/
+
+static void output_binary( mlt_properties properties, xmlDocPtr doc, const char *resource )
+{
+	size_t size = 0;
+	uint8_t *buffer = mlt_xml_binary_make( doc, &size );
+
+	if ( buffer == NULL )
+	{
+		mlt_log_error( NULL, "[consumer_xml] failed to make the binary document\n" );
+	}
+	else if ( resource == NULL || !strcmp( resource, "" ) )
+	{
+		fwrite( buffer, 1, size, stdout );
+		free( buffer );
+	}
+	else if ( strchr( resource, '.' ) == NULL )
+	{
+		mlt_properties_set_data( properties, resource, buffer, size, free, NULL );
+	}
+	else
+	{
+		FILE *file = mlt_fopen( resource, "wb" );
+		if ( file == NULL || fwrite( buffer, 1, size, file ) != size )
+			mlt_log_error( NULL, "[consumer_xml] failed to write %s\n", resource );
+		if ( file )
+			fclose( file );
+		free( buffer );
+	}
+}
+
 static void output_xml( mlt_consumer consumer )
 {
 	// Get the producer service
@@ -861,7 +1187,11 @@ static void output_xml( mlt_consumer consumer )
 	doc = xml_make_doc( consumer, service );
 
 	// Handle the output
-	if ( resource == NULL || !strcmp( resource, "" ) )
+	if ( !strcmp( mlt_properties_get( properties, "mlt_service" ), "mlt_binary" ) )
+	{
+		output_binary( properties, doc, resource );
+	}
+	else if ( resource == NULL || !strcmp( resource, "" ) )
 	{
 		xmlDocFormatDump( stdout, doc, 1 );
 	}
@@ -961,7 +1291,7 @@ static void *consumer_thread( void *arg )
 	// Frame and size
 	mlt_frame frame = NULL;
 
-	int video_off = mlt_properties_get_int( properties, "video_off" );
+	int video_off = mlt_properties_get_int( properties, "video_off" ) || mlt_properties_get_int( properties, "audio_only" );
 	int audio_off = mlt_properties_get_int( properties, "audio_off" );
 
 	// Loop while running
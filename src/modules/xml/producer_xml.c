@@ -28,6 +28,9 @@
 #include <string.h>
 #include <ctype.h>
 #include <unistd.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 #include <libxml/parser.h>
 #include <libxml/parserInternals.h> // for xmlCreateFileParserCtxt
@@ -63,6 +66,58 @@ enum service_type
 	mlt_dummy_consumer_type
 };
 
+enum xml_event_type
+{
+	xml_event_start,
+	xml_event_end,
+	xml_event_text
+};
+
+/** A recorded SAX event.
+ *
+ * Names, attributes and text live in the string arena of the record; the
+ * attributes of a start event follow its name as name\0value\0 pairs.
+ */
+
+struct xml_event_s
+{
+	enum xml_event_type type;
+	int match;              /* start: index of the end event; end: index of the start event */
+	int job;                /* start: index of the producer created in advance, or -1 */
+	int count;              /* start: number of attributes */
+	int is_replace;         /* text: the characters announced by a pending entity substitution */
+	size_t name;            /* offset of the element name or the text */
+	size_t length;          /* text: number of bytes */
+};
+typedef struct xml_event_s *xml_event;
+
+/** The document as parsed once, replayed after references are resolved.
+*/
+
+struct xml_record_s
+{
+	struct xml_event_s *events;
+	int count;
+	int alloc;
+	char *strings;
+	size_t size;
+	size_t strings_alloc;
+	const xmlChar **atts;
+	int atts_alloc;
+	mlt_deque stack;
+	int in_property;
+};
+typedef struct xml_record_s *xml_record;
+
+/** A producer instantiated on a worker thread before the replay.
+*/
+
+struct xml_job_s
+{
+	mlt_properties properties;
+	mlt_service producer;
+};
+
 struct deserialise_context_s
 {
 	mlt_deque stack_types;
@@ -81,13 +136,18 @@ struct deserialise_context_s
 	mlt_properties params;
 	mlt_profile profile;
 	mlt_profile consumer_profile;
-	int pass;
 	char *lc_numeric;
 	mlt_consumer consumer;
 	int multi_consumer;
+	int multi;
 	int consumer_count;
 	int seekable;
 	mlt_consumer qglsl;
+	int want_qglsl;
+	struct xml_record_s record;
+	struct xml_job_s *jobs;
+	int job_count;
+	struct xml_job_s *job;
 };
 typedef struct deserialise_context_s *deserialise_context;
 
@@ -584,6 +644,72 @@ static void on_start_producer( deserialise_context context, const xmlChar *name,
 		mlt_properties_set_string( properties, (const char*) atts[0], atts[1] == NULL ? "" : (const char*) atts[1] );
 }
 
+/** Qualify the resource of a producer and tidy its service name.
+ * \return the resource, or NULL if there is none
+ */
+
+static char *producer_resource( deserialise_context context, mlt_properties properties )
+{
+	qualify_property( context, properties, "resource" );
+	char *resource = mlt_properties_get( properties, "resource" );
+
+	// Let Kino-SMIL src be a synonym for resource
+	if ( resource == NULL )
+	{
+		qualify_property( context, properties, "src" );
+		resource = mlt_properties_get( properties, "src" );
+	}
+	trim( mlt_properties_get( properties, "mlt_service" ) );
+
+	return resource;
+}
+
+/** Instantiate the producer named by the mlt_service property.
+ *
+ * This may run on a worker thread, so it only reads the context.
+ * \return the producer, or NULL if the service failed to load it
+ */
+
+static mlt_service create_producer( deserialise_context context, mlt_properties properties, char *resource )
+{
+	mlt_service producer = NULL;
+
+	if ( mlt_properties_get( properties, "mlt_service" ) != NULL )
+	{
+		char *service_name = mlt_properties_get( properties, "mlt_service" );
+		if ( resource )
+		{
+			// If a document was saved as +INVALID.txt (see below), then ignore the mlt_service and
+			// try to load it just from the resource. This is an attempt to recover the failed
+			// producer in case, for example, a file returns.
+			if (!strcmp("qtext", service_name)) {
+				const char *text = mlt_properties_get( properties, "text" );
+				if (text && !strcmp("INVALID", text)) {
+					service_name = NULL;
+				}
+			} else if (!strcmp("pango", service_name)) {
+				const char *markup = mlt_properties_get( properties, "markup" );
+				if (markup && !strcmp("INVALID", markup)) {
+					service_name = NULL;
+				}
+			}
+			if (service_name) {
+				char *temp = calloc( 1, strlen( service_name ) + strlen( resource ) + 2 );
+				strcat( temp, service_name );
+				strcat( temp, ":" );
+				strcat( temp, resource );
+				producer = MLT_SERVICE( mlt_factory_producer( context->profile, NULL, temp ) );
+				free( temp );
+			}
+		}
+		else
+		{
+			producer = MLT_SERVICE( mlt_factory_producer( context->profile, NULL, service_name ) );
+		}
+	}
+	return producer;
+}
+
 static void on_end_producer( deserialise_context context, const xmlChar *name )
 {
 	enum service_type type;
@@ -593,50 +719,17 @@ static void on_end_producer( deserialise_context context, const xmlChar *name )
 	if ( service != NULL && type == mlt_dummy_producer_type )
 	{
 		mlt_service producer = NULL;
+		char *resource = producer_resource( context, properties );
 
-		qualify_property( context, properties, "resource" );
-		char *resource = mlt_properties_get( properties, "resource" );
-
-		// Let Kino-SMIL src be a synonym for resource
-		if ( resource == NULL )
+		// Instantiate the producer unless a worker already did
+		if ( context->job )
 		{
-			qualify_property( context, properties, "src" );
-			resource = mlt_properties_get( properties, "src" );
+			producer = context->job->producer;
+			context->job->producer = NULL;
 		}
-
-		// Instantiate the producer
-		if ( mlt_properties_get( properties, "mlt_service" ) != NULL )
+		else
 		{
-			char *service_name = trim( mlt_properties_get( properties, "mlt_service" ) );
-			if ( resource )
-			{
-				// If a document was saved as +INVALID.txt (see below), then ignore the mlt_service and
-				// try to load it just from the resource. This is an attempt to recover the failed
-				// producer in case, for example, a file returns.
-				if (!strcmp("qtext", service_name)) {
-					const char *text = mlt_properties_get( properties, "text" );
-					if (text && !strcmp("INVALID", text)) {
-						service_name = NULL;
-					}
-				} else if (!strcmp("pango", service_name)) {
-					const char *markup = mlt_properties_get( properties, "markup" );
-					if (markup && !strcmp("INVALID", markup)) {
-						service_name = NULL;
-					}
-				}
-				if (service_name) {
-					char *temp = calloc( 1, strlen( service_name ) + strlen( resource ) + 2 );
-					strcat( temp, service_name );
-					strcat( temp, ":" );
-					strcat( temp, resource );
-					producer = MLT_SERVICE( mlt_factory_producer( context->profile, NULL, temp ) );
-					free( temp );
-				}
-			}
-			else
-			{
-				producer = MLT_SERVICE( mlt_factory_producer( context->profile, NULL, service_name ) );
-			}
+			producer = create_producer( context, properties, resource );
 		}
 
 		// Just in case the plugin requested doesn't exist...
@@ -1155,17 +1248,14 @@ static void on_end_transition( deserialise_context context, const xmlChar *name
 
 static void on_start_consumer( deserialise_context context, const xmlChar *name, const xmlChar **atts)
 {
-	if ( context->pass == 1 )
-	{
-		mlt_properties properties = mlt_properties_new();
+	mlt_properties properties = mlt_properties_new();
 
-		mlt_properties_set_lcnumeric( properties, context->lc_numeric );
-		context_push_service( context, (mlt_service) properties, mlt_dummy_consumer_type );
+	mlt_properties_set_lcnumeric( properties, context->lc_numeric );
+	context_push_service( context, (mlt_service) properties, mlt_dummy_consumer_type );
 
-		// Set the properties from attributes
-		for ( ; atts != NULL && *atts != NULL; atts += 2 )
-			mlt_properties_set_string( properties, (const char*) atts[0], (const char*) atts[1] );
-	}
+	// Set the properties from attributes
+	for ( ; atts != NULL && *atts != NULL; atts += 2 )
+		mlt_properties_set_string( properties, (const char*) atts[0], (const char*) atts[1] );
 }
 
 static void set_preview_scale(mlt_profile *consumer_profile, mlt_profile *profile, double scale)
@@ -1181,94 +1271,91 @@ static void set_preview_scale(mlt_profile *consumer_profile, mlt_profile *profil
 
 static void on_end_consumer( deserialise_context context, const xmlChar *name )
 {
-	if ( context->pass == 1 )
+	// Get the consumer from the stack
+	enum service_type type;
+	mlt_properties properties = (mlt_properties) context_pop_service( context, &type );
+
+	if ( properties && type == mlt_dummy_consumer_type )
 	{
-		// Get the consumer from the stack
-		enum service_type type;
-		mlt_properties properties = (mlt_properties) context_pop_service( context, &type );
+		qualify_property( context, properties, "resource" );
+		qualify_property( context, properties, "target" );
+		char *resource = mlt_properties_get( properties, "resource" );
 
-		if ( properties && type == mlt_dummy_consumer_type )
+		if ( context->multi_consumer > 1 || context->qglsl || context->multi )
 		{
-			qualify_property( context, properties, "resource" );
-			qualify_property( context, properties, "target" );
-			char *resource = mlt_properties_get( properties, "resource" );
-
-			if ( context->multi_consumer > 1 || context->qglsl || mlt_properties_get_int( context->params, "multi" ) )
+			// Instantiate the multi consumer
+			if ( !context->consumer )
 			{
-				// Instantiate the multi consumer
-				if ( !context->consumer )
+				if ( context->qglsl )
+					context->consumer = context->qglsl;
+				else
+					context->consumer = mlt_factory_consumer( context->profile, "multi", NULL );
+				if ( context->consumer )
 				{
-					if ( context->qglsl )
-						context->consumer = context->qglsl;
-					else
-						context->consumer = mlt_factory_consumer( context->profile, "multi", NULL );
-					if ( context->consumer )
-					{
-						// Track this consumer
-						track_service( context->destructors, MLT_CONSUMER_SERVICE(context->consumer), (mlt_destructor) mlt_consumer_close );
-						mlt_properties_set_lcnumeric( MLT_CONSUMER_PROPERTIES(context->consumer), context->lc_numeric );
-					}
+					// Track this consumer
+					track_service( context->destructors, MLT_CONSUMER_SERVICE(context->consumer), (mlt_destructor) mlt_consumer_close );
+					mlt_properties_set_lcnumeric( MLT_CONSUMER_PROPERTIES(context->consumer), context->lc_numeric );
 				}
-				if ( context->consumer )
+			}
+			if ( context->consumer )
+			{
+				// Set this properties object on multi consumer
+				mlt_properties consumer_properties = MLT_CONSUMER_PROPERTIES(context->consumer);
+				char key[20];
+				snprintf( key, sizeof(key), "%d", context->consumer_count++ );
+				mlt_properties_inc_ref( properties );
+				mlt_properties_set_data( consumer_properties, key, properties, 0,
+					(mlt_destructor) mlt_properties_close, NULL );
+
+				// Pass in / out if provided
+				mlt_properties_pass_list( consumer_properties, properties, "in, out" );
+
+				// Pass along quality and performance properties to the multi consumer and its render thread(s).
+				if ( !context->qglsl )
 				{
-					// Set this properties object on multi consumer
-					mlt_properties consumer_properties = MLT_CONSUMER_PROPERTIES(context->consumer);
-					char key[20];
-					snprintf( key, sizeof(key), "%d", context->consumer_count++ );
-					mlt_properties_inc_ref( properties );
-					mlt_properties_set_data( consumer_properties, key, properties, 0,
-						(mlt_destructor) mlt_properties_close, NULL );
-
-					// Pass in / out if provided
-					mlt_properties_pass_list( consumer_properties, properties, "in, out" );
-
-					// Pass along quality and performance properties to the multi consumer and its render thread(s).
-					if ( !context->qglsl )
-					{
-						mlt_properties_pass_list( consumer_properties, properties,
-							"real_time, deinterlace_method, rescale, progressive, top_field_first, channels, channel_layout" );
+					mlt_properties_pass_list( consumer_properties, properties,
+						"real_time, deinterlace_method, rescale, progressive, top_field_first, channels, channel_layout" );
 
-						// We only really know how to optimize real_time for the avformat consumer.
-						const char *service_name = mlt_properties_get( properties, "mlt_service" );
-						if ( service_name && !strcmp( "avformat", service_name ) )
-							mlt_properties_set_int( properties, "real_time", -1 );
-					}
+					// We only really know how to optimize real_time for the avformat consumer.
+					const char *service_name = mlt_properties_get( properties, "mlt_service" );
+					if ( service_name && !strcmp( "avformat", service_name ) )
+						mlt_properties_set_int( properties, "real_time", -1 );
 				}
 			}
-			else
+		}
+		else
+		{
+			double scale = mlt_properties_get_double(properties, "scale");
+			if (scale > 0.0) {
+				set_preview_scale(&context->consumer_profile, &context->profile, scale);
+			}
+			// Instantiate the consumer
+			char *id = trim( mlt_properties_get( properties, "mlt_service" ) );
+			mlt_profile profile = context->consumer_profile? context->consumer_profile : context->profile;
+			context->consumer = mlt_factory_consumer( profile, id, resource );
+			if ( context->consumer )
 			{
-				double scale = mlt_properties_get_double(properties, "scale");
-				if (scale > 0.0) {
-					set_preview_scale(&context->consumer_profile, &context->profile, scale);
+				// Track this consumer
+				track_service( context->destructors, MLT_CONSUMER_SERVICE(context->consumer), (mlt_destructor) mlt_consumer_close );
+				mlt_properties_set_lcnumeric( MLT_CONSUMER_PROPERTIES(context->consumer), context->lc_numeric );
+				if (context->consumer_profile) {
+					mlt_properties_set_data(MLT_CONSUMER_PROPERTIES(context->consumer),
+						"_profile", context->consumer_profile, sizeof(*context->consumer_profile),
+						(mlt_destructor) mlt_profile_close, NULL);
 				}
-				// Instantiate the consumer
-				char *id = trim( mlt_properties_get( properties, "mlt_service" ) );
-				mlt_profile profile = context->consumer_profile? context->consumer_profile : context->profile;
-				context->consumer = mlt_factory_consumer( profile, id, resource );
-				if ( context->consumer )
-				{
-					// Track this consumer
-					track_service( context->destructors, MLT_CONSUMER_SERVICE(context->consumer), (mlt_destructor) mlt_consumer_close );
-					mlt_properties_set_lcnumeric( MLT_CONSUMER_PROPERTIES(context->consumer), context->lc_numeric );
-					if (context->consumer_profile) {
-						mlt_properties_set_data(MLT_CONSUMER_PROPERTIES(context->consumer),
-							"_profile", context->consumer_profile, sizeof(*context->consumer_profile),
-							(mlt_destructor) mlt_profile_close, NULL);
-					}
 
-					// Do not let XML overwrite these important properties set by mlt_factory.
-					mlt_properties_set_string( properties, "mlt_type", NULL );
-					mlt_properties_set_string( properties, "mlt_service", NULL );
+				// Do not let XML overwrite these important properties set by mlt_factory.
+				mlt_properties_set_string( properties, "mlt_type", NULL );
+				mlt_properties_set_string( properties, "mlt_service", NULL );
 
-					// Inherit the properties
-					mlt_properties_inherit( MLT_CONSUMER_PROPERTIES(context->consumer), properties );
-				}
+				// Inherit the properties
+				mlt_properties_inherit( MLT_CONSUMER_PROPERTIES(context->consumer), properties );
 			}
 		}
-		// Close the dummy
-		if ( properties )
-			mlt_properties_close( properties );
 	}
+	// Close the dummy
+	if ( properties )
+		mlt_properties_close( properties );
 }
 
 static void on_start_property( deserialise_context context, const xmlChar *name, const xmlChar **atts)
@@ -1344,34 +1431,13 @@ static void on_end_property( deserialise_context context, const xmlChar *name )
 	}
 }
 
-static void on_start_element( void *ctx, const xmlChar *name, const xmlChar **atts)
+static void on_start_element( deserialise_context context, const xmlChar *name, const xmlChar **atts)
 {
-	struct _xmlParserCtxt *xmlcontext = ( struct _xmlParserCtxt* )ctx;
-	deserialise_context context = ( deserialise_context )( xmlcontext->_private );
-	
-	if ( context->pass == 0 )
-	{
-		if ( xmlStrcmp( name, _x("mlt") ) == 0 ||
-		     xmlStrcmp( name, _x("profile") ) == 0 ||
-		     xmlStrcmp( name, _x("profileinfo") ) == 0 )
-			on_start_profile( context, name, atts );
-		if ( xmlStrcmp( name, _x("consumer") ) == 0 )
-			context->multi_consumer++;
-
-		// Check for a service beginning with glsl. or movit.
-		for ( ; atts != NULL && *atts != NULL; atts += 2 ) {
-			if ( !xmlStrncmp( atts[1], _x("glsl."), 5 ) || !xmlStrncmp( atts[1], _x("movit."), 6 ) ) {
-				mlt_properties_set_int( context->params, "qglsl", 1 );
-				break;
-			}
-		}
-		return;
-	}
 	mlt_deque_push_back_int( context->stack_branch, mlt_deque_pop_back_int( context->stack_branch ) + 1 );
 	mlt_deque_push_back_int( context->stack_branch, 0 );
 	
 	// Build a tree from nodes within a property value
-	if ( context->is_value == 1 && context->pass == 1 )
+	if ( context->is_value == 1 )
 	{
 		xmlNodePtr node = xmlNewNode( NULL, name );
 		
@@ -1426,12 +1492,9 @@ static void on_start_element( void *ctx, const xmlChar *name, const xmlChar **at
 	}
 }
 
-static void on_end_element( void *ctx, const xmlChar *name )
+static void on_end_element( deserialise_context context, const xmlChar *name )
 {
-	struct _xmlParserCtxt *xmlcontext = ( struct _xmlParserCtxt* )ctx;
-	deserialise_context context = ( deserialise_context )( xmlcontext->_private );
-	
-	if ( context->is_value == 1 && context->pass == 1 && xmlStrcmp( name, _x("property") ) != 0 )
+	if ( context->is_value == 1 && xmlStrcmp( name, _x("property") ) != 0 )
 		context_pop_node( context );
 	else if ( xmlStrcmp( name, _x("multitrack") ) == 0 )
 		on_end_multitrack( context, name );
@@ -1457,11 +1520,27 @@ static void on_end_element( void *ctx, const xmlChar *name )
 	mlt_deque_pop_back_int( context->stack_branch );
 }
 
-static void on_characters( void *ctx, const xmlChar *ch, int len )
+/** Append text to a property value.
+*/
+
+static void append_property( mlt_properties properties, const char *name, const char *value )
+{
+	char *s = mlt_properties_get( properties, name );
+	if ( s != NULL )
+	{
+		// Append new text to existing content
+		char *new = calloc( 1, strlen( s ) + strlen( value ) + 1 );
+		strcat( new, s );
+		strcat( new, value );
+		mlt_properties_set_string( properties, name, new );
+		free( new );
+	}
+	else
+		mlt_properties_set_string( properties, name, value );
+}
+
+static void on_characters( deserialise_context context, const char *value )
 {
-	struct _xmlParserCtxt *xmlcontext = ( struct _xmlParserCtxt* )ctx;
-	deserialise_context context = ( deserialise_context )( xmlcontext->_private );
-	char *value = calloc( 1, len + 1 );
 	enum service_type type;
 	mlt_service service = context_pop_service( context, &type );
 	mlt_properties properties = MLT_SERVICE_PROPERTIES( service );
@@ -1469,9 +1548,6 @@ static void on_characters( void *ctx, const xmlChar *ch, int len )
 	if ( service != NULL )
 		context_push_service( context, service, type );
 
-	value[ len ] = 0;
-	strncpy( value, (const char*) ch, len );
-
 	if ( mlt_deque_count( context->stack_node ) )
 		xmlNodeAddContent( mlt_deque_peek_back( context->stack_node ), ( xmlChar* )value );
 
@@ -1479,27 +1555,8 @@ static void on_characters( void *ctx, const xmlChar *ch, int len )
 	// an element value, and we ignore it because it is called again during
 	// actual substitution.
 	else if ( context->property != NULL && context->entity_is_replace == 0 )
-	{
-		char *s = mlt_properties_get( properties, context->property );
-		if ( s != NULL )
-		{
-			// Append new text to existing content
-			char *new = calloc( 1, strlen( s ) + len + 1 );
-			strcat( new, s );
-			strcat( new, value );
-			mlt_properties_set_string( properties, context->property, new );
-			free( new );
-		}
-		else
-			mlt_properties_set_string( properties, context->property, value );
-	}
+		append_property( properties, context->property, value );
 	context->entity_is_replace = 0;
-
-	// Check for a service beginning with glsl. or movit.
-	if ( !strncmp( value, "glsl.", 5 ) || !strncmp( value, "movit.", 6 ) )
-		mlt_properties_set_int( context->params, "qglsl", 1 );
-
-	free( value);
 }
 
 /** Convert parameters parsed from resource into entity declarations.
@@ -1581,6 +1638,508 @@ static xmlEntityPtr on_get_entity( void *ctx, const xmlChar* name )
 	return e;
 }
 
+/** Copy a string into the arena of the record.
+ * \return the offset of the copy
+ */
+
+static size_t record_string( xml_record record, const char *s, size_t length )
+{
+	size_t offset = record->size;
+
+	if ( record->size + length + 1 > record->strings_alloc )
+	{
+		size_t alloc = record->strings_alloc ? record->strings_alloc : 4096;
+		while ( record->size + length + 1 > alloc )
+			alloc *= 2;
+		record->strings = realloc( record->strings, alloc );
+		record->strings_alloc = alloc;
+	}
+	memcpy( record->strings + offset, s, length );
+	record->strings[ offset + length ] = 0;
+	record->size += length + 1;
+
+	return offset;
+}
+
+/** Append an event to the record.
+*/
+
+static xml_event record_event( xml_record record, enum xml_event_type type )
+{
+	xml_event event;
+
+	if ( record->count == record->alloc )
+	{
+		record->alloc = record->alloc ? record->alloc * 2 : 256;
+		record->events = realloc( record->events, record->alloc * sizeof( struct xml_event_s ) );
+	}
+	event = &record->events[ record->count ++ ];
+	memset( event, 0, sizeof( *event ) );
+	event->type = type;
+	event->match = -1;
+	event->job = -1;
+
+	return event;
+}
+
+static int is_glsl_service( const char *s, size_t length )
+{
+	return ( length >= 5 && !strncmp( s, "glsl.", 5 ) ) || ( length >= 6 && !strncmp( s, "movit.", 6 ) );
+}
+
+/** Record the start of an element.
+ *
+ * The document-wide settings - the profile, the number of consumers and
+ * whether a glsl. or movit. service appears - are taken here so that they
+ * are known before any service is created.
+ */
+
+static void record_start( deserialise_context context, const xmlChar *name, const xmlChar **atts )
+{
+	xml_record record = &context->record;
+	int index = record->count;
+	xml_event event = record_event( record, xml_event_start );
+
+	event->name = record_string( record, _s(name), strlen( _s(name) ) );
+	if ( xmlStrcmp( name, _x("mlt") ) == 0 ||
+	     xmlStrcmp( name, _x("profile") ) == 0 ||
+	     xmlStrcmp( name, _x("profileinfo") ) == 0 )
+		on_start_profile( context, name, atts );
+	if ( xmlStrcmp( name, _x("consumer") ) == 0 )
+		context->multi_consumer++;
+
+	for ( ; atts != NULL && *atts != NULL; atts += 2 )
+	{
+		const char *value = atts[1] == NULL ? "" : _s(atts[1]);
+		record_string( record, _s(atts[0]), strlen( _s(atts[0]) ) );
+		record_string( record, value, strlen( value ) );
+		event->count ++;
+
+		// Check for a service beginning with glsl. or movit.
+		if ( is_glsl_service( value, strlen( value ) ) )
+			context->want_qglsl = 1;
+	}
+	mlt_deque_push_back_int( record->stack, index );
+
+	// Only text within a property is used
+	if ( record->in_property || xmlStrcmp( name, _x("property") ) == 0 )
+		record->in_property ++;
+}
+
+static void record_end( deserialise_context context )
+{
+	xml_record record = &context->record;
+	int start = mlt_deque_pop_back_int( record->stack );
+	xml_event event = record_event( record, xml_event_end );
+
+	event->match = start;
+	event->name = record->events[ start ].name;
+	record->events[ start ].match = record->count - 1;
+	if ( record->in_property )
+		record->in_property --;
+}
+
+static void record_text( deserialise_context context, const xmlChar *ch, int len )
+{
+	xml_record record = &context->record;
+
+	if ( record->in_property )
+	{
+		xml_event event = record_event( record, xml_event_text );
+		event->name = record_string( record, _s(ch), len );
+		event->length = len;
+		event->is_replace = context->entity_is_replace;
+	}
+	context->entity_is_replace = 0;
+
+	// Check for a service beginning with glsl. or movit.
+	if ( is_glsl_service( _s(ch), len ) )
+		context->want_qglsl = 1;
+}
+
+// The SAX callbacks record the document
+static void record_start_element( void *ctx, const xmlChar *name, const xmlChar **atts )
+{
+	struct _xmlParserCtxt *xmlcontext = ( struct _xmlParserCtxt* )ctx;
+	record_start( ( deserialise_context )( xmlcontext->_private ), name, atts );
+}
+
+static void record_end_element( void *ctx, const xmlChar *name )
+{
+	struct _xmlParserCtxt *xmlcontext = ( struct _xmlParserCtxt* )ctx;
+	record_end( ( deserialise_context )( xmlcontext->_private ) );
+}
+
+static void record_characters( void *ctx, const xmlChar *ch, int len )
+{
+	struct _xmlParserCtxt *xmlcontext = ( struct _xmlParserCtxt* )ctx;
+	record_text( ( deserialise_context )( xmlcontext->_private ), ch, len );
+}
+
+static void record_close( xml_record record )
+{
+	free( record->events );
+	free( record->strings );
+	free( record->atts );
+	mlt_deque_close( record->stack );
+}
+
+/** Get the attributes of a recorded start event as a SAX attribute list.
+ * The list is valid until the next call.
+ */
+
+static const xmlChar **event_attributes( xml_record record, xml_event event )
+{
+	const char *p = record->strings + event->name;
+	int i;
+
+	if ( event->count * 2 + 1 > record->atts_alloc )
+	{
+		record->atts_alloc = event->count * 2 + 1;
+		record->atts = realloc( record->atts, record->atts_alloc * sizeof( *record->atts ) );
+	}
+	for ( i = 0; i < event->count * 2; i++ )
+	{
+		p += strlen( p ) + 1;
+		record->atts[ i ] = _x(p);
+	}
+	record->atts[ i ] = NULL;
+
+	return record->atts;
+}
+
+/** Get the value of an attribute of a recorded start event.
+*/
+
+static const char *event_attribute( xml_record record, xml_event event, const char *name )
+{
+	const char *p = record->strings + event->name;
+	int i;
+
+	for ( i = 0; i < event->count; i++ )
+	{
+		const char *value;
+		p += strlen( p ) + 1;
+		value = p + strlen( p ) + 1;
+		if ( !strcmp( p, name ) )
+			return value;
+		p = value;
+	}
+	return NULL;
+}
+
+static int event_is( xml_record record, xml_event event, const char *name )
+{
+	return event->type == xml_event_start && !strcmp( record->strings + event->name, name );
+}
+
+static int event_defines_id( xml_record record, xml_event event )
+{
+	return event_is( record, event, "producer" ) || event_is( record, event, "video" ) ||
+	       event_is( record, event, "playlist" ) || event_is( record, event, "seq" ) ||
+	       event_is( record, event, "smil" ) || event_is( record, event, "tractor" ) ||
+	       event_is( record, event, "multitrack" );
+}
+
+struct xml_order_s
+{
+	xml_record record;
+	int *first;             /* the first event of each top-level element */
+	int *state;             /* 0 = pending, 1 = being placed, 2 = placed */
+	mlt_properties ids;     /* top-level element (plus one) that first defines each id */
+	int *order;
+	int count;
+};
+
+/** Place a top-level element after the elements defining the services it references.
+*/
+
+static void place_element( struct xml_order_s *order, int element )
+{
+	xml_record record = order->record;
+	int first = order->first[ element ];
+	int last = record->events[ first ].type == xml_event_start ? record->events[ first ].match : first;
+	int i;
+
+	order->state[ element ] = 1;
+	for ( i = first; i <= last; i++ )
+	{
+		xml_event event = &record->events[ i ];
+		if ( event_is( record, event, "entry" ) || event_is( record, event, "track" ) )
+		{
+			const char *id = event_attribute( record, event, "producer" );
+			int defined = id ? mlt_properties_get_int( order->ids, id ) - 1 : -1;
+			if ( defined >= 0 && order->state[ defined ] == 0 )
+				place_element( order, defined );
+		}
+	}
+	for ( i = first; i <= last; i++ )
+		order->order[ order->count ++ ] = i;
+	order->state[ element ] = 2;
+}
+
+/** Order the recorded events for replay.
+ *
+ * References to services are resolved as they are replayed, so a top-level
+ * element that is referenced before it is defined is moved ahead of the first
+ * element that needs it. Everything else keeps document order.
+ * \return an array of event indices, to be freed by the caller
+ */
+
+static int *order_events( xml_record record )
+{
+	struct xml_order_s order;
+	xml_event root = &record->events[ 0 ];
+	int elements = 0;
+	int i;
+
+	memset( &order, 0, sizeof( order ) );
+	order.record = record;
+	order.order = malloc( ( record->count + 1 ) * sizeof( int ) );
+	if ( record->count == 0 || root->type != xml_event_start || root->match != record->count - 1 )
+	{
+		for ( i = 0; i < record->count; i++ )
+			order.order[ i ] = i;
+		return order.order;
+	}
+
+	// Find the top-level elements and the ids they define
+	order.first = malloc( record->count * sizeof( int ) );
+	order.ids = mlt_properties_new();
+	for ( i = 1; i < root->match; i++ )
+	{
+		xml_event event = &record->events[ i ];
+		int last = event->type == xml_event_start ? event->match : i;
+		int j;
+
+		for ( j = i; j <= last; j++ )
+		{
+			const char *id = event_defines_id( record, &record->events[ j ] ) ?
+				event_attribute( record, &record->events[ j ], "id" ) : NULL;
+			if ( id && !mlt_properties_get( order.ids, id ) )
+				mlt_properties_set_int( order.ids, id, elements + 1 );
+		}
+		order.first[ elements ++ ] = i;
+		i = last;
+	}
+
+	order.state = calloc( elements + 1, sizeof( int ) );
+	order.order[ order.count ++ ] = 0;
+	for ( i = 0; i < elements; i++ )
+		if ( order.state[ i ] == 0 )
+			place_element( &order, i );
+	order.order[ order.count ++ ] = root->match;
+
+	mlt_properties_close( order.ids );
+	free( order.first );
+	free( order.state );
+	return order.order;
+}
+
+/** Services that may be instantiated concurrently.
+ *
+ * Their constructors, and the loader filters attached to them, only share
+ * state that is locked: the service caches, the loader dictionaries and the
+ * one time initialisation of avformat.
+*/
+
+static const char *parallel_services[] =
+{
+	"avformat",
+	"avformat-novalidate",
+	"color",
+	"colour",
+	NULL
+};
+
+/** The factory events fired while a producer is created.
+*/
+
+static const char *create_events[] =
+{
+	"producer-create-request",
+	"producer-create-done",
+	"filter-create-request",
+	"filter-create-done",
+	NULL
+};
+
+/** Collect the properties of a producer element when it can be created early.
+ *
+ * Only producers made of plain properties (and filters, which are attached
+ * later) and using a service known to be safe on another thread qualify.
+ * \return the properties, or NULL
+ */
+
+static mlt_properties job_properties( xml_record record, int start )
+{
+	xml_event element = &record->events[ start ];
+	const xmlChar **atts = event_attributes( record, element );
+	mlt_properties properties = mlt_properties_new();
+	const char *service;
+	int i, j;
+
+	for ( ; *atts != NULL; atts += 2 )
+		mlt_properties_set_string( properties, _s(atts[0]), _s(atts[1]) );
+
+	for ( i = start + 1; properties && i < element->match; i++ )
+	{
+		xml_event event = &record->events[ i ];
+
+		if ( event_is( record, event, "filter" ) )
+		{
+			i = event->match;
+		}
+		else if ( event_is( record, event, "property" ) )
+		{
+			const char *name = event_attribute( record, event, "name" );
+			const char *value = event_attribute( record, event, "value" );
+
+			if ( name )
+				mlt_properties_set_string( properties, name, value == NULL ? "" : value );
+			for ( j = i + 1; j < event->match; j++ )
+			{
+				xml_event text = &record->events[ j ];
+				if ( text->type != xml_event_text )
+				{
+					// A property holding a document is left to the replay
+					mlt_properties_close( properties );
+					properties = NULL;
+					break;
+				}
+				if ( name && !text->is_replace )
+					append_property( properties, name, record->strings + text->name );
+			}
+			i = event->match;
+		}
+		else if ( event->type == xml_event_start )
+		{
+			mlt_properties_close( properties );
+			properties = NULL;
+		}
+	}
+
+	service = properties ? trim( mlt_properties_get( properties, "mlt_service" ) ) : NULL;
+	for ( i = 0; service && parallel_services[ i ]; i++ )
+		if ( !strcmp( service, parallel_services[ i ] ) )
+			return properties;
+	mlt_properties_close( properties );
+	return NULL;
+}
+
+static int create_producer_job( int id, int index, int jobs, void *cookie )
+{
+	deserialise_context context = cookie;
+	struct xml_job_s *job = &context->jobs[ index ];
+
+	job->producer = create_producer( context, job->properties, producer_resource( context, job->properties ) );
+	return 0;
+}
+
+/** Instantiate the independent producers of the document on the slice threads.
+*/
+
+static void create_producers( deserialise_context context )
+{
+	xml_record record = &context->record;
+	int i;
+
+	// A glsl consumer needs services to be created on its own thread
+	if ( context->want_qglsl || context->qglsl )
+		return;
+
+	// Listeners to the factory expect to be called on the thread that loads
+	for ( i = 0; create_events[ i ]; i++ )
+		if ( mlt_events_listening( mlt_factory_event_object(), mlt_events_id( create_events[ i ] ) ) )
+			return;
+
+	context->jobs = calloc( record->count, sizeof( struct xml_job_s ) );
+	for ( i = 0; i < record->count; i++ )
+	{
+		xml_event event = &record->events[ i ];
+
+		// Elements within a property value are not services
+		if ( event_is( record, event, "property" ) )
+		{
+			i = event->match;
+		}
+		else if ( event_is( record, event, "producer" ) || event_is( record, event, "video" ) )
+		{
+			mlt_properties properties = job_properties( record, i );
+			if ( properties )
+			{
+				event->job = context->job_count;
+				context->jobs[ context->job_count ++ ].properties = properties;
+			}
+		}
+	}
+
+	if ( context->job_count > 1 && mlt_slices_count_normal() > 1 )
+	{
+		mlt_log_debug( NULL, "[producer_xml] creating %d producers in parallel\n", context->job_count );
+		mlt_slices_run_normal( context->job_count, create_producer_job, context );
+	}
+	else
+	{
+		for ( i = 0; i < context->job_count; i++ )
+			mlt_properties_close( context->jobs[ i ].properties );
+		for ( i = 0; i < record->count; i++ )
+			record->events[ i ].job = -1;
+		context->job_count = 0;
+	}
+}
+
+static void close_producers( deserialise_context context )
+{
+	int i;
+	for ( i = 0; i < context->job_count; i++ )
+	{
+		mlt_service_close( context->jobs[ i ].producer );
+		mlt_properties_close( context->jobs[ i ].properties );
+	}
+	free( context->jobs );
+	context->jobs = NULL;
+	context->job_count = 0;
+}
+
+/** Build the service network from the recorded document.
+*/
+
+static void replay( deserialise_context context )
+{
+	xml_record record = &context->record;
+	int *order = order_events( record );
+	int i;
+
+	for ( i = 0; i < record->count; i++ )
+	{
+		xml_event event = &record->events[ order[ i ] ];
+		const xmlChar *name = _x( record->strings + event->name );
+
+		switch ( event->type )
+		{
+		case xml_event_start:
+			on_start_element( context, name, event_attributes( record, event ) );
+			// The document element sets the root used to qualify resources
+			if ( i == 0 )
+				create_producers( context );
+			break;
+		case xml_event_end:
+			if ( record->events[ event->match ].job >= 0 )
+				context->job = &context->jobs[ record->events[ event->match ].job ];
+			on_end_element( context, name );
+			context->job = NULL;
+			break;
+		case xml_event_text:
+			context->entity_is_replace = event->is_replace;
+			on_characters( context, _s(name) );
+			break;
+		}
+	}
+	close_producers( context );
+	free( order );
+}
+
 static void	on_error( void * ctx, const char * msg, ... )
 {
 	struct _xmlError* err_ptr = xmlCtxtGetLastError( ctx );
@@ -1754,6 +2313,7 @@ static deserialise_context context_new( mlt_profile profile )
 		context->stack_node = mlt_deque_init();
 		context->stack_branch = mlt_deque_init();
 		mlt_deque_push_back_int( context->stack_branch, 0 );
+		context->record.stack = mlt_deque_init();
 	}
 	return context;
 }
@@ -1768,20 +2328,241 @@ static void context_close( deserialise_context context )
 	mlt_deque_close( context->stack_node );
 	mlt_deque_close( context->stack_branch );
 	xmlFreeDoc( context->entity_doc );
+	record_close( &context->record );
 	free( context->lc_numeric );
 	free( context );
 }
 
-mlt_producer producer_xml_init( mlt_profile profile, mlt_service_type servtype, const char *id, char *data )
+/** Record a document in MLT XML.
+ * \return true if the document is well formed
+ */
+
+static int parse_xml( deserialise_context context, const char *filename, const char *data )
 {
 	xmlSAXHandler *sax, *sax_orig;
+	struct _xmlParserCtxt *xmlcontext;
+	int well_formed = 0;
+
+	// Setup SAX callbacks
+	sax = calloc( 1, sizeof( xmlSAXHandler ) );
+	sax->startElement = record_start_element;
+	sax->endElement = record_end_element;
+	sax->characters = record_characters;
+	sax->cdataBlock = record_characters;
+	sax->internalSubset = on_internal_subset;
+	sax->entityDecl = on_entity_declaration;
+	sax->getEntity = on_get_entity;
+	sax->warning = on_error;
+	sax->error = on_error;
+	sax->fatalError = on_error;
+
+	// Setup libxml2 SAX parsing
+	xmlInitParser(); 
+	xmlSubstituteEntitiesDefault( 1 );
+	// This is used to facilitate entity substitution in the SAX parser
+	context->entity_doc = xmlNewDoc( _x("1.0") );
+	if ( filename )
+		xmlcontext = xmlCreateFileParserCtxt( filename );
+	else
+		xmlcontext = xmlCreateMemoryParserCtxt( data, strlen( data ) );
+
+	// Invalid context
+	if ( xmlcontext == NULL )
+	{
+		free( sax );
+		return 0;
+	}
+
+	// Parse the document once into a record of its events
+	sax_orig = xmlcontext->sax;
+	xmlcontext->sax = sax;
+	xmlcontext->_private = ( void* )context;
+	xmlParseDocument( xmlcontext );
+	well_formed = xmlcontext->wellFormed;
+
+	// Cleanup after parsing
+	xmlFreeDoc( context->entity_doc );
+	context->entity_doc = NULL;
+	free( sax );
+	xmlMemoryDump( ); // for debugging
+	xmlcontext->sax = sax_orig;
+	xmlcontext->_private = NULL;
+	if ( xmlcontext->myDoc )
+		xmlFreeDoc( xmlcontext->myDoc );
+	xmlFreeParserCtxt( xmlcontext );
+
+	return well_formed;
+}
+
+/** Record a document in the binary form of MLT XML.
+ *
+ * \param data the document
+ * \param size the size of the document in bytes
+ * \param name the name of the document for error messages
+ * \return true if the document is valid
+ */
+
+static int record_binary( deserialise_context context, const uint8_t *data, size_t size, const char *name )
+{
+	const uint8_t *strings, *p, *end;
+	const xmlChar **atts = NULL;
+	uint32_t strings_size = 0, events_size = 0;
+	int atts_alloc = 0;
+	int depth = 0;
+	int valid = 0;
+
+	// Check the header and the layout of the document
+	if ( size > MLT_BINARY_HEADER_SIZE )
+	{
+		strings_size = mlt_binary_word( data + 12 );
+		events_size = mlt_binary_word( data + 16 );
+		valid = !memcmp( data, MLT_BINARY_MAGIC, 8 ) && mlt_binary_word( data + 8 ) == MLT_BINARY_VERSION &&
+			strings_size > 0 && events_size % 4 == 0 &&
+			(uint64_t) MLT_BINARY_HEADER_SIZE + strings_size + events_size == size &&
+			data[ MLT_BINARY_HEADER_SIZE + strings_size - 1 ] == 0;
+	}
+	if ( !valid )
+	{
+		mlt_log_error( NULL, "[producer_xml] %s is not a valid binary document\n", name );
+		return 0;
+	}
+
+	strings = data + MLT_BINARY_HEADER_SIZE;
+	p = strings + strings_size;
+	end = p + events_size;
+	while ( valid && p < end )
+	{
+		uint32_t type = mlt_binary_word( p ) & 3;
+		uint32_t count = mlt_binary_word( p ) >> 2;
+		uint32_t value = 0;
+		uint32_t i;
+
+		p += 4;
+		if ( type != mlt_binary_end )
+		{
+			valid = p < end && ( value = mlt_binary_word( p ) ) < strings_size;
+			p += 4;
+			if ( !valid )
+				break;
+		}
+		switch ( type )
+		{
+		case mlt_binary_start:
+			if ( count > ( end - p ) / 8 )
+			{
+				valid = 0;
+				break;
+			}
+			if ( (int) count * 2 + 1 > atts_alloc )
+			{
+				atts_alloc = count * 2 + 1;
+				atts = realloc( atts, atts_alloc * sizeof( *atts ) );
+			}
+			for ( i = 0; i < count * 2; i++, p += 4 )
+			{
+				uint32_t offset = mlt_binary_word( p );
+				valid &= offset < strings_size;
+				atts[ i ] = strings + ( valid ? offset : 0 );
+			}
+			atts[ i ] = NULL;
+			if ( valid )
+				record_start( context, strings + value, atts );
+			depth ++;
+			break;
+		case mlt_binary_end:
+			valid = depth -- > 0;
+			if ( valid )
+				record_end( context );
+			break;
+		case mlt_binary_text:
+			valid = count < strings_size - value && strings[ value + count ] == 0;
+			if ( valid )
+				record_text( context, strings + value, count );
+			break;
+		default:
+			valid = 0;
+			break;
+		}
+	}
+	valid = valid && p == end && depth == 0 && context->record.count > 0;
+
+	free( atts );
+	return valid;
+}
+
+/** Record a document in the binary form of MLT XML from a file.
+ * \return true if the document is valid
+ */
+
+static int load_binary( deserialise_context context, const char *filename )
+{
+	const uint8_t *data = NULL;
+	size_t size = 0;
+	int valid;
+	FILE *file = mlt_fopen( filename, "rb" );
+
+	if ( file == NULL )
+		return 0;
+	if ( !fseek( file, 0, SEEK_END ) )
+		size = ftell( file );
+#ifndef _WIN32
+	if ( size > MLT_BINARY_HEADER_SIZE )
+	{
+		data = mmap( NULL, size, PROT_READ, MAP_SHARED, fileno( file ), 0 );
+		if ( data == MAP_FAILED )
+			data = NULL;
+	}
+#else
+	if ( size > MLT_BINARY_HEADER_SIZE )
+	{
+		uint8_t *buffer = malloc( size );
+		fseek( file, 0, SEEK_SET );
+		if ( buffer && fread( buffer, 1, size, file ) != size )
+		{
+			free( buffer );
+			buffer = NULL;
+		}
+		data = buffer;
+	}
+#endif
+	fclose( file );
+	if ( data == NULL )
+		return 0;
+
+	valid = record_binary( context, data, size, filename );
+
+#ifndef _WIN32
+	munmap( (void*) data, size );
+#else
+	free( (void*) data );
+#endif
+	return valid;
+}
+
+/** Record a document in the binary form of MLT XML held in memory.
+ *
+ * The document is the data property the mlt_binary consumer stores when its
+ * resource has no extension; its size is taken from its header.
+ * \return true if the document is valid
+ */
+
+static int load_binary_data( deserialise_context context, const uint8_t *data )
+{
+	size_t size = 0;
+	if ( !memcmp( data, MLT_BINARY_MAGIC, 8 ) )
+		size = (size_t) MLT_BINARY_HEADER_SIZE + mlt_binary_word( data + 12 ) + mlt_binary_word( data + 16 );
+	return record_binary( context, data, size, "data" );
+}
+
+mlt_producer producer_xml_init( mlt_profile profile, mlt_service_type servtype, const char *id, char *data )
+{
 	deserialise_context context;
 	mlt_properties properties = NULL;
 	int i = 0;
-	struct _xmlParserCtxt *xmlcontext;
 	int well_formed = 0;
 	char *filename = NULL;
-	int is_filename = strcmp( id, "xml-string" );
+	int is_filename = strcmp( id, "xml-string" ) && strcmp( id, "mlt_binary-string" );
+	int is_binary = !strcmp( id, "mlt_binary" ) || !strcmp( id, "mlt_binary-string" );
 
 	// Strip file:// prefix
 	if ( data && strlen( data ) >= 7 && strncmp( data, "file://", 7 ) == 0 )
@@ -1843,110 +2624,36 @@ mlt_producer producer_xml_init( mlt_profile profile, mlt_service_type servtype,
 	// We need to track the number of registered filters
 	mlt_properties_set_int( context->destructors, "registered", 0 );
 
-	// Setup SAX callbacks for first pass
-	sax = calloc( 1, sizeof( xmlSAXHandler ) );
-	sax->startElement = on_start_element;
-	sax->characters = on_characters;
-	sax->warning = on_error;
-	sax->error = on_error;
-	sax->fatalError = on_error;
+	// The query string is consumed by entity declarations during the parse
+	context->multi = mlt_properties_get_int( context->params, "multi" );
+	context->want_qglsl = mlt_properties_get_int( context->params, "qglsl" );
 
-	// Setup libxml2 SAX parsing
-	xmlInitParser(); 
-	xmlSubstituteEntitiesDefault( 1 );
-	// This is used to facilitate entity substitution in the SAX parser
-	context->entity_doc = xmlNewDoc( _x("1.0") );
-	if ( is_filename )
-		xmlcontext = xmlCreateFileParserCtxt( filename );
+	// Record the document
+	if ( is_binary && is_filename )
+		well_formed = load_binary( context, filename );
+	else if ( is_binary )
+		well_formed = load_binary_data( context, (const uint8_t*) data );
 	else
-		xmlcontext = xmlCreateMemoryParserCtxt( data, strlen( data ) );
-
-	// Invalid context - clean up and return NULL
-	if ( xmlcontext == NULL )
-	{
-		context_close( context );
-		free( sax );
-		return NULL;
-	}
-
-	// Parse
-	sax_orig = xmlcontext->sax;
-	xmlcontext->sax = sax;
-	xmlcontext->_private = ( void* )context;	
-	xmlParseDocument( xmlcontext );
-	well_formed = xmlcontext->wellFormed;
-	
-	// Cleanup after parsing
-	xmlcontext->sax = sax_orig;
-	xmlcontext->_private = NULL;
-	if ( xmlcontext->myDoc )
-		xmlFreeDoc( xmlcontext->myDoc );
-	xmlFreeParserCtxt( xmlcontext );
+		well_formed = parse_xml( context, is_filename ? filename : NULL, data );
 
 	// Bad xml - clean up and return NULL
 	if ( !well_formed )
 	{
 		context_close( context );
-		free( sax );
-		return NULL;
-	}
-
-	// Setup the second pass
-	context->pass ++;
-	if ( is_filename )
-		xmlcontext = xmlCreateFileParserCtxt( filename );
-	else
-		xmlcontext = xmlCreateMemoryParserCtxt( data, strlen( data ) );
-
-	// Invalid context - clean up and return NULL
-	if ( xmlcontext == NULL )
-	{
-		context_close( context );
-		free( sax );
 		return NULL;
 	}
 
-	// Reset the stack.
-	mlt_deque_close( context->stack_service );
-	mlt_deque_close( context->stack_types );
-	mlt_deque_close( context->stack_node );
-	context->stack_service = mlt_deque_init();
-	context->stack_types = mlt_deque_init();
-	context->stack_node = mlt_deque_init();
-
 	// Create the qglsl consumer now, if requested, so that glsl.manager
 	// may exist when trying to load glsl. or movit. services.
 	// The "if requested" part can come from query string qglsl=1 or when
 	// a service beginning with glsl. or movit. appears in the XML.
-	if ( mlt_properties_get_int( context->params, "qglsl" ) && strcmp( id, "xml-nogl" )
+	if ( context->want_qglsl && strcmp( id, "xml-nogl" )
 		// Only if glslManager does not yet exist.
 		&& !mlt_properties_get_data( mlt_global_properties(), "glslManager", NULL ) )
 		context->qglsl = mlt_factory_consumer( profile, "qglsl", NULL );
 
-	// Setup SAX callbacks for second pass
-	sax->endElement = on_end_element;
-	sax->cdataBlock = on_characters;
-	sax->internalSubset = on_internal_subset;
-	sax->entityDecl = on_entity_declaration;
-	sax->getEntity = on_get_entity;
-
-	// Parse
-	sax_orig = xmlcontext->sax;
-	xmlcontext->sax = sax;
-	xmlcontext->_private = ( void* )context;
-	xmlParseDocument( xmlcontext );
-	well_formed = xmlcontext->wellFormed;
-
-	// Cleanup after parsing
-	xmlFreeDoc( context->entity_doc );
-	context->entity_doc = NULL;
-	free( sax );
-	xmlMemoryDump( ); // for debugging
-	xmlcontext->sax = sax_orig;
-	xmlcontext->_private = NULL;
-	if ( xmlcontext->myDoc )
-		xmlFreeDoc( xmlcontext->myDoc );
-	xmlFreeParserCtxt( xmlcontext );
+	// Build the services
+	replay( context );
 
 	// Get the last producer on the stack
 	enum service_type type;
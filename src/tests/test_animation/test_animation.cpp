@@ -237,6 +237,31 @@ private Q_SLOTS:
 		QCOMPARE(p.anim_get_int("foo", 60), 60);
 	}
 
+	void EditsChangeGenerationOfProperties()
+	{
+		Properties p;
+		p.set("foo", "50=100; 60=60; 100=0");
+		// Cause the string to be interpreted as animated value.
+		p.anim_get_int("foo", 0);
+		Animation a = p.get_animation("foo");
+		QVERIFY(a.is_valid());
+		int64_t generation = mlt_properties_generation(p.get_properties());
+		QCOMPARE(mlt_properties_generation(p.get_properties()), generation);
+		a.remove(60);
+		QVERIFY(mlt_properties_generation(p.get_properties()) != generation);
+		generation = mlt_properties_generation(p.get_properties());
+		a.key_set_frame(1, 90);
+		QVERIFY(mlt_properties_generation(p.get_properties()) != generation);
+		generation = mlt_properties_generation(p.get_properties());
+		a.key_set_type(0, mlt_keyframe_discrete);
+		QVERIFY(mlt_properties_generation(p.get_properties()) != generation);
+		generation = mlt_properties_generation(p.get_properties());
+		// Reading the values does not change the generation.
+		QCOMPARE(p.anim_get_int("foo", 50), 100);
+		QCOMPARE(p.anim_get_int("foo", 70), 100);
+		QCOMPARE(mlt_properties_generation(p.get_properties()), generation);
+	}
+
 	void EmptyAnimationIsInvalid()
 	{
 		Properties p;
@@ -70,6 +70,51 @@ private Q_SLOTS:
         delete frame;
     }
 
+    int RenderLuma(Producer &producer, int position)
+    {
+        mlt_image_format format = mlt_image_yuv422;
+        int width = 64;
+        int height = 64;
+        producer.seek(position);
+        Frame* frame = producer.get_frame();
+        uint8_t* image = frame->get_image(format, width, height, 0);
+        int luma = image[0];
+        delete frame;
+        return luma;
+    }
+
+    void RenderCacheSeesKeyframeEdits()
+    {
+        Profile profile("dv_pal");
+        Producer producer(profile, "color", "white");
+        Filter brightness(profile, "brightness");
+        Filter cache(profile, "rendercache");
+        brightness.set("level", "0=0.2;50=0.8");
+        producer.attach(brightness);
+        producer.attach(cache);
+
+        int before = RenderLuma(producer, 25);
+        QCOMPARE(RenderLuma(producer, 25), before);
+
+        // Insert a keyframe through the animation API
+        brightness.anim_get_double("level", 25);
+        Animation animation = brightness.get_animation("level");
+        struct mlt_animation_item_s item;
+        item.frame = 25;
+        item.is_key = 1;
+        item.keyframe_type = mlt_keyframe_linear;
+        item.property = mlt_property_init();
+        mlt_property_set_double(item.property, 0.0);
+        mlt_animation_insert(animation.get_animation(), &item);
+        mlt_property_close(item.property);
+        animation.interpolate();
+
+        int after = RenderLuma(producer, 25);
+        QVERIFY(after != before);
+        cache.set("disable", 1);
+        QCOMPARE(RenderLuma(producer, 25), after);
+    }
+
 };
 
 QTEST_APPLESS_MAIN(TestFilter)
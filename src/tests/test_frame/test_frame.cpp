@@ -25,7 +25,9 @@ class TestFrame: public QObject
     Q_OBJECT
 
 public:
-    TestFrame() {}
+    TestFrame() {
+        Factory::init();
+    }
 
 private Q_SLOTS:
     void FrameConstructorAddsReference()
@@ -93,6 +95,149 @@ private Q_SLOTS:
         QCOMPARE(f1.ref_count(), 2);
         mlt_frame_close(frame);
     }
+
+    void ImageReferencesAreCounted()
+    {
+        mlt_image image = mlt_image_new();
+        mlt_image_set_values(image, NULL, mlt_image_rgb24a, 4, 2);
+        mlt_image_alloc_data(image);
+        QVERIFY(image->data != NULL);
+        QVERIFY(mlt_image_is_writable(image));
+        QCOMPARE(mlt_image_inc_ref(image), 2);
+        QVERIFY(!mlt_image_is_writable(image));
+        mlt_image_close(image);
+        QVERIFY(mlt_image_is_writable(image));
+        mlt_image copy = mlt_image_copy(image);
+        QVERIFY(copy->data != image->data);
+        QCOMPARE(copy->format, mlt_image_rgb24a);
+        QCOMPARE(copy->width, 4);
+        QCOMPARE(copy->height, 2);
+        mlt_image_close(copy);
+        mlt_image_close(image);
+    }
+
+    void SharedImageIsCopiedBeforeWriting()
+    {
+        mlt_image image = mlt_image_new();
+        mlt_image_set_values(image, NULL, mlt_image_yuv422, 4, 2);
+        mlt_image_alloc_data(image);
+        mlt_image_alloc_alpha(image);
+        memset(image->data, 100, mlt_image_calculate_size(image));
+        memset(image->alpha, 200, 4 * 2);
+        mlt_frame frame = mlt_frame_init(NULL);
+        QCOMPARE(mlt_frame_set_shared_image(frame, image), 0);
+        QCOMPARE(image->ref_count, 2);
+
+        mlt_image shared = NULL;
+        mlt_image_format format = mlt_image_yuv422;
+        int width = 0;
+        int height = 0;
+        QCOMPARE(mlt_frame_get_shared_image(frame, &shared, &format, &width, &height), 0);
+        QCOMPARE(shared, image);
+        QCOMPARE(image->ref_count, 3);
+        QCOMPARE(width, 4);
+        QCOMPARE(height, 2);
+        mlt_image_close(shared);
+
+        uint8_t* buffer = NULL;
+        QCOMPARE(mlt_frame_get_image(frame, &buffer, &format, &width, &height, 1), 0);
+        QVERIFY(buffer != image->data);
+        buffer[0] = 1;
+        uint8_t* alpha = mlt_frame_get_alpha_mask(frame);
+        QVERIFY(alpha != image->alpha);
+        alpha[0] = 1;
+        QCOMPARE(((uint8_t*) image->data)[0], uint8_t(100));
+        QCOMPARE(((uint8_t*) image->alpha)[0], uint8_t(200));
+
+        mlt_frame_close(frame);
+        QCOMPARE(image->ref_count, 1);
+        mlt_image_close(image);
+    }
+
+    void WritingDeepCloneImageLeavesSource()
+    {
+        mlt_frame frame = mlt_frame_init(NULL);
+        mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+        uint8_t* image = (uint8_t*) mlt_pool_alloc(4 * 2 * 2);
+        uint8_t* alpha = (uint8_t*) mlt_pool_alloc(4 * 2);
+        memset(image, 100, 4 * 2 * 2);
+        memset(alpha, 200, 4 * 2);
+        mlt_frame_set_image(frame, image, 4 * 2 * 2, mlt_pool_release);
+        mlt_frame_set_alpha(frame, alpha, 4 * 2, mlt_pool_release);
+        mlt_properties_set_int(properties, "format", mlt_image_yuv422);
+        mlt_properties_set_int(properties, "width", 4);
+        mlt_properties_set_int(properties, "height", 2);
+
+        // Writing to the clone leaves the source unchanged
+        mlt_frame clone = mlt_frame_clone(frame, 1);
+        QVERIFY(mlt_properties_is_shared(MLT_FRAME_PROPERTIES(clone), "image"));
+        uint8_t* buffer = NULL;
+        mlt_image_format format = mlt_image_yuv422;
+        int width = 4;
+        int height = 2;
+        QCOMPARE(mlt_frame_get_image(clone, &buffer, &format, &width, &height, 1), 0);
+        QVERIFY(buffer != image);
+        memset(buffer, 1, 4 * 2 * 2);
+        uint8_t* clone_alpha = mlt_frame_get_alpha_mask(clone);
+        QVERIFY(clone_alpha != alpha);
+        memset(clone_alpha, 1, 4 * 2);
+        QCOMPARE(image[0], uint8_t(100));
+        QCOMPARE(image[4 * 2 * 2 - 1], uint8_t(100));
+        QCOMPARE(alpha[0], uint8_t(200));
+        QCOMPARE(alpha[4 * 2 - 1], uint8_t(200));
+        QCOMPARE(mlt_properties_get_data(properties, "image", NULL), (void*) image);
+        QCOMPARE(mlt_properties_ref_count(properties), 1);
+        mlt_frame_close(clone);
+        QVERIFY(!mlt_properties_is_shared(properties, "image"));
+
+        // and the reverse
+        clone = mlt_frame_clone(frame, 1);
+        width = 4;
+        height = 2;
+        QCOMPARE(mlt_frame_get_image(frame, &buffer, &format, &width, &height, 1), 0);
+        QVERIFY(buffer != image);
+        memset(buffer, 2, 4 * 2 * 2);
+        uint8_t* clone_image = (uint8_t*) mlt_properties_get_data(MLT_FRAME_PROPERTIES(clone), "image", NULL);
+        QCOMPARE(clone_image, image);
+        QCOMPARE(clone_image[0], uint8_t(100));
+        mlt_frame_close(clone);
+        mlt_frame_close(frame);
+    }
+
+    void ConvertingCloneAudioLeavesSource()
+    {
+        Profile profile;
+        Filter convert(profile, "audioconvert");
+        QVERIFY(convert.is_valid());
+        mlt_frame frame = mlt_frame_init(NULL);
+        mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+        int32_t* audio = (int32_t*) mlt_pool_alloc(4 * 2 * sizeof(int32_t));
+        for (int i = 0; i < 4 * 2; i++)
+            audio[i] = i << 16;
+        mlt_frame_set_audio(frame, audio, mlt_audio_s32le, 4 * 2 * sizeof(int32_t), mlt_pool_release);
+        mlt_properties_set_int(properties, "audio_frequency", 48000);
+        mlt_properties_set_int(properties, "audio_channels", 2);
+        mlt_properties_set_int(properties, "audio_samples", 4);
+
+        // s32le converts to s16 in place unless the buffer is shared
+        mlt_frame clone = mlt_frame_clone(frame, 1);
+        mlt_filter_process(convert.get_filter(), clone);
+        void* buffer = NULL;
+        mlt_audio_format format = mlt_audio_s16;
+        int frequency = 48000;
+        int channels = 2;
+        int samples = 4;
+        QCOMPARE(mlt_frame_get_audio(clone, &buffer, &format, &frequency, &channels, &samples), 0);
+        QCOMPARE(format, mlt_audio_s16);
+        QVERIFY(buffer != (void*) audio);
+        QCOMPARE(((int16_t*) buffer)[3], int16_t(3));
+        QCOMPARE(mlt_properties_get_int(properties, "audio_format"), int(mlt_audio_s32le));
+        QCOMPARE(mlt_properties_get_data(properties, "audio", NULL), (void*) audio);
+        for (int i = 0; i < 4 * 2; i++)
+            QCOMPARE(audio[i], i << 16);
+        mlt_frame_close(clone);
+        mlt_frame_close(frame);
+    }
 };
 
 QTEST_APPLESS_MAIN(TestFrame)
@@ -1135,6 +1135,64 @@ private Q_SLOTS:
         QCOMPARE(p.get_int("foo"), 123);
         QCOMPARE(p.get_double("foo"), 123.4);
     }
+
+    void CloneSharesUntilWritten()
+    {
+        Properties a;
+        Properties b;
+        a.set("key", "1");
+        a.set("n", 5);
+        QCOMPARE(mlt_properties_clone(b.get_properties(), a.get_properties()), 0);
+        QVERIFY(mlt_properties_is_shared(a.get_properties(), "key"));
+        QVERIFY(mlt_properties_is_shared(b.get_properties(), "key"));
+        QVERIFY(!mlt_properties_is_shared(b.get_properties(), "missing"));
+        QCOMPARE(b.get("key"), "1");
+        QCOMPARE(b.count(), 2);
+
+        // Writing to the clone leaves the source unchanged
+        b.set("key", "2");
+        QCOMPARE(a.get("key"), "1");
+        QCOMPARE(b.get("key"), "2");
+
+        // and the reverse
+        a.set("n", 6);
+        a.set("new", "x");
+        QCOMPARE(a.get_int("n"), 6);
+        QCOMPARE(b.get_int("n"), 5);
+        QCOMPARE(b.get("new"), (char*) 0);
+        QCOMPARE(b.count(), 2);
+    }
+
+    void ClosingCloneUnsharesProperties()
+    {
+        Properties a;
+        a.set("key", "1");
+        Properties* b = new Properties;
+        mlt_properties_clone(b->get_properties(), a.get_properties());
+        QVERIFY(mlt_properties_is_shared(a.get_properties(), "key"));
+        delete b;
+        QVERIFY(!mlt_properties_is_shared(a.get_properties(), "key"));
+        QCOMPARE(a.get("key"), "1");
+    }
+
+    void SharedPropertyKeepsData()
+    {
+        Properties p;
+        char* data = strdup("abc");
+        p.set("data", data, 4, free);
+        mlt_property property = mlt_properties_share_property(p.get_properties(), "data");
+        QCOMPARE(mlt_property_ref_count(property), 2);
+        QVERIFY(mlt_properties_is_shared(p.get_properties(), "data"));
+        QCOMPARE(mlt_property_inc_ref(property), 3);
+        mlt_property_close(property);
+        QCOMPARE(mlt_property_ref_count(property), 2);
+
+        // Replacing the value releases the list's reference only
+        p.set("data", "x");
+        QCOMPARE(mlt_property_ref_count(property), 1);
+        QCOMPARE(mlt_property_get_data(property, NULL), (void*) data);
+        mlt_property_close(property);
+    }
 };
 
 QTEST_APPLESS_MAIN(TestProperties)
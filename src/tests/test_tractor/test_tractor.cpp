@@ -402,6 +402,33 @@ private Q_SLOTS:
         QCOMPARE(t.count(), 1);
         QCOMPARE(filter.get_track(), 0);
     }
+
+    void CompositeBlendsEveryColumnOfUnevenBox()
+    {
+        Tractor t(profile);
+        Producer background(profile, "color:black");
+        Producer box(profile, "color:0x80ffffff");
+        t.set_track(background, 0);
+        t.set_track(box, 1);
+
+        // An odd x misaligns the chroma of the box and the background
+        Transition trans(profile, "composite", "5/10:100x50");
+        trans.set("distort", 1);
+        t.plant_transition(trans, 0, 1);
+
+        Frame* frame = t.get_frame();
+        mlt_image_format format = mlt_image_yuv422;
+        int width = profile.width();
+        int height = profile.height();
+        uint8_t* image = frame->get_image(format, width, height, 0);
+        QVERIFY(image);
+        uint8_t* row = image + 20 * width * 2;
+        QCOMPARE(int(row[4 * 2]), 16);
+        QVERIFY(row[5 * 2] > 16);
+        QCOMPARE(row[104 * 2], row[5 * 2]);
+        QCOMPARE(int(row[105 * 2]), 16);
+        delete frame;
+    }
 };
 
 QTEST_APPLESS_MAIN(TestTractor)
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2020 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with consumer library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest>
+#include <mlt++/Mlt.h>
+using namespace Mlt;
+
+class TestXml : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestXml()
+    {
+        // Let independent producers be created on several threads
+        qputenv("MLT_SLICES_COUNT", "4");
+        repo = Factory::init();
+    }
+
+    ~TestXml()
+    {
+        Factory::close();
+    }
+
+private:
+    QString ToXml(Profile &profile, Service &service)
+    {
+        Consumer consumer(profile, "xml", "string");
+        consumer.connect(service);
+        consumer.start();
+        return QString::fromUtf8(consumer.get("string"));
+    }
+
+private Q_SLOTS:
+    void BinaryDataRoundTrip()
+    {
+        Profile profile;
+        Producer producer(profile, "color", "red");
+        Filter filter(profile, "brightness");
+        filter.set("level", "0=0.2;50=0.8");
+        producer.attach(filter);
+        Playlist playlist(profile);
+        playlist.append(producer, 10, 40);
+        playlist.blank(9);
+        playlist.append(producer);
+        QString xml = ToXml(profile, playlist);
+
+        // Without an extension the document is kept in a data property
+        Consumer consumer(profile, "mlt_binary", "snapshot");
+        consumer.connect(playlist);
+        consumer.start();
+        int size = 0;
+        const char* data = static_cast<const char*>(consumer.get_data("snapshot", size));
+        QVERIFY(data);
+        QVERIFY(size > 0);
+
+        Producer restored(profile, "mlt_binary-string", data);
+        QVERIFY(restored.is_valid());
+        QCOMPARE(ToXml(profile, restored), xml);
+    }
+
+    void BinaryDataRejectsOtherData()
+    {
+        Profile profile;
+        Producer producer(profile, "mlt_binary-string", "<mlt/>");
+        QVERIFY(!producer.is_valid());
+    }
+
+    void LoadsAvformatProducersInParallel()
+    {
+        Profile profile("dv_pal");
+        QTemporaryDir dir;
+        QString clip = dir.filePath("clip.mkv");
+        Consumer consumer(profile, "avformat", clip.toUtf8().constData());
+        if (!consumer.is_valid())
+            QSKIP("avformat is not available");
+        consumer.set("vcodec", "ffv1");
+        consumer.set("acodec", "pcm_s16le");
+        consumer.set("real_time", -1);
+        consumer.set("terminate_on_pause", 1);
+        Producer color(profile, "color:red");
+        color.set_in_and_out(0, 24);
+        consumer.connect(color);
+        consumer.run();
+
+        QString xml = "<mlt>";
+        for (int i = 0; i < 8; i++)
+            xml += QString("<producer id=\"p%1\" out=\"24\">"
+                           "<property name=\"mlt_service\">avformat</property>"
+                           "<property name=\"resource\">%2</property></producer>").arg(i).arg(clip);
+        xml += "<playlist id=\"playlist\">";
+        for (int i = 0; i < 8; i++)
+            xml += QString("<entry producer=\"p%1\"/>").arg(i);
+        xml += "</playlist></mlt>";
+
+        Producer producer(profile, "xml-string", xml.toUtf8().constData());
+        QVERIFY(producer.is_valid());
+        QCOMPARE(producer.get_playtime(), 8 * 25);
+        Playlist playlist(producer);
+        QVERIFY(playlist.is_valid());
+        QCOMPARE(playlist.count(), 8);
+        for (int i = 0; i < playlist.count(); i++) {
+            Producer* clip_producer = playlist.get_clip(i);
+            QVERIFY(clip_producer);
+            QCOMPARE(QString(clip_producer->parent().get("resource")), clip);
+            QVERIFY(clip_producer->parent().get_int("meta.media.nb_streams") > 0);
+            delete clip_producer;
+        }
+    }
+
+private:
+    Repository* repo;
+};
+
+QTEST_APPLESS_MAIN(TestXml)
+
+#include "test_xml.moc"
@@ -0,0 +1,3 @@
+include(../common.pri)
+TARGET = test_xml
+SOURCES += test_xml.cpp